@@ -466,12 +466,26 @@ void Plane::update_dynamic_notch()
                 ins.update_harmonic_notch_freq_hz(ref_freq);
             }
             break;
-#ifdef HAVE_AP_BLHELI_SUPPORT
-        case HarmonicNotchDynamicMode::UpdateBLHeli: // BLHeli based tracking
+        case HarmonicNotchDynamicMode::UpdateBLHeli: // ESC telemetry based tracking
             // set the harmonic notch filter frequency scaled on measured frequency
-            if (ins.has_harmonic_option(HarmonicNotchFilterParams::Options::DynamicHarmonic)) {
+            if (ins.has_harmonic_option(HarmonicNotchFilterParams::Options::PerMotor)) {
+                float motor_freqs[INS_MAX_MOTOR_NOTCHES];
+                const uint8_t num_motors = AP::esc_telem().get_motor_frequencies_hz(INS_MAX_MOTOR_NOTCHES, motor_freqs);
+
+                for (uint8_t i = 0; i < num_motors; i++) {
+                    motor_freqs[i] = MAX(ref_freq, motor_freqs[i]);
+                }
+                ins.update_motor_notch_frequencies_hz(num_motors, motor_freqs);
+                if (num_motors == 0) {    // throttle fallback
+                    if (quadplane.available()) {
+                        ins.update_harmonic_notch_freq_hz(ref_freq * MAX(1.0f, sqrtf(quadplane.motors->get_throttle_out() / ref)));
+                    } else {
+                        ins.update_harmonic_notch_freq_hz(ref_freq);
+                    }
+                }
+            } else if (ins.has_harmonic_option(HarmonicNotchFilterParams::Options::DynamicHarmonic)) {
                 float notches[INS_MAX_NOTCHES];
-                const uint8_t num_notches = AP_BLHeli::get_singleton()->get_motor_frequencies_hz(INS_MAX_NOTCHES, notches);
+                const uint8_t num_notches = AP::esc_telem().get_motor_frequencies_hz(INS_MAX_NOTCHES, notches);
 
                 for (uint8_t i = 0; i < num_notches; i++) {
                     notches[i] =  MAX(ref_freq, notches[i]);
@@ -484,10 +498,9 @@ void Plane::update_dynamic_notch()
                     ins.update_harmonic_notch_freq_hz(ref_freq);
                 }
             } else {
-                ins.update_harmonic_notch_freq_hz(MAX(ref_freq, AP_BLHeli::get_singleton()->get_average_motor_frequency_hz() * ref));
+                ins.update_harmonic_notch_freq_hz(MAX(ref_freq, AP::esc_telem().get_average_motor_frequency_hz() * ref));
             }
             break;
-#endif
 #if HAL_GYROFFT_ENABLED
         case HarmonicNotchDynamicMode::UpdateGyroFFT: // FFT based tracking
             // set the harmonic notch filter frequency scaled on measured frequency
@@ -302,6 +302,27 @@ void LR_MsgHandler_RBOH::process_message(uint8_t *msgbytes)
     AP::dal().handle_message(msg, ekf2, ekf3);
 }
 
+void LR_MsgHandler_RDLT::process_message(uint8_t *msgbytes)
+{
+    MSG_CREATE(RDLT, msgbytes);
+    decoder.feed(msg);
+
+    // handlers copy the whole structure, including _end and padding
+    uint8_t buf[3+DAL_DELTA_MAX_MSG_SIZE+8] {};
+    buf[0] = HEAD_BYTE1;
+    buf[1] = HEAD_BYTE2;
+    uint8_t size;
+    while (decoder.next(buf[2], &buf[3], size)) {
+        if (buf[2] >= LOGREADER_MAX_FORMATS) {
+            continue;
+        }
+        LR_MsgHandler *p = msgparser[buf[2]];
+        if (p != nullptr) {
+            p->process_message(buf);
+        }
+    }
+}
+
 void LR_MsgHandler_REPH::process_message(uint8_t *msgbytes)
 {
     MSG_CREATE(REPH, msgbytes);
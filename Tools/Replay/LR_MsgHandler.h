@@ -5,6 +5,7 @@
 #include <AP_GPS/AP_GPS.h>
 #include <AP_NavEKF2/AP_NavEKF2.h>
 #include <AP_NavEKF3/AP_NavEKF3.h>
+#include <AP_DAL/AP_DAL_DeltaStream.h>
 
 class LR_MsgHandler : public MsgHandler {
 public:
@@ -75,6 +76,22 @@ class LR_MsgHandler_RBOH : public LR_MsgHandler_EKF
     void process_message(uint8_t *msg) override;
 };
 
+/*
+  delta encoded replay data. The messages in the stream are passed to
+  the handlers for their types
+ */
+class LR_MsgHandler_RDLT : public LR_MsgHandler
+{
+public:
+    LR_MsgHandler_RDLT(struct log_Format &_f, LR_MsgHandler **_msgparser) :
+        LR_MsgHandler(_f),
+        msgparser(_msgparser) {}
+    void process_message(uint8_t *msg) override;
+private:
+    LR_MsgHandler **msgparser;
+    AP_DAL_DeltaDecoder decoder;
+};
+
 class LR_MsgHandler_RFRN : public LR_MsgHandler
 {
 public:
@@ -0,0 +1,806 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LogExport.h"
+#include "MsgHandler.h"
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/getopt_cpp.h>
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+#include <AP_HAL_Linux/Scheduler.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+template <typename T>
+static T read_value(const uint8_t *p)
+{
+    T v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void append_uint(std::string &s, uint64_t v)
+{
+    char buf[20];
+    char *p = buf + sizeof(buf);
+    do {
+        *--p = '0' + v % 10;
+        v /= 10;
+    } while (v != 0);
+    s.append(p, buf + sizeof(buf) - p);
+}
+
+static void append_int(std::string &s, int64_t v)
+{
+    if (v < 0) {
+        s += '-';
+        append_uint(s, -(uint64_t)v);
+    } else {
+        append_uint(s, v);
+    }
+}
+
+// append a value held as an integer scaled by 10^places, exactly
+static void append_fixed(std::string &s, int64_t v, uint8_t places)
+{
+    uint64_t magnitude = v;
+    if (v < 0) {
+        s += '-';
+        magnitude = -(uint64_t)v;
+    }
+    uint64_t divisor = 1;
+    for (uint8_t i = 0; i < places; i++) {
+        divisor *= 10;
+    }
+    append_uint(s, magnitude / divisor);
+    s += '.';
+    char frac[20];
+    uint64_t remainder = magnitude % divisor;
+    for (int8_t i = places-1; i >= 0; i--) {
+        frac[i] = '0' + remainder % 10;
+        remainder /= 10;
+    }
+    s.append(frac, places);
+}
+
+static void append_double(std::string &s, double v, uint8_t precision)
+{
+    char buf[32];
+    const int n = snprintf(buf, sizeof(buf), "%.*g", precision, v);
+    s.append(buf, n);
+}
+
+// append a NUL padded string field, quoted if it needs to be
+static void append_string(std::string &s, const uint8_t *p, uint8_t length)
+{
+    const char *str = (const char *)p;
+    const size_t len = strnlen(str, length);
+    if (strcspn(str, ",\"\n") >= len) {
+        s.append(str, len);
+        return;
+    }
+    s += '"';
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] == '"') {
+            s += '"';
+        }
+        s += str[i];
+    }
+    s += '"';
+}
+
+LogExporter::~LogExporter()
+{
+    for (Type &type : _types) {
+        if (type.csv != nullptr) {
+            fclose(type.csv);
+        }
+        if (type.columnar != nullptr) {
+            fclose(type.columnar);
+        }
+    }
+    if (_log != nullptr) {
+        munmap((void *)_log, _log_size);
+    }
+}
+
+bool LogExporter::map_log(const char *filename)
+{
+    const int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        ::printf("open(%s): %m\n", filename);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::printf("%s: empty or unreadable log\n", filename);
+        close(fd);
+        return false;
+    }
+    _log_size = st.st_size;
+    void *p = mmap(nullptr, _log_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        ::printf("mmap(%s): %m\n", filename);
+        return false;
+    }
+    madvise(p, _log_size, MADV_SEQUENTIAL);
+    _log = (const uint8_t *)p;
+    return true;
+}
+
+/*
+  return the length of the message at msg, or zero if there is not a
+  complete message of a known type there
+ */
+uint8_t LogExporter::message_length(const uint8_t *msg, size_t remaining) const
+{
+    if (remaining < 3 || msg[0] != HEAD_BYTE1 || msg[1] != HEAD_BYTE2) {
+        return 0;
+    }
+    const uint8_t length = msg[2] == LOG_FORMAT_MSG ? sizeof(struct log_Format) : _types[msg[2]].format.length;
+    if (length < 3 || length > remaining) {
+        return 0;
+    }
+    return length;
+}
+
+/*
+  walk the message headers of the whole log, collecting the metadata
+  messages and the offset of the first message of each chunk. Bytes
+  that are not a message are skipped, as the decoders will also do
+ */
+bool LogExporter::frame_log()
+{
+    _chunks.clear();
+    _chunks.push_back(0);
+    size_t next_chunk = _options.chunk_size;
+    size_t pos = 0;
+    uint64_t messages = 0;
+
+    while (pos < _log_size) {
+        const uint8_t *msg = &_log[pos];
+        const uint8_t length = message_length(msg, _log_size - pos);
+        if (length == 0) {
+            pos++;
+            continue;
+        }
+        if (pos >= next_chunk) {
+            _chunks.push_back(pos);
+            next_chunk = pos + _options.chunk_size;
+        }
+        switch (msg[2]) {
+        case LOG_FORMAT_MSG: {
+            struct log_Format f;
+            memcpy(&f, msg, sizeof(f));
+            handle_format(f);
+            break;
+        }
+        case LOG_FORMAT_UNITS_MSG:
+            handle_format_units(msg);
+            break;
+        case LOG_UNIT_MSG:
+            handle_unit(msg);
+            break;
+        case LOG_MULT_MSG:
+            handle_multiplier(msg);
+            break;
+        }
+        messages++;
+        pos += length;
+    }
+    return messages > 0;
+}
+
+void LogExporter::handle_format(const struct log_Format &f)
+{
+    Type &type = _types[f.type];
+    if (type.defined) {
+        // types are not redefined within a log, so keep the first
+        // definition the chunks were framed with
+        return;
+    }
+    type.defined = true;
+    type.format = f;
+    memcpy(type.name, f.name, sizeof(f.name));
+    type.name[4] = 0;
+    memset(type.units, '-', sizeof(type.units));
+    memset(type.multipliers, '-', sizeof(type.multipliers));
+}
+
+void LogExporter::handle_format_units(const uint8_t *msg)
+{
+    if (_types[LOG_FORMAT_UNITS_MSG].format.length != sizeof(struct log_Format_Units)) {
+        return;
+    }
+    struct log_Format_Units fu;
+    memcpy(&fu, msg, sizeof(fu));
+    Type &type = _types[fu.format_type];
+    memcpy(type.units, fu.units, sizeof(type.units));
+    memcpy(type.multipliers, fu.multipliers, sizeof(type.multipliers));
+}
+
+void LogExporter::handle_unit(const uint8_t *msg)
+{
+    if (_types[LOG_UNIT_MSG].format.length != sizeof(struct log_Unit)) {
+        return;
+    }
+    struct log_Unit u;
+    memcpy(&u, msg, sizeof(u));
+    _unit_names[(uint8_t)u.type] = std::string(u.unit, strnlen(u.unit, sizeof(u.unit)));
+}
+
+void LogExporter::handle_multiplier(const uint8_t *msg)
+{
+    if (_types[LOG_MULT_MSG].format.length != sizeof(struct log_Format_Multiplier)) {
+        return;
+    }
+    struct log_Format_Multiplier m;
+    memcpy(&m, msg, sizeof(m));
+    _multipliers[(uint8_t)m.type] = m.multiplier;
+    _have_multiplier[(uint8_t)m.type] = true;
+}
+
+/*
+  get the layout of the fields of a type from the Replay message handler
+ */
+void LogExporter::setup_columns(Type &type)
+{
+    MsgHandler handler(type.format);
+    type.columns.clear();
+    type.time_offset = 0;
+    for (uint8_t i = 0; i < handler.num_fields(); i++) {
+        const struct MsgHandler::format_field_info &info = handler.field(i);
+        if (info.offset + info.length > type.format.length) {
+            ::printf("%s: fields are longer than the message, skipping\n", type.name);
+            type.columns.clear();
+            return;
+        }
+        Column c;
+        c.label = info.label;
+        c.type = info.type;
+        c.offset = info.offset;
+        c.length = info.length;
+        switch (c.type) {
+        case 'c':
+        case 'C':
+        case 'e':
+        case 'E':
+            c.scale = 0.01;
+            break;
+        case 'L':
+            c.scale = 1.0e-7;
+            break;
+        default:
+            c.scale = 1;
+            break;
+        }
+        if (i == 0 && c.label == "TimeUS" && c.type == 'Q') {
+            type.time_offset = c.offset;
+        }
+        type.columns.push_back(c);
+    }
+}
+
+void LogExporter::select_types()
+{
+    for (Type &type : _types) {
+        if (!type.defined) {
+            continue;
+        }
+        setup_columns(type);
+        type.selected = !type.columns.empty();
+        if (type.selected && _options.types != nullptr) {
+            const size_t len = strlen(type.name);
+            const char *p = _options.types;
+            bool found = false;
+            while (*p != 0 && !found) {
+                const size_t n = strcspn(p, ",");
+                found = n == len && strncmp(p, type.name, n) == 0;
+                p += n;
+                if (*p == ',') {
+                    p++;
+                }
+            }
+            type.selected = found;
+        }
+    }
+}
+
+/*
+  decode the messages of one chunk into its output
+ */
+void LogExporter::decode_chunk(uint32_t chunk, ChunkOutput &output) const
+{
+    for (uint16_t i = 0; i < LOGEXPORT_MAX_TYPES; i++) {
+        output.csv[i].clear();
+        output.rows[i].clear();
+        output.columns[i].clear();
+        output.num_rows[i] = 0;
+    }
+    output.messages = 0;
+    output.skipped_bytes = 0;
+
+    const bool csv = _options.formats & CSV;
+    const bool columnar = _options.formats & COLUMNAR;
+    size_t pos = _chunks[chunk];
+    const size_t end = chunk+1 < _chunks.size() ? _chunks[chunk+1] : _log_size;
+
+    while (pos < end) {
+        const uint8_t *msg = &_log[pos];
+        const uint8_t length = message_length(msg, _log_size - pos);
+        if (length == 0) {
+            output.skipped_bytes++;
+            pos++;
+            continue;
+        }
+        pos += length;
+        output.messages++;
+
+        const uint8_t type_id = msg[2];
+        const Type &type = _types[type_id];
+        if (!type.selected) {
+            continue;
+        }
+        if (type.time_offset != 0) {
+            const uint64_t time_us = read_value<uint64_t>(&msg[type.time_offset]);
+            if (time_us < _options.start_us || time_us > _options.end_us) {
+                continue;
+            }
+        }
+        if (csv) {
+            append_csv_row(type, msg, output.csv[type_id]);
+        }
+        if (columnar) {
+            output.rows[type_id].append((const char *)&msg[3], length-3);
+        }
+        output.num_rows[type_id]++;
+    }
+
+    if (columnar) {
+        for (uint16_t i = 0; i < LOGEXPORT_MAX_TYPES; i++) {
+            if (output.num_rows[i] > 0) {
+                transpose_rows(_types[i], output.rows[i], output.num_rows[i], output.columns[i]);
+            }
+        }
+    }
+}
+
+void LogExporter::append_csv_row(const Type &type, const uint8_t *msg, std::string &csv) const
+{
+    for (uint8_t i = 0; i < type.columns.size(); i++) {
+        const Column &c = type.columns[i];
+        const uint8_t *p = &msg[c.offset];
+        if (i != 0) {
+            csv += ',';
+        }
+        switch (c.type) {
+        case 'b':
+            append_int(csv, read_value<int8_t>(p));
+            break;
+        case 'B':
+        case 'M':
+            append_uint(csv, read_value<uint8_t>(p));
+            break;
+        case 'h':
+            append_int(csv, read_value<int16_t>(p));
+            break;
+        case 'H':
+            append_uint(csv, read_value<uint16_t>(p));
+            break;
+        case 'i':
+            append_int(csv, read_value<int32_t>(p));
+            break;
+        case 'I':
+            append_uint(csv, read_value<uint32_t>(p));
+            break;
+        case 'q':
+            append_int(csv, read_value<int64_t>(p));
+            break;
+        case 'Q':
+            append_uint(csv, read_value<uint64_t>(p));
+            break;
+        case 'c':
+            append_fixed(csv, read_value<int16_t>(p), 2);
+            break;
+        case 'C':
+            append_fixed(csv, read_value<uint16_t>(p), 2);
+            break;
+        case 'e':
+            append_fixed(csv, read_value<int32_t>(p), 2);
+            break;
+        case 'E':
+            append_fixed(csv, read_value<uint32_t>(p), 2);
+            break;
+        case 'L':
+            append_fixed(csv, read_value<int32_t>(p), 7);
+            break;
+        case 'f':
+            append_double(csv, read_value<float>(p), 9);
+            break;
+        case 'd':
+            append_double(csv, read_value<double>(p), 17);
+            break;
+        case 'n':
+        case 'N':
+        case 'Z':
+            append_string(csv, p, c.length);
+            break;
+        case 'a':
+            // one cell of space separated values
+            for (uint8_t j = 0; j < c.length / sizeof(int16_t); j++) {
+                if (j != 0) {
+                    csv += ' ';
+                }
+                append_int(csv, read_value<int16_t>(&p[j * sizeof(int16_t)]));
+            }
+            break;
+        }
+    }
+    csv += '\n';
+}
+
+/*
+  turn the payloads of the messages of a type into one array per field
+ */
+void LogExporter::transpose_rows(const Type &type, const std::string &rows, uint32_t num_rows, std::string &columns) const
+{
+    const uint8_t payload_length = type.format.length - 3;
+    size_t row_length = 0;
+    for (const Column &c : type.columns) {
+        row_length += c.length;
+    }
+    columns.resize(row_length * num_rows);
+
+    const uint8_t *src = (const uint8_t *)rows.data();
+    uint8_t *dst = (uint8_t *)&columns[0];
+    for (const Column &c : type.columns) {
+        const uint8_t *field = src + c.offset - 3;
+        for (uint32_t r = 0; r < num_rows; r++) {
+            memcpy(dst, field, c.length);
+            dst += c.length;
+            field += payload_length;
+        }
+    }
+}
+
+/*
+  decode count chunks from first on all threads
+ */
+void LogExporter::decode_chunks(std::vector<ChunkOutput> &outputs, uint32_t first, uint32_t count)
+{
+    std::atomic<uint32_t> next {0};
+    auto worker = [&]() {
+        uint32_t i;
+        while ((i = next++) < count) {
+            decode_chunk(first + i, outputs[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (uint8_t i = 1; i < _options.num_threads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &t : threads) {
+        t.join();
+    }
+}
+
+bool LogExporter::open_outputs(uint8_t type_id)
+{
+    Type &type = _types[type_id];
+    char path[PATH_MAX];
+
+    if ((_options.formats & CSV) && type.csv == nullptr) {
+        snprintf(path, sizeof(path), "%s/%s.csv", _options.output_dir, type.name);
+        type.csv = fopen(path, "w");
+        if (type.csv == nullptr) {
+            ::printf("open(%s): %m\n", path);
+            return false;
+        }
+        for (uint8_t i = 0; i < type.columns.size(); i++) {
+            fprintf(type.csv, "%s%s", i == 0 ? "" : ",", type.columns[i].label.c_str());
+        }
+        fputc('\n', type.csv);
+    }
+    if ((_options.formats & COLUMNAR) && type.columnar == nullptr) {
+        snprintf(path, sizeof(path), "%s/%s.col", _options.output_dir, type.name);
+        type.columnar = fopen(path, "w");
+        if (type.columnar == nullptr) {
+            ::printf("open(%s): %m\n", path);
+            return false;
+        }
+        if (!write_columnar_header(type)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LogExporter::write_columnar_header(const Type &type)
+{
+    std::string header("APLOGCOL", 8);
+    header += char(1);
+    header.append(type.format.name, sizeof(type.format.name));
+    header += char(type.columns.size());
+    for (uint8_t i = 0; i < type.columns.size(); i++) {
+        const Column &c = type.columns[i];
+        header += char(c.label.size());
+        header += c.label;
+        header += c.type;
+        header += char(c.length);
+        header.append((const char *)&c.scale, sizeof(c.scale));
+
+        double multiplier = nan("");
+        std::string unit;
+        if (i < sizeof(type.multipliers) && _have_multiplier[(uint8_t)type.multipliers[i]]) {
+            multiplier = _multipliers[(uint8_t)type.multipliers[i]];
+        }
+        if (i < sizeof(type.units)) {
+            unit = _unit_names[(uint8_t)type.units[i]];
+        }
+        header.append((const char *)&multiplier, sizeof(multiplier));
+        header += char(unit.size());
+        header += unit;
+    }
+    return fwrite(header.data(), header.size(), 1, type.columnar) == 1;
+}
+
+/*
+  append the output of count decoded chunks to the files, in log order
+ */
+bool LogExporter::write_outputs(std::vector<ChunkOutput> &outputs, uint32_t count)
+{
+    for (uint32_t c = 0; c < count; c++) {
+        ChunkOutput &output = outputs[c];
+        _messages += output.messages;
+        _skipped_bytes += output.skipped_bytes;
+        for (uint16_t i = 0; i < LOGEXPORT_MAX_TYPES; i++) {
+            const uint32_t num_rows = output.num_rows[i];
+            if (num_rows == 0) {
+                continue;
+            }
+            if (!open_outputs(i)) {
+                return false;
+            }
+            Type &type = _types[i];
+            if (type.csv != nullptr &&
+                fwrite(output.csv[i].data(), output.csv[i].size(), 1, type.csv) != 1) {
+                ::printf("%s.csv: write failed: %m\n", type.name);
+                return false;
+            }
+            if (type.columnar != nullptr &&
+                (fwrite(&num_rows, sizeof(num_rows), 1, type.columnar) != 1 ||
+                 fwrite(output.columns[i].data(), output.columns[i].size(), 1, type.columnar) != 1)) {
+                ::printf("%s.col: write failed: %m\n", type.name);
+                return false;
+            }
+            type.rows += num_rows;
+            _exported_rows += num_rows;
+        }
+    }
+    return true;
+}
+
+bool LogExporter::run(const char *filename)
+{
+    const auto start = std::chrono::steady_clock::now();
+    _messages = 0;
+    _skipped_bytes = 0;
+    _exported_rows = 0;
+
+    if (!map_log(filename)) {
+        return false;
+    }
+    if (!frame_log()) {
+        ::printf("%s: no messages found\n", filename);
+        return false;
+    }
+    select_types();
+    const auto framed = std::chrono::steady_clock::now();
+
+    // decode a batch of chunks while the batch before is written
+    const uint32_t num_chunks = _chunks.size();
+    const uint32_t batch = MAX(_options.num_threads, 1U) * 2;
+    std::vector<ChunkOutput> outputs[2] { std::vector<ChunkOutput>(batch), std::vector<ChunkOutput>(batch) };
+
+    decode_chunks(outputs[0], 0, MIN(batch, num_chunks));
+    for (uint32_t first = 0, n = 0; first < num_chunks; first += batch, n++) {
+        const uint32_t next_first = first + batch;
+        std::thread decoder;
+        if (next_first < num_chunks) {
+            decoder = std::thread(&LogExporter::decode_chunks, this, std::ref(outputs[(n+1)%2]),
+                                  next_first, MIN(batch, num_chunks - next_first));
+        }
+        const bool ok = write_outputs(outputs[n%2], MIN(batch, num_chunks - first));
+        if (decoder.joinable()) {
+            decoder.join();
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    for (Type &type : _types) {
+        if (type.csv != nullptr && fflush(type.csv) != 0) {
+            ::printf("%s.csv: write failed: %m\n", type.name);
+            return false;
+        }
+        if (type.columnar != nullptr && fflush(type.columnar) != 0) {
+            ::printf("%s.col: write failed: %m\n", type.name);
+            return false;
+        }
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    const double framing_s = std::chrono::duration<double>(framed - start).count();
+    const double total_s = std::chrono::duration<double>(end - start).count();
+    ::printf("%llu messages, %llu exported, %llu bytes skipped\n",
+             (unsigned long long)_messages, (unsigned long long)_exported_rows,
+             (unsigned long long)_skipped_bytes);
+    ::printf("%.1f MB in %.2fs (framing %.2fs), %.1f MB/s on %u threads\n",
+             _log_size * 1.0e-6, total_s, framing_s, _log_size * 1.0e-6 / total_s,
+             unsigned(_options.num_threads));
+    return true;
+}
+
+/*
+  command line tool
+ */
+class LogExport : public AP_HAL::HAL::Callbacks {
+public:
+    void setup() override;
+    void loop() override {}
+
+private:
+    LogExporter::Options options;
+    const char *filename;
+
+    void parse_command_line(uint8_t argc, char * const argv[]);
+    void usage();
+    static void finish(int status);
+};
+
+void LogExport::usage(void)
+{
+    ::printf("Options:\n");
+    ::printf("\t-o, --output DIR        directory for the exported files (default .)\n");
+    ::printf("\t-f, --format FORMAT     csv, col or all (default csv)\n");
+    ::printf("\t-t, --types LIST        comma separated message types to export (default all)\n");
+    ::printf("\t-s, --start SECONDS     skip messages with an earlier TimeUS\n");
+    ::printf("\t-e, --end SECONDS       skip messages with a later TimeUS\n");
+    ::printf("\t-j, --threads N         decoding threads (default number of CPUs)\n");
+    ::printf("\t-c, --chunk-size MB     size of the chunks the log is split into (default 4)\n");
+}
+
+void LogExport::parse_command_line(uint8_t argc, char * const argv[])
+{
+    const struct GetOptLong::option long_options[] = {
+        // name           has_arg flag   val
+        {"output",          true,   0, 'o'},
+        {"format",          true,   0, 'f'},
+        {"types",           true,   0, 't'},
+        {"start",           true,   0, 's'},
+        {"end",             true,   0, 'e'},
+        {"threads",         true,   0, 'j'},
+        {"chunk-size",      true,   0, 'c'},
+        {"help",            false,  0, 'h'},
+        {0, false, 0, 0}
+    };
+
+    GetOptLong gopt(argc, argv, "o:f:t:s:e:j:c:h", long_options);
+
+    const unsigned cpus = std::thread::hardware_concurrency();
+    options.num_threads = constrain_int32(cpus, 1, 64);
+
+    int opt;
+    while ((opt = gopt.getoption()) != -1) {
+        switch (opt) {
+        case 'o':
+            options.output_dir = gopt.optarg;
+            break;
+        case 'f':
+            if (streq(gopt.optarg, "csv")) {
+                options.formats = LogExporter::CSV;
+            } else if (streq(gopt.optarg, "col")) {
+                options.formats = LogExporter::COLUMNAR;
+            } else if (streq(gopt.optarg, "all")) {
+                options.formats = LogExporter::CSV | LogExporter::COLUMNAR;
+            } else {
+                ::printf("Unknown format %s\n", gopt.optarg);
+                finish(1);
+            }
+            break;
+        case 't':
+            options.types = gopt.optarg;
+            break;
+        case 's':
+            options.start_us = atof(gopt.optarg) * 1.0e6;
+            break;
+        case 'e':
+            options.end_us = atof(gopt.optarg) * 1.0e6;
+            break;
+        case 'j':
+            options.num_threads = constrain_int32(atoi(gopt.optarg), 1, 64);
+            break;
+        case 'c':
+            options.chunk_size = constrain_int32(atoi(gopt.optarg), 1, 256) * 1024U * 1024U;
+            break;
+        case 'h':
+        default:
+            usage();
+            finish(0);
+        }
+    }
+
+    argv += gopt.optind;
+    argc -= gopt.optind;
+
+    if (argc > 0) {
+        filename = argv[0];
+    }
+}
+
+void LogExport::finish(int status)
+{
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    // If we don't tear down the threads then they continue to access
+    // global state during object destruction.
+    ((Linux::Scheduler*)hal.scheduler)->teardown();
+#endif
+    exit(status);
+}
+
+void LogExport::setup()
+{
+    uint8_t argc;
+    char * const *argv;
+
+    hal.util->commandline_arguments(argc, argv);
+
+    if (argc > 0) {
+        parse_command_line(argc, argv);
+    }
+    if (filename == nullptr) {
+        ::printf("You must supply a log filename\n");
+        usage();
+        finish(1);
+    }
+    if (mkdir(options.output_dir, 0755) != 0 && errno != EEXIST) {
+        ::printf("mkdir(%s): %m\n", options.output_dir);
+        finish(1);
+    }
+
+    LogExporter exporter(options);
+    const bool ok = exporter.run(filename);
+    finish(ok ? 0 : 1);
+}
+
+static LogExport logexport;
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+AP_HAL_MAIN_CALLBACKS(&logexport);
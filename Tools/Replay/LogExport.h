@@ -0,0 +1,141 @@
+#pragma once
+
+/*
+  export a log to one file per message type, as CSV and/or a binary
+  columnar format.
+
+  The log is mapped into memory and a single pass over the message
+  headers collects the formats, units and multipliers, and splits the
+  log into chunks on message boundaries. The chunks are then decoded by
+  a pool of threads, a batch at a time, and the output of each batch is
+  appended to the files in log order while the next batch is decoded.
+
+  A columnar file (NAME.col) is:
+    char magic[8]           "APLOGCOL"
+    uint8_t version         1
+    char name[4]            message name
+    uint8_t num_columns
+    for each column:
+      uint8_t len, char label[len]
+      char type             log format character
+      uint8_t size          bytes per value
+      double scale          scale of the type itself, e.g. 0.01 for 'c'
+      double multiplier     from FMTU/MULT, NaN if there is none
+      uint8_t len, char unit[len]   from FMTU/UNIT, empty if there is none
+  followed by row groups to the end of the file, each of which is:
+    uint32_t num_rows
+    for each column, num_rows values as they are in the log
+  All values are little-endian.
+ */
+
+#include <AP_Logger/AP_Logger.h>
+
+#include <string>
+#include <vector>
+
+#define LOGEXPORT_MAX_TYPES 256
+#define LOGEXPORT_DEFAULT_CHUNK_SIZE (4U*1024*1024)
+
+class LogExporter {
+public:
+    enum OutputFormat : uint8_t {
+        CSV      = 1U<<0,
+        COLUMNAR = 1U<<1,
+    };
+
+    struct Options {
+        uint8_t formats = CSV;
+        const char *output_dir = ".";
+        // comma separated message names, all messages if nullptr
+        const char *types = nullptr;
+        // only messages with TimeUS in this range are exported.
+        // Messages without TimeUS are always exported
+        uint64_t start_us = 0;
+        uint64_t end_us = UINT64_MAX;
+        uint8_t num_threads = 1;
+        uint32_t chunk_size = LOGEXPORT_DEFAULT_CHUNK_SIZE;
+    };
+
+    LogExporter(const Options &options) : _options(options) {}
+    ~LogExporter();
+
+    /* Do not allow copies */
+    LogExporter(const LogExporter &other) = delete;
+    LogExporter &operator=(const LogExporter&) = delete;
+
+    // export a log, returns false on failure
+    bool run(const char *filename);
+
+private:
+    struct Column {
+        std::string label;
+        char type;
+        uint8_t offset;
+        uint8_t length;
+        double scale;
+    };
+
+    struct Type {
+        bool defined;
+        bool selected;
+        char name[5];
+        struct log_Format format;
+        std::vector<Column> columns;
+        // offset of TimeUS in the message, zero if there is none
+        uint8_t time_offset;
+        // unit and multiplier ids of each column from FMTU
+        char units[16];
+        char multipliers[16];
+        FILE *csv;
+        FILE *columnar;
+        uint64_t rows;
+    };
+
+    // the output of one chunk for each type
+    struct ChunkOutput {
+        std::string csv[LOGEXPORT_MAX_TYPES];
+        // message payloads in log order, transposed into columns once
+        // the chunk is decoded
+        std::string rows[LOGEXPORT_MAX_TYPES];
+        std::string columns[LOGEXPORT_MAX_TYPES];
+        uint32_t num_rows[LOGEXPORT_MAX_TYPES];
+        uint64_t messages;
+        uint32_t skipped_bytes;
+    };
+
+    const Options _options;
+
+    const uint8_t *_log = nullptr;
+    size_t _log_size;
+
+    Type _types[LOGEXPORT_MAX_TYPES] {};
+    std::string _unit_names[LOGEXPORT_MAX_TYPES];
+    double _multipliers[LOGEXPORT_MAX_TYPES] {};
+    bool _have_multiplier[LOGEXPORT_MAX_TYPES] {};
+
+    // offset of the first message of each chunk
+    std::vector<size_t> _chunks;
+
+    uint64_t _messages;
+    uint64_t _skipped_bytes;
+    uint64_t _exported_rows;
+
+    bool map_log(const char *filename);
+    uint8_t message_length(const uint8_t *msg, size_t remaining) const;
+    bool frame_log();
+    void handle_format(const struct log_Format &f);
+    void handle_format_units(const uint8_t *msg);
+    void handle_unit(const uint8_t *msg);
+    void handle_multiplier(const uint8_t *msg);
+    void select_types();
+    void setup_columns(Type &type);
+
+    void decode_chunks(std::vector<ChunkOutput> &outputs, uint32_t first, uint32_t count);
+    void decode_chunk(uint32_t chunk, ChunkOutput &output) const;
+    void append_csv_row(const Type &type, const uint8_t *msg, std::string &csv) const;
+    void transpose_rows(const Type &type, const std::string &rows, uint32_t num_rows, std::string &columns) const;
+
+    bool write_outputs(std::vector<ChunkOutput> &outputs, uint32_t count);
+    bool open_outputs(uint8_t type_id);
+    bool write_columnar_header(const Type &type);
+};
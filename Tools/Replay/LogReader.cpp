@@ -124,6 +124,8 @@ bool LogReader::handle_log_format_msg(const struct log_Format &f)
         msgparser[f.type] = new LR_MsgHandler_RWOH(formats[f.type], ekf2, ekf3);
     } else if (streq(name, "RBOH")) {
         msgparser[f.type] = new LR_MsgHandler_RBOH(formats[f.type], ekf2, ekf3);
+    } else if (streq(name, "RDLT")) {
+        msgparser[f.type] = new LR_MsgHandler_RDLT(formats[f.type], msgparser);
 	} else {
         // debug("  No parser for (%s)\n", name);
     }
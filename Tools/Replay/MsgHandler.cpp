@@ -17,6 +17,7 @@ uint8_t MsgHandler::size_for_type(char type)
 
 void MsgHandler::init_field_types()
 {
+    add_field_type('a', sizeof(int16_t[32]));
     add_field_type('b', sizeof(int8_t));
     add_field_type('c', sizeof(int16_t));
     add_field_type('d', sizeof(double));
@@ -7,12 +7,16 @@ Andrew Tridgell
 May 2017
 '''
 
-import os, sys, tempfile, gzip
+import os, sys, tempfile, gzip, zlib
+
+# log2 of the compression window size for boards which stream ROMFS
+# files. This must match AP_ROMFS_WINDOW_SIZE
+stream_window_bits = 12
 
 def write_encode(out, s):
     out.write(s.encode())
 
-def embed_file(out, f, idx, embedded_name, uncompressed):
+def embed_file(out, f, idx, embedded_name, uncompressed, streaming):
     '''embed one file'''
     try:
         contents = open(f,'rb').read()
@@ -46,6 +50,11 @@ def embed_file(out, f, idx, embedded_name, uncompressed):
         if contents[-1] != nul:
             contents += nul
         compressed.write(contents)
+    elif streaming:
+        # compress it as gzip with a small window, so AP_ROMFS can
+        # decompress it incrementally
+        c = zlib.compressobj(9, zlib.DEFLATED, 16 + stream_window_bits)
+        compressed.write(c.compress(contents) + c.flush())
     else:
         # compress it
         f = open(compressed.name, "wb")
@@ -62,7 +71,7 @@ def embed_file(out, f, idx, embedded_name, uncompressed):
     write_encode(out, '};\n\n');
     return True
 
-def create_embedded_h(filename, files, uncompressed=False):
+def create_embedded_h(filename, files, uncompressed=False, streaming=False):
     '''create a ap_romfs_embedded.h file'''
 
     out = open(filename, "wb")
@@ -73,7 +82,7 @@ def create_embedded_h(filename, files, uncompressed=False):
 
     for i in range(len(files)):
         (name, filename) = files[i]
-        if not embed_file(out, filename, i, name, uncompressed):
+        if not embed_file(out, filename, i, name, uncompressed, streaming):
             return False
 
     write_encode(out, '''const AP_ROMFS::embedded_file AP_ROMFS::files[] = {\n''')
@@ -0,0 +1,109 @@
+#!/usr/bin/env python
+
+'''
+measure the speedup over real time that SITL achieves for a set of
+vehicles and simulation options.
+
+Each configuration is started with a wiped eeprom and run for a fixed
+amount of wall clock time; the simulated time reached is read from
+SYSTEM_TIME messages.  Binaries must already be built, e.g.:
+
+  ./waf configure --board sitl && ./waf copter plane
+  ./Tools/scripts/sitl_speedup_benchmark.py
+'''
+
+from __future__ import print_function
+
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+from argparse import ArgumentParser
+from pymavlink import mavutil
+
+topdir = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+
+vehicles = {
+    'copter': ('arducopter', 'quad', 'copter.parm'),
+    'plane': ('arduplane', 'plane', 'plane.parm'),
+}
+
+configs = [
+    ('speedup 10', ['--speedup', '10']),
+    ('speedup 100', ['--speedup', '100']),
+    ('max-speed', ['--max-speed']),
+]
+
+
+def sim_time(mav, timeout=10):
+    '''return simulated time since boot in seconds'''
+    mav.mav.command_long_send(1, 1, mavutil.mavlink.MAV_CMD_REQUEST_MESSAGE, 0,
+                              mavutil.mavlink.MAVLINK_MSG_ID_SYSTEM_TIME,
+                              0, 0, 0, 0, 0, 0)
+    m = mav.recv_match(type='SYSTEM_TIME', blocking=True, timeout=timeout)
+    if m is None:
+        raise Exception("No SYSTEM_TIME received")
+    return m.time_boot_ms * 0.001
+
+
+def run_config(binary, model, defaults, options, duration):
+    '''run one configuration, returning the achieved speedup'''
+    cmd = [binary, '--model', model, '--wipe', '--defaults', defaults] + options
+    workdir = tempfile.mkdtemp(prefix='sitl_benchmark_')
+    devnull = open(os.devnull, 'w')
+    p = subprocess.Popen(cmd, cwd=workdir, stdout=devnull, stderr=devnull)
+    try:
+        # wait for SITL to start listening
+        mav = None
+        for i in range(50):
+            try:
+                mav = mavutil.mavlink_connection('tcp:127.0.0.1:5760', autoreconnect=False)
+                break
+            except Exception:
+                time.sleep(0.1)
+        if mav is None:
+            raise Exception("Failed to connect to %s" % binary)
+        mav.wait_heartbeat(timeout=30)
+        t0_sim = sim_time(mav)
+        t0_wall = time.time()
+        while time.time() - t0_wall < duration:
+            # keep draining the link so SITL does not throttle on a
+            # full TCP queue
+            mav.recv_match(blocking=True, timeout=0.1)
+        t1_sim = sim_time(mav)
+        t1_wall = time.time()
+        mav.close()
+        return (t1_sim - t0_sim) / (t1_wall - t0_wall)
+    finally:
+        p.terminate()
+        p.wait()
+        devnull.close()
+
+
+def main():
+    parser = ArgumentParser(description=__doc__)
+    parser.add_argument("--duration", type=float, default=20, help="wall clock seconds to run each configuration")
+    parser.add_argument("--vehicle", action='append', choices=sorted(vehicles.keys()), help="vehicles to test")
+    args = parser.parse_args()
+
+    results = []
+    for vehicle in args.vehicle or sorted(vehicles.keys()):
+        (binary, model, defaults) = vehicles[vehicle]
+        binary = os.path.join(topdir, 'build', 'sitl', 'bin', binary)
+        defaults = os.path.join(topdir, 'Tools', 'autotest', 'default_params', defaults)
+        if not os.path.exists(binary):
+            print("Missing %s, skipping %s" % (binary, vehicle))
+            continue
+        for (name, options) in configs:
+            speedup = run_config(binary, model, defaults, options, args.duration)
+            print("%-8s %-24s speedup %.1f" % (vehicle, name, speedup))
+            results.append((vehicle, name, speedup))
+
+    if len(results) == 0:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
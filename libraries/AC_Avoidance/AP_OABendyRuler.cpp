@@ -32,6 +32,9 @@ const float OA_BENDYRULER_LOOKAHEAD_STEP2_MIN = 2.0f;   // step2 checks at least
 const float OA_BENDYRULER_LOOKAHEAD_PAST_DEST = 2.0f;   // lookahead length will be at least this many meters past the destination
 const float OA_BENDYRULER_LOW_SPEED_SQUARED = (0.2f * 0.2f);    // when ground course is below this speed squared, vehicle's heading will be used
 
+static_assert(OA_BENDYRULER_STEP1_MAX == 1 + 2 * (170 / OA_BENDYRULER_BEARING_INC_XY), "OA_BENDYRULER_STEP1_MAX must match the horizontal search");
+static_assert(OA_BENDYRULER_STEP1_MAX >= 2 * (180 / OA_BENDYRULER_BEARING_INC_VERTICAL), "OA_BENDYRULER_STEP1_MAX too small for vertical search");
+
 #define VERTICAL_ENABLED APM_BUILD_TYPE(APM_BUILD_ArduCopter)
 
 const AP_Param::GroupInfo AP_OABendyRuler::var_info[] = {
@@ -68,6 +71,13 @@ const AP_Param::GroupInfo AP_OABendyRuler::var_info[] = {
     // @User: Standard
     AP_GROUPINFO_FRAME("TYPE", 4, AP_OABendyRuler, _bendy_type, OA_BENDYRULER_TYPE_DEFAULT, AP_PARAM_FRAME_COPTER | AP_PARAM_FRAME_HELI | AP_PARAM_FRAME_TRICOPTER),
 
+    // @Param: OPTIONS
+    // @DisplayName: BendyRuler options
+    // @Description: Bitmask of BendyRuler options. Calculating margins together copies the object database once per update and checks all the directions of each search step in one pass over it, which is faster when many directions must be tested but slower when the direct path is clear
+    // @Bitmask: 0:Calculate margins of all directions together
+    // @User: Advanced
+    AP_GROUPINFO("OPTIONS", 5, AP_OABendyRuler, _options, 0),
+
     AP_GROUPEND
 };
 
@@ -109,7 +119,10 @@ bool AP_OABendyRuler::update(const Location& current_loc, const Location& destin
     } else {
         ground_course_deg = degrees(ground_speed_vec.angle());
     }
-    
+
+    // copy the object database's obstacles once for all the margins calculated by this update
+    _use_obstacle_cache = ((_options.get() & uint16_t(Options::BatchMargins)) != 0) && _obstacles.update_from_database();
+
     bool ret;
     switch (get_type()) {
         case OABendyType::OA_BENDY_VERTICAL:
@@ -139,6 +152,25 @@ bool AP_OABendyRuler::search_xy_path(const Location& current_loc, const Location
     float best_margin = -FLT_MAX;
     float best_margin_bearing = best_bearing;
 
+    // with the obstacle cache calculate the margins of all bearings together
+    const bool batch = _use_obstacle_cache;
+    if (batch) {
+        uint8_t num_tests = 0;
+        for (uint8_t i = 0; i <= (170 / OA_BENDYRULER_BEARING_INC_XY); i++) {
+            for (uint8_t bdir = 0; bdir <= 1; bdir++) {
+                if ((i==0) && (bdir > 0)) {
+                    continue;
+                }
+                const float bearing_delta = i * OA_BENDYRULER_BEARING_INC_XY * (bdir == 0 ? -1.0f : 1.0f);
+                _step1_locs[num_tests] = current_loc;
+                _step1_locs[num_tests].offset_bearing(wrap_180(bearing_to_dest + bearing_delta), lookahead_step1_dist);
+                num_tests++;
+            }
+        }
+        calc_avoidance_margins(current_loc, _step1_locs, num_tests, _step1_margins, proximity_only);
+    }
+
+    uint8_t test_num = 0;
     for (uint8_t i = 0; i <= (170 / OA_BENDYRULER_BEARING_INC_XY); i++) {
         for (uint8_t bdir = 0; bdir <= 1; bdir++) {
             // skip duplicate check of bearing straight towards destination
@@ -153,11 +185,19 @@ bool AP_OABendyRuler::search_xy_path(const Location& current_loc, const Location
             // ToDo: add prediction of vehicle's position change as part of turn to desired heading
 
             // test location is projected from current location at test bearing
-            Location test_loc = current_loc;
-            test_loc.offset_bearing(bearing_test, lookahead_step1_dist);
-
-            // calculate margin from obstacles for this scenario
-            float margin = calc_avoidance_margin(current_loc, test_loc, proximity_only);
+            Location test_loc;
+            float margin;
+            if (batch) {
+                test_loc = _step1_locs[test_num];
+                margin = _step1_margins[test_num];
+            } else {
+                test_loc = current_loc;
+                test_loc.offset_bearing(bearing_test, lookahead_step1_dist);
+
+                // calculate margin from obstacles for this scenario
+                margin = calc_avoidance_margin(current_loc, test_loc, proximity_only);
+            }
+            test_num++;
             if (margin > best_margin) {
                 best_margin_bearing = bearing_test;
                 best_margin = margin;
@@ -178,13 +218,26 @@ bool AP_OABendyRuler::search_xy_path(const Location& current_loc, const Location
                 const float test_bearings[] { 0.0f, 45.0f, -45.0f };
                 const float bearing_to_dest2 = test_loc.get_bearing_to(destination) * 0.01f;
                 float distance2 = constrain_float(lookahead_step2_dist, OA_BENDYRULER_LOOKAHEAD_STEP2_MIN, test_loc.get_distance(destination));
+                static_assert(ARRAY_SIZE(test_bearings) <= OA_BENDYRULER_STEP2_MAX, "OA_BENDYRULER_STEP2_MAX too small");
+                if (batch) {
+                    for (uint8_t j = 0; j < ARRAY_SIZE(test_bearings); j++) {
+                        _step2_locs[j] = test_loc;
+                        _step2_locs[j].offset_bearing(wrap_180(bearing_to_dest2 + test_bearings[j]), distance2);
+                    }
+                    calc_avoidance_margins(test_loc, _step2_locs, ARRAY_SIZE(test_bearings), _step2_margins, proximity_only);
+                }
                 for (uint8_t j = 0; j < ARRAY_SIZE(test_bearings); j++) {
-                    float bearing_test2 = wrap_180(bearing_to_dest2 + test_bearings[j]);
-                    Location test_loc2 = test_loc;
-                    test_loc2.offset_bearing(bearing_test2, distance2);
-
-                    // calculate minimum margin to fence and obstacles for this scenario
-                    float margin2 = calc_avoidance_margin(test_loc, test_loc2, proximity_only);
+                    float margin2;
+                    if (batch) {
+                        margin2 = _step2_margins[j];
+                    } else {
+                        float bearing_test2 = wrap_180(bearing_to_dest2 + test_bearings[j]);
+                        Location test_loc2 = test_loc;
+                        test_loc2.offset_bearing(bearing_test2, distance2);
+
+                        // calculate minimum margin to fence and obstacles for this scenario
+                        margin2 = calc_avoidance_margin(test_loc, test_loc2, proximity_only);
+                    }
                     if (margin2 > _margin_max) {
                         // if the chosen direction is directly towards the destination avoidance can be turned off
                         // i == 0 && j == 0 implies no deviation from bearing to destination 
@@ -240,6 +293,25 @@ bool AP_OABendyRuler::search_vertical_path(const Location& current_loc, const Lo
     float best_margin_pitch = best_pitch;
     const uint8_t angular_limit = 180 / OA_BENDYRULER_BEARING_INC_VERTICAL;
 
+    // with the obstacle cache calculate the margins of all pitches together
+    const bool batch = _use_obstacle_cache;
+    if (batch) {
+        uint8_t num_tests = 0;
+        for (uint8_t i = 0; i <= angular_limit; i++) {
+            for (uint8_t bdir = 0; bdir <= 1; bdir++) {
+                if (((i==0) && (bdir > 0)) || ((i == angular_limit) && (bdir > 0))) {
+                    continue;
+                }
+                const float pitch_delta = i * OA_BENDYRULER_BEARING_INC_VERTICAL * (bdir == 0 ? 1.0f : -1.0f);
+                _step1_locs[num_tests] = current_loc;
+                _step1_locs[num_tests].offset_bearing_and_pitch(bearing_to_dest, pitch_delta, lookahead_step1_dist);
+                num_tests++;
+            }
+        }
+        calc_avoidance_margins(current_loc, _step1_locs, num_tests, _step1_margins, proximity_only);
+    }
+
+    uint8_t test_num = 0;
     for (uint8_t i = 0; i <= angular_limit; i++) {
         for (uint8_t bdir = 0; bdir <= 1; bdir++) {
             // skip duplicate check of bearing straight towards destination or 180 degrees behind
@@ -250,11 +322,19 @@ bool AP_OABendyRuler::search_vertical_path(const Location& current_loc, const Lo
             // bearing that we are probing
             const float pitch_delta = i * OA_BENDYRULER_BEARING_INC_VERTICAL * (bdir == 0 ? 1.0f : -1.0f);
 
-            Location test_loc = current_loc;
-            test_loc.offset_bearing_and_pitch(bearing_to_dest, pitch_delta, lookahead_step1_dist);
-
-            // calculate margin from obstacles for this scenario
-            float margin = calc_avoidance_margin(current_loc, test_loc, proximity_only);
+            Location test_loc;
+            float margin;
+            if (batch) {
+                test_loc = _step1_locs[test_num];
+                margin = _step1_margins[test_num];
+            } else {
+                test_loc = current_loc;
+                test_loc.offset_bearing_and_pitch(bearing_to_dest, pitch_delta, lookahead_step1_dist);
+
+                // calculate margin from obstacles for this scenario
+                margin = calc_avoidance_margin(current_loc, test_loc, proximity_only);
+            }
+            test_num++;
 
             if (margin > best_margin) {
                 best_margin_pitch = pitch_delta;
@@ -275,14 +355,27 @@ bool AP_OABendyRuler::search_vertical_path(const Location& current_loc, const Lo
                     bearing_to_dest2 = test_loc.get_bearing_to(destination) * 0.01f;
                 }
                 float distance2 = constrain_float(lookahead_step2_dist, OA_BENDYRULER_LOOKAHEAD_STEP2_MIN, test_loc.get_distance(destination));
+                static_assert(ARRAY_SIZE(test_pitch_step2) <= OA_BENDYRULER_STEP2_MAX, "OA_BENDYRULER_STEP2_MAX too small");
+                if (batch) {
+                    for (uint8_t j = 0; j < ARRAY_SIZE(test_pitch_step2); j++) {
+                        _step2_locs[j] = test_loc;
+                        _step2_locs[j].offset_bearing_and_pitch(bearing_to_dest2, wrap_180(test_pitch_step2[j]), distance2);
+                    }
+                    calc_avoidance_margins(test_loc, _step2_locs, ARRAY_SIZE(test_pitch_step2), _step2_margins, proximity_only);
+                }
 
                 for (uint8_t j = 0; j < ARRAY_SIZE(test_pitch_step2); j++) {
-                    float bearing_test2 = wrap_180(test_pitch_step2[j]);
-                    Location test_loc2 = test_loc;
-                    test_loc2.offset_bearing_and_pitch(bearing_to_dest2, bearing_test2 ,distance2);
-
-                    // calculate minimum margin to fence and obstacles for this scenario
-                    float margin2 = calc_avoidance_margin(test_loc, test_loc2, proximity_only);
+                    float margin2;
+                    if (batch) {
+                        margin2 = _step2_margins[j];
+                    } else {
+                        float bearing_test2 = wrap_180(test_pitch_step2[j]);
+                        Location test_loc2 = test_loc;
+                        test_loc2.offset_bearing_and_pitch(bearing_to_dest2, bearing_test2 ,distance2);
+
+                        // calculate minimum margin to fence and obstacles for this scenario
+                        margin2 = calc_avoidance_margin(test_loc, test_loc2, proximity_only);
+                    }
                     if (margin2 > _margin_max) {
                         // if the chosen direction is directly towards the destination we might turn off avoidance
                         // i == 0 && j == 0 implies no deviation from bearing to destination 
@@ -414,7 +507,51 @@ float AP_OABendyRuler::calc_avoidance_margin(const Location &start, const Locati
         // only need margin from proximity data
         return margin_min;
     }
-    
+
+    // return smallest margin from any obstacle
+    return MIN(margin_min, calc_margin_from_fences(start, end));
+}
+
+// calculate minimum distance between each of the paths from start to ends[] and any obstacle
+// object database obstacles are taken from the obstacle cache
+void AP_OABendyRuler::calc_avoidance_margins(const Location &start, const Location ends[], uint8_t num_segments, float margins[], bool proximity_only)
+{
+    for (uint8_t i = 0; i < num_segments; i++) {
+        margins[i] = FLT_MAX;
+    }
+
+    // convert start and ends to offsets (in cm) from EKF origin and check them against all obstacles at once
+    Vector3f start_NEU;
+    if ((_obstacles.count() > 0) && start.get_vector_from_origin_NEU(start_NEU)) {
+        bool converted = true;
+        for (uint8_t i = 0; i < num_segments; i++) {
+            if (!ends[i].get_vector_from_origin_NEU(_segment_ends_NEU[i])) {
+                converted = false;
+                break;
+            }
+        }
+        if (converted) {
+            _obstacles.calc_margins(start_NEU, _segment_ends_NEU, num_segments, margins);
+        }
+    }
+
+    if (proximity_only) {
+        // only need margin from proximity data
+        return;
+    }
+
+    for (uint8_t i = 0; i < num_segments; i++) {
+        margins[i] = MIN(margins[i], calc_margin_from_fences(start, ends[i]));
+    }
+}
+
+// calculate minimum distance between a path and all enabled fences
+float AP_OABendyRuler::calc_margin_from_fences(const Location &start, const Location &end) const
+{
+    float margin_min = FLT_MAX;
+
+    float latest_margin;
+
     if (calc_margin_from_circular_fence(start, end, latest_margin)) {
         margin_min = MIN(margin_min, latest_margin);
     }
@@ -436,7 +573,7 @@ float AP_OABendyRuler::calc_avoidance_margin(const Location &start, const Locati
         margin_min = MIN(margin_min, latest_margin);
     }
 
-    // return smallest margin from any obstacle
+    // return smallest margin from any fence
     return margin_min;
 }
 
@@ -661,13 +798,18 @@ bool AP_OABendyRuler::calc_margin_from_object_database(const Location &start, co
 
     // check each obstacle's distance from segment
     float smallest_margin = FLT_MAX;
-    for (uint16_t i=0; i<oaDb->database_count(); i++) {
-        const AP_OADatabase::OA_DbItem& item = oaDb->get_item(i);
-        const Vector3f point_cm = item.pos * 100.0f;
-        // margin is distance between line segment and obstacle minus obstacle's radius
-        const float m = Vector3f::closest_distance_between_line_and_point(start_NEU, end_NEU, point_cm) * 0.01f - item.radius;
-        if (m < smallest_margin) {
-            smallest_margin = m;
+    if (_use_obstacle_cache) {
+        // obstacles copied from the database by this update
+        _obstacles.calc_margins(start_NEU, &end_NEU, 1, &smallest_margin);
+    } else {
+        for (uint16_t i=0; i<oaDb->database_count(); i++) {
+            const AP_OADatabase::OA_DbItem& item = oaDb->get_item(i);
+            const Vector3f point_cm = item.pos * 100.0f;
+            // margin is distance between line segment and obstacle minus obstacle's radius
+            const float m = Vector3f::closest_distance_between_line_and_point(start_NEU, end_NEU, point_cm) * 0.01f - item.radius;
+            if (m < smallest_margin) {
+                smallest_margin = m;
+            }
         }
     }
 
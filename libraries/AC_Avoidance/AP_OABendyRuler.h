@@ -4,6 +4,10 @@
 #include <AP_Common/Location.h>
 #include <AP_Math/AP_Math.h>
 #include <AP_HAL/AP_HAL.h>
+#include "AP_OAObstacleCache.h"
+
+#define OA_BENDYRULER_STEP1_MAX 69  // maximum number of directions tested in the first step of a search
+#define OA_BENDYRULER_STEP2_MAX 4   // maximum number of directions tested in the second step of a search
 
 /*
  * BendyRuler avoidance algorithm for avoiding the polygon and circular fence and dynamic objects detected by the proximity sensor
@@ -42,12 +46,24 @@ public:
 
 private:
 
+    // options
+    enum class Options : uint16_t {
+        BatchMargins = (1U << 0),   // calculate margins of all directions in each step together
+    };
+
     // calculate minimum distance between a path and any obstacle
     float calc_avoidance_margin(const Location &start, const Location &end, bool proximity_only) const;
 
+    // calculate minimum distance between each of the paths from start to ends[] and any obstacle
+    // object database obstacles are taken from the obstacle cache
+    void calc_avoidance_margins(const Location &start, const Location ends[], uint8_t num_segments, float margins[], bool proximity_only);
+
     // determine if BendyRuler should accept the new bearing or try and resist it. Returns true if bearing is not changed  
     bool resist_bearing_change(const Location &destination, const Location &current_loc, bool active, float bearing_test, float lookahead_step1_dist, float margin, Location &prev_dest, float &prev_bearing, float &final_bearing, float &final_margin, bool proximity_only) const;    
 
+    // calculate minimum distance between a path and all enabled fences
+    float calc_margin_from_fences(const Location &start, const Location &end) const;
+
     // calculate minimum distance between a path and the circular fence (centered on home)
     // on success returns true and updates margin
     bool calc_margin_from_circular_fence(const Location &start, const Location &end, float &margin) const;
@@ -76,9 +92,19 @@ private:
     AP_Float _bendy_ratio;          // object avoidance will avoid major directional change if change in margin ratio is less than this param
     AP_Int16 _bendy_angle;          // object avoidance will try avoding change in direction over this much angle
     AP_Int8  _bendy_type;           // Type of BendyRuler to run
+    AP_Int16 _options;              // bitmask of options
     
     // internal variables used by background thread
     float _current_lookahead;       // distance (in meters) ahead of the vehicle we are looking for obstacles
     float _bearing_prev;            // stored bearing in degrees 
     Location _destination_prev;     // previous destination, to check if there has been a change in destination
+
+    // batch margin calculation, kept here rather than on the avoidance thread's stack
+    bool _use_obstacle_cache;       // true if object database margins are calculated from _obstacles
+    AP_OAObstacleCache _obstacles;  // object database obstacles, copied once per update
+    Location _step1_locs[OA_BENDYRULER_STEP1_MAX];      // end of each path tested in the first step
+    float _step1_margins[OA_BENDYRULER_STEP1_MAX];      // margin of each path tested in the first step
+    Location _step2_locs[OA_BENDYRULER_STEP2_MAX];      // end of each path tested in the second step
+    float _step2_margins[OA_BENDYRULER_STEP2_MAX];      // margin of each path tested in the second step
+    Vector3f _segment_ends_NEU[OA_BENDYRULER_STEP1_MAX];    // ends of paths as offsets (in cm) from EKF origin
 };
@@ -0,0 +1,141 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AP_OAObstacleCache.h"
+#include <AC_Avoidance/AP_OADatabase.h>
+
+// arrays grow in multiples of this many obstacles
+#define OA_OBSTACLE_CACHE_SIZE_INCREMENT 16
+
+AP_OAObstacleCache::~AP_OAObstacleCache()
+{
+    delete[] _x;
+}
+
+// replace contents with the object database's obstacles
+// returns false if memory could not be allocated
+bool AP_OAObstacleCache::update_from_database()
+{
+    clear();
+
+    const AP_OADatabase *oaDb = AP::oadatabase();
+    if (oaDb == nullptr || !oaDb->healthy()) {
+        return true;
+    }
+
+    const uint16_t num_items = oaDb->database_count();
+    if (!reserve(num_items)) {
+        return false;
+    }
+    for (uint16_t i=0; i<num_items; i++) {
+        const AP_OADatabase::OA_DbItem& item = oaDb->get_item(i);
+        _x[i] = item.pos.x * 100.0f;
+        _y[i] = item.pos.y * 100.0f;
+        _z[i] = item.pos.z * 100.0f;
+        _radius[i] = item.radius;
+    }
+    _count = num_items;
+    return true;
+}
+
+// add an obstacle at pos_cm (offset from EKF origin in cm) with radius in meters
+// returns false if memory could not be allocated
+bool AP_OAObstacleCache::add(const Vector3f &pos_cm, float radius)
+{
+    if (_count == UINT16_MAX || !reserve(_count + 1)) {
+        return false;
+    }
+    _x[_count] = pos_cm.x;
+    _y[_count] = pos_cm.y;
+    _z[_count] = pos_cm.z;
+    _radius[_count] = radius;
+    _count++;
+    return true;
+}
+
+// make room for at least size obstacles
+bool AP_OAObstacleCache::reserve(uint16_t size)
+{
+    if (size <= _size) {
+        return true;
+    }
+
+    // one allocation holds all four arrays
+    const uint32_t new_size = ((uint32_t(size) + OA_OBSTACLE_CACHE_SIZE_INCREMENT - 1) / OA_OBSTACLE_CACHE_SIZE_INCREMENT) * OA_OBSTACLE_CACHE_SIZE_INCREMENT;
+    float *new_x = new float[new_size * 4];
+    if (new_x == nullptr) {
+        return false;
+    }
+    float *new_y = &new_x[new_size];
+    float *new_z = &new_x[new_size * 2];
+    float *new_radius = &new_x[new_size * 3];
+    if (_count > 0) {
+        memcpy(new_x, _x, _count * sizeof(float));
+        memcpy(new_y, _y, _count * sizeof(float));
+        memcpy(new_z, _z, _count * sizeof(float));
+        memcpy(new_radius, _radius, _count * sizeof(float));
+    }
+    delete[] _x;
+
+    _x = new_x;
+    _y = new_y;
+    _z = new_z;
+    _radius = new_radius;
+    _size = MIN(new_size, uint32_t(UINT16_MAX));
+    return true;
+}
+
+// lower each of margins[] to the smallest distance (in meters) between the
+// segment from start_cm to end_cm[i] and any obstacle, less the obstacle's radius
+// margins of segments of zero length are left alone, as in
+// AP_OABendyRuler::calc_margin_from_object_database()
+void AP_OAObstacleCache::calc_margins(const Vector3f &start_cm, const Vector3f end_cm[], uint8_t num_segments, float margins[]) const
+{
+    for (uint8_t s=0; s<num_segments; s++) {
+        if (end_cm[s] == start_cm) {
+            continue;
+        }
+        const float line_x = end_cm[s].x - start_cm.x;
+        const float line_y = end_cm[s].y - start_cm.y;
+        const float line_z = end_cm[s].z - start_cm.z;
+        // protection against divide by zero
+        const float line_len_sq = sq(line_x, line_y, line_z);
+        const float inv_line_len_sq = is_zero(line_len_sq) ? 0.0f : 1.0f / line_len_sq;
+
+        // the same calculation as Vector3f::closest_distance_between_line_and_point()
+        // on the separate arrays, with the square root only taken for obstacles
+        // that may be closer than the smallest margin so far
+        float smallest_margin = margins[s];
+        for (uint16_t i=0; i<_count; i++) {
+            const float p_x = _x[i] - start_cm.x;
+            const float p_y = _y[i] - start_cm.y;
+            const float p_z = _z[i] - start_cm.z;
+            // fraction of the way along the segment of the closest point to the obstacle
+            float t = (p_x * line_x + p_y * line_y + p_z * line_z) * inv_line_len_sq;
+            t = constrain_float(t, 0.0f, 1.0f);
+            const float d_x = p_x - line_x * t;
+            const float d_y = p_y - line_y * t;
+            const float d_z = p_z - line_z * t;
+            const float dist_sq = d_x * d_x + d_y * d_y + d_z * d_z;
+            const float limit_cm = (smallest_margin + _radius[i]) * 100.0f;
+            if (limit_cm <= 0.0f || dist_sq >= sq(limit_cm)) {
+                continue;
+            }
+            const float m = sqrtf(dist_sq) * 0.01f - _radius[i];
+            smallest_margin = MIN(smallest_margin, m);
+        }
+        margins[s] = smallest_margin;
+    }
+}
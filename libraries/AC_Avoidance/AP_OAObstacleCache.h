@@ -0,0 +1,50 @@
+#pragma once
+
+#include <AP_Common/AP_Common.h>
+#include <AP_Math/AP_Math.h>
+
+/*
+ * copy of the object database's obstacles held as separate arrays of
+ * coordinates and radii, so the margins of many path segments can be
+ * calculated in tight loops over all the obstacles
+ */
+class AP_OAObstacleCache {
+public:
+    AP_OAObstacleCache() {}
+    ~AP_OAObstacleCache();
+
+    /* Do not allow copies */
+    AP_OAObstacleCache(const AP_OAObstacleCache &other) = delete;
+    AP_OAObstacleCache &operator=(const AP_OAObstacleCache&) = delete;
+
+    // replace contents with the object database's obstacles
+    // returns false if memory could not be allocated
+    bool update_from_database();
+
+    // add an obstacle at pos_cm (offset from EKF origin in cm) with radius in meters
+    // returns false if memory could not be allocated
+    bool add(const Vector3f &pos_cm, float radius);
+
+    // remove all obstacles
+    void clear() { _count = 0; }
+
+    // number of obstacles held
+    uint16_t count() const { return _count; }
+
+    // lower each of margins[] to the smallest distance (in meters) between the
+    // segment from start_cm to end_cm[i] and any obstacle, less the obstacle's radius
+    // margins of segments of zero length are left alone, as in
+    // AP_OABendyRuler::calc_margin_from_object_database()
+    void calc_margins(const Vector3f &start_cm, const Vector3f end_cm[], uint8_t num_segments, float margins[]) const;
+
+private:
+    // make room for at least size obstacles
+    bool reserve(uint16_t size);
+
+    float *_x = nullptr;            // north offsets from EKF origin in cm
+    float *_y = nullptr;            // east offsets from EKF origin in cm
+    float *_z = nullptr;            // up offsets from EKF origin in cm
+    float *_radius = nullptr;       // radii in meters
+    uint16_t _count = 0;            // number of obstacles held
+    uint16_t _size = 0;             // number of obstacles there is room for
+};
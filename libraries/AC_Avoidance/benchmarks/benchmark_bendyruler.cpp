@@ -0,0 +1,107 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+
+#include <AC_Avoidance/AP_OADatabase.h>
+#include <AC_Avoidance/AP_OAObstacleCache.h>
+#include <AC_Avoidance/AP_OABendyRuler.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  synthetic object database states: a 360 degree proximity sensor with
+  a 5 degree beam seeing objects 2m to 30m away from a vehicle 10m above
+  the EKF origin, as AP_OADatabase::queue_push() would store them
+ */
+static const Vector3f vehicle_cm(1200, -800, 1000);
+static const float lookahead_cm = 1500;
+
+static uint32_t seed = 1;
+static float random_float(float min, float max)
+{
+    seed = seed * 1103515245U + 12345U;
+    return min + (max - min) * ((seed >> 8) & 0xFFFF) / 65535.0f;
+}
+
+static AP_OADatabase::OA_DbItem *new_database(uint16_t count)
+{
+    seed = 1;
+    AP_OADatabase::OA_DbItem *items = new AP_OADatabase::OA_DbItem[count];
+    for (uint16_t i=0; i<count; i++) {
+        const float bearing = radians(random_float(0, 360));
+        const float distance = random_float(2, 30);
+        items[i].pos = vehicle_cm * 0.01f + Vector3f(cosf(bearing) * distance, sinf(bearing) * distance, random_float(-2, 2));
+        items[i].radius = MAX(0.01f, distance * tanf(radians(5)));
+    }
+    return items;
+}
+
+// ends of the paths tested by the first step of a horizontal search
+static void get_step1_ends(Vector3f ends_cm[OA_BENDYRULER_STEP1_MAX])
+{
+    for (uint8_t i=0; i<OA_BENDYRULER_STEP1_MAX; i++) {
+        // 0, -5, 5, -10, 10 ... degrees from the bearing to the destination
+        const float bearing = radians(30 + ((i + 1) / 2) * 5 * (i % 2 ? -1 : 1));
+        ends_cm[i] = vehicle_cm + Vector3f(cosf(bearing), sinf(bearing), 0) * lookahead_cm;
+    }
+}
+
+// margins of all paths, one path at a time as calc_margin_from_object_database() does
+static void BM_MarginsSerial(benchmark::State& state)
+{
+    const uint16_t count = state.range_x();
+    AP_OADatabase::OA_DbItem *items = new_database(count);
+    Vector3f ends_cm[OA_BENDYRULER_STEP1_MAX];
+    get_step1_ends(ends_cm);
+    float margins[OA_BENDYRULER_STEP1_MAX];
+
+    while (state.KeepRunning()) {
+        for (uint8_t s=0; s<OA_BENDYRULER_STEP1_MAX; s++) {
+            float smallest_margin = FLT_MAX;
+            for (uint16_t i=0; i<count; i++) {
+                const Vector3f point_cm = items[i].pos * 100.0f;
+                const float m = Vector3f::closest_distance_between_line_and_point(vehicle_cm, ends_cm[s], point_cm) * 0.01f - items[i].radius;
+                if (m < smallest_margin) {
+                    smallest_margin = m;
+                }
+            }
+            margins[s] = smallest_margin;
+        }
+        gbenchmark_escape(margins);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * count * OA_BENDYRULER_STEP1_MAX);
+
+    delete [] items;
+}
+
+// margins of all paths together, including copying the database to the cache
+static void BM_MarginsBatch(benchmark::State& state)
+{
+    const uint16_t count = state.range_x();
+    AP_OADatabase::OA_DbItem *items = new_database(count);
+    Vector3f ends_cm[OA_BENDYRULER_STEP1_MAX];
+    get_step1_ends(ends_cm);
+    float margins[OA_BENDYRULER_STEP1_MAX];
+    AP_OAObstacleCache *cache = new AP_OAObstacleCache();
+
+    while (state.KeepRunning()) {
+        cache->clear();
+        for (uint16_t i=0; i<count; i++) {
+            cache->add(items[i].pos * 100.0f, items[i].radius);
+        }
+        for (uint8_t s=0; s<OA_BENDYRULER_STEP1_MAX; s++) {
+            margins[s] = FLT_MAX;
+        }
+        cache->calc_margins(vehicle_cm, ends_cm, OA_BENDYRULER_STEP1_MAX, margins);
+        gbenchmark_escape(margins);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * count * OA_BENDYRULER_STEP1_MAX);
+
+    delete cache;
+    delete [] items;
+}
+
+BENCHMARK(BM_MarginsSerial)->Arg(25)->Arg(100)->Arg(400);
+BENCHMARK(BM_MarginsBatch)->Arg(25)->Arg(100)->Arg(400);
+
+BENCHMARK_MAIN()
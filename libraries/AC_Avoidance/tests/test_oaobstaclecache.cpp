@@ -0,0 +1,114 @@
+#include <AP_gtest.h>
+
+#include <AC_Avoidance/AP_OAObstacleCache.h>
+#include <AP_Math/AP_Math.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+// random float between -1 and 1
+static float random_float(void)
+{
+    return get_random16() / 32767.5f - 1.0f;
+}
+
+// margins of all segments together match the margin of each segment
+// calculated one obstacle at a time
+TEST(AP_OAObstacleCache, matches_serial)
+{
+    const uint8_t num_segments = 20;
+    const uint16_t num_obstacles = 37;
+
+    Vector3f obstacles_cm[num_obstacles];
+    float radii[num_obstacles];
+    AP_OAObstacleCache cache;
+    for (uint16_t i=0; i<num_obstacles; i++) {
+        obstacles_cm[i] = Vector3f(random_float(), random_float(), random_float() * 0.1f) * 3000.0f;
+        radii[i] = (random_float() + 1.0f) * 2.0f;
+        ASSERT_TRUE(cache.add(obstacles_cm[i], radii[i]));
+    }
+    EXPECT_EQ(num_obstacles, cache.count());
+
+    const Vector3f start_cm(100, -200, 300);
+    Vector3f ends_cm[num_segments];
+    float margins[num_segments];
+    for (uint8_t s=0; s<num_segments; s++) {
+        ends_cm[s] = start_cm + Vector3f(random_float(), random_float(), random_float() * 0.1f) * 2000.0f;
+        margins[s] = FLT_MAX;
+    }
+    cache.calc_margins(start_cm, ends_cm, num_segments, margins);
+
+    for (uint8_t s=0; s<num_segments; s++) {
+        float smallest_margin = FLT_MAX;
+        for (uint16_t i=0; i<num_obstacles; i++) {
+            const float m = Vector3f::closest_distance_between_line_and_point(start_cm, ends_cm[s], obstacles_cm[i]) * 0.01f - radii[i];
+            smallest_margin = MIN(smallest_margin, m);
+        }
+        EXPECT_NEAR(smallest_margin, margins[s], 1.0e-3f);
+    }
+}
+
+// margins are only ever lowered
+TEST(AP_OAObstacleCache, margins_lowered)
+{
+    AP_OAObstacleCache cache;
+    ASSERT_TRUE(cache.add(Vector3f(1000, 0, 0), 1.0f));
+
+    const Vector3f start_cm;
+    const Vector3f ends_cm[] { Vector3f(2000, 0, 0), Vector3f(0, 2000, 0), Vector3f() };
+    float margins[] { FLT_MAX, 5.0f, 3.0f };
+    cache.calc_margins(start_cm, ends_cm, ARRAY_SIZE(ends_cm), margins);
+
+    // straight through the obstacle
+    EXPECT_FLOAT_EQ(-1.0f, margins[0]);
+    // 10m from the obstacle's centre, but already lower
+    EXPECT_FLOAT_EQ(5.0f, margins[1]);
+    EXPECT_FLOAT_EQ(3.0f, margins[2]);
+
+    // an empty cache leaves the margins alone
+    cache.clear();
+    float margin = FLT_MAX;
+    cache.calc_margins(start_cm, ends_cm, 1, &margin);
+    EXPECT_FLOAT_EQ(FLT_MAX, margin);
+}
+
+// a segment of zero length is left alone, as it is when the margin is
+// calculated from the object database one segment at a time
+TEST(AP_OAObstacleCache, zero_length_segment)
+{
+    AP_OAObstacleCache cache;
+    ASSERT_TRUE(cache.add(Vector3f(1000, 0, 0), 1.0f));
+    ASSERT_TRUE(cache.add(Vector3f(300, 400, 0), 2.0f));
+
+    const Vector3f ends_cm[] { Vector3f(), Vector3f(2000, 0, 0) };
+    float margins[] { FLT_MAX, 7.0f };
+    cache.calc_margins(Vector3f(), ends_cm, 2, margins);
+
+    EXPECT_FLOAT_EQ(FLT_MAX, margins[0]);
+    // other segments are still checked, straight through the first obstacle
+    EXPECT_FLOAT_EQ(-1.0f, margins[1]);
+
+    // inside the first obstacle, but going nowhere
+    float margin = 7.0f;
+    const Vector3f here_cm { 1000, 0, 0 };
+    cache.calc_margins(here_cm, &here_cm, 1, &margin);
+    EXPECT_FLOAT_EQ(7.0f, margin);
+}
+
+// the cache grows as obstacles are added
+TEST(AP_OAObstacleCache, grows)
+{
+    AP_OAObstacleCache cache;
+    for (uint16_t i=0; i<500; i++) {
+        ASSERT_TRUE(cache.add(Vector3f(i * 100.0f, 0, 0), 0.5f));
+    }
+    EXPECT_EQ(500U, cache.count());
+
+    // only the last obstacle is within 1m of this segment
+    const Vector3f start_cm(49900, 100, 0);
+    const Vector3f end_cm(60000, 100, 0);
+    float margin = FLT_MAX;
+    cache.calc_margins(start_cm, &end_cm, 1, &margin);
+    EXPECT_NEAR(0.5f, margin, 1.0e-4f);
+}
+
+AP_GTEST_MAIN()
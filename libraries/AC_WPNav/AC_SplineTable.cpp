@@ -0,0 +1,75 @@
+#include "AC_SplineTable.h"
+
+/// build - sample the spline with the given hermite coefficients
+void AC_SplineTable::build(const Vector3f hermite[4], float accel_cmss, float speed_min_cms)
+{
+    const float dt = 1.0f / AC_SPLINE_TABLE_SIZE;
+    Vector3f pos, vel, accel;
+    Vector3f vel_mid, accel_mid;
+    float speed_prev = 0.0f;
+
+    for (uint8_t i=0; i<=AC_SPLINE_TABLE_SIZE; i++) {
+        const float spline_time = i * dt;
+        calc_pos_vel_accel(hermite, spline_time, pos, vel, accel);
+        const float speed = vel.length();
+
+        // arc length using Simpson's rule over each interval
+        if (i == 0) {
+            _length[i] = 0.0f;
+        } else {
+            calc_pos_vel_accel(hermite, spline_time - 0.5f * dt, pos, vel_mid, accel_mid);
+            _length[i] = _length[i-1] + (speed_prev + 4.0f * vel_mid.length() + speed) * dt / 6.0f;
+        }
+        speed_prev = speed;
+
+        // curvature is |v x a| / |v|^3 so the acceleration towards the
+        // centre of the curve stays below accel_cmss at speeds below
+        // sqrt(accel_cmss / curvature)
+        const float cross = (vel % accel).length();
+        if (is_positive(cross)) {
+            _speed_max[i] = safe_sqrt(accel_cmss * speed * speed * speed / cross);
+        } else {
+            _speed_max[i] = FLT_MAX;
+        }
+    }
+
+    // allow slowing down before each curve
+    for (int8_t i=AC_SPLINE_TABLE_SIZE-1; i>=0; i--) {
+        if (_speed_max[i+1] < FLT_MAX) {
+            const float speed_slow_down = safe_sqrt(sq(_speed_max[i+1]) + 2.0f * accel_cmss * (_length[i+1] - _length[i]));
+            _speed_max[i] = MIN(_speed_max[i], speed_slow_down);
+        }
+    }
+
+    // the target must always be able to move along the track
+    for (uint8_t i=0; i<=AC_SPLINE_TABLE_SIZE; i++) {
+        _speed_max[i] = MAX(_speed_max[i], speed_min_cms);
+    }
+}
+
+// linear interpolation of a sampled value at spline_time
+float AC_SplineTable::lookup(const float values[AC_SPLINE_TABLE_SIZE+1], float spline_time) const
+{
+    const float pos = constrain_float(spline_time, 0.0f, 1.0f) * AC_SPLINE_TABLE_SIZE;
+    const uint8_t i = MIN(uint8_t(pos), AC_SPLINE_TABLE_SIZE-1);
+    return values[i] + (values[i+1] - values[i]) * (pos - i);
+}
+
+/// calc_pos_vel_accel - position, velocity and acceleration of the spline at spline_time
+void AC_SplineTable::calc_pos_vel_accel(const Vector3f hermite[4], float spline_time, Vector3f& position, Vector3f& velocity, Vector3f& accel)
+{
+    const float spline_time_sqrd = spline_time * spline_time;
+    const float spline_time_cubed = spline_time_sqrd * spline_time;
+
+    position = hermite[0] + \
+               hermite[1] * spline_time + \
+               hermite[2] * spline_time_sqrd + \
+               hermite[3] * spline_time_cubed;
+
+    velocity = hermite[1] + \
+               hermite[2] * 2.0f * spline_time + \
+               hermite[3] * 3.0f * spline_time_sqrd;
+
+    accel = hermite[2] * 2.0f + \
+            hermite[3] * 6.0f * spline_time;
+}
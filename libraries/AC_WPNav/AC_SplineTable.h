@@ -0,0 +1,41 @@
+#pragma once
+
+#include <AP_Math/AP_Math.h>
+
+// number of intervals in the table built for each spline leg
+#ifndef AC_SPLINE_TABLE_SIZE
+#define AC_SPLINE_TABLE_SIZE 32
+#endif
+
+/*
+  arc length and speed limits along a hermite spline leg. These are
+  sampled at uniform steps of spline time when the leg is set, so they
+  can be looked up in constant time while the leg is flown
+ */
+class AC_SplineTable
+{
+public:
+    /// build - sample the spline with the given hermite coefficients
+    ///     speed limits keep the acceleration towards the centre of each curve below accel_cmss,
+    ///     allow slowing down at accel_cmss before each curve and are never below speed_min_cms
+    void build(const Vector3f hermite[4], float accel_cmss, float speed_min_cms);
+
+    /// length - total arc length of the leg in cm
+    float length() const { return _length[AC_SPLINE_TABLE_SIZE]; }
+
+    /// distance - arc length in cm from the origin to spline_time
+    float distance(float spline_time) const { return lookup(_length, spline_time); }
+
+    /// speed_max - maximum speed in cm/s along the track at spline_time
+    float speed_max(float spline_time) const { return lookup(_speed_max, spline_time); }
+
+    /// calc_pos_vel_accel - position, velocity and acceleration of the spline at spline_time
+    static void calc_pos_vel_accel(const Vector3f hermite[4], float spline_time, Vector3f& position, Vector3f& velocity, Vector3f& accel);
+
+private:
+    // linear interpolation of a sampled value at spline_time
+    float lookup(const float values[AC_SPLINE_TABLE_SIZE+1], float spline_time) const;
+
+    float _length[AC_SPLINE_TABLE_SIZE+1];      // arc length in cm from the origin to each sample
+    float _speed_max[AC_SPLINE_TABLE_SIZE+1];   // maximum speed in cm/s at each sample
+};
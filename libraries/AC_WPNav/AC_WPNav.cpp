@@ -67,6 +67,13 @@ const AP_Param::GroupInfo AC_WPNav::var_info[] = {
     // @User: Advanced
     AP_GROUPINFO("RFND_USE",   10, AC_WPNav, _rangefinder_use, 1),
 
+    // @Param: OPTIONS
+    // @DisplayName: Waypoint navigation options
+    // @Description: Bitmask of waypoint navigation options. Slowing spline legs for curves keeps the acceleration towards the centre of each curve below WPNAV_ACCEL and measures the distance to the destination along the spline
+    // @Bitmask: 0:Slow spline legs for curves
+    // @User: Advanced
+    AP_GROUPINFO("OPTIONS",    11, AC_WPNav, _options, 0),
+
     AP_GROUPEND
 };
 
@@ -802,6 +809,10 @@ bool AC_WPNav::set_spline_origin_and_destination(const Vector3f& origin, const V
         // update spline calculator
         update_spline_solution(origin, destination, _spline_origin_vel, _spline_destination_vel);
     }
+    _spline_table_valid = (_options.get() & uint8_t(Options::SplineSlowForCurves)) != 0;
+    if (_spline_table_valid) {
+        _spline_table.build(_hermite_spline_solution, _wp_accel_cmss, WPNAV_WP_TRACK_SPEED_MIN);
+    }
 
     // store origin and destination locations
     _origin = origin;
@@ -933,8 +944,15 @@ bool AC_WPNav::advance_spline_target_along_track(float dt)
         }
 
         // update velocity
-        float spline_dist_to_wp = (_destination - target_pos).length();
+        float spline_dist_to_wp;
         float vel_limit = _pos_control.get_max_speed_xy();
+        if (_spline_table_valid) {
+            // slow down for curves, and measure the distance left along the spline
+            spline_dist_to_wp = _spline_table.length() - _spline_table.distance(_spline_time);
+            vel_limit = MIN(vel_limit, _spline_table.speed_max(_spline_time));
+        } else {
+            spline_dist_to_wp = (_destination - target_pos).length();
+        }
         if (!is_zero(dt)) {
             vel_limit = MIN(vel_limit, track_leash_slack/dt);
         }
@@ -990,17 +1008,8 @@ bool AC_WPNav::advance_spline_target_along_track(float dt)
 /// 	relies on update_spline_solution being called when the segment's origin and destination were set
 void AC_WPNav::calc_spline_pos_vel(float spline_time, Vector3f& position, Vector3f& velocity)
 {
-    float spline_time_sqrd = spline_time * spline_time;
-    float spline_time_cubed = spline_time_sqrd * spline_time;
-
-    position = _hermite_spline_solution[0] + \
-               _hermite_spline_solution[1] * spline_time + \
-               _hermite_spline_solution[2] * spline_time_sqrd + \
-               _hermite_spline_solution[3] * spline_time_cubed;
-
-    velocity = _hermite_spline_solution[1] + \
-               _hermite_spline_solution[2] * 2.0f * spline_time + \
-               _hermite_spline_solution[3] * 3.0f * spline_time_sqrd;
+    Vector3f accel;
+    AC_SplineTable::calc_pos_vel_accel(_hermite_spline_solution, spline_time, position, velocity, accel);
 }
 
 // get terrain's altitude (in cm above the ekf origin) at the current position (+ve means terrain below vehicle is above ekf origin's altitude)
@@ -9,6 +9,7 @@
 #include <AC_AttitudeControl/AC_AttitudeControl.h> // Attitude control library
 #include <AP_Terrain/AP_Terrain.h>
 #include <AC_Avoidance/AC_Avoid.h>                 // Stop at fence library
+#include "AC_SplineTable.h"
 
 // maximum velocities and accelerations
 #define WPNAV_ACCELERATION              100.0f      // defines the default velocity vs distant curve.  maximum acceleration in cm/s/s that position controller asks for from acceleration controller
@@ -241,6 +242,11 @@ public:
 
 protected:
 
+    // options
+    enum class Options : uint8_t {
+        SplineSlowForCurves = (1U << 0),    // slow spline legs for curves using _spline_table
+    };
+
     // segment types, either straight or spine
     enum SegmentType {
         SEGMENT_STRAIGHT = 0,
@@ -304,6 +310,7 @@ protected:
     AP_Float    _wp_radius_cm;          // distance from a waypoint in cm that, when crossed, indicates the wp has been reached
     AP_Float    _wp_accel_cmss;          // horizontal acceleration in cm/s/s during missions
     AP_Float    _wp_accel_z_cmss;        // vertical acceleration in cm/s/s during missions
+    AP_Int8     _options;                // bitmask of Options
 
     // waypoint controller internal variables
     uint32_t    _wp_last_update;        // time of last update_wpnav call
@@ -328,6 +335,8 @@ protected:
     Vector3f    _spline_destination_vel;// the target velocity vector at the destination point of the spline segment
     Vector3f    _hermite_spline_solution[4]; // array describing spline path between origin and destination
     float       _spline_vel_scaler;	    //
+    AC_SplineTable _spline_table;       // arc length and speed limits along the spline segment
+    bool        _spline_table_valid;    // true if _spline_table was built for this segment, see Options::SplineSlowForCurves
     float       _yaw;                   // heading according to yaw
 
     // terrain following variables
@@ -0,0 +1,166 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AC_WPNav/AC_SplineTable.h>
+
+static const uint16_t mission_legs = 100;
+static const float update_dt = 0.0025f;
+static const float speed_xy = 1000.0f;
+static const float speed_up = 250.0f;
+static const float speed_down = 150.0f;
+static const float accel_xy = 250.0f;
+static const float accel_z = 100.0f;
+static const float leash_xy = 800.0f;
+static const float leash_up = 300.0f;
+static const float leash_down = 200.0f;
+
+struct mission_leg {
+    Vector3f destination;
+    Vector3f hermite[4];
+};
+
+static mission_leg mission[mission_legs];
+
+static float random_float(float min, float max)
+{
+    return min + (max - min) * (random() / (float)RAND_MAX);
+}
+
+/*
+  a mission of spline waypoints 50m to 500m apart. Each is flown
+  through with its velocity parallel to the line from its origin to
+  the next waypoint as AC_WPNav does, so the target never slows down
+  for a waypoint
+ */
+static void setup_mission()
+{
+    srandom(1);
+    Vector3f wp[mission_legs+2];
+    for (uint16_t i=0; i<mission_legs+2; i++) {
+        const float dist = random_float(5000, 50000);
+        const float bearing = random_float(-M_PI, M_PI);
+        wp[i] = Vector3f(dist * cosf(bearing), dist * sinf(bearing), random_float(-1000, 1000));
+        if (i > 0) {
+            wp[i] += wp[i-1];
+            wp[i].z = random_float(1000, 10000);
+        }
+    }
+    Vector3f origin_vel = (wp[1] - wp[0]) * update_dt;
+    for (uint16_t i=0; i<mission_legs; i++) {
+        const Vector3f &origin = wp[i];
+        const Vector3f &dest = wp[i+1];
+        const Vector3f dest_vel = wp[i+2] - origin;
+        mission_leg &leg = mission[i];
+        leg.destination = dest;
+        leg.hermite[0] = origin;
+        leg.hermite[1] = origin_vel;
+        leg.hermite[2] = -origin*3.0f -origin_vel*2.0f + dest*3.0f - dest_vel;
+        leg.hermite[3] = origin*2.0f + origin_vel -dest*2.0f + dest_vel;
+        origin_vel = dest_vel;
+    }
+}
+
+// leash length along the track, as calculated by AC_WPNav
+static float track_leash_length(const Vector3f &pos_delta_unit, float &slow_down_dist)
+{
+    const float pos_delta_unit_xy = norm(pos_delta_unit.x, pos_delta_unit.y);
+    const float pos_delta_unit_z = fabsf(pos_delta_unit.z);
+    const float speed_z = pos_delta_unit.z >= 0.0f ? speed_up : speed_down;
+    const float leash_z = pos_delta_unit.z >= 0.0f ? leash_up : leash_down;
+    if (is_zero(pos_delta_unit_z) || is_zero(pos_delta_unit_xy)) {
+        slow_down_dist = 0.0f;
+        return leash_xy;
+    }
+    const float track_accel = MIN(accel_z/pos_delta_unit_z, accel_xy/pos_delta_unit_xy);
+    const float track_speed = MIN(speed_z/pos_delta_unit_z, speed_xy/pos_delta_unit_xy);
+    slow_down_dist = track_speed * track_speed / (4.0f*track_accel);
+    return MIN(leash_z/pos_delta_unit_z, leash_xy/pos_delta_unit_xy);
+}
+
+/*
+  fly each leg of the mission, evaluating the spline and leash lengths
+  at every update
+ */
+static void BM_SplineMissionDirect(benchmark::State& state)
+{
+    setup_mission();
+    uint32_t updates = 0;
+    while (state.KeepRunning()) {
+        float vel_scaler = 0.0f;
+        for (uint16_t i=0; i<mission_legs; i++) {
+            const mission_leg &leg = mission[i];
+            float spline_time = 0.0f;
+            while (spline_time < 1.0f) {
+                Vector3f pos, vel, accel;
+                AC_SplineTable::calc_pos_vel_accel(leg.hermite, spline_time, pos, vel, accel);
+                const float vel_length = vel.length();
+                float slow_down_dist;
+                const float leash = track_leash_length(vel / vel_length, slow_down_dist);
+                float dist_to_wp = (leg.destination - pos).length();
+                float vel_limit = MIN(speed_xy, leash / update_dt);
+                gbenchmark_escape(&slow_down_dist);
+                gbenchmark_escape(&dist_to_wp);
+                vel_scaler = constrain_float(vel_scaler + accel_xy * update_dt, 0.0f, vel_limit);
+                spline_time += vel_scaler / vel_length * update_dt;
+                updates++;
+            }
+        }
+        gbenchmark_escape(&vel_scaler);
+    }
+    state.SetItemsProcessed(int64_t(updates));
+}
+
+/*
+  fly each leg of the mission, building its table when the leg is set
+  and looking up distances and speed limits at every update, as
+  AC_WPNav does with WPNAV_OPTIONS set to slow spline legs for curves
+ */
+static void BM_SplineMissionTable(benchmark::State& state)
+{
+    setup_mission();
+    AC_SplineTable table;
+    uint32_t updates = 0;
+    while (state.KeepRunning()) {
+        float vel_scaler = 0.0f;
+        for (uint16_t i=0; i<mission_legs; i++) {
+            const mission_leg &leg = mission[i];
+            table.build(leg.hermite, accel_xy, 50.0f);
+            float spline_time = 0.0f;
+            while (spline_time < 1.0f) {
+                Vector3f pos, vel, accel;
+                AC_SplineTable::calc_pos_vel_accel(leg.hermite, spline_time, pos, vel, accel);
+                const float vel_length = vel.length();
+                float slow_down_dist;
+                const float leash = track_leash_length(vel / vel_length, slow_down_dist);
+                float dist_to_wp = table.length() - table.distance(spline_time);
+                float vel_limit = MIN(MIN(speed_xy, table.speed_max(spline_time)), leash / update_dt);
+                gbenchmark_escape(&slow_down_dist);
+                gbenchmark_escape(&dist_to_wp);
+                vel_scaler = constrain_float(vel_scaler + accel_xy * update_dt, 0.0f, vel_limit);
+                spline_time += vel_scaler / vel_length * update_dt;
+                updates++;
+            }
+        }
+        gbenchmark_escape(&vel_scaler);
+    }
+    state.SetItemsProcessed(int64_t(updates));
+}
+
+// cost of setting a spline leg
+static void BM_SplineTableBuild(benchmark::State& state)
+{
+    setup_mission();
+    AC_SplineTable table;
+    uint16_t i = 0;
+    while (state.KeepRunning()) {
+        table.build(mission[i].hermite, accel_xy, 50.0f);
+        gbenchmark_escape(&table);
+        i = (i + 1) % mission_legs;
+    }
+}
+
+BENCHMARK(BM_SplineMissionDirect);
+BENCHMARK(BM_SplineMissionTable);
+BENCHMARK(BM_SplineTableBuild);
+
+BENCHMARK_MAIN()
@@ -186,12 +186,23 @@ void AP_ADSB::init(void)
 
         in_state.vehicle_list = new adsb_vehicle_t[in_state.list_size_param];
 
+        in_state.icao_index_bits = 1;
+        while ((1U << in_state.icao_index_bits) < 2U * in_state.list_size_param) {
+            in_state.icao_index_bits++;
+        }
+        in_state.icao_index = new uint16_t[1U << in_state.icao_index_bits];
+        if (in_state.icao_index == nullptr) {
+            delete [] in_state.vehicle_list;
+            in_state.vehicle_list = nullptr;
+        }
+
         if (in_state.vehicle_list == nullptr) {
             // dynamic RAM allocation of in_state.vehicle_list[] failed
             _init_failed = true; // this keeps us from constantly trying to init forever in main update
             gcs().send_text(MAV_SEVERITY_INFO, "ADSB: Unable to initialize ADSB vehicle list");
             return;
         }
+        memset(in_state.icao_index, 0xFF, sizeof(uint16_t) << in_state.icao_index_bits);
         in_state.list_size_allocated = in_state.list_size_param;
     }
 
@@ -403,7 +414,13 @@ void AP_ADSB::delete_vehicle(const uint16_t index)
         in_state.furthest_vehicle_distance = 0;
         in_state.furthest_vehicle_index = 0;
     }
+    icao_index_remove(in_state.vehicle_list[index].info.ICAO_address);
     if (index != (in_state.vehicle_count-1)) {
+        // point the index of the last vehicle at its new position
+        uint16_t slot;
+        if (icao_find_slot(in_state.vehicle_list[in_state.vehicle_count-1].info.ICAO_address, slot)) {
+            in_state.icao_index[slot] = index;
+        }
         in_state.vehicle_list[index] = in_state.vehicle_list[in_state.vehicle_count-1];
     }
     // TODO: is memset needed? When we decrement the index we essentially forget about it
@@ -418,15 +435,71 @@ void AP_ADSB::delete_vehicle(const uint16_t index)
  */
 bool AP_ADSB::find_index(const adsb_vehicle_t &vehicle, uint16_t *index) const
 {
-    for (uint16_t i = 0; i < in_state.vehicle_count; i++) {
-        if (in_state.vehicle_list[i].info.ICAO_address == vehicle.info.ICAO_address) {
-            *index = i;
+    uint16_t slot;
+    if (!icao_find_slot(vehicle.info.ICAO_address, slot)) {
+        return false;
+    }
+    *index = in_state.icao_index[slot];
+    return true;
+}
+
+/*
+ * home slot of an ICAO_address in the hash index. ICAO addresses are
+ * allocated to operators in blocks, so use a multiplicative hash to
+ * spread consecutive addresses
+ */
+uint16_t AP_ADSB::icao_slot(const uint32_t icao) const
+{
+    return (icao * 2654435761U) >> (32 - in_state.icao_index_bits);
+}
+
+/*
+ * find the hash index slot holding the vehicle with the given
+ * ICAO_address, returning false if it is not in the list
+ */
+bool AP_ADSB::icao_find_slot(const uint32_t icao, uint16_t &slot) const
+{
+    const uint16_t mask = (1U << in_state.icao_index_bits) - 1;
+    for (slot = icao_slot(icao); in_state.icao_index[slot] != UINT16_MAX; slot = (slot + 1) & mask) {
+        if (in_state.vehicle_list[in_state.icao_index[slot]].info.ICAO_address == icao) {
             return true;
         }
     }
     return false;
 }
 
+void AP_ADSB::icao_index_add(const uint32_t icao, const uint16_t index)
+{
+    const uint16_t mask = (1U << in_state.icao_index_bits) - 1;
+    uint16_t slot = icao_slot(icao);
+    while (in_state.icao_index[slot] != UINT16_MAX) {
+        slot = (slot + 1) & mask;
+    }
+    in_state.icao_index[slot] = index;
+}
+
+/*
+ * remove an ICAO_address from the hash index. The vehicle must still
+ * be in vehicle_list. Following entries are moved back into the gap
+ * so they can still be found from their home slot
+ */
+void AP_ADSB::icao_index_remove(const uint32_t icao)
+{
+    uint16_t hole;
+    if (!icao_find_slot(icao, hole)) {
+        return;
+    }
+    const uint16_t mask = (1U << in_state.icao_index_bits) - 1;
+    for (uint16_t slot = (hole + 1) & mask; in_state.icao_index[slot] != UINT16_MAX; slot = (slot + 1) & mask) {
+        const uint16_t home = icao_slot(in_state.vehicle_list[in_state.icao_index[slot]].info.ICAO_address);
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            in_state.icao_index[hole] = in_state.icao_index[slot];
+            hole = slot;
+        }
+    }
+    in_state.icao_index[hole] = UINT16_MAX;
+}
+
 /*
  * Update the vehicle list. If the vehicle is already in the
  * list then it will update it, otherwise it will be added.
@@ -521,6 +594,16 @@ void AP_ADSB::set_vehicle(const uint16_t index, const adsb_vehicle_t &vehicle)
         // out of range
         return;
     }
+    if (index < in_state.vehicle_count) {
+        // updating a vehicle, or replacing it with a new one
+        const uint32_t old_icao = in_state.vehicle_list[index].info.ICAO_address;
+        if (old_icao != vehicle.info.ICAO_address) {
+            icao_index_remove(old_icao);
+            icao_index_add(vehicle.info.ICAO_address, index);
+        }
+    } else {
+        icao_index_add(vehicle.info.ICAO_address, index);
+    }
     in_state.vehicle_list[index] = vehicle;
 
     write_log(vehicle);
@@ -42,6 +42,7 @@ class AP_ADSB {
 public:
     friend class AP_ADSB_Backend;
     friend class AP_ADSB_uAvionix_MAVLink;
+    friend class AP_Avoidance_Benchmark;
 
     // constructor
     AP_ADSB();
@@ -153,6 +154,12 @@ private:
     // return index of given vehicle if ICAO_ADDRESS matches. return -1 if no match
     bool find_index(const adsb_vehicle_t &vehicle, uint16_t *index) const;
 
+    // hash index of ICAO_address to vehicle_list index
+    uint16_t icao_slot(const uint32_t icao) const;
+    bool icao_find_slot(const uint32_t icao, uint16_t &slot) const;
+    void icao_index_add(const uint32_t icao, const uint16_t index);
+    void icao_index_remove(const uint32_t icao);
+
     // remove a vehicle from the list
     void delete_vehicle(const uint16_t index);
 
@@ -185,6 +192,11 @@ private:
         uint16_t    list_size_allocated;
         adsb_vehicle_t *vehicle_list;
         uint16_t    vehicle_count;
+
+        // open addressing hash table of vehicle_list indexes by
+        // ICAO_address, with at least twice as many slots as vehicles
+        uint16_t    *icao_index;
+        uint8_t     icao_index_bits;
         AP_Int32    list_radius;
         AP_Int16    list_altitude;
 
@@ -159,6 +159,15 @@ const AP_Param::GroupInfo AP_AHRS::var_info[] = {
     // @User: Advanced
     AP_GROUPINFO("CUSTOM_YAW", 17, AP_AHRS, _custom_yaw, 0),
 
+#if AP_AHRS_DCM_BANK_ENABLED
+    // @Param: IMU_CHECK
+    // @DisplayName: Per-IMU attitude consistency check
+    // @Description: When enabled a DCM is run for each IMU, and arming fails if the attitude of any IMU in use differs from the AHRS attitude by more than 10 degrees in roll or pitch, or 20 degrees in yaw. Each IMU adds to the CPU load of the AHRS update
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("IMU_CHECK", 18, AP_AHRS, _imu_check, 0),
+#endif
+
     AP_GROUPEND
 };
 
@@ -46,6 +46,9 @@ AP_AHRS_DCM::reset_gyro_drift(void)
     _omega_I.zero();
     _omega_I_sum.zero();
     _omega_I_sum_time = 0;
+#if AP_AHRS_DCM_BANK_ENABLED
+    _imu_dcm.reset_gyro_drift();
+#endif
 }
 
 
@@ -91,9 +94,15 @@ AP_AHRS_DCM::update(bool skip_ins_update)
     if (delta_t > 0.2f) {
         memset((void *)&_ra_sum[0], 0, sizeof(_ra_sum));
         _ra_deltat = 0;
+#if AP_AHRS_DCM_BANK_ENABLED
+        _imu_dcm.discard_accel();
+#endif
         return;
     }
 
+    // update the DCM of each IMU
+    update_imu_dcm(delta_t);
+
     // Integrate the DCM matrix using gyro inputs
     matrix_update(delta_t);
 
@@ -118,6 +127,50 @@ AP_AHRS_DCM::update(bool skip_ins_update)
     backup_attitude();
 }
 
+/*
+  update the DCM of each IMU when AHRS_IMU_CHECK is set. The
+  consistency is taken before the update, against the attitude the
+  AHRS gave at the end of the last loop
+ */
+void AP_AHRS_DCM::update_imu_dcm(float delta_t)
+{
+#if AP_AHRS_DCM_BANK_ENABLED
+    if (_imu_check == 0) {
+        _imu_dcm_active = false;
+        return;
+    }
+    const Matrix3f reference = get_imu_dcm_reference();
+    if (!_imu_dcm_active) {
+        _imu_dcm.reset(reference);
+        _imu_dcm_active = true;
+    }
+
+    const AP_InertialSensor &_ins = AP::ins();
+
+    _imu_dcm.update_consistency(reference, delta_t);
+
+    AP_AHRS_DCM_Bank::Sample samples[INS_MAX_INSTANCES];
+    const uint8_t count = _ins.get_gyro_count();
+    for (uint8_t i=0; i<count; i++) {
+        AP_AHRS_DCM_Bank::Sample &s = samples[i];
+        s.gyro_ok = _ins.get_gyro_health(i) && _ins.get_delta_angle(i, s.delta_angle);
+        s.accel_ok = _ins.get_accel_health(i) && _ins.get_delta_velocity(i, s.delta_velocity);
+        s.delta_velocity_dt = _ins.get_delta_velocity_dt(i);
+    }
+    _imu_dcm.update(samples, count, delta_t, reference);
+#endif
+}
+
+// get the difference between the DCM of one IMU and the AHRS attitude
+bool AP_AHRS_DCM::get_imu_consistency(uint8_t instance, float &rp_error, float &yaw_error) const
+{
+#if AP_AHRS_DCM_BANK_ENABLED
+    return _imu_dcm_active && _imu_dcm.get_consistency(instance, rp_error, yaw_error);
+#else
+    return false;
+#endif
+}
+
 /*
   backup attitude to persistent_data for use in watchdog reset
  */
@@ -229,6 +282,10 @@ AP_AHRS_DCM::reset(bool recover_eulers)
 
     }
 
+#if AP_AHRS_DCM_BANK_ENABLED
+    _imu_dcm.reset(_dcm_matrix);
+#endif
+
     if (_last_startup_ms == 0) {
         load_watchdog_home();
     }
@@ -239,6 +296,9 @@ AP_AHRS_DCM::reset(bool recover_eulers)
 void AP_AHRS_DCM::reset_attitude(const float &_roll, const float &_pitch, const float &_yaw)
 {
     _dcm_matrix.from_euler(_roll, _pitch, _yaw);
+#if AP_AHRS_DCM_BANK_ENABLED
+    _imu_dcm.reset(_dcm_matrix);
+#endif
 }
 
 /*
@@ -786,6 +846,20 @@ AP_AHRS_DCM::drift_correction(float deltat)
         using_gps_corrections = true;
     }
 
+#if AP_AHRS_DCM_BANK_ENABLED
+    // correct the DCM of each IMU with the same reference vector
+    if (_imu_dcm_active) {
+        const AP_AHRS_DCM_Bank::Gains imu_dcm_gains {
+            kp : _kp,
+            ki : _ki,
+            kp_yaw : _kp_yaw,
+            ki_yaw : _ki_yaw,
+            gyro_drift_limit : _gyro_drift_limit,
+        };
+        _imu_dcm.drift_correction(GA_e, _ra_deltat, using_gps_corrections, get_imu_dcm_reference(), imu_dcm_gains);
+    }
+#endif
+
     // calculate the error term in earth frame.
     // we do this for each available accelerometer then pick the
     // accelerometer that leads to the smallest error term. This takes
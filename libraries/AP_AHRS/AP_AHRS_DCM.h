@@ -21,6 +21,16 @@
  *
  */
 
+#include "AP_AHRS_DCM_Bank.h"
+
+#ifndef AP_AHRS_DCM_BANK_ENABLED
+#define AP_AHRS_DCM_BANK_ENABLED (INS_MAX_INSTANCES > 1 && !HAL_MINIMIZE_FEATURES)
+#endif
+
+#if AP_AHRS_DCM_BANK_ENABLED
+static_assert(INS_MAX_INSTANCES <= AP_AHRS_DCM_BANK_LANES, "one DCM lane is needed per IMU");
+#endif
+
 class AP_AHRS_DCM : public AP_AHRS {
 public:
     AP_AHRS_DCM()
@@ -123,6 +133,15 @@ public:
     // returns false if we fail arming checks, in which case the buffer will be populated with a failure message
     bool pre_arm_check(char *failure_msg, uint8_t failure_msg_len) const override;
 
+    // get the filtered roll/pitch and yaw difference in radians
+    // between the DCM of one IMU and the attitude of the AHRS
+    bool get_imu_consistency(uint8_t instance, float &rp_error, float &yaw_error) const WARN_IF_UNUSED;
+
+protected:
+    // attitude of the autopilot board the DCM of each IMU is checked
+    // against, and pulled towards in yaw
+    virtual Matrix3f get_imu_dcm_reference(void) const { return _dcm_matrix; }
+
 private:
     float _ki;
     float _ki_yaw;
@@ -140,6 +159,7 @@ private:
     bool            use_fast_gains(void) const;
     void            load_watchdog_home();
     void            backup_attitude(void);
+    void            update_imu_dcm(float delta_t);
 
     // primary representation of attitude of board used for all inertial calculations
     Matrix3f _dcm_matrix;
@@ -214,4 +234,10 @@ private:
 
     // time when DCM was last reset
     uint32_t _last_startup_ms;
+
+#if AP_AHRS_DCM_BANK_ENABLED
+    // a DCM for each IMU, to check them against each other
+    AP_AHRS_DCM_Bank _imu_dcm;
+    bool _imu_dcm_active;
+#endif
 };
@@ -0,0 +1,360 @@
+/*
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  bank of per-IMU DCM estimators. The maths follows AP_AHRS_DCM, with
+  the vectors written out element by element so that each loop below
+  runs across all lanes at once
+ */
+#include "AP_AHRS_DCM_Bank.h"
+
+#define LANES AP_AHRS_DCM_BANK_LANES
+
+// the spin rate (rad/s) beyond which we stop integrating omega_I, as
+// in AP_AHRS_DCM
+#define SPIN_RATE_LIMIT radians(20)
+
+// time constant of the consistency filters in seconds
+#define CONSISTENCY_TC 1.0f
+
+// the consistency is only needed for arming checks, so is updated at
+// a lower rate than the loop
+#define CONSISTENCY_PERIOD 0.02f
+
+AP_AHRS_DCM_Bank::AP_AHRS_DCM_Bank()
+{
+    Matrix3f dcm;
+    dcm.identity();
+    reset(dcm);
+}
+
+void AP_AHRS_DCM_Bank::reset_lane(uint8_t i, const Matrix3f &dcm)
+{
+    _m[0][i] = dcm.a.x; _m[1][i] = dcm.a.y; _m[2][i] = dcm.a.z;
+    _m[3][i] = dcm.b.x; _m[4][i] = dcm.b.y; _m[5][i] = dcm.b.z;
+    _m[6][i] = dcm.c.x; _m[7][i] = dcm.c.y; _m[8][i] = dcm.c.z;
+    for (uint8_t k=0; k<3; k++) {
+        _omega_P[k][i] = 0;
+        _omega_I[k][i] = 0;
+        _omega_I_sum[k][i] = 0;
+        _ra_sum[k][i] = 0;
+        _ra_delay[k][i] = 0;
+    }
+    _spin_rate_sq[i] = 0;
+    _rp_error[i] = 0;
+    _yaw_error[i] = 0;
+    _restart[i] = false;
+}
+
+void AP_AHRS_DCM_Bank::reset(const Matrix3f &dcm)
+{
+    for (uint8_t i=0; i<LANES; i++) {
+        reset_lane(i, dcm);
+    }
+    _omega_I_sum_time = 0;
+}
+
+void AP_AHRS_DCM_Bank::reset_gyro_drift(void)
+{
+    memset(_omega_I, 0, sizeof(_omega_I));
+    memset(_omega_I_sum, 0, sizeof(_omega_I_sum));
+    _omega_I_sum_time = 0;
+}
+
+void AP_AHRS_DCM_Bank::discard_accel(void)
+{
+    memset(_ra_sum, 0, sizeof(_ra_sum));
+}
+
+void AP_AHRS_DCM_Bank::update(const Sample samples[], uint8_t count, float dt, const Matrix3f &reference)
+{
+    _count = MIN(count, LANES);
+    if (dt <= 0) {
+        return;
+    }
+
+    // gather the inputs into lanes. The velocities are scaled to dt
+    // so that the sum is of the acceleration times dt, as in
+    // AP_AHRS_DCM::drift_correction()
+    float da[3][LANES] {};
+    float dv[3][LANES] {};
+    for (uint8_t i=0; i<_count; i++) {
+        const Sample &s = samples[i];
+        if (!s.gyro_ok) {
+            _restart[i] = true;
+            continue;
+        }
+        if (_restart[i]) {
+            reset_lane(i, reference);
+            _reset_count[i]++;
+        }
+        da[0][i] = s.delta_angle.x;
+        da[1][i] = s.delta_angle.y;
+        da[2][i] = s.delta_angle.z;
+        if (s.accel_ok && s.delta_velocity_dt > 0) {
+            const float scale = dt / s.delta_velocity_dt;
+            dv[0][i] = s.delta_velocity.x * scale;
+            dv[1][i] = s.delta_velocity.y * scale;
+            dv[2][i] = s.delta_velocity.z * scale;
+        }
+    }
+
+    // matrix_update()
+    const float inv_dt = 1.0f / dt;
+    for (uint8_t i=0; i<LANES; i++) {
+        // the P terms are not included in the spin rate, see
+        // AP_AHRS_DCM::matrix_update()
+        const float wx = da[0][i] * inv_dt + _omega_I[0][i];
+        const float wy = da[1][i] * inv_dt + _omega_I[1][i];
+        const float wz = da[2][i] * inv_dt + _omega_I[2][i];
+        _spin_rate_sq[i] = wx*wx + wy*wy + wz*wz;
+
+        const float gx = (wx + _omega_P[0][i]) * dt;
+        const float gy = (wy + _omega_P[1][i]) * dt;
+        const float gz = (wz + _omega_P[2][i]) * dt;
+
+        // Matrix3f::rotate() on each row
+        for (uint8_t r=0; r<9; r+=3) {
+            const float x = _m[r][i];
+            const float y = _m[r+1][i];
+            const float z = _m[r+2][i];
+            _m[r][i]   = x + y * gz - z * gy;
+            _m[r+1][i] = y + z * gx - x * gz;
+            _m[r+2][i] = z + x * gy - y * gx;
+        }
+    }
+
+    normalize();
+
+    // an instance that has blown up starts again from the reference,
+    // as AP_AHRS_DCM::check_matrix() does with the last euler angles.
+    // The rows of a good matrix are unit vectors
+    for (uint8_t i=0; i<_count; i++) {
+        float sum_sq = 0;
+        for (uint8_t k=0; k<9; k++) {
+            sum_sq += sq(_m[k][i]);
+        }
+        if (!(fabsf(sum_sq - 3) < 0.1f)) {
+            reset_lane(i, reference);
+            _reset_count[i]++;
+        }
+    }
+
+    // rotate the accelerations into earth frame and add them up for
+    // the next drift correction
+    for (uint8_t i=0; i<LANES; i++) {
+        for (uint8_t k=0; k<3; k++) {
+            _ra_sum[k][i] += _m[3*k][i] * dv[0][i] + _m[3*k+1][i] * dv[1][i] + _m[3*k+2][i] * dv[2][i];
+        }
+    }
+}
+
+/*
+  renormalisation from the DCM IMU paper, see AP_AHRS_DCM::normalize().
+  Unlike AP_AHRS_DCM this uses the Taylor expansion of eq.21 for the
+  length of each row. The rows are renormalised every loop so are
+  always within a small fraction of unit length, where the expansion
+  is exact to well below float precision, and without sqrtf() the
+  loop has no calls and is vectorised by the compiler
+ */
+void AP_AHRS_DCM_Bank::normalize(void)
+{
+    for (uint8_t i=0; i<LANES; i++) {
+        const float ax = _m[0][i], ay = _m[1][i], az = _m[2][i];
+        const float bx = _m[3][i], by = _m[4][i], bz = _m[5][i];
+
+        const float half_error = 0.5f * (ax*bx + ay*by + az*bz);       // eq.18
+
+        const float t0x = ax - bx * half_error;                         // eq.19
+        const float t0y = ay - by * half_error;
+        const float t0z = az - bz * half_error;
+        const float t1x = bx - ax * half_error;
+        const float t1y = by - ay * half_error;
+        const float t1z = bz - az * half_error;
+        const float t2x = t0y * t1z - t0z * t1y;                        // eq.20
+        const float t2y = t0z * t1x - t0x * t1z;
+        const float t2z = t0x * t1y - t0y * t1x;
+
+        const float n0 = 0.5f * (3 - (t0x*t0x + t0y*t0y + t0z*t0z));   // eq.21
+        const float n1 = 0.5f * (3 - (t1x*t1x + t1y*t1y + t1z*t1z));
+        const float n2 = 0.5f * (3 - (t2x*t2x + t2y*t2y + t2z*t2z));
+
+        _m[0][i] = t0x * n0; _m[1][i] = t0y * n0; _m[2][i] = t0z * n0;
+        _m[3][i] = t1x * n1; _m[4][i] = t1y * n1; _m[5][i] = t1z * n1;
+        _m[6][i] = t2x * n2; _m[7][i] = t2y * n2; _m[8][i] = t2z * n2;
+    }
+}
+
+void AP_AHRS_DCM_Bank::drift_correction(const Vector3f &GA_e, float ra_deltat, bool delayed,
+                                        const Matrix3f &reference, const Gains &gains)
+{
+    if (ra_deltat <= 0) {
+        return;
+    }
+
+    // heading of the reference, from its body x axis in earth frame
+    const float ref_hx = reference.a.x;
+    const float ref_hy = reference.b.x;
+    const float ref_h2 = ref_hx*ref_hx + ref_hy*ref_hy;
+
+    for (uint8_t i=0; i<LANES; i++) {
+        float rx = _ra_sum[0][i];
+        float ry = _ra_sum[1][i];
+        float rz = _ra_sum[2][i];
+        _ra_sum[0][i] = _ra_sum[1][i] = _ra_sum[2][i] = 0;
+
+        if (delayed) {
+            // use the sum from the last correction, unless there
+            // isn't one yet. See AP_AHRS_DCM::ra_delayed()
+            const float ox = _ra_delay[0][i];
+            const float oy = _ra_delay[1][i];
+            const float oz = _ra_delay[2][i];
+            _ra_delay[0][i] = rx;
+            _ra_delay[1][i] = ry;
+            _ra_delay[2][i] = rz;
+            const bool have_old = (ox*ox + oy*oy + oz*oz) > 0;
+            rx = have_old ? ox : rx;
+            ry = have_old ? oy : ry;
+            rz = have_old ? oz : rz;
+        }
+
+        // GA_b, with no correction from an instance that has no
+        // acceleration data
+        const float r2 = rx*rx + ry*ry + rz*rz;
+        const float rn = r2 > 0 ? 1.0f / sqrtf(r2) : 0;
+        rx *= rn;
+        ry *= rn;
+        rz *= rn;
+
+        // roll and pitch error in earth frame, GA_b % GA_e. The z
+        // component is left to the yaw correction
+        const float ex = ry * GA_e.z - rz * GA_e.y;
+        const float ey = rz * GA_e.x - rx * GA_e.z;
+
+        // yaw error in earth frame, the sine of the heading difference
+        // of the body x axis to the reference
+        const float hx = _m[0][i];
+        const float hy = _m[3][i];
+        const float h2 = (hx*hx + hy*hy) * ref_h2;
+        const float ez = h2 > 1.0e-6f ? (hx * ref_hy - hy * ref_hx) / sqrtf(h2) : 0;
+
+        // rotate the errors into body frame
+        const float rp_x = _m[0][i] * ex + _m[3][i] * ey;
+        const float rp_y = _m[1][i] * ex + _m[4][i] * ey;
+        const float rp_z = _m[2][i] * ex + _m[5][i] * ey;
+        const float yaw_x = _m[6][i] * ez;
+        const float yaw_y = _m[7][i] * ez;
+        const float yaw_z = _m[8][i] * ez;
+
+        // see AP_AHRS_DCM::_P_gain()
+        const float spin_rate = sqrtf(_spin_rate_sq[i]);
+        const float p_gain = constrain_float(spin_rate * (1.0f / radians(50)), 1, 10);
+        const float kp = gains.kp * p_gain;
+        const float kp_yaw = gains.kp_yaw * p_gain;
+        _omega_P[0][i] = rp_x * kp + yaw_x * kp_yaw;
+        _omega_P[1][i] = rp_y * kp + yaw_y * kp_yaw;
+        _omega_P[2][i] = rp_z * kp + yaw_z * kp_yaw;
+
+        const float i_dt = spin_rate < SPIN_RATE_LIMIT ? ra_deltat : 0;
+        _omega_I_sum[0][i] += (rp_x * gains.ki + yaw_x * gains.ki_yaw) * i_dt;
+        _omega_I_sum[1][i] += (rp_y * gains.ki + yaw_y * gains.ki_yaw) * i_dt;
+        _omega_I_sum[2][i] += (rp_z * gains.ki + yaw_z * gains.ki_yaw) * i_dt;
+    }
+
+    _omega_I_sum_time += ra_deltat;
+    if (_omega_I_sum_time >= 5) {
+        // limit the change of omega_I to the maximum gyro drift
+        // rate, as AP_AHRS_DCM does
+        const float change_limit = gains.gyro_drift_limit * _omega_I_sum_time;
+        for (uint8_t k=0; k<3; k++) {
+            for (uint8_t i=0; i<LANES; i++) {
+                _omega_I[k][i] += constrain_float(_omega_I_sum[k][i], -change_limit, change_limit);
+                _omega_I_sum[k][i] = 0;
+            }
+        }
+        _omega_I_sum_time = 0;
+    }
+}
+
+void AP_AHRS_DCM_Bank::update_consistency(const Matrix3f &reference, float dt)
+{
+    _consistency_dt += dt;
+    if (_consistency_dt < CONSISTENCY_PERIOD) {
+        return;
+    }
+    dt = _consistency_dt;
+    _consistency_dt = 0;
+
+    const float ref[9] = { reference.a.x, reference.a.y, reference.a.z,
+                           reference.b.x, reference.b.y, reference.b.z,
+                           reference.c.x, reference.c.y, reference.c.z };
+    const float alpha = dt / (dt + CONSISTENCY_TC);
+
+    for (uint8_t i=0; i<LANES; i++) {
+        // M = R^T * R_ref, the rotation from the reference body frame
+        // to the body frame of the instance
+        float M[3][3];
+        for (uint8_t r=0; r<3; r++) {
+            for (uint8_t c=0; c<3; c++) {
+                M[r][c] = _m[r][i] * ref[c] + _m[3+r][i] * ref[3+c] + _m[6+r][i] * ref[6+c];
+            }
+        }
+
+        // axis and angle of M, split into the roll/pitch and yaw
+        // parts as AP_AHRS_NavEKF::attitudes_consistent() does
+        const float vx = 0.5f * (M[2][1] - M[1][2]);
+        const float vy = 0.5f * (M[0][2] - M[2][0]);
+        const float vz = 0.5f * (M[1][0] - M[0][1]);
+        const float s = sqrtf(vx*vx + vy*vy + vz*vz);
+        const float c = 0.5f * (M[0][0] + M[1][1] + M[2][2] - 1);
+        const float angle = atan2f(s, c);
+        const float scale = s > 1.0e-6f ? angle / s : 1;
+
+        const float rp = sqrtf(vx*vx + vy*vy) * scale;
+        const float yaw = fabsf(vz) * scale;
+        _rp_error[i] += (rp - _rp_error[i]) * alpha;
+        _yaw_error[i] += (yaw - _yaw_error[i]) * alpha;
+    }
+}
+
+bool AP_AHRS_DCM_Bank::get_consistency(uint8_t instance, float &rp_error, float &yaw_error) const
+{
+    if (instance >= _count || _restart[instance]) {
+        return false;
+    }
+    rp_error = _rp_error[instance];
+    yaw_error = _yaw_error[instance];
+    return true;
+}
+
+bool AP_AHRS_DCM_Bank::get_gyro_drift(uint8_t instance, Vector3f &drift) const
+{
+    if (instance >= _count || _restart[instance]) {
+        return false;
+    }
+    drift = Vector3f(_omega_I[0][instance], _omega_I[1][instance], _omega_I[2][instance]);
+    return true;
+}
+
+bool AP_AHRS_DCM_Bank::get_rotation_body_to_ned(uint8_t instance, Matrix3f &dcm) const
+{
+    if (instance >= _count || _restart[instance]) {
+        return false;
+    }
+    dcm = Matrix3f(_m[0][instance], _m[1][instance], _m[2][instance],
+                   _m[3][instance], _m[4][instance], _m[5][instance],
+                   _m[6][instance], _m[7][instance], _m[8][instance]);
+    return true;
+}
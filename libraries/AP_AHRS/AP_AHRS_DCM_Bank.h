@@ -0,0 +1,130 @@
+#pragma once
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ *  a bank of DCM attitude estimators, one per IMU, used to cross-check
+ *  each IMU against the attitude the AHRS is flying on.
+ *
+ *  The state of all instances is held as a structure of arrays, with
+ *  one lane per instance, so that the gyro integration,
+ *  renormalisation and drift correction of every instance are done
+ *  in the same loop without branches. Roll and pitch of each instance
+ *  are corrected from its own accelerometer only. Yaw is pulled
+ *  towards the reference attitude, as the compass and GPS are shared
+ *  by all IMUs.
+ */
+
+#include <AP_Math/AP_Math.h>
+
+// number of instances updated together. Unused lanes cost the same as
+// used ones, so this is a multiple of the SIMD width of most targets
+#define AP_AHRS_DCM_BANK_LANES 4
+
+class AP_AHRS_DCM_Bank {
+public:
+    AP_AHRS_DCM_Bank();
+
+    // the data from one IMU for an update
+    struct Sample {
+        Vector3f delta_angle;
+        Vector3f delta_velocity;
+        float delta_velocity_dt;
+        bool gyro_ok;
+        bool accel_ok;
+    };
+
+    struct Gains {
+        float kp;
+        float ki;
+        float kp_yaw;
+        float ki_yaw;
+        float gyro_drift_limit;
+    };
+
+    // start all instances from an attitude
+    void reset(const Matrix3f &dcm);
+
+    // zero the gyro drift estimate of all instances
+    void reset_gyro_drift(void);
+
+    // integrate the gyros of count instances over dt, and accumulate
+    // their accelerations in earth frame for the next drift
+    // correction. An instance that has missed data restarts from the
+    // reference attitude
+    void update(const Sample samples[], uint8_t count, float dt, const Matrix3f &reference);
+
+    // throw away the accelerations accumulated since the last drift
+    // correction
+    void discard_accel(void);
+
+    // correct the attitude of each instance towards the reference
+    // gravity vector GA_e, which is the vector the primary DCM uses
+    // including any GPS acceleration. ra_deltat is the time the
+    // accelerations were accumulated over. With delayed set the
+    // accelerations of the previous correction are used, to match the
+    // GPS lag
+    void drift_correction(const Vector3f &GA_e, float ra_deltat, bool delayed,
+                          const Matrix3f &reference, const Gains &gains);
+
+    // update the consistency of each instance with a reference attitude
+    void update_consistency(const Matrix3f &reference, float dt);
+
+    uint8_t num_instances(void) const { return _count; }
+
+    // get the filtered roll/pitch and yaw difference in radians
+    // between an instance and the reference attitude
+    bool get_consistency(uint8_t instance, float &rp_error, float &yaw_error) const WARN_IF_UNUSED;
+
+    // get the gyro drift estimate of an instance
+    bool get_gyro_drift(uint8_t instance, Vector3f &drift) const WARN_IF_UNUSED;
+
+    // get the attitude of an instance
+    bool get_rotation_body_to_ned(uint8_t instance, Matrix3f &dcm) const WARN_IF_UNUSED;
+
+    // number of times an instance has been restarted after bad data
+    uint16_t get_reset_count(uint8_t instance) const {
+        return instance < _count ? _reset_count[instance] : 0;
+    }
+
+private:
+    // rotation matrix, element [3*row+col] for each lane
+    float _m[9][AP_AHRS_DCM_BANK_LANES];
+
+    float _omega_P[3][AP_AHRS_DCM_BANK_LANES];
+    float _omega_I[3][AP_AHRS_DCM_BANK_LANES];
+    float _omega_I_sum[3][AP_AHRS_DCM_BANK_LANES];
+    float _omega_I_sum_time;
+    float _spin_rate_sq[AP_AHRS_DCM_BANK_LANES];
+
+    // earth frame accelerations since the last drift correction,
+    // and those of the correction before for GPS lag
+    float _ra_sum[3][AP_AHRS_DCM_BANK_LANES];
+    float _ra_delay[3][AP_AHRS_DCM_BANK_LANES];
+
+    // filtered difference from the reference attitude
+    float _rp_error[AP_AHRS_DCM_BANK_LANES];
+    float _yaw_error[AP_AHRS_DCM_BANK_LANES];
+    float _consistency_dt;
+
+    // instance needs to restart from the reference attitude
+    bool _restart[AP_AHRS_DCM_BANK_LANES];
+    uint16_t _reset_count[AP_AHRS_DCM_BANK_LANES];
+    uint8_t _count;
+
+    void reset_lane(uint8_t i, const Matrix3f &dcm);
+    void normalize(void);
+};
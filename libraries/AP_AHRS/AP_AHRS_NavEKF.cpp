@@ -88,6 +88,16 @@ const Matrix3f &AP_AHRS_NavEKF::get_rotation_body_to_ned(void) const
     return _dcm_matrix;
 }
 
+// the EKF attitude is of the vehicle body, so is rotated back to the
+// autopilot board the DCM of each IMU runs in
+Matrix3f AP_AHRS_NavEKF::get_imu_dcm_reference(void) const
+{
+    if (active_EKF_type() == EKFType::NONE) {
+        return AP_AHRS_DCM::get_imu_dcm_reference();
+    }
+    return _dcm_matrix * get_rotation_autopilot_body_to_vehicle_body();
+}
+
 const Vector3f &AP_AHRS_NavEKF::get_gyro_drift(void) const
 {
     if (active_EKF_type() == EKFType::NONE) {
@@ -1732,6 +1742,23 @@ bool AP_AHRS_NavEKF::attitudes_consistent(char *failure_msg, const uint8_t failu
         }
     }
 
+    // check primary vs the DCM of each IMU
+    const AP_InertialSensor &_ins = AP::ins();
+    for (uint8_t i = 0; i < _ins.get_gyro_count(); i++) {
+        float rp_diff, yaw_diff;
+        if (!_ins.use_gyro(i) || !get_imu_consistency(i, rp_diff, yaw_diff)) {
+            continue;
+        }
+        if (rp_diff > ATTITUDE_CHECK_THRESH_ROLL_PITCH_RAD) {
+            hal.util->snprintf(failure_msg, failure_msg_len, "IMU%u Roll/Pitch inconsistent by %d deg", (unsigned)(i+1), (int)degrees(rp_diff));
+            return false;
+        }
+        if (check_yaw && (yaw_diff > ATTITUDE_CHECK_THRESH_YAW_RAD)) {
+            hal.util->snprintf(failure_msg, failure_msg_len, "IMU%u Yaw inconsistent by %d deg", (unsigned)(i+1), (int)degrees(yaw_diff));
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -351,6 +351,9 @@ private:
     void update_EKF3(void);
 #endif
 
+    // the EKF attitude when an EKF is active, otherwise the DCM attitude
+    Matrix3f get_imu_dcm_reference(void) const override;
+
     // rotation from vehicle body to NED frame
     Matrix3f _dcm_matrix;
     Vector3f _dcm_attitude;
@@ -0,0 +1,96 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_AHRS/AP_AHRS_DCM_Bank.h>
+
+/*
+  the cost of one loop of the per-IMU DCM bank against the same steps
+  done with Matrix3f for a single IMU, as AP_AHRS_DCM does for its
+  primary estimate: matrix_update(), normalize() and the earth frame
+  acceleration sum, with a drift correction every 40 loops
+ */
+
+static const float dt = 1.0f / 400;
+
+static const AP_AHRS_DCM_Bank::Gains gains {
+    kp : 0.2f,
+    ki : 0.0087f,
+    kp_yaw : 0.2f,
+    ki_yaw : 0.01f,
+    gyro_drift_limit : radians(0.5f/60),
+};
+
+static void BM_DCMSingle(benchmark::State& state)
+{
+    Matrix3f dcm;
+    dcm.identity();
+    Vector3f omega_P, omega_I, ra_sum;
+    const Vector3f delta_angle { 0.3f * dt, -0.2f * dt, 0.1f * dt };
+    const Vector3f delta_velocity { 0.1f * dt, -0.2f * dt, -9.8f * dt };
+    uint8_t count = 0;
+
+    while (state.KeepRunning()) {
+        const Vector3f omega = delta_angle / dt + omega_I;
+        dcm.rotate((omega + omega_P) * dt);
+        dcm.normalize();
+        ra_sum += dcm * (delta_velocity / dt) * dt;
+        if (++count == 40) {
+            Vector3f GA_b = ra_sum;
+            GA_b.normalize();
+            const Vector3f error = dcm.mul_transpose(GA_b % Vector3f(0, 0, -1));
+            omega_P = error * gains.kp;
+            omega_I += error * gains.ki * 0.1f;
+            ra_sum.zero();
+            count = 0;
+        }
+        gbenchmark_escape(&dcm);
+    }
+}
+
+static void BM_DCMBank(benchmark::State& state)
+{
+    const uint8_t num_imus = state.range(0);
+    AP_AHRS_DCM_Bank bank {};
+    Matrix3f reference;
+    reference.identity();
+    bank.reset(reference);
+
+    AP_AHRS_DCM_Bank::Sample samples[AP_AHRS_DCM_BANK_LANES] {};
+    for (uint8_t i=0; i<num_imus; i++) {
+        samples[i].delta_angle = Vector3f(0.3f, -0.2f, 0.1f + 0.01f * i) * dt;
+        samples[i].delta_velocity = Vector3f(0.1f, -0.2f, -9.8f) * dt;
+        samples[i].delta_velocity_dt = dt;
+        samples[i].gyro_ok = true;
+        samples[i].accel_ok = true;
+    }
+    uint8_t count = 0;
+
+    while (state.KeepRunning()) {
+        bank.update(samples, num_imus, dt, reference);
+        if (++count == 40) {
+            bank.drift_correction(Vector3f(0, 0, -1), 0.1f, true, reference, gains);
+            count = 0;
+        }
+        gbenchmark_escape(&bank);
+    }
+}
+
+// the consistency check each loop
+static void BM_DCMBankConsistency(benchmark::State& state)
+{
+    AP_AHRS_DCM_Bank bank {};
+    Matrix3f reference;
+    reference.from_euler(0.1f, -0.2f, 1.0f);
+    bank.reset(reference);
+    reference.from_euler(0.12f, -0.18f, 1.05f);
+
+    while (state.KeepRunning()) {
+        bank.update_consistency(reference, dt);
+        gbenchmark_escape(&bank);
+    }
+}
+
+BENCHMARK(BM_DCMSingle);
+BENCHMARK(BM_DCMBank)->Arg(1)->Arg(3);
+BENCHMARK(BM_DCMBankConsistency);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,195 @@
+#include <AP_gtest.h>
+
+#include <AP_AHRS/AP_AHRS_DCM_Bank.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+// gains as AP_AHRS_DCM uses them with the default parameters
+static const AP_AHRS_DCM_Bank::Gains gains {
+    kp : 0.2f,
+    ki : 0.0087f,
+    kp_yaw : 0.2f,
+    ki_yaw : 0.01f,
+    gyro_drift_limit : radians(0.5f/60),
+};
+
+static const float loop_rate_hz = 400;
+
+/*
+  a vehicle turning slowly with three IMUs, each with its own errors
+ */
+class DCMBankSim {
+public:
+    DCMBankSim() {
+        truth.identity();
+        bank.reset(truth);
+        for (uint8_t i=0; i<3; i++) {
+            accel_rotation[i].identity();
+        }
+    }
+
+    // run for a time with the drift correction at 10Hz, as with a GPS
+    void run(float seconds) {
+        const float dt = 1.0f / loop_rate_hz;
+        const uint32_t steps = seconds * loop_rate_hz;
+        const Vector3f rate { 0.05f, -0.03f, 0.2f };
+        for (uint32_t n=0; n<steps; n++) {
+            bank.update_consistency(truth, dt);
+
+            truth.rotate(rate * dt);
+            truth.normalize();
+
+            // specific force of a vehicle at rest in the air
+            const Vector3f accel = truth.mul_transpose(Vector3f(0, 0, -GRAVITY_MSS));
+            AP_AHRS_DCM_Bank::Sample samples[3];
+            for (uint8_t i=0; i<3; i++) {
+                AP_AHRS_DCM_Bank::Sample &s = samples[i];
+                s.delta_angle = (rate + gyro_bias[i] + Vector3f(noise(0.01f), noise(0.01f), noise(0.01f))) * dt;
+                s.delta_velocity = (accel_rotation[i] * accel + Vector3f(noise(0.3f), noise(0.3f), noise(0.3f))) * dt;
+                s.delta_velocity_dt = dt;
+                s.gyro_ok = gyro_ok[i];
+                s.accel_ok = true;
+            }
+            bank.update(samples, 3, dt, truth);
+
+            if (++steps_since_correction == loop_rate_hz / 10) {
+                bank.drift_correction(Vector3f(0, 0, -1), steps_since_correction * dt, true, truth, gains);
+                steps_since_correction = 0;
+            }
+        }
+    }
+
+    AP_AHRS_DCM_Bank bank;
+    Matrix3f truth;
+    Vector3f gyro_bias[3];
+    Matrix3f accel_rotation[3];
+    bool gyro_ok[3] { true, true, true };
+
+private:
+    uint32_t steps_since_correction;
+    uint32_t noise_state = 1;
+
+    float noise(float scale) {
+        noise_state = noise_state * 1103515245U + 12345U;
+        return (((noise_state >> 8) & 0xFFFF) / 32768.0f - 1) * scale;
+    }
+};
+
+static void get_consistency(const DCMBankSim &sim, uint8_t instance, float &rp_error, float &yaw_error)
+{
+    EXPECT_TRUE(sim.bank.get_consistency(instance, rp_error, yaw_error));
+}
+
+TEST(AP_AHRS_DCM_Bank, consistent)
+{
+    DCMBankSim *sim = new DCMBankSim();
+    sim->gyro_bias[0] = Vector3f(radians(0.3f), radians(-0.2f), radians(0.1f));
+    sim->gyro_bias[1] = Vector3f(radians(-0.5f), radians(0.4f), radians(-0.3f));
+    sim->run(120);
+
+    EXPECT_EQ(3, sim->bank.num_instances());
+    for (uint8_t i=0; i<3; i++) {
+        float rp_error, yaw_error;
+        get_consistency(*sim, i, rp_error, yaw_error);
+        EXPECT_LT(rp_error, radians(2)) << "IMU " << int(i);
+        EXPECT_LT(yaw_error, radians(2)) << "IMU " << int(i);
+        EXPECT_EQ(0, sim->bank.get_reset_count(i));
+
+        // the drift estimate is going the right way
+        Vector3f drift;
+        EXPECT_TRUE(sim->bank.get_gyro_drift(i, drift));
+        EXPECT_LE(drift * sim->gyro_bias[i], 0);
+    }
+    delete sim;
+}
+
+TEST(AP_AHRS_DCM_Bank, bad_gyro)
+{
+    DCMBankSim *sim = new DCMBankSim();
+    sim->gyro_bias[2] = Vector3f(radians(5), 0, 0);
+    sim->run(30);
+
+    float rp_error, yaw_error;
+    get_consistency(*sim, 2, rp_error, yaw_error);
+    EXPECT_GT(rp_error, radians(10));
+    for (uint8_t i=0; i<2; i++) {
+        get_consistency(*sim, i, rp_error, yaw_error);
+        EXPECT_LT(rp_error, radians(2)) << "IMU " << int(i);
+    }
+    delete sim;
+}
+
+TEST(AP_AHRS_DCM_Bank, bad_accel)
+{
+    DCMBankSim *sim = new DCMBankSim();
+    // an accelerometer mounted 15 degrees off in pitch
+    sim->accel_rotation[1].from_euler(0, radians(15), 0);
+    sim->run(30);
+
+    float rp_error, yaw_error;
+    get_consistency(*sim, 1, rp_error, yaw_error);
+    EXPECT_GT(rp_error, radians(10));
+    EXPECT_LT(rp_error, radians(16));
+    for (uint8_t i=0; i<3; i+=2) {
+        get_consistency(*sim, i, rp_error, yaw_error);
+        EXPECT_LT(rp_error, radians(2)) << "IMU " << int(i);
+    }
+    delete sim;
+}
+
+TEST(AP_AHRS_DCM_Bank, restart)
+{
+    DCMBankSim *sim = new DCMBankSim();
+    sim->gyro_bias[0] = Vector3f(0, radians(20), 0);
+    sim->run(10);
+
+    float rp_error, yaw_error;
+    get_consistency(*sim, 0, rp_error, yaw_error);
+    EXPECT_GT(rp_error, radians(10));
+
+    // while the gyro is unhealthy there is no consistency to report,
+    // and when it comes back the instance starts from the reference
+    sim->gyro_ok[0] = false;
+    sim->run(1);
+    EXPECT_FALSE(sim->bank.get_consistency(0, rp_error, yaw_error));
+    sim->gyro_bias[0].zero();
+    sim->gyro_ok[0] = true;
+    sim->run(10);
+    EXPECT_EQ(1, sim->bank.get_reset_count(0));
+    get_consistency(*sim, 0, rp_error, yaw_error);
+    EXPECT_LT(rp_error, radians(2));
+    delete sim;
+}
+
+// without drift correction each lane integrates its gyro as Matrix3f does
+TEST(AP_AHRS_DCM_Bank, matches_matrix)
+{
+    const Vector3f rates[] { { 0.3f, -0.2f, 0.1f }, { -1.5f, 0.7f, 2.0f }, { 0.0f, 4.0f, -0.5f } };
+    const float dt = 1.0f / loop_rate_hz;
+
+    AP_AHRS_DCM_Bank bank {};
+    Matrix3f start;
+    start.from_euler(radians(10), radians(-20), radians(135));
+    bank.reset(start);
+    Matrix3f expected[3] { start, start, start };
+
+    for (uint16_t n=0; n<4000; n++) {
+        AP_AHRS_DCM_Bank::Sample samples[3] {};
+        for (uint8_t i=0; i<3; i++) {
+            samples[i].delta_angle = rates[i] * dt;
+            samples[i].gyro_ok = true;
+            expected[i].rotate(rates[i] * dt);
+            expected[i].normalize();
+        }
+        bank.update(samples, 3, dt, start);
+    }
+
+    for (uint8_t i=0; i<3; i++) {
+        Matrix3f m;
+        EXPECT_TRUE(bank.get_rotation_body_to_ned(i, m));
+        const Matrix3f diff = m - expected[i];
+        EXPECT_LT(diff.a.length() + diff.b.length() + diff.c.length(), 1.0e-4f) << "IMU " << int(i);
+    }
+}
+
+AP_GTEST_MAIN()
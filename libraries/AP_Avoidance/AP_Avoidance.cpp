@@ -155,6 +155,8 @@ void AP_Avoidance::init(void)
         _obstacles_allocated = _obstacles_max;
     }
     _obstacle_count = 0;
+    _grid_origin.zero();
+    memset(_grid_head, GRID_NONE, sizeof(_grid_head));
     _last_state_change_ms = 0;
     _threat_level = MAV_COLLISION_THREAT_LEVEL_NONE;
     _gcs_cleared_messages_first_sent = std::numeric_limits<uint32_t>::max();
@@ -218,11 +220,13 @@ void AP_Avoidance::add_obstacle(const uint32_t obstacle_timestamp_ms,
     }
     WITH_SEMAPHORE(_rsem);
     
+    bool in_grid = true;
     if (index == -1) {
         // existing obstacle not found.  See if we can store it anyway:
         if (i <_obstacles_allocated) {
             // have room to store more vehicles...
             index = _obstacle_count++;
+            in_grid = false;
         } else if (oldest_timestamp < obstacle_timestamp_ms) {
             // replace this very old entry with this new data
             index = oldest_index;
@@ -234,10 +238,59 @@ void AP_Avoidance::add_obstacle(const uint32_t obstacle_timestamp_ms,
         _obstacles[index].src = src;
         _obstacles[index].src_id = src_id;
     }
+    if (in_grid) {
+        // the obstacle may be moving to another cell
+        grid_remove(index);
+    }
 
     _obstacles[index]._location = loc;
     _obstacles[index]._velocity = vel_ned;
     _obstacles[index].timestamp_ms = obstacle_timestamp_ms;
+    grid_add(index);
+}
+
+/*
+  move the grid to be centred on origin
+ */
+void AP_Avoidance::grid_reset(const Location &origin)
+{
+    _grid_origin = origin;
+    memset(_grid_head, GRID_NONE, sizeof(_grid_head));
+    for (uint8_t i=0; i<_obstacle_count; i++) {
+        grid_add(i);
+    }
+}
+
+// add an obstacle to the cell containing its location
+void AP_Avoidance::grid_add(const uint8_t index)
+{
+    AP_Avoidance::Obstacle &obstacle = _obstacles[index];
+    const Vector2f ne = _grid_origin.get_distance_NE(obstacle._location);
+    const float half = AP_AVOIDANCE_GRID_SIZE / 2;
+    const uint8_t row = constrain_float(floorf(ne.x / AP_AVOIDANCE_GRID_CELL_SIZE) + half, 0, AP_AVOIDANCE_GRID_SIZE-1);
+    const uint8_t col = constrain_float(floorf(ne.y / AP_AVOIDANCE_GRID_CELL_SIZE) + half, 0, AP_AVOIDANCE_GRID_SIZE-1);
+    const uint8_t cell = row * AP_AVOIDANCE_GRID_SIZE + col;
+
+    obstacle.grid_cell = cell;
+    obstacle.grid_prev = GRID_NONE;
+    obstacle.grid_next = _grid_head[cell];
+    if (obstacle.grid_next != GRID_NONE) {
+        _obstacles[obstacle.grid_next].grid_prev = index;
+    }
+    _grid_head[cell] = index;
+}
+
+void AP_Avoidance::grid_remove(const uint8_t index)
+{
+    AP_Avoidance::Obstacle &obstacle = _obstacles[index];
+    if (obstacle.grid_prev != GRID_NONE) {
+        _obstacles[obstacle.grid_prev].grid_next = obstacle.grid_next;
+    } else {
+        _grid_head[obstacle.grid_cell] = obstacle.grid_next;
+    }
+    if (obstacle.grid_next != GRID_NONE) {
+        _obstacles[obstacle.grid_next].grid_prev = obstacle.grid_prev;
+    }
 }
 
 void AP_Avoidance::add_obstacle(const uint32_t obstacle_timestamp_ms,
@@ -470,30 +523,73 @@ void AP_Avoidance::check_for_threats()
         return;
     }
 
-    // we always check all obstacles to see if they are threats since it
-    // is most likely our own position and/or velocity have changed
-    // determine the current most-serious-threat
-    _current_most_serious_threat = -1;
-    for (uint8_t i=0; i<_obstacle_count; i++) {
+    check_for_threats(my_loc, my_vel);
+}
 
-        AP_Avoidance::Obstacle &obstacle = _obstacles[i];
-        const uint32_t obstacle_age = AP_HAL::millis() - obstacle.timestamp_ms;
-        debug("i=%d src_id=%d timestamp=%u age=%d", i, obstacle.src_id, obstacle.timestamp_ms, obstacle_age);
+void AP_Avoidance::check_for_threats(const Location &my_loc, const Vector3f &my_vel)
+{
+    WITH_SEMAPHORE(_rsem);
 
-        update_threat_level(my_loc, my_vel, obstacle);
-        debug("   threat-level=%d", obstacle.threat_level);
+    // drop really old data from the end of the list
+    const uint32_t now = AP_HAL::millis();
+    while (_obstacle_count > 0 &&
+           now - _obstacles[_obstacle_count-1].timestamp_ms > MAX_OBSTACLE_AGE_MS) {
+        grid_remove(_obstacle_count-1);
+        _obstacle_count--;
+    }
 
-        // ignore any really old data:
-        if (obstacle_age > MAX_OBSTACLE_AGE_MS) {
-            // shrink list if this is the last entry:
-            if (i == _obstacle_count-1) {
-                _obstacle_count -= 1;
+    // obstacles are no threat unless found to be one below, and the
+    // fastest one bounds how far away a threat can be
+    float max_speed_sq = 0;
+    for (uint8_t i=0; i<_obstacle_count; i++) {
+        AP_Avoidance::Obstacle &obstacle = _obstacles[i];
+        obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_NONE;
+        max_speed_sq = MAX(max_speed_sq, sq(obstacle._velocity.x) + sq(obstacle._velocity.y));
+    }
+
+    // keep the grid centred near the vehicle
+    Vector2f my_ne = _grid_origin.get_distance_NE(my_loc);
+    if (_grid_origin.is_zero() || my_ne.length() > 2 * AP_AVOIDANCE_GRID_CELL_SIZE) {
+        grid_reset(my_loc);
+        my_ne.zero();
+    }
+
+    // an obstacle can only come within the warn or fail distance
+    // within the time horizon if it is within reach now. Add a margin
+    // for the flat earth approximation of distances
+    const float time_horizon = MAX(_warn_time_horizon.get(), _fail_time_horizon.get()) + MAX_OBSTACLE_AGE_MS / 1000;
+    const float speed = norm(my_vel.x, my_vel.y) + sqrtf(max_speed_sq);
+    const float reach = (MAX(_warn_distance_xy.get(), float(_fail_distance_xy)) + speed * time_horizon) * 1.1f;
+    const float half = AP_AVOIDANCE_GRID_SIZE / 2;
+    const uint8_t row_min = constrain_float(floorf((my_ne.x - reach) / AP_AVOIDANCE_GRID_CELL_SIZE) + half, 0, AP_AVOIDANCE_GRID_SIZE-1);
+    const uint8_t row_max = constrain_float(floorf((my_ne.x + reach) / AP_AVOIDANCE_GRID_CELL_SIZE) + half, 0, AP_AVOIDANCE_GRID_SIZE-1);
+    const uint8_t col_min = constrain_float(floorf((my_ne.y - reach) / AP_AVOIDANCE_GRID_CELL_SIZE) + half, 0, AP_AVOIDANCE_GRID_SIZE-1);
+    const uint8_t col_max = constrain_float(floorf((my_ne.y + reach) / AP_AVOIDANCE_GRID_CELL_SIZE) + half, 0, AP_AVOIDANCE_GRID_SIZE-1);
+
+    // we always check all obstacles in reach to see if they are
+    // threats since it is most likely our own position and/or
+    // velocity have changed. Determine the current most-serious-threat
+    _current_most_serious_threat = -1;
+    for (uint8_t row=row_min; row<=row_max; row++) {
+        for (uint8_t col=col_min; col<=col_max; col++) {
+            uint8_t i = _grid_head[row * AP_AVOIDANCE_GRID_SIZE + col];
+            for (; i != GRID_NONE; i = _obstacles[i].grid_next) {
+                AP_Avoidance::Obstacle &obstacle = _obstacles[i];
+                const uint32_t obstacle_age = now - obstacle.timestamp_ms;
+                debug("i=%d src_id=%d timestamp=%u age=%d", i, obstacle.src_id, obstacle.timestamp_ms, obstacle_age);
+
+                // ignore any really old data:
+                if (obstacle_age > MAX_OBSTACLE_AGE_MS) {
+                    continue;
+                }
+
+                update_threat_level(my_loc, my_vel, obstacle);
+                debug("   threat-level=%d", obstacle.threat_level);
+
+                if (obstacle_is_more_serious_threat(obstacle)) {
+                    _current_most_serious_threat = i;
+                }
             }
-            continue;
-        }
-
-        if (obstacle_is_more_serious_threat(obstacle)) {
-            _current_most_serious_threat = i;
         }
     }
     if (_current_most_serious_threat != -1) {
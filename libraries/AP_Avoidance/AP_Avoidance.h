@@ -33,8 +33,14 @@
 
 #define AP_AVOIDANCE_ESCAPE_TIME_SEC                        2       // vehicle runs from thread for 2 seconds
 
+// obstacles are kept in a grid of cells around the vehicle so threat
+// checks only look at obstacles which could come within range
+#define AP_AVOIDANCE_GRID_SIZE                              16      // cells per side, obstacles outside the grid are kept in the edge cells
+#define AP_AVOIDANCE_GRID_CELL_SIZE                         1000    // metres
+
 class AP_Avoidance {
 public:
+    friend class AP_Avoidance_Benchmark;
 
     // constructor
     AP_Avoidance(class AP_ADSB &adsb);
@@ -73,6 +79,11 @@ public:
         float time_to_closest_approach; // seconds, 3D approach
         float distance_to_closest_approach; // metres, 3D
         uint32_t last_gcs_report_time; // millis
+
+        // grid cell and links to the other obstacles in the same cell
+        uint8_t grid_cell;
+        uint8_t grid_prev;
+        uint8_t grid_next;
     };
 
 
@@ -172,6 +183,7 @@ private:
     uint32_t src_id_for_adsb_vehicle(const AP_ADSB::adsb_vehicle_t &vehicle) const;
 
     void check_for_threats();
+    void check_for_threats(const Location &my_loc, const Vector3f &my_vel);
     void update_threat_level(const Location &my_loc,
                              const Vector3f &my_vel,
                              AP_Avoidance::Obstacle &obstacle);
@@ -179,6 +191,11 @@ private:
     // calls into the AP_ADSB library to retrieve vehicle data
     void get_adsb_samples();
 
+    // maintain the grid of obstacles
+    void grid_reset(const Location &origin);
+    void grid_add(uint8_t index);
+    void grid_remove(uint8_t index);
+
     // returns true if the obstacle should be considered more of a
     // threat than the current most serious threat
     bool obstacle_is_more_serious_threat(const AP_Avoidance::Obstacle &obstacle) const;
@@ -190,6 +207,12 @@ private:
     int8_t _current_most_serious_threat;
     MAV_COLLISION_ACTION _latest_action = MAV_COLLISION_ACTION_NONE;
 
+    // first obstacle in each grid cell, obstacles 0 to
+    // _obstacle_count-1 are always in the grid
+    static const uint8_t GRID_NONE = 255;
+    uint8_t _grid_head[AP_AVOIDANCE_GRID_SIZE * AP_AVOIDANCE_GRID_SIZE];
+    Location _grid_origin;
+
     // external references
     class AP_ADSB &_adsb;
 
@@ -0,0 +1,152 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+
+#include <AP_ADSB/AP_ADSB.h>
+#include <AP_Avoidance/AP_Avoidance.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+class AP_Avoidance_Test final : public AP_Avoidance {
+public:
+    using AP_Avoidance::AP_Avoidance;
+
+protected:
+    MAV_COLLISION_ACTION handle_avoidance(const AP_Avoidance::Obstacle *obstacle, MAV_COLLISION_ACTION requested_action) override {
+        return requested_action;
+    }
+    void handle_recovery(RecoveryAction recovery_action) override {}
+};
+
+/*
+  synthetic traffic around an airport: aircraft spread over a 30km
+  square flying straight at 20 to 120 m/s, with our vehicle in the
+  middle at 15 m/s
+ */
+static const Location home(-353632620, 1491652370, 58400, Location::AltFrame::ABSOLUTE);
+static const Vector3f my_vel(10, 11, 0);
+
+struct target {
+    uint32_t icao;
+    Location loc;
+    float heading;
+    float speed;
+};
+
+static uint32_t seed = 1;
+static float random_float(float min, float max)
+{
+    seed = seed * 1103515245U + 12345U;
+    return min + (max - min) * ((seed >> 8) & 0xFFFF) / 65535.0f;
+}
+
+static target *new_traffic(uint16_t count)
+{
+    seed = 1;
+    target *traffic = new target[count];
+    for (uint16_t i=0; i<count; i++) {
+        traffic[i].icao = 0x7C0000 + i * 7;
+        traffic[i].loc = home;
+        traffic[i].loc.offset(random_float(-15000, 15000), random_float(-15000, 15000));
+        traffic[i].loc.alt += random_float(0, 300000);
+        traffic[i].heading = random_float(0, 360);
+        traffic[i].speed = random_float(20, 120);
+    }
+    return traffic;
+}
+
+// move a target on by dt seconds and make the ADSB_VEHICLE report for it
+static void report(target &t, float dt, AP_ADSB::adsb_vehicle_t &vehicle)
+{
+    t.loc.offset_bearing(t.heading, t.speed * dt);
+    vehicle = {};
+    vehicle.info.ICAO_address = t.icao;
+    vehicle.info.lat = t.loc.lat;
+    vehicle.info.lon = t.loc.lng;
+    vehicle.info.altitude = t.loc.alt * 10;
+    vehicle.info.heading = t.heading * 100;
+    vehicle.info.hor_velocity = t.speed * 100;
+    vehicle.info.flags = ADSB_FLAGS_VALID_COORDS | ADSB_FLAGS_VALID_ALTITUDE |
+        ADSB_FLAGS_VALID_HEADING | ADSB_FLAGS_VALID_VELOCITY;
+    vehicle.last_update_ms = AP_HAL::millis();
+}
+
+class AP_Avoidance_Benchmark {
+public:
+    static AP_ADSB *new_adsb(uint16_t list_size) {
+        AP_ADSB::_singleton = nullptr;
+        AP_ADSB *adsb = new AP_ADSB();
+        adsb->_type[0].set(int8_t(AP_ADSB::Type::uAvionix_MAVLink));
+        adsb->in_state.list_size_param.set(list_size);
+        return adsb;
+    }
+
+    static AP_Avoidance_Test *new_avoidance(AP_ADSB &adsb, uint8_t obstacles) {
+        AP_Avoidance::_singleton = nullptr;
+        AP_Avoidance_Test *avoidance = new AP_Avoidance_Test(adsb);
+        avoidance->_enabled.set(1);
+        avoidance->_obstacles_max.set(obstacles);
+        return avoidance;
+    }
+
+    static void get_adsb_samples(AP_Avoidance &avoidance) {
+        avoidance.get_adsb_samples();
+    }
+
+    static void check_for_threats(AP_Avoidance &avoidance) {
+        avoidance.check_for_threats(home, my_vel);
+    }
+};
+
+// every target reporting its position once per iteration
+static void BM_ADSBReceive(benchmark::State& state)
+{
+    const uint16_t count = state.range_x();
+    target *traffic = new_traffic(count);
+    AP_ADSB *adsb = AP_Avoidance_Benchmark::new_adsb(count);
+    AP_ADSB::adsb_vehicle_t vehicle;
+
+    while (state.KeepRunning()) {
+        for (uint16_t i=0; i<count; i++) {
+            report(traffic[i], 1, vehicle);
+            adsb->handle_adsb_vehicle(vehicle);
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * count);
+
+    delete adsb;
+    delete [] traffic;
+}
+
+/*
+  replay of 10Hz avoidance updates, with a tenth of the targets
+  reporting between each update
+ */
+static void BM_AvoidanceUpdate(benchmark::State& state)
+{
+    const uint16_t count = state.range_x();
+    target *traffic = new_traffic(count);
+    AP_ADSB *adsb = AP_Avoidance_Benchmark::new_adsb(count);
+    AP_Avoidance_Test *avoidance = AP_Avoidance_Benchmark::new_avoidance(*adsb, MIN(count, 100));
+    AP_ADSB::adsb_vehicle_t vehicle;
+
+    uint16_t next = 0;
+    while (state.KeepRunning()) {
+        for (uint16_t i=0; i<count/10; i++) {
+            report(traffic[next], 1, vehicle);
+            adsb->handle_adsb_vehicle(vehicle);
+            next = (next + 1) % count;
+        }
+        AP_Avoidance_Benchmark::get_adsb_samples(*avoidance);
+        AP_Avoidance_Benchmark::check_for_threats(*avoidance);
+    }
+
+    delete avoidance;
+    delete adsb;
+    delete [] traffic;
+}
+
+BENCHMARK(BM_ADSBReceive)->Arg(25)->Arg(100)->Arg(400);
+BENCHMARK(BM_AvoidanceUpdate)->Arg(25)->Arg(100)->Arg(400);
+
+BENCHMARK_MAIN()
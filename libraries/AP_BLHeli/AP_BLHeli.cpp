@@ -31,6 +31,7 @@
 #include <GCS_MAVLink/GCS.h>
 #include <AP_SerialManager/AP_SerialManager.h>
 #include <AP_Logger/AP_Logger.h>
+#include <AP_ESC_Telem/AP_ESC_Telem.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -1419,6 +1420,19 @@ void AP_BLHeli::read_telemetry_packet(void)
     last_telem[last_telem_esc].count++;
     received_telem_data = true;
 
+    AP_ESC_Telem *esc_telem = AP_ESC_Telem::get_singleton();
+    if (esc_telem != nullptr) {
+        AP_ESC_Telem::TelemetryData t {};
+        t.temperature_cdeg = int16_t(td.temperature * 100);
+        t.voltage = td.voltage * 0.01f;
+        t.current = td.current * 0.01f;
+        t.consumption_mah = td.consumption;
+        t.rpm = td.rpm;
+        esc_telem->update_telem_data(last_telem_esc, t,
+                                     AP_ESC_Telem::TEMPERATURE | AP_ESC_Telem::VOLTAGE | AP_ESC_Telem::CURRENT |
+                                     AP_ESC_Telem::CONSUMPTION | AP_ESC_Telem::RPM);
+    }
+
     AP_Logger *logger = AP_Logger::get_singleton();
     if (logger && logger->logging_enabled()
         // log at 10Hz
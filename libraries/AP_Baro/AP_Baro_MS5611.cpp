@@ -162,15 +162,6 @@ uint16_t AP_Baro_MS56XX::_read_prom_word(uint8_t word)
     return (val[0] << 8) | val[1];
 }
 
-uint32_t AP_Baro_MS56XX::_read_adc()
-{
-    uint8_t val[3];
-    if (!_dev->transfer(&CMD_MS56XX_READ_ADC, 1, val, sizeof(val))) {
-        return 0;
-    }
-    return (val[0] << 16) | (val[1] << 8) | val[2];
-}
-
 bool AP_Baro_MS56XX::_read_prom_5611(uint16_t prom[8])
 {
     /*
@@ -246,30 +237,42 @@ void AP_Baro_MS56XX::_timer(void)
 {
     uint8_t next_cmd;
     uint8_t next_state;
-    uint32_t adc_val = _read_adc();
+    uint8_t val[3];
+
+    /*
+     * Read the last conversion and start the next one in a single batch
+     */
+    next_state = (_state + 1) % 5;
+    next_cmd = next_state == 0 ? ADDR_CMD_CONVERT_TEMPERATURE
+                               : ADDR_CMD_CONVERT_PRESSURE;
+    const AP_HAL::Device::Transaction batch[] {
+        { &CMD_MS56XX_READ_ADC, 1, val, sizeof(val) },
+        { &next_cmd, 1, nullptr, 0 },
+    };
+    uint32_t adc_val = 0;
+    if (_dev->transfer_batch(batch, ARRAY_SIZE(batch))) {
+        adc_val = (val[0] << 16) | (val[1] << 8) | val[2];
+    }
 
     /*
      * If read fails, re-initiate a read command for current state or we are
      * stuck
      */
     if (adc_val == 0) {
-        next_state = _state;
-    } else {
-        next_state = (_state + 1) % 5;
-    }
-
-    next_cmd = next_state == 0 ? ADDR_CMD_CONVERT_TEMPERATURE
+        next_cmd = _state == 0 ? ADDR_CMD_CONVERT_TEMPERATURE
                                : ADDR_CMD_CONVERT_PRESSURE;
-    if (!_dev->transfer(&next_cmd, 1, nullptr, 0)) {
+        _dev->transfer(&next_cmd, 1, nullptr, 0);
+        _discard_next = true;
         return;
     }
 
     /* if we had a failed read we are all done */
-    if (adc_val == 0 || adc_val == 0xFFFFFF) {
+    if (adc_val == 0xFFFFFF) {
         // a failed read can mean the next returned value will be
         // corrupt, we must discard it. This copes with MISO being
         // pulled either high or low
         _discard_next = true;
+        _state = next_state;
         return;
     }
 
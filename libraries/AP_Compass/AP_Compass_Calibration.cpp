@@ -93,7 +93,7 @@ bool Compass::_start_calibration(uint8_t i, bool retry, float delay)
     }
     if (!_cal_thread_started) {
         _cal_requires_reboot = true;
-        if (!hal.scheduler->thread_create(FUNCTOR_BIND(this, &Compass::_update_calibration_trampoline, void), "compasscal", 2048, AP_HAL::Scheduler::PRIORITY_IO, 0)) {
+        if (!hal.scheduler->thread_create(FUNCTOR_BIND(this, &Compass::_update_calibration_trampoline, void), "compasscal", 2560, AP_HAL::Scheduler::PRIORITY_IO, 0)) {
             gcs().send_text(MAV_SEVERITY_CRITICAL, "CompassCalibrator: Cannot start compass thread.");
             return false;
         }
@@ -106,15 +106,23 @@ bool Compass::_start_calibration(uint8_t i, bool retry, float delay)
     return true;
 }
 
+/*
+  one thread steps all of the calibrators. It runs at 1kHz while any of
+  them is active, and otherwise only polls for a start at 10Hz
+ */
 void Compass::_update_calibration_trampoline() {
     while(true) {
+        bool active = false;
         for (Priority i(0); i<COMPASS_MAX_INSTANCES; i++) {
             if (_calibrator[i] == nullptr) {
                 continue;
             }
             _calibrator[i]->update();
+            if (_calibrator[i]->active()) {
+                active = true;
+            }
         }
-        hal.scheduler->delay(1);
+        hal.scheduler->delay(active ? 1 : 100);
     }
 }
 
@@ -202,14 +202,23 @@ void AP_Compass_IST8310::timer()
         le16_t rz;
     } buffer;
 
-    bool ret = _dev->read_registers(OUTPUT_X_L_REG, (uint8_t *) &buffer, sizeof(buffer));
-    if (!ret) {
+    /*
+     * read the measurement and start the next one in a single batch. If
+     * it fails we don't know whether a measurement was started, so start
+     * one next time and ignore it
+     */
+    const uint8_t read_reg = OUTPUT_X_L_REG;
+    const uint8_t start_cmd[2] { CNTL1_REG, CNTL1_VAL_SINGLE_MEASUREMENT_MODE };
+    const AP_HAL::Device::Transaction batch[] {
+        { &read_reg, 1, (uint8_t *) &buffer, sizeof(buffer) },
+        { start_cmd, sizeof(start_cmd), nullptr, 0 },
+    };
+    if (!_dev->transfer_batch(batch, ARRAY_SIZE(batch))) {
         hal.util->perf_count(_perf_xfer_err);
+        _ignore_next_sample = true;
         return;
     }
 
-    start_conversion();
-
     /* same period, but start counting from now */
     _dev->adjust_periodic_callback(_periodic_handle, SAMPLING_PERIOD_USEC);
 
@@ -68,6 +68,9 @@
 #define FIELD_RADIUS_MIN 150
 #define FIELD_RADIUS_MAX 950
 
+#define COMPASS_CAL_SAMPLE_SCALE_TO_FIXED(__X) ((int16_t)constrain_float(roundf(__X*8.0f), INT16_MIN, INT16_MAX))
+#define COMPASS_CAL_SAMPLE_SCALE_TO_FLOAT(__X) (__X/8.0f)
+
 extern const AP_HAL::HAL& hal;
 
 ////////////////////////////////////////////////////////////
@@ -143,6 +146,14 @@ bool CompassCalibrator::running() {
     return (cal_state.status == Status::RUNNING_STEP_ONE || cal_state.status == Status::RUNNING_STEP_TWO);
 }
 
+bool CompassCalibrator::active() {
+    WITH_SEMAPHORE(state_sem);
+    return (_status_set_requested ||
+            cal_state.status == Status::WAITING_TO_START ||
+            cal_state.status == Status::RUNNING_STEP_ONE ||
+            cal_state.status == Status::RUNNING_STEP_TWO);
+}
+
 const CompassCalibrator::Report CompassCalibrator::get_report() {
     WITH_SEMAPHORE(state_sem);
     return cal_report;
@@ -152,6 +163,7 @@ const CompassCalibrator::State CompassCalibrator::get_state() {
     WITH_SEMAPHORE(state_sem);
     return cal_state;
 }
+
 /////////////////////////////////////////////////////////////
 ////////////////////// PRIVATE METHODS //////////////////////
 /////////////////////////////////////////////////////////////
@@ -231,7 +243,7 @@ void CompassCalibrator::pull_sample()
     }
     if (_running() && _samples_collected < COMPASS_CAL_NUM_SAMPLES && accept_sample(mag_sample.get())) {
         update_completion_mask(mag_sample.get());
-        _sample_buffer[_samples_collected] = mag_sample;
+        _sample_buffer->set(_samples_collected, mag_sample);
         _samples_collected++;
     }
 }
@@ -275,7 +287,7 @@ void CompassCalibrator::update_completion_mask()
 {
     memset(_completion_mask, 0, sizeof(_completion_mask));
     for (int i = 0; i < _samples_collected; i++) {
-        update_completion_mask(_sample_buffer[i].get());
+        update_completion_mask(_sample_buffer->get(i));
     }
 }
 
@@ -396,7 +408,7 @@ bool CompassCalibrator::set_status(CompassCalibrator::Status status)
             }
 
             if (_sample_buffer == nullptr) {
-                _sample_buffer = (CompassSample*)calloc(COMPASS_CAL_NUM_SAMPLES, sizeof(CompassSample));
+                _sample_buffer = (SampleBuffer*)calloc(1, sizeof(SampleBuffer));
             }
             if (_sample_buffer != nullptr) {
                 initialize_fit();
@@ -488,15 +500,13 @@ void CompassCalibrator::thin_samples()
     // this is so that adjacent samples don't get sequentially eliminated
     for (uint16_t i=_samples_collected-1; i>=1; i--) {
         uint16_t j = get_random16() % (i+1);
-        CompassSample temp = _sample_buffer[i];
-        _sample_buffer[i] = _sample_buffer[j];
-        _sample_buffer[j] = temp;
+        _sample_buffer->swap(i, j);
     }
 
     // remove any samples that are close together
     for (uint16_t i=0; i < _samples_collected; i++) {
-        if (!accept_sample(_sample_buffer[i], i)) {
-            _sample_buffer[i] = _sample_buffer[_samples_collected-1];
+        if (!accept_sample(_sample_buffer->get(i), i)) {
+            _sample_buffer->set(i, _sample_buffer->get_sample(_samples_collected-1));
             _samples_collected--;
             _samples_thinned++;
         }
@@ -535,7 +545,7 @@ bool CompassCalibrator::accept_sample(const Vector3f& sample, uint16_t skip_inde
 
     for (uint16_t i = 0; i<_samples_collected; i++) {
         if (i != skip_index) {
-            float distance = (sample - _sample_buffer[i].get()).length();
+            float distance = (sample - _sample_buffer->get(i)).length();
             if (distance < min_distance) {
                 return false;
             }
@@ -549,14 +559,38 @@ bool CompassCalibrator::accept_sample(const CompassSample& sample, uint16_t skip
     return accept_sample(sample.get(), skip_index);
 }
 
-float CompassCalibrator::calc_residual(const Vector3f& sample, const param_t& params) const
+/*
+  calc the residuals of a block of samples starting at start vs a set
+  of parameters (offsets, diagonals, off diagonals). Each axis is read
+  from its own array and each step is a separate loop so the compiler
+  can vectorise them
+ */
+uint8_t CompassCalibrator::calc_block(uint16_t start, const param_t& params, FitBlock &b) const
 {
-    Matrix3f softiron(
-        params.diag.x    , params.offdiag.x , params.offdiag.y,
-        params.offdiag.x , params.diag.y    , params.offdiag.z,
-        params.offdiag.y , params.offdiag.z , params.diag.z
-    );
-    return params.radius - (softiron*(sample+params.offset)).length();
+    const uint8_t n = MIN(COMPASS_CAL_FIT_BLOCK, _samples_collected - start);
+    const Vector3f &offset = params.offset;
+    const Vector3f &diag = params.diag;
+    const Vector3f &offdiag = params.offdiag;
+    const int16_t *x = &_sample_buffer->x[start];
+    const int16_t *y = &_sample_buffer->y[start];
+    const int16_t *z = &_sample_buffer->z[start];
+
+    for (uint8_t k = 0; k < n; k++) {
+        b.sx[k] = COMPASS_CAL_SAMPLE_SCALE_TO_FLOAT(x[k]) + offset.x;
+        b.sy[k] = COMPASS_CAL_SAMPLE_SCALE_TO_FLOAT(y[k]) + offset.y;
+        b.sz[k] = COMPASS_CAL_SAMPLE_SCALE_TO_FLOAT(z[k]) + offset.z;
+    }
+    for (uint8_t k = 0; k < n; k++) {
+        b.A[k] = (diag.x    * b.sx[k]) + (offdiag.x * b.sy[k]) + (offdiag.y * b.sz[k]);
+        b.B[k] = (offdiag.x * b.sx[k]) + (diag.y    * b.sy[k]) + (offdiag.z * b.sz[k]);
+        b.C[k] = (offdiag.y * b.sx[k]) + (offdiag.z * b.sy[k]) + (diag.z    * b.sz[k]);
+    }
+    for (uint8_t k = 0; k < n; k++) {
+        const float length = sqrtf(sq(b.A[k]) + sq(b.B[k]) + sq(b.C[k]));
+        b.inv_length[k] = 1.0f / length;
+        b.resid[k] = params.radius - length;
+    }
+    return n;
 }
 
 // calc the fitness given a set of parameters (offsets, diagonals, off diagonals)
@@ -566,10 +600,12 @@ float CompassCalibrator::calc_mean_squared_residuals(const param_t& params) cons
         return 1.0e30f;
     }
     float sum = 0.0f;
-    for (uint16_t i=0; i < _samples_collected; i++) {
-        Vector3f sample = _sample_buffer[i].get();
-        float resid = calc_residual(sample, params);
-        sum += sq(resid);
+    FitBlock block;
+    for (uint16_t start = 0; start < _samples_collected; start += COMPASS_CAL_FIT_BLOCK) {
+        const uint8_t n = calc_block(start, params, block);
+        for (uint8_t k = 0; k < n; k++) {
+            sum += sq(block.resid[k]);
+        }
     }
     sum /= _samples_collected;
     return sum;
@@ -581,33 +617,46 @@ void CompassCalibrator::calc_initial_offset()
     // Set initial offset to the average value of the samples
     _params.offset.zero();
     for (uint16_t k = 0; k < _samples_collected; k++) {
-        _params.offset -= _sample_buffer[k].get();
+        _params.offset -= _sample_buffer->get(k);
     }
     _params.offset /= _samples_collected;
 }
 
-void CompassCalibrator::calc_sphere_jacob(const Vector3f& sample, const param_t& params, float* ret) const
+// add a block of jacobians and residuals to the upper triangle of JTJ and to JTFI
+void CompassCalibrator::accumulate_normal(const float jacob[][COMPASS_CAL_FIT_BLOCK], const float resid[], uint8_t n,
+                                          uint8_t num_params, float JTJ[], float JTFI[])
+{
+    for (uint8_t i = 0; i < num_params; i++) {
+        // compute JTJ, which is symmetric
+        for (uint8_t j = i; j < num_params; j++) {
+            float sum = 0.0f;
+            for (uint8_t k = 0; k < n; k++) {
+                sum += jacob[i][k] * jacob[j][k];
+            }
+            JTJ[i*num_params+j] += sum;
+        }
+        // compute JTFI
+        float sum = 0.0f;
+        for (uint8_t k = 0; k < n; k++) {
+            sum += jacob[i][k] * resid[k];
+        }
+        JTFI[i] += sum;
+    }
+}
+
+void CompassCalibrator::calc_sphere_jacob(const FitBlock &b, uint8_t n, const param_t& params, float ret[][COMPASS_CAL_FIT_BLOCK]) const
 {
-    const Vector3f &offset = params.offset;
     const Vector3f &diag = params.diag;
     const Vector3f &offdiag = params.offdiag;
-    Matrix3f softiron(
-        diag.x    , offdiag.x , offdiag.y,
-        offdiag.x , diag.y    , offdiag.z,
-        offdiag.y , offdiag.z , diag.z
-    );
-
-    float A =  (diag.x    * (sample.x + offset.x)) + (offdiag.x * (sample.y + offset.y)) + (offdiag.y * (sample.z + offset.z));
-    float B =  (offdiag.x * (sample.x + offset.x)) + (diag.y    * (sample.y + offset.y)) + (offdiag.z * (sample.z + offset.z));
-    float C =  (offdiag.y * (sample.x + offset.x)) + (offdiag.z * (sample.y + offset.y)) + (diag.z    * (sample.z + offset.z));
-    float length = (softiron*(sample+offset)).length();
-
-    // 0: partial derivative (radius wrt fitness fn) fn operated on sample
-    ret[0] = 1.0f;
-    // 1-3: partial derivative (offsets wrt fitness fn) fn operated on sample
-    ret[1] = -1.0f * (((diag.x    * A) + (offdiag.x * B) + (offdiag.y * C))/length);
-    ret[2] = -1.0f * (((offdiag.x * A) + (diag.y    * B) + (offdiag.z * C))/length);
-    ret[3] = -1.0f * (((offdiag.y * A) + (offdiag.z * B) + (diag.z    * C))/length);
+
+    for (uint8_t k = 0; k < n; k++) {
+        // 0: partial derivative (radius wrt fitness fn) fn operated on sample
+        ret[0][k] = 1.0f;
+        // 1-3: partial derivative (offsets wrt fitness fn) fn operated on sample
+        ret[1][k] = -1.0f * ((diag.x    * b.A[k]) + (offdiag.x * b.B[k]) + (offdiag.y * b.C[k])) * b.inv_length[k];
+        ret[2][k] = -1.0f * ((offdiag.x * b.A[k]) + (diag.y    * b.B[k]) + (offdiag.z * b.C[k])) * b.inv_length[k];
+        ret[3][k] = -1.0f * ((offdiag.y * b.A[k]) + (offdiag.z * b.B[k]) + (diag.z    * b.C[k])) * b.inv_length[k];
+    }
 }
 
 // run sphere fit to calculate diagonals and offdiagonals
@@ -626,27 +675,25 @@ void CompassCalibrator::run_sphere_fit()
     fit1_params = fit2_params = _params;
 
     float JTJ[COMPASS_CAL_NUM_SPHERE_PARAMS*COMPASS_CAL_NUM_SPHERE_PARAMS] = { };
-    float JTJ2[COMPASS_CAL_NUM_SPHERE_PARAMS*COMPASS_CAL_NUM_SPHERE_PARAMS] = { };
+    float JTJ2[COMPASS_CAL_NUM_SPHERE_PARAMS*COMPASS_CAL_NUM_SPHERE_PARAMS];
     float JTFI[COMPASS_CAL_NUM_SPHERE_PARAMS] = { };
 
     // Gauss Newton Part common for all kind of extensions including LM
-    for (uint16_t k = 0; k<_samples_collected; k++) {
-        Vector3f sample = _sample_buffer[k].get();
-
-        float sphere_jacob[COMPASS_CAL_NUM_SPHERE_PARAMS];
-
-        calc_sphere_jacob(sample, fit1_params, sphere_jacob);
+    FitBlock block;
+    float sphere_jacob[COMPASS_CAL_NUM_SPHERE_PARAMS][COMPASS_CAL_FIT_BLOCK];
+    for (uint16_t start = 0; start < _samples_collected; start += COMPASS_CAL_FIT_BLOCK) {
+        const uint8_t n = calc_block(start, fit1_params, block);
+        calc_sphere_jacob(block, n, fit1_params, sphere_jacob);
+        accumulate_normal(sphere_jacob, block.resid, n, COMPASS_CAL_NUM_SPHERE_PARAMS, JTJ, JTFI);
+    }
 
-        for (uint8_t i = 0;i < COMPASS_CAL_NUM_SPHERE_PARAMS; i++) {
-            // compute JTJ
-            for (uint8_t j = 0; j < COMPASS_CAL_NUM_SPHERE_PARAMS; j++) {
-                JTJ[i*COMPASS_CAL_NUM_SPHERE_PARAMS+j] += sphere_jacob[i] * sphere_jacob[j];
-                JTJ2[i*COMPASS_CAL_NUM_SPHERE_PARAMS+j] += sphere_jacob[i] * sphere_jacob[j];   //a backup JTJ for LM
-            }
-            // compute JTFI
-            JTFI[i] += sphere_jacob[i] * calc_residual(sample, fit1_params);
+    // fill in the lower triangle of JTJ and take a backup JTJ for LM
+    for (uint8_t i = 0; i < COMPASS_CAL_NUM_SPHERE_PARAMS; i++) {
+        for (uint8_t j = 0; j < i; j++) {
+            JTJ[i*COMPASS_CAL_NUM_SPHERE_PARAMS+j] = JTJ[j*COMPASS_CAL_NUM_SPHERE_PARAMS+i];
         }
     }
+    memcpy(JTJ2, JTJ, sizeof(JTJ2));
 
     //------------------------Levenberg-Marquardt-part-starts-here---------------------------------//
     // refer: http://en.wikipedia.org/wiki/Levenberg%E2%80%93Marquardt_algorithm#Choice_of_damping_parameter
@@ -697,34 +744,25 @@ void CompassCalibrator::run_sphere_fit()
     }
 }
 
-void CompassCalibrator::calc_ellipsoid_jacob(const Vector3f& sample, const param_t& params, float* ret) const
+void CompassCalibrator::calc_ellipsoid_jacob(const FitBlock &b, uint8_t n, const param_t& params, float ret[][COMPASS_CAL_FIT_BLOCK]) const
 {
-    const Vector3f &offset = params.offset;
     const Vector3f &diag = params.diag;
     const Vector3f &offdiag = params.offdiag;
-    Matrix3f softiron(
-        diag.x    , offdiag.x , offdiag.y,
-        offdiag.x , diag.y    , offdiag.z,
-        offdiag.y , offdiag.z , diag.z
-    );
-
-    float A =  (diag.x    * (sample.x + offset.x)) + (offdiag.x * (sample.y + offset.y)) + (offdiag.y * (sample.z + offset.z));
-    float B =  (offdiag.x * (sample.x + offset.x)) + (diag.y    * (sample.y + offset.y)) + (offdiag.z * (sample.z + offset.z));
-    float C =  (offdiag.y * (sample.x + offset.x)) + (offdiag.z * (sample.y + offset.y)) + (diag.z    * (sample.z + offset.z));
-    float length = (softiron*(sample+offset)).length();
-
-    // 0-2: partial derivative (offset wrt fitness fn) fn operated on sample
-    ret[0] = -1.0f * (((diag.x    * A) + (offdiag.x * B) + (offdiag.y * C))/length);
-    ret[1] = -1.0f * (((offdiag.x * A) + (diag.y    * B) + (offdiag.z * C))/length);
-    ret[2] = -1.0f * (((offdiag.y * A) + (offdiag.z * B) + (diag.z    * C))/length);
-    // 3-5: partial derivative (diag offset wrt fitness fn) fn operated on sample
-    ret[3] = -1.0f * ((sample.x + offset.x) * A)/length;
-    ret[4] = -1.0f * ((sample.y + offset.y) * B)/length;
-    ret[5] = -1.0f * ((sample.z + offset.z) * C)/length;
-    // 6-8: partial derivative (off-diag offset wrt fitness fn) fn operated on sample
-    ret[6] = -1.0f * (((sample.y + offset.y) * A) + ((sample.x + offset.x) * B))/length;
-    ret[7] = -1.0f * (((sample.z + offset.z) * A) + ((sample.x + offset.x) * C))/length;
-    ret[8] = -1.0f * (((sample.z + offset.z) * B) + ((sample.y + offset.y) * C))/length;
+
+    for (uint8_t k = 0; k < n; k++) {
+        // 0-2: partial derivative (offset wrt fitness fn) fn operated on sample
+        ret[0][k] = -1.0f * ((diag.x    * b.A[k]) + (offdiag.x * b.B[k]) + (offdiag.y * b.C[k])) * b.inv_length[k];
+        ret[1][k] = -1.0f * ((offdiag.x * b.A[k]) + (diag.y    * b.B[k]) + (offdiag.z * b.C[k])) * b.inv_length[k];
+        ret[2][k] = -1.0f * ((offdiag.y * b.A[k]) + (offdiag.z * b.B[k]) + (diag.z    * b.C[k])) * b.inv_length[k];
+        // 3-5: partial derivative (diag offset wrt fitness fn) fn operated on sample
+        ret[3][k] = -1.0f * (b.sx[k] * b.A[k]) * b.inv_length[k];
+        ret[4][k] = -1.0f * (b.sy[k] * b.B[k]) * b.inv_length[k];
+        ret[5][k] = -1.0f * (b.sz[k] * b.C[k]) * b.inv_length[k];
+        // 6-8: partial derivative (off-diag offset wrt fitness fn) fn operated on sample
+        ret[6][k] = -1.0f * ((b.sy[k] * b.A[k]) + (b.sx[k] * b.B[k])) * b.inv_length[k];
+        ret[7][k] = -1.0f * ((b.sz[k] * b.A[k]) + (b.sx[k] * b.C[k])) * b.inv_length[k];
+        ret[8][k] = -1.0f * ((b.sz[k] * b.B[k]) + (b.sy[k] * b.C[k])) * b.inv_length[k];
+    }
 }
 
 void CompassCalibrator::run_ellipsoid_fit()
@@ -742,27 +780,25 @@ void CompassCalibrator::run_ellipsoid_fit()
     fit1_params = fit2_params = _params;
 
     float JTJ[COMPASS_CAL_NUM_ELLIPSOID_PARAMS*COMPASS_CAL_NUM_ELLIPSOID_PARAMS] = { };
-    float JTJ2[COMPASS_CAL_NUM_ELLIPSOID_PARAMS*COMPASS_CAL_NUM_ELLIPSOID_PARAMS] = { };
+    float JTJ2[COMPASS_CAL_NUM_ELLIPSOID_PARAMS*COMPASS_CAL_NUM_ELLIPSOID_PARAMS];
     float JTFI[COMPASS_CAL_NUM_ELLIPSOID_PARAMS] = { };
 
     // Gauss Newton Part common for all kind of extensions including LM
-    for (uint16_t k = 0; k<_samples_collected; k++) {
-        Vector3f sample = _sample_buffer[k].get();
-
-        float ellipsoid_jacob[COMPASS_CAL_NUM_ELLIPSOID_PARAMS];
-
-        calc_ellipsoid_jacob(sample, fit1_params, ellipsoid_jacob);
+    FitBlock block;
+    float ellipsoid_jacob[COMPASS_CAL_NUM_ELLIPSOID_PARAMS][COMPASS_CAL_FIT_BLOCK];
+    for (uint16_t start = 0; start < _samples_collected; start += COMPASS_CAL_FIT_BLOCK) {
+        const uint8_t n = calc_block(start, fit1_params, block);
+        calc_ellipsoid_jacob(block, n, fit1_params, ellipsoid_jacob);
+        accumulate_normal(ellipsoid_jacob, block.resid, n, COMPASS_CAL_NUM_ELLIPSOID_PARAMS, JTJ, JTFI);
+    }
 
-        for (uint8_t i = 0;i < COMPASS_CAL_NUM_ELLIPSOID_PARAMS; i++) {
-            // compute JTJ
-            for (uint8_t j = 0; j < COMPASS_CAL_NUM_ELLIPSOID_PARAMS; j++) {
-                JTJ [i*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+j] += ellipsoid_jacob[i] * ellipsoid_jacob[j];
-                JTJ2[i*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+j] += ellipsoid_jacob[i] * ellipsoid_jacob[j];
-            }
-            // compute JTFI
-            JTFI[i] += ellipsoid_jacob[i] * calc_residual(sample, fit1_params);
+    // fill in the lower triangle of JTJ and take a backup JTJ for LM
+    for (uint8_t i = 0; i < COMPASS_CAL_NUM_ELLIPSOID_PARAMS; i++) {
+        for (uint8_t j = 0; j < i; j++) {
+            JTJ[i*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+j] = JTJ[j*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+i];
         }
     }
+    memcpy(JTJ2, JTJ, sizeof(JTJ2));
 
     //------------------------Levenberg-Marquardt-part-starts-here---------------------------------//
     //refer: http://en.wikipedia.org/wiki/Levenberg%E2%80%93Marquardt_algorithm#Choice_of_damping_parameter
@@ -818,9 +854,6 @@ void CompassCalibrator::run_ellipsoid_fit()
 //////////// CompassSample public interface //////////////
 //////////////////////////////////////////////////////////
 
-#define COMPASS_CAL_SAMPLE_SCALE_TO_FIXED(__X) ((int16_t)constrain_float(roundf(__X*8.0f), INT16_MIN, INT16_MAX))
-#define COMPASS_CAL_SAMPLE_SCALE_TO_FLOAT(__X) (__X/8.0f)
-
 Vector3f CompassCalibrator::CompassSample::get() const
 {
     return Vector3f(COMPASS_CAL_SAMPLE_SCALE_TO_FLOAT(x),
@@ -835,6 +868,49 @@ void CompassCalibrator::CompassSample::set(const Vector3f &in)
     z = COMPASS_CAL_SAMPLE_SCALE_TO_FIXED(in.z);
 }
 
+//////////////////////////////////////////////////////////
+//////////// SampleBuffer public interface ///////////////
+//////////////////////////////////////////////////////////
+
+Vector3f CompassCalibrator::SampleBuffer::get(uint16_t i) const
+{
+    return Vector3f(COMPASS_CAL_SAMPLE_SCALE_TO_FLOAT(x[i]),
+                    COMPASS_CAL_SAMPLE_SCALE_TO_FLOAT(y[i]),
+                    COMPASS_CAL_SAMPLE_SCALE_TO_FLOAT(z[i]));
+}
+
+CompassCalibrator::CompassSample CompassCalibrator::SampleBuffer::get_sample(uint16_t i) const
+{
+    CompassSample sample;
+    sample.x = x[i];
+    sample.y = y[i];
+    sample.z = z[i];
+    sample.att = att[i];
+    return sample;
+}
+
+void CompassCalibrator::SampleBuffer::set(uint16_t i, const CompassSample &sample)
+{
+    x[i] = sample.x;
+    y[i] = sample.y;
+    z[i] = sample.z;
+    att[i] = sample.att;
+}
+
+void CompassCalibrator::SampleBuffer::set(uint16_t i, const Vector3f &v)
+{
+    x[i] = COMPASS_CAL_SAMPLE_SCALE_TO_FIXED(v.x);
+    y[i] = COMPASS_CAL_SAMPLE_SCALE_TO_FIXED(v.y);
+    z[i] = COMPASS_CAL_SAMPLE_SCALE_TO_FIXED(v.z);
+}
+
+void CompassCalibrator::SampleBuffer::swap(uint16_t i, uint16_t j)
+{
+    const CompassSample tmp = get_sample(i);
+    set(i, get_sample(j));
+    set(j, tmp);
+}
+
 void CompassCalibrator::AttitudeSample::set_from_ahrs(void)
 {
     const Matrix3f &dcm = AP::ahrs().get_DCM_rotation_body_to_ned();
@@ -867,9 +943,9 @@ Matrix3f CompassCalibrator::AttitudeSample::get_rotmat(void)
   Note that this earth field uses an arbitrary north reference, so it
   may not match the true earth field.
  */
-Vector3f CompassCalibrator::calculate_earth_field(CompassSample &sample, enum Rotation r)
+Vector3f CompassCalibrator::calculate_earth_field(uint16_t i, enum Rotation r)
 {
-    Vector3f v = sample.get();
+    Vector3f v = _sample_buffer->get(i);
 
     // convert the sample back to sensor frame
     v.rotate_inverse(_orientation);
@@ -886,7 +962,7 @@ Vector3f CompassCalibrator::calculate_earth_field(CompassSample &sample, enum Ro
     v += rot_offsets;
 
     // rotate the sample from body frame back to earth frame
-    Matrix3f rot = sample.att.get_rotmat();
+    Matrix3f rot = _sample_buffer->att[i].get_rotmat();
 
     Vector3f efield = rot * v;
 
@@ -917,14 +993,14 @@ bool CompassCalibrator::calculate_orientation(void)
         // calculate the average implied earth field across all samples
         Vector3f total_ef {};
         for (uint32_t i=0; i<_samples_collected; i++) {
-            Vector3f efield = calculate_earth_field(_sample_buffer[i], r);
+            Vector3f efield = calculate_earth_field(i, r);
             total_ef += efield;
         }
         Vector3f avg_efield = total_ef / _samples_collected;
 
         // now calculate the square error for this rotation against the average earth field
         for (uint32_t i=0; i<_samples_collected; i++) {
-            Vector3f efield = calculate_earth_field(_sample_buffer[i], r);
+            Vector3f efield = calculate_earth_field(i, r);
             float err = (efield - avg_efield).length_squared();
             // divide by number of samples collected to get the variance
             variance[r] += err / _samples_collected;
@@ -1005,10 +1081,10 @@ bool CompassCalibrator::calculate_orientation(void)
 
     // rotate the samples for the new orientation
     for (uint32_t i=0; i<_samples_collected; i++) {
-        Vector3f s = _sample_buffer[i].get();
+        Vector3f s = _sample_buffer->get(i);
         s.rotate_inverse(_orientation);
         s.rotate(besti);
-        _sample_buffer[i].set(s);
+        _sample_buffer->set(i, s);
     }
 
     _orientation = besti;
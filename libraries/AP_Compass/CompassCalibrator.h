@@ -5,11 +5,13 @@
 #define COMPASS_CAL_NUM_SPHERE_PARAMS       4
 #define COMPASS_CAL_NUM_ELLIPSOID_PARAMS    9
 #define COMPASS_CAL_NUM_SAMPLES             300     // number of samples required before fitting begins
+#define COMPASS_CAL_FIT_BLOCK               4       // number of samples processed together by the fitting loops
 
 #define COMPASS_MAX_SCALE_FACTOR 1.5
 #define COMPASS_MIN_SCALE_FACTOR (1.0/COMPASS_MAX_SCALE_FACTOR)
 
 class CompassCalibrator {
+    friend class CompassCalibrator_Benchmark;
 public:
     CompassCalibrator();
 
@@ -29,6 +31,10 @@ public:
     // failed is true if either of the failure states are hit
     bool failed();
 
+    // active is true if waiting to start or running, or if a start or
+    // stop has been requested, so update() needs calling often
+    bool active();
+
 
     // update the state machine and calculate offsets, diagonals and offdiagonals
     void update();
@@ -122,8 +128,11 @@ private:
         int8_t yaw;
     };
 
+    class SampleBuffer;
+
     // compact class to hold compass samples, to save memory
     class CompassSample {
+        friend class SampleBuffer;
     public:
         Vector3f get() const;
         void set(const Vector3f &in);
@@ -134,6 +143,33 @@ private:
         int16_t z;
     };
 
+    // buffer of compass samples held as a structure of arrays, so the
+    // fitting loops read each axis from contiguous memory
+    class SampleBuffer {
+    public:
+        Vector3f get(uint16_t i) const;
+        CompassSample get_sample(uint16_t i) const;
+        void set(uint16_t i, const CompassSample &sample);
+        void set(uint16_t i, const Vector3f &v);
+        void swap(uint16_t i, uint16_t j);
+        int16_t x[COMPASS_CAL_NUM_SAMPLES];
+        int16_t y[COMPASS_CAL_NUM_SAMPLES];
+        int16_t z[COMPASS_CAL_NUM_SAMPLES];
+        AttitudeSample att[COMPASS_CAL_NUM_SAMPLES];
+    };
+
+    // intermediate values for a block of samples vs a set of parameters
+    struct FitBlock {
+        float sx[COMPASS_CAL_FIT_BLOCK];            // sample plus offsets
+        float sy[COMPASS_CAL_FIT_BLOCK];
+        float sz[COMPASS_CAL_FIT_BLOCK];
+        float A[COMPASS_CAL_FIT_BLOCK];             // soft iron corrected sample
+        float B[COMPASS_CAL_FIT_BLOCK];
+        float C[COMPASS_CAL_FIT_BLOCK];
+        float inv_length[COMPASS_CAL_FIT_BLOCK];    // reciprocal of corrected field length
+        float resid[COMPASS_CAL_FIT_BLOCK];         // radius minus corrected field length
+    };
+
     // set status including any required initialisation
     bool set_status(Status status);
 
@@ -159,8 +195,9 @@ private:
     // thins out samples between step one and step two
     void thin_samples();
 
-    // calc the fitness of a single sample vs a set of parameters (offsets, diagonals, off diagonals)
-    float calc_residual(const Vector3f& sample, const param_t& params) const;
+    // calc the residuals of a block of samples starting at start vs a set of parameters (offsets, diagonals, off diagonals)
+    // returns the number of samples in the block
+    uint8_t calc_block(uint16_t start, const param_t& params, FitBlock &b) const;
 
     // calc the fitness of the parameters (offsets, diagonals, off diagonals) vs all the samples collected
     // returns 1.0e30f if the sample buffer is empty
@@ -169,12 +206,16 @@ private:
     // calculate initial offsets by simply taking the average values of the samples
     void calc_initial_offset();
 
+    // add a block of jacobians and residuals to the upper triangle of JTJ and to JTFI
+    static void accumulate_normal(const float jacob[][COMPASS_CAL_FIT_BLOCK], const float resid[], uint8_t n,
+                                  uint8_t num_params, float JTJ[], float JTFI[]);
+
     // run sphere fit to calculate diagonals and offdiagonals
-    void calc_sphere_jacob(const Vector3f& sample, const param_t& params, float* ret) const;
+    void calc_sphere_jacob(const FitBlock &b, uint8_t n, const param_t& params, float ret[][COMPASS_CAL_FIT_BLOCK]) const;
     void run_sphere_fit();
 
     // run ellipsoid fit to calculate diagonals and offdiagonals
-    void calc_ellipsoid_jacob(const Vector3f& sample, const param_t& params, float* ret) const;
+    void calc_ellipsoid_jacob(const FitBlock &b, uint8_t n, const param_t& params, float ret[][COMPASS_CAL_FIT_BLOCK]) const;
     void run_ellipsoid_fit();
 
     // update the completion mask based on a single sample
@@ -184,7 +225,7 @@ private:
     void update_completion_mask();
 
     // calculate compass orientation
-    Vector3f calculate_earth_field(CompassSample &sample, enum Rotation r);
+    Vector3f calculate_earth_field(uint16_t i, enum Rotation r);
     bool calculate_orientation();
 
     // fix radius to compensate for sensor scaling errors
@@ -211,7 +252,7 @@ private:
     uint32_t _start_time_ms;                // system time start() function was last called
     uint8_t _attempt;                       // number of attempts have been made to calibrate
     completion_mask_t _completion_mask;     // bitmask of directions in which we have samples
-    CompassSample *_sample_buffer;          // buffer of sensor values
+    SampleBuffer *_sample_buffer;           // buffer of sensor values
     uint16_t _samples_collected;            // number of samples in buffer
     uint16_t _samples_thinned;              // number of samples removed by the thin_samples() call (called before step 2 begins)
 
@@ -0,0 +1,89 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+
+#include <AP_Compass/CompassCalibrator.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  feed a calibrator with a full buffer of synthetic samples and run
+  the fit steps CompassCalibrator::update() makes once the buffer is
+  full. The samples are a 450mGauss field rotated to evenly spread
+  directions, distorted by hard and soft iron errors and noise
+ */
+class CompassCalibrator_Benchmark {
+public:
+    CompassCalibrator_Benchmark() {
+        cal = new CompassCalibrator();
+        cal->_sample_buffer = (CompassCalibrator::SampleBuffer*)calloc(1, sizeof(CompassCalibrator::SampleBuffer));
+
+        const Vector3f hard_iron { 120, -80, 45 };
+        const Matrix3f soft_iron { 1.08f, 0.04f, -0.02f,
+                                   0.04f, 0.93f, 0.03f,
+                                  -0.02f, 0.03f, 1.02f };
+        uint32_t seed = 1;
+        auto noise = [&seed]() {
+            seed = seed * 1103515245U + 12345U;
+            return ((seed >> 16) % 1000) * 0.004f - 2.0f;
+        };
+        for (uint16_t i=0; i<COMPASS_CAL_NUM_SAMPLES; i++) {
+            // spiral points over the sphere
+            const float z = 1 - 2 * (i + 0.5f) / COMPASS_CAL_NUM_SAMPLES;
+            const float r = sqrtf(1 - sq(z));
+            const float theta = i * M_PI * (3 - sqrtf(5));
+            const Vector3f field = Vector3f(r * cosf(theta), r * sinf(theta), z) * 450;
+            const Vector3f sample = soft_iron * field + hard_iron + Vector3f(noise(), noise(), noise());
+            cal->_sample_buffer->set(i, sample);
+        }
+    }
+
+    ~CompassCalibrator_Benchmark() {
+        free(cal->_sample_buffer);
+        cal->_sample_buffer = nullptr;
+        delete cal;
+    }
+
+    // returns the RMS residual of the fit
+    float fit() {
+        cal->reset_state();
+        cal->_samples_collected = COMPASS_CAL_NUM_SAMPLES;
+
+        // RUNNING_STEP_ONE
+        cal->calc_initial_offset();
+        for (uint8_t step=0; step<10; step++) {
+            cal->run_sphere_fit();
+        }
+
+        // RUNNING_STEP_TWO, without thinning so each run is the same
+        cal->initialize_fit();
+        for (uint8_t step=0; step<35; step++) {
+            if (step < 15) {
+                cal->run_sphere_fit();
+            } else {
+                cal->run_ellipsoid_fit();
+            }
+        }
+        return sqrtf(cal->_fitness);
+    }
+
+private:
+    CompassCalibrator *cal;
+};
+
+static void BM_CompassCalFit(benchmark::State& state)
+{
+    CompassCalibrator_Benchmark bench;
+    float fitness = 0;
+
+    while (state.KeepRunning()) {
+        fitness = bench.fit();
+    }
+
+    char label[32];
+    snprintf(label, sizeof(label), "fitness %.2f", double(fitness));
+    state.SetLabel(label);
+}
+
+BENCHMARK(BM_CompassCalFit);
+
+BENCHMARK_MAIN()
@@ -18,6 +18,8 @@ AP_DAL *AP_DAL::_singleton = nullptr;
 
 bool AP_DAL::force_write;
 bool AP_DAL::logging_started;
+AP_DAL_DeltaEncoder *AP_DAL::delta;
+bool AP_DAL::delta_active;
 
 void AP_DAL::start_frame(AP_DAL::FrameType frametype)
 {
@@ -40,6 +42,9 @@ void AP_DAL::start_frame(AP_DAL::FrameType frametype)
     bool logging = AP::logger().logging_started() && AP::logger().allow_start_ekf();
     if (logging && !logging_started) {
         force_write = true;
+        if (delta != nullptr) {
+            delta->reset();
+        }
     }
     logging_started = logging;
 
@@ -49,6 +54,7 @@ void AP_DAL::start_frame(AP_DAL::FrameType frametype)
     
     _RFRH.time_flying_ms = AP::vehicle()->get_time_flying_ms();
     _RFRH.time_us = AP_HAL::micros64();
+    update_delta(logging);
     WRITE_REPLAY_BLOCK(RFRH, _RFRH);
 
     // update RFRN data
@@ -139,6 +145,36 @@ void AP_DAL::init_sensors(void)
     }
 }
 
+/*
+  start or stop delta encoding as LOG_REPLAY changes, and write a
+  keyframe every DAL_DELTA_KEYFRAME_US
+ */
+void AP_DAL::update_delta(bool logging)
+{
+    const bool use_delta = logging && AP::logger().log_replay() == 2;
+    if (use_delta && delta == nullptr) {
+        // if this fails the messages are written in full
+        delta = new AP_DAL_DeltaEncoder;
+    }
+    if (delta_active && !use_delta) {
+        // full messages must come after the stream
+        delta->flush();
+    }
+    delta_active = use_delta && delta != nullptr;
+    if (!delta_active) {
+        return;
+    }
+
+    if (delta->check_lost() ||
+        _RFRH.time_us - last_keyframe_us >= DAL_DELTA_KEYFRAME_US) {
+        // writing everything in full lets Replay pick up the stream
+        // after lost data
+        delta->keyframe();
+        force_write = true;
+        last_keyframe_us = _RFRH.time_us;
+    }
+}
+
 /*
   end a frame. Must be called on all events and injections of data (eg
   flow) and before starting a new frame
@@ -158,7 +194,7 @@ void AP_DAL::log_event2(AP_DAL::Event event)
     struct log_REV2 pkt{
         event          : uint8_t(event),
     };
-    WRITE_REPLAY_BLOCK(REV2, pkt);
+    WRITE_REPLAY_EVENT(REV2, pkt);
 #endif
 }
 
@@ -170,7 +206,7 @@ void AP_DAL::log_SetOriginLLH2(const Location &loc)
         lng            : loc.lng,
         alt            : loc.alt,
     };
-    WRITE_REPLAY_BLOCK(RSO2, pkt);
+    WRITE_REPLAY_EVENT(RSO2, pkt);
 #endif
 }
 
@@ -180,7 +216,7 @@ void AP_DAL::log_writeDefaultAirSpeed2(const float aspeed)
     struct log_RWA2 pkt{
         airspeed:      aspeed,
     };
-    WRITE_REPLAY_BLOCK(RWA2, pkt);
+    WRITE_REPLAY_EVENT(RWA2, pkt);
 #endif
 }
 
@@ -191,7 +227,7 @@ void AP_DAL::log_event3(AP_DAL::Event event)
     struct log_REV3 pkt{
         event          : uint8_t(event),
     };
-    WRITE_REPLAY_BLOCK(REV3, pkt);
+    WRITE_REPLAY_EVENT(REV3, pkt);
 #endif
 }
 
@@ -203,7 +239,7 @@ void AP_DAL::log_SetOriginLLH3(const Location &loc)
         lng            : loc.lng,
         alt            : loc.alt,
     };
-    WRITE_REPLAY_BLOCK(RSO3, pkt);
+    WRITE_REPLAY_EVENT(RSO3, pkt);
 #endif
 }
 
@@ -213,7 +249,7 @@ void AP_DAL::log_writeDefaultAirSpeed3(const float aspeed)
     struct log_RWA3 pkt{
         airspeed:      aspeed,
     };
-    WRITE_REPLAY_BLOCK(RWA3, pkt);
+    WRITE_REPLAY_EVENT(RWA3, pkt);
 #endif
 }
 
@@ -226,7 +262,7 @@ void AP_DAL::log_writeEulerYawAngle(float yawAngle, float yawAngleErr, uint32_t
         timestamp_ms   : timeStamp_ms,
         type           : type,
     };
-    WRITE_REPLAY_BLOCK(REY3, pkt);
+    WRITE_REPLAY_EVENT(REY3, pkt);
 #endif
 }
 
@@ -264,8 +300,9 @@ uint8_t AP_DAL::logging_core(uint8_t c) const
 }
 
 // write out a DAL log message. If old_msg is non-null, then
-// only write if the content has changed
-void AP_DAL::WriteLogMessage(enum LogMessages msg_type, void *msg, const void *old_msg, uint8_t msg_size)
+// only write if the content has changed. If delta_ok is false the
+// message is always written in full
+void AP_DAL::WriteLogMessage(enum LogMessages msg_type, void *msg, const void *old_msg, uint8_t msg_size, bool delta_ok)
 {
     if (!logging_started) {
         // we're not logging
@@ -277,6 +314,15 @@ void AP_DAL::WriteLogMessage(enum LogMessages msg_type, void *msg, const void *o
         // no change, skip this block write
         return;
     }
+    if (delta_active) {
+        if (delta_ok && delta->encode(msg_type, msg, msg_size)) {
+            // a lost RDLT is caught by delta->check_lost()
+            _end = 0;
+            return;
+        }
+        // keep the message after the records before it
+        delta->flush();
+    }
     if (!AP::logger().WriteReplayBlock(msg_type, msg, msg_size)) {
         // mark for forced write next time
         _end = 1;
@@ -8,6 +8,7 @@
 #include "AP_DAL_Airspeed.h"
 #include "AP_DAL_Beacon.h"
 #include "AP_DAL_VisualOdom.h"
+#include "AP_DAL_DeltaStream.h"
 
 #include "LogStructure.h"
 
@@ -308,8 +309,9 @@ public:
     uint8_t logging_core(uint8_t c) const;
 
     // write out a DAL log message. If old_msg is non-null, then
-    // only write if the content has changed
-    static void WriteLogMessage(enum LogMessages msg_type, void *msg, const void *old_msg, uint8_t msg_size);
+    // only write if the content has changed. If delta_ok is false the
+    // message is always written in full
+    static void WriteLogMessage(enum LogMessages msg_type, void *msg, const void *old_msg, uint8_t msg_size, bool delta_ok=true);
 
 private:
 
@@ -349,6 +351,12 @@ private:
     static bool logging_started;
     static bool force_write;
 
+    // delta encoding of replay messages when LOG_REPLAY is 2
+    static AP_DAL_DeltaEncoder *delta;
+    static bool delta_active;
+    uint64_t last_keyframe_us;
+    void update_delta(bool logging);
+
     bool ekf2_init_done;
     bool ekf3_init_done;
 
@@ -357,6 +365,8 @@ private:
 };
 
 #define WRITE_REPLAY_BLOCK(sname,v) AP_DAL::WriteLogMessage(LOG_## sname ##_MSG, &v, nullptr, offsetof(log_ ##sname, _end))
+// events are written from a local structure, so are never delta encoded
+#define WRITE_REPLAY_EVENT(sname,v) AP_DAL::WriteLogMessage(LOG_## sname ##_MSG, &v, nullptr, offsetof(log_ ##sname, _end), false)
 #define WRITE_REPLAY_BLOCK_IFCHANGED(sname,v,old) do { static_assert(sizeof(v) == sizeof(old), "types must match"); \
                                                       AP_DAL::WriteLogMessage(LOG_## sname ##_MSG, &v, &old, offsetof(log_ ##sname, _end)); } \
                                                  while (0)
@@ -0,0 +1,257 @@
+#include "AP_DAL_DeltaStream.h"
+
+#include <AP_Logger/AP_Logger.h>
+#include <AP_Math/AP_Math.h>
+
+static_assert(DAL_DELTA_MAX_CHANNELS <= 0x40, "channel must fit in a record header");
+static_assert(sizeof(log_RDLT::data) < 0xFF, "0xFF is used for no record start");
+
+#define RECORD_FULL      0x80
+#define RECORD_UNCHANGED 0x40
+#define RECORD_CHANNEL   0x3F
+
+#define NO_RECORD_START  0xFF
+
+/*
+  find the channel for a message, adding one if this is the first
+  time it has been seen
+ */
+AP_DAL_DeltaEncoder::channel *AP_DAL_DeltaEncoder::find_channel(uint8_t msg_type, const void *msg, uint8_t size)
+{
+    for (uint8_t i=0; i<num_channels; i++) {
+        channel &c = channels[i];
+        if (c.src == msg && c.msg_type == msg_type) {
+            return &c;
+        }
+    }
+    if (num_channels >= ARRAY_SIZE(channels)) {
+        return nullptr;
+    }
+    uint8_t *last = new uint8_t[size];
+    if (last == nullptr) {
+        return nullptr;
+    }
+    channel &c = channels[num_channels++];
+    c.src = msg;
+    c.last = last;
+    c.msg_type = msg_type;
+    c.size = size;
+    c.full = true;
+    return &c;
+}
+
+bool AP_DAL_DeltaEncoder::encode(uint8_t msg_type, const void *msg, uint8_t size)
+{
+    if (size > DAL_DELTA_MAX_MSG_SIZE) {
+        return false;
+    }
+    channel *c = find_channel(msg_type, msg, size);
+    if (c == nullptr) {
+        return false;
+    }
+    const uint8_t *bytes = (const uint8_t *)msg;
+    const uint8_t chan = c - &channels[0];
+
+    uint8_t rec[DAL_DELTA_MAX_RECORD];
+    uint8_t len = 0;
+    if (c->full) {
+        rec[len++] = RECORD_FULL | chan;
+        rec[len++] = msg_type;
+        rec[len++] = size;
+        memcpy(&rec[len], bytes, size);
+        len += size;
+        c->full = false;
+    } else {
+        const uint8_t mask_len = (size+7)/8;
+        uint8_t *mask = &rec[1];
+        memset(mask, 0, mask_len);
+        len = 1 + mask_len;
+        for (uint8_t i=0; i<size; i++) {
+            const uint8_t x = bytes[i] ^ c->last[i];
+            if (x != 0) {
+                mask[i/8] |= 1U<<(i%8);
+                rec[len++] = x;
+            }
+        }
+        if (len == 1 + mask_len) {
+            rec[0] = RECORD_UNCHANGED | chan;
+            len = 1;
+        } else {
+            rec[0] = chan;
+        }
+    }
+    memcpy(c->last, bytes, size);
+
+    if (chunk.first == NO_RECORD_START) {
+        chunk.first = chunk.len;
+    }
+    put(rec, len);
+    return true;
+}
+
+// append bytes to the stream, writing out each RDLT as it fills
+void AP_DAL_DeltaEncoder::put(const uint8_t *bytes, uint8_t len)
+{
+    while (len > 0) {
+        const uint8_t n = MIN(len, sizeof(chunk.data) - chunk.len);
+        memcpy(&chunk.data[chunk.len], bytes, n);
+        chunk.len += n;
+        bytes += n;
+        len -= n;
+        if (chunk.len == sizeof(chunk.data)) {
+            write_out();
+        }
+    }
+}
+
+void AP_DAL_DeltaEncoder::write_out(void)
+{
+    if (!write_chunk(chunk)) {
+        // the reader will see the gap in the sequence. Start the
+        // channels again so that it can pick up the stream
+        lost = true;
+        keyframe();
+    }
+    chunk.seq++;
+    chunk.len = 0;
+    chunk.first = NO_RECORD_START;
+}
+
+void AP_DAL_DeltaEncoder::flush(void)
+{
+    if (chunk.len > 0) {
+        write_out();
+    }
+}
+
+void AP_DAL_DeltaEncoder::keyframe(void)
+{
+    for (uint8_t i=0; i<num_channels; i++) {
+        channels[i].full = true;
+    }
+}
+
+void AP_DAL_DeltaEncoder::reset(void)
+{
+    if (chunk.len > 0) {
+        // the sequence number of the discarded data is skipped so
+        // that a reader doesn't join it to the next record
+        chunk.seq++;
+        chunk.len = 0;
+    }
+    chunk.first = NO_RECORD_START;
+    keyframe();
+    lost = false;
+}
+
+bool AP_DAL_DeltaEncoder::write_chunk(const log_RDLT &pkt)
+{
+    return AP::logger().WriteReplayBlock(LOG_RDLT_MSG, &pkt, offsetof(log_RDLT, _end));
+}
+
+void AP_DAL_DeltaDecoder::lose_sync(void)
+{
+    in_sync = false;
+    buf_len = 0;
+    buf_ofs = 0;
+    // keep the message types and sizes so that the records of other
+    // channels can be stepped over until a full record arrives
+    for (uint8_t i=0; i<ARRAY_SIZE(channels); i++) {
+        channels[i].valid = false;
+    }
+}
+
+void AP_DAL_DeltaDecoder::feed(const log_RDLT &pkt)
+{
+    if (have_seq && pkt.seq != uint8_t(last_seq+1)) {
+        lose_sync();
+    }
+    have_seq = true;
+    last_seq = pkt.seq;
+
+    const uint8_t len = MIN(pkt.len, sizeof(pkt.data));
+    uint8_t ofs = 0;
+    if (!in_sync) {
+        if (pkt.first >= len) {
+            // no record starts in this RDLT
+            return;
+        }
+        ofs = pkt.first;
+        in_sync = true;
+    }
+    const uint8_t n = len - ofs;
+
+    // move any partial record to the start of the buffer
+    memmove(&buf[0], &buf[buf_ofs], buf_len - buf_ofs);
+    buf_len -= buf_ofs;
+    buf_ofs = 0;
+    if (n > sizeof(buf) - buf_len) {
+        // the buffer only ever holds a partial record and one RDLT
+        lose_sync();
+        return;
+    }
+    memcpy(&buf[buf_len], &pkt.data[ofs], n);
+    buf_len += n;
+}
+
+bool AP_DAL_DeltaDecoder::next(uint8_t &msg_type, uint8_t *msg, uint8_t &size)
+{
+    while (in_sync && buf_ofs < buf_len) {
+        const uint8_t *rec = &buf[buf_ofs];
+        const uint8_t avail = buf_len - buf_ofs;
+        channel &c = channels[rec[0] & RECORD_CHANNEL];
+
+        if (rec[0] & RECORD_FULL) {
+            if (avail < 3) {
+                return false;
+            }
+            if (rec[2] > DAL_DELTA_MAX_MSG_SIZE) {
+                lose_sync();
+                return false;
+            }
+            if (avail < 3 + rec[2]) {
+                return false;
+            }
+            c.msg_type = rec[1];
+            c.size = rec[2];
+            memcpy(c.data, &rec[3], c.size);
+            c.valid = true;
+            buf_ofs += 3 + c.size;
+        } else if (c.size == 0) {
+            // the channel was never defined, so the length of the
+            // record isn't known
+            lose_sync();
+            return false;
+        } else if (rec[0] & RECORD_UNCHANGED) {
+            buf_ofs++;
+        } else {
+            const uint8_t mask_len = (c.size+7)/8;
+            if (avail < 1 + mask_len) {
+                return false;
+            }
+            const uint8_t *mask = &rec[1];
+            uint8_t changed = 0;
+            for (uint8_t i=0; i<mask_len; i++) {
+                changed += __builtin_popcount(mask[i]);
+            }
+            if (avail < 1 + mask_len + changed) {
+                return false;
+            }
+            const uint8_t *x = &rec[1 + mask_len];
+            for (uint8_t i=0; i<c.size; i++) {
+                if (mask[i/8] & (1U<<(i%8))) {
+                    c.data[i] ^= *x++;
+                }
+            }
+            buf_ofs += 1 + mask_len + changed;
+        }
+
+        if (c.valid) {
+            msg_type = c.msg_type;
+            size = c.size;
+            memcpy(msg, c.data, size);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "LogStructure.h"
+
+/*
+  delta encoding of replay messages.
+
+  Each message written by the DAL is given a channel, one per message
+  type and source structure. The first record on a channel holds the
+  whole message, after that a record holds a bitmask of the bytes
+  that differ from the previous message on the channel followed by the
+  XOR of those bytes. A message that has not changed is a single
+  byte.
+
+  Records are packed back to back into the data of RDLT messages, so
+  a record may be split between two of them. Each RDLT has a sequence
+  number and the offset of the first record that starts in it, which
+  lets a reader find its place again after a lost RDLT.
+
+  Record layout:
+    full:      0x80|channel, msg_type, size, message
+    delta:     channel, mask of (size+7)/8 bytes, changed bytes XORed
+    unchanged: 0x40|channel
+ */
+
+#define DAL_DELTA_MAX_CHANNELS 48
+#define DAL_DELTA_MAX_MSG_SIZE 64
+#define DAL_DELTA_MAX_RECORD   (1 + DAL_DELTA_MAX_MSG_SIZE/8 + DAL_DELTA_MAX_MSG_SIZE)
+
+// time between keyframes, where every message is written in full
+#define DAL_DELTA_KEYFRAME_US  1000000U
+
+class AP_DAL_DeltaEncoder {
+public:
+    // add a message to the stream. Returns false if the message can't
+    // be encoded, in which case it must be written in full after a
+    // flush()
+    bool encode(uint8_t msg_type, const void *msg, uint8_t size);
+
+    // write out any partially filled RDLT
+    void flush(void);
+
+    // write the next message on each channel in full
+    void keyframe(void);
+
+    // forget the stream, for the start of a new log
+    void reset(void);
+
+    // returns true once after a RDLT failed to be written. The
+    // caller should write all of its messages again
+    bool check_lost(void) {
+        const bool ret = lost;
+        lost = false;
+        return ret;
+    }
+
+protected:
+    virtual bool write_chunk(const log_RDLT &pkt);
+
+private:
+    struct channel {
+        const void *src;
+        uint8_t *last;
+        uint8_t msg_type;
+        uint8_t size;
+        bool full;
+    } channels[DAL_DELTA_MAX_CHANNELS];
+    uint8_t num_channels;
+
+    log_RDLT chunk;
+    bool lost;
+
+    struct channel *find_channel(uint8_t msg_type, const void *msg, uint8_t size);
+    void put(const uint8_t *bytes, uint8_t len);
+    void write_out(void);
+};
+
+class AP_DAL_DeltaDecoder {
+public:
+    // add a RDLT from the log
+    void feed(const log_RDLT &pkt);
+
+    // get the next message from the stream. msg must have room for
+    // DAL_DELTA_MAX_MSG_SIZE bytes
+    bool next(uint8_t &msg_type, uint8_t *msg, uint8_t &size);
+
+private:
+    struct channel {
+        uint8_t msg_type;
+        uint8_t size;
+        bool valid;
+        uint8_t data[DAL_DELTA_MAX_MSG_SIZE];
+    } channels[0x40];
+
+    // bytes of records not yet decoded, which is at most a partial
+    // record and one RDLT
+    uint8_t buf[DAL_DELTA_MAX_RECORD + sizeof(log_RDLT::data)];
+    uint8_t buf_len;
+    uint8_t buf_ofs;
+
+    uint8_t last_seq;
+    bool have_seq;
+    bool in_sync;
+
+    void lose_sync(void);
+};
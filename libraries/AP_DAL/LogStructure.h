@@ -37,7 +37,8 @@
     LOG_REPH_MSG, \
     LOG_REVH_MSG, \
     LOG_RWOH_MSG, \
-    LOG_RBOH_MSG
+    LOG_RBOH_MSG, \
+    LOG_RDLT_MSG
 
 // Replay Data Structures
 struct log_RFRH {
@@ -351,6 +352,18 @@ struct log_RBOH {
     uint8_t _end;
 };
 
+// @LoggerMessage: RDLT
+// @Description: Replay delta encoded data, carrying the other replay messages when LOG_REPLAY is 2
+struct log_RDLT {
+    uint8_t seq;
+    uint8_t first;
+    uint8_t len;
+    // binary, logged as an int16_t[32] array so log tools don't
+    // treat it as a nul terminated string
+    uint8_t data[64];
+    uint8_t _end;
+};
+
 #define RLOG_SIZE(sname) 3+offsetof(struct log_ ##sname,_end)
 
 #define LOG_STRUCTURE_FROM_DAL        \
@@ -415,4 +428,6 @@ struct log_RBOH {
     { LOG_RWOH_MSG, RLOG_SIZE(RWOH),                                   \
       "RWOH", "ffIffff", "DA,DT,TS,PX,PY,PZ,R", "-------", "-------" }, \
     { LOG_RBOH_MSG, RLOG_SIZE(RBOH),                                   \
-      "RBOH", "ffffffffIfffH", "Q,DPX,DPY,DPZ,DAX,DAY,DAZ,DT,TS,OX,OY,OZ,D", "-------------", "-------------" },
+      "RBOH", "ffffffffIfffH", "Q,DPX,DPY,DPZ,DAX,DAY,DAZ,DT,TS,OX,OY,OZ,D", "-------------", "-------------" }, \
+    { LOG_RDLT_MSG, RLOG_SIZE(RDLT),                                   \
+      "RDLT", "BBBa", "Seq,First,Len,Data", "----", "----" },
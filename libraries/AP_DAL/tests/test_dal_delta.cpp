@@ -0,0 +1,322 @@
+#include <AP_gtest.h>
+
+#include <stdio.h>
+
+#include <AP_DAL/AP_DAL.h>
+#include <AP_DAL/AP_DAL_DeltaStream.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#define MAX_CHUNKS   20000
+#define MAX_MESSAGES 60000
+
+struct message {
+    uint8_t msg_type;
+    uint8_t size;
+    uint8_t data[DAL_DELTA_MAX_MSG_SIZE];
+};
+
+// messages in the order they were given to the encoder
+static message sent[MAX_MESSAGES];
+static uint32_t num_sent;
+
+// the RDLT messages in the log
+static log_RDLT chunks[MAX_CHUNKS];
+static uint32_t num_chunks;
+
+class AP_DAL_DeltaEncoder_Test : public AP_DAL_DeltaEncoder {
+public:
+    // the RDLT with this index is lost
+    int32_t drop_chunk = -1;
+    uint32_t attempts;
+
+protected:
+    bool write_chunk(const log_RDLT &pkt) override {
+        if (int32_t(attempts++) == drop_chunk) {
+            return false;
+        }
+        if (num_chunks < MAX_CHUNKS) {
+            chunks[num_chunks++] = pkt;
+        }
+        return true;
+    }
+};
+
+// repeatable noise, roughly gaussian with a standard deviation of scale
+static uint32_t noise_state = 1;
+static float noise(float scale)
+{
+    float sum = 0;
+    for (uint8_t i=0; i<3; i++) {
+        noise_state = noise_state * 1103515245U + 12345U;
+        sum += ((noise_state >> 8) & 0xFFFF) / 32768.0f - 1;
+    }
+    return sum * scale;
+}
+
+/*
+  the replay messages of a vehicle at rest with sensor noise. Messages
+  are written or skipped as AP_DAL does, counting the bytes they would
+  take in the log without delta encoding
+ */
+class ReplaySim {
+public:
+    ReplaySim(AP_DAL_DeltaEncoder_Test &_enc, uint16_t _loop_rate_hz, bool _airspeed, float _imu_noise) :
+        enc(_enc),
+        loop_rate_hz(_loop_rate_hz),
+        airspeed(_airspeed),
+        imu_noise(_imu_noise)
+    {
+        RISH.loop_rate_hz = loop_rate_hz;
+        RISH.loop_delta_t = 1.0f / loop_rate_hz;
+        RISH.accel_count = ARRAY_SIZE(RISI);
+        RISH.gyro_count = ARRAY_SIZE(RISI);
+        for (uint8_t i=0; i<ARRAY_SIZE(RISI); i++) {
+            RISI[i].instance = i;
+            RISI[i].use_accel = RISI[i].use_gyro = true;
+            RISI[i].get_delta_velocity_ret = RISI[i].get_delta_angle_ret = true;
+        }
+        RGPJ.lat = -353632620;
+        RGPJ.lng = 1491652370;
+        RGPJ.alt = 58400;
+    }
+
+    void frame() {
+        const float dt = 1.0f / loop_rate_hz;
+        const uint32_t now_ms = time_us / 1000;
+
+        // AP_DAL::start_frame()
+        if (enc.check_lost() || time_us - last_keyframe_us >= DAL_DELTA_KEYFRAME_US) {
+            enc.keyframe();
+            force_write = true;
+            last_keyframe_us = time_us;
+        }
+        RFRH.time_us = time_us;
+        RFRH.time_flying_ms = now_ms;
+        write(LOG_RFRH_MSG, &RFRH, nullptr, offsetof(log_RFRH, _end));
+        write(LOG_RISH_MSG, &RISH, &RISH, offsetof(log_RISH, _end));
+        for (uint8_t i=0; i<ARRAY_SIZE(RISI); i++) {
+            const log_RISI old = RISI[i];
+            RISI[i].delta_velocity = Vector3f(0.05f + noise(imu_noise), -0.02f + noise(imu_noise), -9.81f + noise(imu_noise)) * dt;
+            RISI[i].delta_angle = Vector3f(noise(imu_noise*0.03f), noise(imu_noise*0.03f), noise(imu_noise*0.03f)) * dt;
+            RISI[i].delta_velocity_dt = dt;
+            RISI[i].delta_angle_dt = dt;
+            write(LOG_RISI_MSG, &RISI[i], &old, offsetof(log_RISI, _end));
+        }
+        {
+            const log_RBRI old = RBRI;
+            if (now_ms - RBRI.last_update_ms >= 20) {
+                RBRI.last_update_ms = now_ms;
+                RBRI.altitude = 0.3f + noise(0.1f);
+                RBRI.healthy = true;
+            }
+            write(LOG_RBRI_MSG, &RBRI, &old, offsetof(log_RBRI, _end));
+        }
+        {
+            const log_RMGI old = RMGI;
+            if (now_ms - RMGI.last_update_usec/1000 >= 10) {
+                RMGI.last_update_usec = time_us;
+                RMGI.field = Vector3f(210 + noise(3), -48 + noise(3), 420 + noise(3));
+                RMGI.healthy = RMGI.use_for_yaw = true;
+            }
+            write(LOG_RMGI_MSG, &RMGI, &old, offsetof(log_RMGI, _end));
+        }
+        {
+            const log_RGPJ old = RGPJ;
+            if (now_ms - RGPJ.last_message_time_ms >= 200) {
+                RGPJ.last_message_time_ms = now_ms;
+                RGPJ.velocity = Vector3f(noise(0.1f), noise(0.1f), noise(0.1f));
+                RGPJ.lat += int32_t(noise(5));
+                RGPJ.lng += int32_t(noise(5));
+                RGPJ.alt += int32_t(noise(10));
+                RGPJ.sacc = 0.2f + noise(0.02f);
+                RGPJ.hacc = 0.8f + noise(0.05f);
+                RGPJ.vacc = 1.2f + noise(0.05f);
+                RGPJ.hdop = 121;
+            }
+            write(LOG_RGPJ_MSG, &RGPJ, &old, offsetof(log_RGPJ, _end));
+        }
+        if (airspeed) {
+            const log_RASI old = RASI;
+            if (now_ms - RASI.last_update_ms >= 50) {
+                RASI.last_update_ms = now_ms;
+                RASI.airspeed = 22 + noise(0.5f);
+                RASI.healthy = RASI.use = true;
+            }
+            write(LOG_RASI_MSG, &RASI, &old, offsetof(log_RASI, _end));
+        }
+        force_write = false;
+
+        // AP_DAL::end_frame()
+        RFRF.frame_types = uint8_t(AP_DAL::FrameType::UpdateFilterEKF3);
+        if (frames % (loop_rate_hz / 25) == 0) {
+            RFRF.frame_types |= uint8_t(AP_DAL::FrameType::LogWriteEKF3);
+        }
+        write(LOG_RFRF_MSG, &RFRF, nullptr, offsetof(log_RFRF, _end));
+
+        time_us += 1000000U / loop_rate_hz;
+        frames++;
+    }
+
+    uint32_t frames;
+    uint64_t time_us = 5000000;
+    uint32_t full_bytes;
+
+private:
+    AP_DAL_DeltaEncoder_Test &enc;
+    const uint16_t loop_rate_hz;
+    const bool airspeed;
+    const float imu_noise;
+    bool force_write;
+    uint64_t last_keyframe_us;
+
+    log_RFRH RFRH;
+    log_RFRF RFRF;
+    log_RISH RISH;
+    log_RISI RISI[2];
+    log_RBRI RBRI;
+    log_RMGI RMGI;
+    log_RGPJ RGPJ;
+    log_RASI RASI;
+
+    // AP_DAL::WriteLogMessage()
+    void write(uint8_t msg_type, const void *msg, const void *old, uint8_t size) {
+        if (old != nullptr && !force_write && memcmp(msg, old, size) == 0) {
+            return;
+        }
+        ASSERT_TRUE(enc.encode(msg_type, msg, size));
+        ASSERT_LT(num_sent, MAX_MESSAGES);
+        message &m = sent[num_sent++];
+        m.msg_type = msg_type;
+        m.size = size;
+        memcpy(m.data, msg, size);
+        full_bytes += 3 + size;
+    }
+};
+
+static void reset_log(void)
+{
+    num_sent = 0;
+    num_chunks = 0;
+    noise_state = 1;
+}
+
+static uint32_t delta_bytes(void)
+{
+    return num_chunks * (3 + offsetof(log_RDLT, _end));
+}
+
+/*
+  decode the log, checking that what comes out is the messages that
+  went in, in order. Returns the number of messages that were not
+  recovered
+ */
+static uint32_t check_decode(void)
+{
+    AP_DAL_DeltaDecoder *decoder = new AP_DAL_DeltaDecoder();
+    uint32_t idx = 0;
+    uint32_t missing = 0;
+    message m;
+    for (uint32_t i=0; i<num_chunks; i++) {
+        decoder->feed(chunks[i]);
+        while (decoder->next(m.msg_type, m.data, m.size)) {
+            // messages may be lost, but never changed
+            while (idx < num_sent &&
+                   (sent[idx].msg_type != m.msg_type || sent[idx].size != m.size ||
+                    memcmp(sent[idx].data, m.data, m.size) != 0)) {
+                missing++;
+                idx++;
+            }
+            EXPECT_LT(idx, num_sent) << "decoded a message that was not sent";
+            idx++;
+        }
+    }
+    delete decoder;
+    return missing + (num_sent - idx);
+}
+
+/*
+  the IMU noise is in m/s/s, with the gyro noise scaled from it. The
+  delta encoding can't remove noise, so the saving depends on it
+ */
+static void check_bandwidth(const char *name, uint16_t loop_rate_hz, bool airspeed, float imu_noise)
+{
+    reset_log();
+    AP_DAL_DeltaEncoder_Test enc {};
+    ReplaySim *sim = new ReplaySim(enc, loop_rate_hz, airspeed, imu_noise);
+    const uint32_t seconds = 20;
+    for (uint32_t i=0; i<seconds*loop_rate_hz; i++) {
+        sim->frame();
+        if (i % 97 == 0) {
+            // an event written in full after the stream
+            enc.flush();
+        }
+    }
+    enc.flush();
+
+    EXPECT_EQ(0U, check_decode());
+
+    printf("%s IMU noise %.2f: %u bytes/s of replay data, %u bytes/s delta encoded\n",
+           name, imu_noise, unsigned(sim->full_bytes / seconds), unsigned(delta_bytes() / seconds));
+    EXPECT_LT(delta_bytes() * 10, sim->full_bytes * 8);
+
+    delete sim;
+}
+
+TEST(AP_DAL_Delta, copter)
+{
+    check_bandwidth("copter 400Hz", 400, false, 0.3);
+    check_bandwidth("copter 400Hz", 400, false, 0.01);
+}
+
+TEST(AP_DAL_Delta, plane)
+{
+    check_bandwidth("plane 50Hz", 50, true, 0.3);
+    check_bandwidth("plane 50Hz", 50, true, 0.01);
+}
+
+TEST(AP_DAL_Delta, lost_data)
+{
+    for (uint32_t drop=3; drop<40; drop += 3) {
+        reset_log();
+        AP_DAL_DeltaEncoder_Test enc {};
+        ReplaySim *sim = new ReplaySim(enc, 400, false, 0.3);
+        enc.drop_chunk = drop;
+        for (uint32_t i=0; i<1000; i++) {
+            sim->frame();
+        }
+        enc.flush();
+
+        // the messages of the lost RDLT and the frame it was in are
+        // lost, the keyframe that follows brings the stream back
+        const uint32_t missing = check_decode();
+        EXPECT_GT(missing, 0U);
+        EXPECT_LT(missing, 40U) << "dropped RDLT " << drop;
+
+        delete sim;
+    }
+}
+
+TEST(AP_DAL_Delta, restart)
+{
+    reset_log();
+    AP_DAL_DeltaEncoder_Test enc {};
+    ReplaySim *sim = new ReplaySim(enc, 400, false, 0.3);
+    for (uint32_t i=0; i<1000; i++) {
+        sim->frame();
+        if (i == 500) {
+            // logging stopped and started again, dropping the
+            // partial RDLT
+            enc.reset();
+        }
+    }
+    enc.flush();
+
+    const uint32_t missing = check_decode();
+    EXPECT_GT(missing, 0U);
+    EXPECT_LT(missing, 20U);
+
+    delete sim;
+}
+
+AP_GTEST_MAIN()
@@ -15,18 +15,13 @@
 
 #include "AP_ESC_Telem.h"
 #include <AP_HAL/AP_HAL.h>
-
-#if HAL_MAX_CAN_PROTOCOL_DRIVERS
-  #include <AP_CANManager/AP_CANManager.h>
-  #include <AP_Common/AP_Common.h>
-  #include <AP_Vehicle/AP_Vehicle.h>
-  #include <AP_UAVCAN/AP_UAVCAN.h>
-  #include <AP_KDECAN/AP_KDECAN.h>
-  #include <AP_ToshibaCAN/AP_ToshibaCAN.h>
-#endif
+#include <AP_Math/AP_Math.h>
 
 extern const AP_HAL::HAL& hal;
 
+// attempts at a consistent copy before a reader gives up
+#define ESC_TELEM_READ_RETRIES 4
+
 AP_ESC_Telem::AP_ESC_Telem()
 {
     if (_singleton) {
@@ -35,25 +30,172 @@ AP_ESC_Telem::AP_ESC_Telem()
     _singleton = this;
 }
 
-// get an individual ESC's usage time in seconds if available, returns true on success
-bool AP_ESC_Telem::get_usage_seconds(uint8_t esc_id, uint32_t& usage_sec) const
+/*
+  update the telemetry of an ESC with the data from one frame. The
+  data of the last write is copied into the other half of the record
+  and the new data applied to it, so readers always have a complete
+  copy to read
+ */
+void AP_ESC_Telem::update_telem_data(const uint8_t esc_index, const TelemetryData &new_data, const uint16_t data_mask)
+{
+    if (esc_index >= ESC_TELEM_MAX_ESCS) {
+        return;
+    }
+    Record &r = _records[esc_index];
+
+    // claim the record. Two drivers should not be reporting the same
+    // ESC; if they are, the update that finds the other one in
+    // progress is dropped rather than waiting, as the other thread
+    // may be preempted by this one
+    uint32_t seq = r.seq.load(std::memory_order_relaxed);
+    if ((seq & 1U) ||
+        !r.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed)) {
+        return;
+    }
+    // the data must not be written before readers can see seq is odd
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const uint32_t n = seq >> 1;
+    const TelemetryData &prev = r.data[(n + 1) & 1U];
+    TelemetryData &d = r.data[n & 1U];
+    d = prev;
+
+    const uint32_t now_ms = AP_HAL::millis();
+    if (data_mask & TEMPERATURE) {
+        d.temperature_cdeg = new_data.temperature_cdeg;
+    }
+    if (data_mask & MOTOR_TEMPERATURE) {
+        d.motor_temp_cdeg = new_data.motor_temp_cdeg;
+    }
+    if (data_mask & VOLTAGE) {
+        d.voltage = new_data.voltage;
+    }
+    if (data_mask & CURRENT) {
+        d.current = new_data.current;
+    }
+    if (data_mask & CONSUMPTION) {
+        d.consumption_mah = new_data.consumption_mah;
+    }
+    if (data_mask & USAGE) {
+        d.usage_s = new_data.usage_s;
+    }
+    if (data_mask & RPM) {
+        // keep the previous value and the update interval so that
+        // readers can slew between updates
+        if (prev.types & RPM) {
+            d.prev_rpm = prev.rpm;
+            d.rpm_interval_ms = now_ms - prev.rpm_update_ms;
+        } else {
+            d.prev_rpm = new_data.rpm;
+        }
+        d.rpm = new_data.rpm;
+        d.rpm_update_ms = now_ms;
+    }
+    d.last_update_ms = now_ms;
+    d.types |= data_mask;
+    d.count++;
+
+    r.seq.store(seq + 2, std::memory_order_release);
+    _have_data.store(true, std::memory_order_relaxed);
+}
+
+/*
+  copy the last complete write to an ESC's record. Write n+1 is the
+  only one that writes the copy holding write n-1, so the copy is good
+  if that write has not started by the time it is finished
+ */
+bool AP_ESC_Telem::read_record(const uint8_t esc_index, TelemetryData &data) const
 {
-#if HAL_MAX_CAN_PROTOCOL_DRIVERS
-    const uint8_t num_drivers = AP::can().get_num_drivers();
-    for (uint8_t i = 0; i < num_drivers; i++) {
-        if (AP::can().get_driver_type(i) == AP_CANManager::Driver_Type_ToshibaCAN) {
-            AP_ToshibaCAN *tcan = AP_ToshibaCAN::get_tcan(i);
-            if (tcan != nullptr) {
-                usage_sec = tcan->get_usage_seconds(esc_id);
-                return true;
-            }
-            return true;
+    if (esc_index >= ESC_TELEM_MAX_ESCS) {
+        return false;
+    }
+    const Record &r = _records[esc_index];
+    for (uint8_t i = 0; i < ESC_TELEM_READ_RETRIES; i++) {
+        const uint32_t seq = r.seq.load(std::memory_order_acquire);
+        data = r.data[((seq >> 1) + 1) & 1U];
+        // the data must be read before seq is checked again
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (r.seq.load(std::memory_order_relaxed) - (seq & ~1U) <= 2) {
+            return data.types != 0;
         }
     }
-#endif
     return false;
 }
 
+// get a consistent copy of the telemetry of an ESC, returns false if there has never been any
+bool AP_ESC_Telem::get_telem_data(const uint8_t esc_index, TelemetryData &data) const
+{
+    return read_record(esc_index, data);
+}
+
+// get the rpm of all ESCs, slewed between updates
+void AP_ESC_Telem::get_rpm_snapshot(RpmSnapshot &snapshot) const
+{
+    snapshot.valid_mask = 0;
+    snapshot.num_valid = 0;
+    if (!_have_data.load(std::memory_order_relaxed)) {
+        memset(snapshot.rpm, 0, sizeof(snapshot.rpm));
+        return;
+    }
+
+    const uint32_t now_ms = AP_HAL::millis();
+    for (uint8_t i = 0; i < ESC_TELEM_MAX_ESCS; i++) {
+        snapshot.rpm[i] = 0;
+        TelemetryData d;
+        if (!read_record(i, d) || !(d.types & RPM) ||
+            now_ms - d.rpm_update_ms > ESC_TELEM_DATA_TIMEOUT_MS) {
+            continue;
+        }
+        float slew = 1.0f;
+        if (d.rpm_interval_ms > 0) {
+            slew = MIN(1.0f, float(now_ms - d.rpm_update_ms) / d.rpm_interval_ms);
+        }
+        snapshot.rpm[i] = d.prev_rpm + (d.rpm - d.prev_rpm) * slew;
+        snapshot.valid_mask |= 1U << i;
+        snapshot.num_valid++;
+    }
+}
+
+// return the average motor frequency in Hz for dynamic filtering
+float AP_ESC_Telem::get_average_motor_frequency_hz() const
+{
+    RpmSnapshot snapshot;
+    get_rpm_snapshot(snapshot);
+    if (snapshot.num_valid == 0) {
+        return 0;
+    }
+    float rpm_sum = 0;
+    for (uint8_t i = 0; i < ESC_TELEM_MAX_ESCS; i++) {
+        rpm_sum += snapshot.rpm[i];
+    }
+    return rpm_sum / (snapshot.num_valid * 60.0f);
+}
+
+// return all the motor frequencies in Hz for dynamic filtering
+uint8_t AP_ESC_Telem::get_motor_frequencies_hz(const uint8_t nfreqs, float* freqs) const
+{
+    RpmSnapshot snapshot;
+    get_rpm_snapshot(snapshot);
+    uint8_t valid_escs = 0;
+    for (uint8_t i = 0; i < ESC_TELEM_MAX_ESCS && valid_escs < nfreqs; i++) {
+        if (snapshot.valid_mask & (1U << i)) {
+            freqs[valid_escs++] = snapshot.rpm[i] / 60.0f;
+        }
+    }
+    return valid_escs;
+}
+
+// get an individual ESC's usage time in seconds if available, returns true on success
+bool AP_ESC_Telem::get_usage_seconds(const uint8_t esc_index, uint32_t& usage_sec) const
+{
+    TelemetryData d;
+    if (!read_record(esc_index, d) || !(d.types & USAGE)) {
+        return false;
+    }
+    usage_sec = d.usage_s;
+    return true;
+}
+
 AP_ESC_Telem *AP_ESC_Telem::_singleton = nullptr;
 
 /*
@@ -2,6 +2,24 @@
 
 #include <AP_HAL/AP_HAL.h>
 
+#include <atomic>
+
+#define ESC_TELEM_MAX_ESCS 12
+#define ESC_TELEM_DATA_TIMEOUT_MS 1000UL
+// a multiple of the cache line size of the targets with a data cache
+#define ESC_TELEM_CACHE_LINE_SIZE 64
+
+/*
+  ESC telemetry from all ESC drivers, held as one record per ESC.
+
+  A driver writes all the data it decoded from one frame in a single
+  update. Each record holds two copies of the data and a sequence
+  number, and a write goes to the copy readers are not using. Readers
+  take no lock and copy the last complete write, so a reader that
+  preempts a driver thread part way through an update does not wait
+  for it. A reader only retries if more than one write starts while
+  it is copying.
+ */
 class AP_ESC_Telem {
 public:
 
@@ -13,11 +31,79 @@ public:
 
     static AP_ESC_Telem *get_singleton();
 
+    enum TelemetryType {
+        TEMPERATURE       = 1 << 0,
+        MOTOR_TEMPERATURE = 1 << 1,
+        VOLTAGE           = 1 << 2,
+        CURRENT           = 1 << 3,
+        CONSUMPTION       = 1 << 4,
+        USAGE             = 1 << 5,
+        RPM               = 1 << 6,
+    };
+
+    struct TelemetryData {
+        int16_t  temperature_cdeg;  // centi-degrees C, negative values allowed
+        int16_t  motor_temp_cdeg;   // centi-degrees C, negative values allowed
+        float    voltage;           // Volt
+        float    current;           // Ampere
+        float    consumption_mah;   // milli-Ampere.hour
+        uint32_t usage_s;           // usage seconds
+        float    rpm;               // mechanical rpm
+        float    prev_rpm;          // rpm before the last update, for slewing
+        uint32_t rpm_update_ms;     // time of the last rpm update
+        uint32_t rpm_interval_ms;   // time between the last two rpm updates
+        uint32_t last_update_ms;    // time of the last update of any type
+        uint16_t count;             // number of updates
+        uint16_t types;             // TelemetryType bits received so far
+    };
+
+    // rpm of all ESCs, read in one call
+    struct RpmSnapshot {
+        float rpm[ESC_TELEM_MAX_ESCS];  // slewed rpm, zero when not valid
+        uint16_t valid_mask;            // ESCs with rpm newer than ESC_TELEM_DATA_TIMEOUT_MS
+        uint8_t num_valid;
+    };
+
+    // called by ESC drivers with the data decoded from one frame. Only
+    // the types in data_mask are taken from new_data
+    void update_telem_data(uint8_t esc_index, const TelemetryData &new_data, uint16_t data_mask);
+
+    // get a consistent copy of the telemetry of an ESC, returns false
+    // if there has never been any
+    bool get_telem_data(uint8_t esc_index, TelemetryData &data) const WARN_IF_UNUSED;
+
+    // get the rpm of all ESCs
+    void get_rpm_snapshot(RpmSnapshot &snapshot) const;
+
+    // return the average motor frequency in Hz for dynamic filtering
+    float get_average_motor_frequency_hz() const;
+
+    // return the frequency in Hz of each motor with rpm data for
+    // dynamic filtering, returns the number of frequencies
+    uint8_t get_motor_frequencies_hz(uint8_t nfreqs, float* freqs) const;
+
+    // return true if any ESC has sent telemetry
+    bool have_telem_data(void) const { return _have_data; }
+
     // get an individual ESC's usage time in seconds if available, returns true on success
-    bool get_usage_seconds(uint8_t esc_id, uint32_t& usage_sec) const;
+    bool get_usage_seconds(uint8_t esc_index, uint32_t& usage_sec) const;
 
 private:
 
+    // a telemetry record on cache lines of its own, so that a driver
+    // updating one ESC does not evict the lines of another from a
+    // reader's cache. seq counts two per write and is odd while a
+    // write is in progress. Write n goes to data[n&1]
+    struct alignas(ESC_TELEM_CACHE_LINE_SIZE) Record {
+        std::atomic<uint32_t> seq;
+        TelemetryData data[2];
+    };
+
+    Record _records[ESC_TELEM_MAX_ESCS];
+    std::atomic<bool> _have_data;
+
+    bool read_record(uint8_t esc_index, TelemetryData &data) const;
+
     static AP_ESC_Telem *_singleton;
 
 };
@@ -0,0 +1,133 @@
+#include <AP_gtest.h>
+
+#include <AP_ESC_Telem/AP_ESC_Telem.h>
+
+#include <atomic>
+#include <pthread.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+static AP_ESC_Telem esc_telem;
+
+TEST(AP_ESC_Telem, update_types)
+{
+    AP_ESC_Telem::TelemetryData d;
+    EXPECT_FALSE(esc_telem.get_telem_data(0, d));
+    EXPECT_FALSE(esc_telem.get_telem_data(ESC_TELEM_MAX_ESCS, d));
+
+    // only the types in the mask are taken
+    AP_ESC_Telem::TelemetryData t {};
+    t.voltage = 16.2f;
+    t.current = 3.5f;
+    t.rpm = 1000;
+    esc_telem.update_telem_data(0, t, AP_ESC_Telem::VOLTAGE | AP_ESC_Telem::CURRENT);
+    t = {};
+    t.temperature_cdeg = 4500;
+    t.voltage = 99;
+    esc_telem.update_telem_data(0, t, AP_ESC_Telem::TEMPERATURE);
+
+    EXPECT_TRUE(esc_telem.get_telem_data(0, d));
+    EXPECT_FLOAT_EQ(16.2f, d.voltage);
+    EXPECT_FLOAT_EQ(3.5f, d.current);
+    EXPECT_EQ(4500, d.temperature_cdeg);
+    EXPECT_FLOAT_EQ(0, d.rpm);
+    EXPECT_EQ(AP_ESC_Telem::VOLTAGE | AP_ESC_Telem::CURRENT | AP_ESC_Telem::TEMPERATURE, d.types);
+    EXPECT_EQ(2, d.count);
+
+    uint32_t usage_s;
+    EXPECT_FALSE(esc_telem.get_usage_seconds(0, usage_s));
+    t.usage_s = 3600;
+    esc_telem.update_telem_data(0, t, AP_ESC_Telem::USAGE);
+    EXPECT_TRUE(esc_telem.get_usage_seconds(0, usage_s));
+    EXPECT_EQ(3600U, usage_s);
+}
+
+TEST(AP_ESC_Telem, rpm_snapshot)
+{
+    AP_ESC_Telem::TelemetryData t {};
+    for (uint8_t i = 2; i < 10; i += 2) {
+        t.rpm = 6000 * i;
+        esc_telem.update_telem_data(i, t, AP_ESC_Telem::RPM);
+        // ESCs that have sent no rpm are not in the snapshot
+        esc_telem.update_telem_data(i + 1, t, AP_ESC_Telem::VOLTAGE);
+    }
+
+    AP_ESC_Telem::RpmSnapshot snapshot;
+    esc_telem.get_rpm_snapshot(snapshot);
+    EXPECT_EQ(4, snapshot.num_valid);
+    EXPECT_EQ(0x154U, snapshot.valid_mask);
+    for (uint8_t i = 2; i < 10; i += 2) {
+        EXPECT_FLOAT_EQ(6000 * i, snapshot.rpm[i]);
+        EXPECT_FLOAT_EQ(0, snapshot.rpm[i + 1]);
+    }
+
+    float freqs[ESC_TELEM_MAX_ESCS];
+    EXPECT_EQ(4, esc_telem.get_motor_frequencies_hz(ESC_TELEM_MAX_ESCS, freqs));
+    EXPECT_FLOAT_EQ(200, freqs[0]);
+    EXPECT_FLOAT_EQ(800, freqs[3]);
+    EXPECT_EQ(2, esc_telem.get_motor_frequencies_hz(2, freqs));
+    EXPECT_FLOAT_EQ(500, esc_telem.get_average_motor_frequency_hz());
+}
+
+/*
+  a driver thread writes records whose fields all hold the same
+  count while the test thread reads them. Every read must see a
+  record from a single write
+ */
+static const uint32_t num_writes = 200000;
+static const uint8_t stress_esc = ESC_TELEM_MAX_ESCS - 1;
+static std::atomic<bool> writer_done;
+
+static void *writer_thread(void *)
+{
+    for (uint32_t n = 1; n <= num_writes; n++) {
+        AP_ESC_Telem::TelemetryData t {};
+        t.voltage = n;
+        t.current = n;
+        t.consumption_mah = n;
+        t.rpm = n;
+        t.usage_s = n;
+        esc_telem.update_telem_data(stress_esc, t,
+                                    AP_ESC_Telem::VOLTAGE | AP_ESC_Telem::CURRENT | AP_ESC_Telem::CONSUMPTION |
+                                    AP_ESC_Telem::RPM | AP_ESC_Telem::USAGE);
+    }
+    writer_done = true;
+    return nullptr;
+}
+
+TEST(AP_ESC_Telem, concurrent_reads)
+{
+    pthread_t writer;
+    ASSERT_EQ(0, pthread_create(&writer, nullptr, writer_thread, nullptr));
+
+    uint32_t reads = 0;
+    uint32_t torn = 0;
+    uint32_t last_usage = 0;
+    bool monotonic = true;
+    while (!writer_done) {
+        AP_ESC_Telem::TelemetryData d;
+        if (!esc_telem.get_telem_data(stress_esc, d)) {
+            continue;
+        }
+        reads++;
+        const float n = d.usage_s;
+        if (d.voltage != n || d.current != n || d.consumption_mah != n || d.rpm != n ||
+            d.count != uint16_t(d.usage_s)) {
+            torn++;
+        }
+        if (d.usage_s < last_usage) {
+            monotonic = false;
+        }
+        last_usage = d.usage_s;
+    }
+    pthread_join(writer, nullptr);
+
+    AP_ESC_Telem::TelemetryData d;
+    EXPECT_TRUE(esc_telem.get_telem_data(stress_esc, d));
+    EXPECT_EQ(num_writes, d.usage_s);
+    EXPECT_GT(reads, 0U);
+    EXPECT_EQ(0U, torn);
+    EXPECT_TRUE(monotonic);
+}
+
+AP_GTEST_MAIN()
@@ -31,7 +31,7 @@ int AP_Filesystem_ROMFS::open(const char *fname, int flags)
     }
     uint8_t idx;
     for (idx=0; idx<max_open_file; idx++) {
-        if (file[idx].data == nullptr) {
+        if (file[idx] == nullptr) {
             break;
         }
     }
@@ -39,43 +39,41 @@ int AP_Filesystem_ROMFS::open(const char *fname, int flags)
         errno = ENFILE;
         return -1;
     }
-    if (file[idx].data != nullptr) {
+    if (file[idx] != nullptr) {
         errno = EBUSY;
         return -1;
     }
-    file[idx].data = AP_ROMFS::find_decompress(fname, file[idx].size);
-    if (file[idx].data == nullptr) {
+    // large files are decompressed as they are read
+    file[idx] = AP_ROMFS::open_stream(fname);
+    if (file[idx] == nullptr) {
         errno = ENOENT;
         return -1;
     }
-    file[idx].ofs = 0;
     return idx;
 }
 
 int AP_Filesystem_ROMFS::close(int fd)
 {
-    if (fd < 0 || fd >= max_open_file || file[fd].data == nullptr) {
+    if (fd < 0 || fd >= max_open_file || file[fd] == nullptr) {
         errno = EBADF;
         return -1;
     }
-    AP_ROMFS::free(file[fd].data);
-    file[fd].data = nullptr;
+    delete file[fd];
+    file[fd] = nullptr;
     return 0;
 }
 
 int32_t AP_Filesystem_ROMFS::read(int fd, void *buf, uint32_t count)
 {
-    if (fd < 0 || fd >= max_open_file || file[fd].data == nullptr) {
+    if (fd < 0 || fd >= max_open_file || file[fd] == nullptr) {
         errno = EBADF;
         return -1;
     }
-    count = MIN(file[fd].size - file[fd].ofs, count);
-    if (count == 0) {
-        return 0;
+    const int32_t ret = file[fd]->read((uint8_t *)buf, count);
+    if (ret < 0) {
+        errno = EIO;
     }
-    memcpy(buf, &file[fd].data[file[fd].ofs], count);
-    file[fd].ofs += count;
-    return count;
+    return ret;
 }
 
 int32_t AP_Filesystem_ROMFS::write(int fd, const void *buf, uint32_t count)
@@ -91,37 +89,40 @@ int AP_Filesystem_ROMFS::fsync(int fd)
 
 int32_t AP_Filesystem_ROMFS::lseek(int fd, int32_t offset, int seek_from)
 {
-    if (fd < 0 || fd >= max_open_file || file[fd].data == nullptr) {
+    if (fd < 0 || fd >= max_open_file || file[fd] == nullptr) {
         errno = EBADF;
         return -1;
     }
+    uint32_t ofs = file[fd]->offset();
     switch (seek_from) {
     case SEEK_SET:
         if (offset < 0) {
             errno = EINVAL;
             return -1;
         }
-        file[fd].ofs = MIN(file[fd].size, (uint32_t)offset);
+        ofs = offset;
         break;
     case SEEK_CUR:
-        file[fd].ofs = MIN(file[fd].size, offset+file[fd].ofs);
+        ofs = offset+ofs;
         break;
     case SEEK_END:
-        file[fd].ofs = file[fd].size;
+        ofs = file[fd]->size();
         break;
     }
-    return file[fd].ofs;
+    if (!file[fd]->seek(ofs)) {
+        errno = EIO;
+        return -1;
+    }
+    return file[fd]->offset();
 }
 
 int AP_Filesystem_ROMFS::stat(const char *name, struct stat *stbuf)
 {
     uint32_t size;
-    const uint8_t *data = AP_ROMFS::find_decompress(name, size);
-    if (data == nullptr) {
+    if (!AP_ROMFS::find_size(name, size)) {
         errno = ENOENT;
         return -1;
     }
-    AP_ROMFS::free(data);
     memset(stbuf, 0, sizeof(*stbuf));
     stbuf->st_size = size;
     return 0;
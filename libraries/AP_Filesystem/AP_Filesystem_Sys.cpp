@@ -22,6 +22,7 @@
 #include <AP_Math/AP_Math.h>
 #include <AP_CANManager/AP_CANManager.h>
 #include <AP_Scheduler/AP_Scheduler.h>
+#include <GCS_MAVLink/GCS.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -31,9 +32,13 @@ struct SysFileList {
 };
 
 static const SysFileList sysfs_file_list[] = {
-    {"threads.txt", 1024},
+    {"threads.txt", 2048},
     {"tasks.txt", 6500},
     {"dma.txt", 1024},
+    {"buses.txt", 1024},
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+    {"mavlink.txt", 8192},
+#endif
 #if HAL_MAX_CAN_PROTOCOL_DRIVERS
     {"can_log.txt", 1024},
     {"can0_stats.txt", 1024},
@@ -105,6 +110,20 @@ int AP_Filesystem_Sys::open(const char *fname, int flags)
             r.data->length = hal.util->dma_info(r.data->data, max_size);
         }
     }
+    if (strcmp(fname, "buses.txt") == 0) {
+        r.data->data = (char *)malloc(max_size);
+        if (r.data->data) {
+            r.data->length = hal.util->bus_info(r.data->data, max_size);
+        }
+    }
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+    if (strcmp(fname, "mavlink.txt") == 0) {
+        r.data->data = (char *)malloc(max_size);
+        if (r.data->data) {
+            r.data->length = gcs().message_stats_info(r.data->data, max_size);
+        }
+    }
+#endif
 #if HAL_MAX_CAN_PROTOCOL_DRIVERS
     int8_t can_stats_num = -1;
     if (strcmp(fname, "can_log.txt") == 0) {
@@ -50,20 +50,50 @@ bool AP_FlashStorage::init(void)
 
     // start with empty memory buffer
     memset(mem_buffer, 0, storage_size);
+    reset_index();
 
     // find state of sectors
     struct sector_header header[2];
 
-    // read headers and possibly initialise if bad signature
+    // read headers, checking for sectors written before the block CRC
+    // was added
+    bool legacy[2];
     for (uint8_t i=0; i<2; i++) {
         if (!flash_read(i, 0, (uint8_t *)&header[i], sizeof(header[i]))) {
             return false;
         }
-        bool bad_header = !header[i].signature_ok();
-        enum SectorState state = header[i].get_state();
+        legacy[i] = header[i].signature_ok(true);
+    }
+
+    for (uint8_t i=0; i<2; i++) {
+        const uint8_t other = i^1;
+        if (header_erased(header[i]) && !header_erased(header[other])) {
+            // we lost power between erasing this sector and writing
+            // its header
+            if (!erase_sector(i, true)) {
+                return false;
+            }
+            header[i].set_state(SECTOR_STATE_AVAILABLE);
+        } else if (legacy[i] && !legacy[other] && header[other].signature_ok() &&
+                   header[other].get_state() == SECTOR_STATE_IN_USE) {
+            // we lost power in migrate_legacy() after the other sector
+            // was given all of the data, but before this one was erased
+            if (!erase_sector(i, true)) {
+                return false;
+            }
+            header[i].set_state(SECTOR_STATE_AVAILABLE);
+            legacy[i] = false;
+        }
+    }
+
+    // possibly initialise if bad signature
+    for (uint8_t i=0; i<2; i++) {
+        bool bad_header = !header[i].signature_ok(legacy[i]);
+        enum SectorState state = header[i].get_state(legacy[i]);
         if (state != SECTOR_STATE_AVAILABLE &&
             state != SECTOR_STATE_IN_USE &&
-            state != SECTOR_STATE_FULL) {
+            state != SECTOR_STATE_FULL &&
+            state != SECTOR_STATE_COMPACTED) {
             bad_header = true;
         }
 
@@ -74,9 +104,18 @@ bool AP_FlashStorage::init(void)
     }
 
     // work out the first sector to read from using sector states
-    enum SectorState states[2] {header[0].get_state(), header[1].get_state()};
+    enum SectorState states[2] {header[0].get_state(legacy[0]), header[1].get_state(legacy[1])};
     uint8_t first_sector;
 
+    // a compacted sector has nothing in it that is not also in the
+    // sector in use, so it is not read. Without a sector in use it is
+    // treated as full
+    for (uint8_t i=0; i<2; i++) {
+        if (states[i] == SECTOR_STATE_COMPACTED && states[i^1] != SECTOR_STATE_IN_USE) {
+            states[i] = SECTOR_STATE_FULL;
+        }
+    }
+
     if (states[0] == states[1]) {
         if (states[0] != SECTOR_STATE_AVAILABLE) {
             return erase_all();
@@ -100,41 +139,65 @@ bool AP_FlashStorage::init(void)
         uint8_t sector = (first_sector + i) & 1;
         if (states[sector] == SECTOR_STATE_IN_USE ||
             states[sector] == SECTOR_STATE_FULL) {
-            if (!load_sector(sector)) {
+            if (!load_sector(sector, legacy[sector])) {
                 return erase_all();
             }
         }
+        if (states[sector] == SECTOR_STATE_FULL) {
+            // blocks in the full sector are pending until they are
+            // found in the sector in use
+            start_compaction();
+        }
     }
 
     // clear any write error
     write_error = false;
-    reserved_space = 0;
-    
-    // if the first sector is full then write out all data so we can erase it
+
+    if (legacy[0] || legacy[1]) {
+        // keep using the legacy format until migrate() is called, so
+        // that earlier firmware can still read storage
+        legacy_states[0] = states[0];
+        legacy_states[1] = states[1];
+        legacy_pending = true;
+        reset_index();
+        return true;
+    }
+
+    // if the first sector is full then write out the data that is only
+    // in it so we can erase it
     if (states[first_sector] == SECTOR_STATE_FULL) {
         current_sector = first_sector ^ 1;
-        if (!write_all()) {
+        if (states[current_sector] == SECTOR_STATE_AVAILABLE) {
+            // we lost power between marking the full sector and the new
+            // one in switch_sectors()
+            struct sector_header new_header;
+            new_header.set_state(SECTOR_STATE_IN_USE);
+            if (!flash_write(current_sector, 0, (const uint8_t *)&new_header, sizeof(new_header))) {
+                return false;
+            }
+            write_offset = sizeof(new_header);
+        }
+        if (!write_pending()) {
             return erase_all();
         }
     }
 
-    // erase any sectors marked full
+    // erase any sectors marked full or compacted
     for (uint8_t i=0; i<2; i++) {
-        if (states[i] == SECTOR_STATE_FULL) {
+        if (states[i] == SECTOR_STATE_FULL ||
+            states[i] == SECTOR_STATE_COMPACTED) {
             if (!erase_sector(i, true)) {
                 return false;
             }
         }
     }
 
-    reserved_space = 0;
-    
+    compact_state = COMPACT_NONE;
+
     // ready to use
     return true;
 }
 
-
-
 // switch full sector - should only be called when safe to have CPU
 // offline for considerable periods as an erase will be needed
 bool AP_FlashStorage::switch_full_sector(void)
@@ -158,17 +221,23 @@ bool AP_FlashStorage::switch_full_sector(void)
 // happens.
 bool AP_FlashStorage::protected_switch_full_sector(void)
 {
+    if (legacy_pending) {
+        return migrate();
+    }
+
     // clear any write error
     write_error = false;
-    reserved_space = 0;
-    
-    if (!write_all()) {
+
+    // finish copying the data that is only in the full sector, into
+    // the space reserved for it
+    if (!write_pending()) {
         return false;
     }
 
     if (!erase_sector(current_sector ^ 1, true)) {
         return false;
     }
+    compact_state = COMPACT_NONE;
 
     return switch_sectors();
 }
@@ -180,6 +249,15 @@ bool AP_FlashStorage::write(uint16_t offset, uint16_t length)
         return false;
     }
     //debug("write at %u for %u write_offset=%u\n", offset, length, write_offset);
+
+    if (legacy_pending) {
+        if (write_legacy(offset, length)) {
+            return true;
+        }
+        // there is no room left in the legacy format. Migrating
+        // writes all of mem_buffer, including this data
+        return migrate();
+    }
     
     while (length > 0) {
         uint8_t n = max_write;
@@ -190,7 +268,7 @@ bool AP_FlashStorage::write(uint16_t offset, uint16_t length)
 #endif
 
         const uint32_t space_available = flash_sector_size - write_offset;
-        const uint32_t space_required = sizeof(struct block_header) + max_write + reserved_space;
+        const uint32_t space_required = sizeof(struct block_header) + max_write + reserved_space();
         if (space_available < space_required) {
             if (!switch_sectors()) {
                 if (!flash_erase_ok()) {
@@ -202,47 +280,14 @@ bool AP_FlashStorage::write(uint16_t offset, uint16_t length)
             }
         }
 
-        struct PACKED {
-            struct block_header header;
-            uint8_t data[max_write];
-        } blk;
-
-        blk.header.state = BLOCK_STATE_WRITING;
-        blk.header.block_num = offset / block_size;
-        blk.header.num_blocks_minus_one = ((n + (block_size - 1)) / block_size)-1;
-
-        uint16_t block_ofs = blk.header.block_num*block_size;
-        uint16_t block_nbytes = (blk.header.num_blocks_minus_one+1)*block_size;
-
-        memcpy(blk.data, &mem_buffer[block_ofs], block_nbytes);
-
-#if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F4
-        if (!flash_write(current_sector, write_offset, (uint8_t*)&blk.header, sizeof(blk.header))) {
-            return false;
-        }
-        if (!flash_write(current_sector, write_offset+sizeof(blk.header), blk.data, block_nbytes)) {
-            return false;
-        }
-        blk.header.state = BLOCK_STATE_VALID;
-        if (!flash_write(current_sector, write_offset, (uint8_t*)&blk.header, sizeof(blk.header))) {
-            return false;
-        }
-#elif AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F1
-        blk.header.state = BLOCK_STATE_VALID;
-        if (!flash_write(current_sector, write_offset, (uint8_t*)&blk, sizeof(blk.header) + block_nbytes)) {
+        const uint16_t block_num = offset / block_size;
+        const uint8_t nblocks = (n + (block_size - 1)) / block_size;
+        if (!write_blocks(block_num, nblocks)) {
             return false;
         }
-#elif AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_H7
-        blk.header.state = BLOCK_STATE_VALID;
-        if (!flash_write(current_sector, write_offset, (uint8_t*)&blk, sizeof(blk.header) + max_write)) {
-            return false;
-        }
-#endif
-
-        write_offset += sizeof(blk.header) + block_nbytes;
 
-        uint8_t n2 = block_nbytes - (offset % block_size);
-        //debug("write_block at %u for %u n2=%u\n", block_ofs, block_nbytes, n2);
+        uint8_t n2 = nblocks*block_size - (offset % block_size);
+        //debug("write_block at %u for %u n2=%u\n", block_num*block_size, nblocks*block_size, n2);
         if (n2 > length) {
             break;
         }
@@ -259,14 +304,89 @@ bool AP_FlashStorage::write(uint16_t offset, uint16_t length)
 }
 
 /*
-  load all data from a flash sector into mem_buffer
+  write blocks from mem_buffer at write_offset
  */
-bool AP_FlashStorage::load_sector(uint8_t sector)
+bool AP_FlashStorage::write_blocks(uint16_t block_num, uint8_t nblocks)
 {
-    uint32_t ofs = sizeof(sector_header);
-    while (ofs < flash_sector_size - sizeof(struct block_header)) {
+    if (nblocks == 0 || nblocks > max_write/block_size || block_num + nblocks > num_blocks) {
+        return false;
+    }
+
+    struct PACKED {
         struct block_header header;
-        if (!flash_read(sector, ofs, (uint8_t *)&header, sizeof(header))) {
+        uint8_t data[max_write];
+    } blk;
+
+    blk.header.state = BLOCK_STATE_WRITING;
+    blk.header.block_num = block_num;
+    blk.header.num_blocks_minus_one = nblocks-1;
+
+    const uint16_t block_ofs = block_num*block_size;
+    const uint16_t block_nbytes = nblocks*block_size;
+
+    // the last block can extend past the end of storage
+    const uint16_t nbytes = MIN(block_nbytes, uint16_t(storage_size - block_ofs));
+    memcpy(blk.data, &mem_buffer[block_ofs], nbytes);
+    memset(&blk.data[nbytes], 0, sizeof(blk.data) - nbytes);
+
+    blk.header.crc = block_crc(blk.header, blk.data, block_nbytes);
+
+#if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F4
+    if (!flash_write(current_sector, write_offset, (uint8_t*)&blk.header, sizeof(blk.header))) {
+        return false;
+    }
+    if (!flash_write(current_sector, write_offset+sizeof(blk.header), blk.data, block_nbytes)) {
+        return false;
+    }
+    blk.header.state = BLOCK_STATE_VALID;
+    if (!flash_write(current_sector, write_offset, (uint8_t*)&blk.header, sizeof(blk.header))) {
+        return false;
+    }
+#elif AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F1
+    blk.header.state = BLOCK_STATE_VALID;
+    if (!flash_write(current_sector, write_offset, (uint8_t*)&blk, sizeof(blk.header) + block_nbytes)) {
+        return false;
+    }
+#elif AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_H7
+    blk.header.state = BLOCK_STATE_VALID;
+    if (!flash_write(current_sector, write_offset, (uint8_t*)&blk, sizeof(blk.header) + max_write)) {
+        return false;
+    }
+#endif
+
+    write_offset += sizeof(blk.header) + block_nbytes;
+
+    set_current(block_num, nblocks);
+
+    return true;
+}
+
+/*
+  CRC of a block, covering the block number and count and the data
+ */
+uint16_t AP_FlashStorage::block_crc(const struct block_header &header, const uint8_t *data, uint16_t nbytes)
+{
+    const uint8_t hdr[2] {
+        uint8_t(header.block_num & 0xFF),
+        uint8_t((header.block_num >> 8) | (header.num_blocks_minus_one << 3))
+    };
+    return crc16_ccitt(data, nbytes, crc16_ccitt(hdr, sizeof(hdr), 0xFFFF));
+}
+
+/*
+  load all data from a flash sector into mem_buffer
+ */
+bool AP_FlashStorage::load_sector(uint8_t sector, bool legacy)
+{
+    current_sector = sector;
+
+    const uint8_t header_size = legacy ? legacy_block_header_size : sizeof(struct block_header);
+    const uint8_t bsize = legacy ? legacy_block_size : block_size;
+
+    uint32_t ofs = legacy ? legacy_sector_header_size : sizeof(sector_header);
+    while (ofs < flash_sector_size - header_size) {
+        struct block_header header {};
+        if (!flash_read(sector, ofs, (uint8_t *)&header, header_size)) {
             return false;
         }
         enum BlockState state = (enum BlockState)header.state;
@@ -287,23 +407,51 @@ bool AP_FlashStorage::load_sector(uint8_t sector)
               gap won't be recovered until we next do an erase of this
               sector
              */
-            uint16_t block_nbytes = (header.num_blocks_minus_one+1)*block_size;
-            ofs += block_nbytes + sizeof(header);
+            uint16_t block_nbytes = (header.num_blocks_minus_one+1)*bsize;
+            ofs += block_nbytes + header_size;
             break;
         }
             
         case BLOCK_STATE_VALID: {
-            uint16_t block_nbytes = (header.num_blocks_minus_one+1)*block_size;
-            uint16_t block_ofs = header.block_num*block_size;
-            if (block_ofs + block_nbytes > storage_size) {
-                // the data is invalid (out of range)
-                return false;
-            }
-            if (!flash_read(sector, ofs+sizeof(header), &mem_buffer[block_ofs], block_nbytes)) {
-                return false;
+            uint16_t block_nbytes = (header.num_blocks_minus_one+1)*bsize;
+            uint16_t block_ofs = header.block_num*bsize;
+            if (legacy) {
+                if (block_ofs + block_nbytes > storage_size) {
+                    // the data is invalid (out of range)
+                    return false;
+                }
+                if (!flash_read(sector, ofs+header_size, &mem_buffer[block_ofs], block_nbytes)) {
+                    return false;
+                }
+            } else {
+                if (block_ofs >= storage_size || block_nbytes > max_write) {
+                    // the data is invalid (out of range)
+                    return false;
+                }
+                uint8_t data[max_write];
+                if (!flash_read(sector, ofs+header_size, data, block_nbytes)) {
+                    return false;
+                }
+                if (header.crc == block_crc(header, data, block_nbytes)) {
+                    memcpy(&mem_buffer[block_ofs], data, MIN(block_nbytes, uint16_t(storage_size - block_ofs)));
+                    set_current(header.block_num, header.num_blocks_minus_one+1);
+                } else {
+                    /*
+                      the block is corrupt, which can happen when
+                      power is lost while writing on flash that
+                      writes the block state with the data. We keep
+                      any earlier copy of the data, and write it
+                      again so later copies in this sector are not
+                      needed
+                     */
+                    debug("bad CRC at %u:%u\n", (unsigned)sector, (unsigned)ofs);
+                    for (uint8_t i=0; i<=header.num_blocks_minus_one; i++) {
+                        set_pending(header.block_num + i);
+                    }
+                }
             }
             //debug("read at %u for %u\n", block_ofs, block_nbytes);
-            ofs += block_nbytes + sizeof(header);
+            ofs += block_nbytes + header_size;
             break;
         }
         default:
@@ -319,6 +467,183 @@ bool AP_FlashStorage::load_sector(uint8_t sector)
     return true;
 }
 
+/*
+  write the data loaded from sectors in the format from before the
+  block CRC was added out again in the current format. The data is
+  written to the sector that does not hold it, which is only marked in
+  use once it has all of the data, and the legacy sector is erased
+  last, so a complete copy survives a loss of power at any point
+ */
+bool AP_FlashStorage::migrate_legacy(const enum SectorState states[2])
+{
+    const bool has_data[2] {
+        states[0] == SECTOR_STATE_IN_USE || states[0] == SECTOR_STATE_FULL,
+        states[1] == SECTOR_STATE_IN_USE || states[1] == SECTOR_STATE_FULL
+    };
+    if (!has_data[0] && !has_data[1]) {
+        return erase_all();
+    }
+
+    uint8_t legacy_sector = has_data[0] ? 0 : 1;
+    if (has_data[0] && has_data[1]) {
+        // the sector in use was loaded last, so it is the current
+        // sector. Copy the data into it in the legacy format, as the
+        // old code did on boot, so the full sector can be erased
+        legacy_sector = current_sector;
+        if (!write_all_legacy()) {
+            // there is no room, so there is no choice but to rewrite
+            // both sectors
+            debug("no room to migrate legacy sectors\n");
+            if (!erase_all()) {
+                return false;
+            }
+            return write_all();
+        }
+    }
+
+    current_sector = legacy_sector ^ 1;
+    write_offset = sizeof(struct sector_header);
+    reset_index();
+    if (!erase_sector(current_sector, true) ||
+        !write_all()) {
+        return false;
+    }
+
+    struct sector_header header;
+    header.set_state(SECTOR_STATE_IN_USE);
+    if (!flash_write(current_sector, 0, (const uint8_t *)&header, sizeof(header))) {
+        return false;
+    }
+
+    return erase_sector(legacy_sector, true);
+}
+
+/*
+  rewrite the sectors in the legacy format in the current format
+ */
+bool AP_FlashStorage::migrate(void)
+{
+    if (!legacy_pending) {
+        return true;
+    }
+    if (!flash_erase_ok()) {
+        return false;
+    }
+    // cleared first, as the data is written with write()
+    legacy_pending = false;
+    if (!migrate_legacy(legacy_states)) {
+        // the sectors are left to be sorted out by init() on the next
+        // boot, or by re_initialise()
+        write_error = true;
+        return false;
+    }
+    return true;
+}
+
+/*
+  write all of mem_buffer to the current sector in the format from
+  before the block CRC was added. Returns false if it does not fit
+ */
+bool AP_FlashStorage::write_all_legacy(void)
+{
+    for (uint16_t ofs=0; ofs<storage_size; ofs += legacy_max_write) {
+        // local variable needed to overcome problem with MIN() macro and -O0
+        const uint8_t max_write_local = legacy_max_write;
+        const uint8_t n = MIN(max_write_local, storage_size-ofs);
+        if (all_zero(ofs, n)) {
+            continue;
+        }
+        if (!write_legacy_group(ofs)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  write data from mem_buffer to the current sector in the format from
+  before the block CRC was added, a whole group at a time, while
+  storage has not been migrated. Returns false if it does not fit, or
+  the current sector is not in use
+ */
+bool AP_FlashStorage::write_legacy(uint16_t offset, uint16_t length)
+{
+    if (legacy_states[current_sector] != SECTOR_STATE_IN_USE) {
+        return false;
+    }
+    const uint32_t end = MIN(uint32_t(offset) + length, uint32_t(storage_size));
+    for (uint32_t ofs = (offset / legacy_max_write) * legacy_max_write; ofs < end; ofs += legacy_max_write) {
+        if (!write_legacy_group(ofs)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  write the group of blocks starting at ofs in the legacy format
+ */
+bool AP_FlashStorage::write_legacy_group(uint16_t ofs)
+{
+    // local variable needed to overcome problem with MIN() macro and -O0
+    const uint8_t max_write_local = legacy_max_write;
+    const uint8_t n = MIN(max_write_local, storage_size-ofs);
+    const uint8_t nblocks = (n + (legacy_block_size - 1)) / legacy_block_size;
+    const uint16_t block_nbytes = nblocks*legacy_block_size;
+    if (ofs + block_nbytes > storage_size ||
+        flash_sector_size - write_offset < uint32_t(legacy_block_header_size + block_nbytes)) {
+        // the legacy format can't hold this block
+        return false;
+    }
+
+    struct block_header header {};
+    header.block_num = ofs / legacy_block_size;
+    header.num_blocks_minus_one = nblocks-1;
+    uint8_t blk[legacy_block_header_size + legacy_max_write];
+    memcpy(&blk[legacy_block_header_size], &mem_buffer[ofs], block_nbytes);
+
+#if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F4
+    header.state = BLOCK_STATE_WRITING;
+    memcpy(blk, &header, legacy_block_header_size);
+    if (!flash_write(current_sector, write_offset, blk, legacy_block_header_size) ||
+        !flash_write(current_sector, write_offset+legacy_block_header_size, &blk[legacy_block_header_size], block_nbytes)) {
+        return false;
+    }
+    header.state = BLOCK_STATE_VALID;
+    memcpy(blk, &header, legacy_block_header_size);
+    if (!flash_write(current_sector, write_offset, blk, legacy_block_header_size)) {
+        return false;
+    }
+#else
+    header.state = BLOCK_STATE_VALID;
+    memcpy(blk, &header, legacy_block_header_size);
+    if (!flash_write(current_sector, write_offset, blk, legacy_block_header_size + block_nbytes)) {
+        return false;
+    }
+#endif
+
+    write_offset += legacy_block_header_size + block_nbytes;
+#if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_H7
+    // offsets must be advanced to a multiple of 32 on H7
+    write_offset = (write_offset + 31U) & ~31U;
+#endif
+    return true;
+}
+
+/*
+  return true if a sector header reads as erased flash
+ */
+bool AP_FlashStorage::header_erased(const struct sector_header &header)
+{
+    const uint8_t *b = (const uint8_t *)&header;
+    for (uint8_t i=0; i<sizeof(header); i++) {
+        if (b[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /*
   erase one sector
  */
@@ -341,6 +666,8 @@ bool AP_FlashStorage::erase_sector(uint8_t sector, bool mark_available)
 bool AP_FlashStorage::erase_all(void)
 {
     write_error = false;
+    legacy_pending = false;
+    reset_index();
 
     current_sector = 0;
     write_offset = sizeof(struct sector_header);
@@ -364,7 +691,7 @@ bool AP_FlashStorage::erase_all(void)
 bool AP_FlashStorage::write_all()
 {
     debug("write_all to sector %u at %u with reserved_space=%u\n",
-           current_sector, write_offset, reserved_space);
+           current_sector, write_offset, (unsigned)reserved_space());
     for (uint16_t ofs=0; ofs<storage_size; ofs += max_write) {
         // local variable needed to overcome problem with MIN() macro and -O0
         const uint8_t max_write_local = max_write;
@@ -392,7 +719,7 @@ bool AP_FlashStorage::all_zero(uint16_t ofs, uint16_t size)
 // switch to next sector for writing
 bool AP_FlashStorage::switch_sectors(void)
 {
-    if (reserved_space != 0) {
+    if (compact_state != COMPACT_NONE) {
         // other sector is already full
         debug("both sectors are full\n");
         return false;
@@ -434,15 +761,244 @@ bool AP_FlashStorage::switch_sectors(void)
 
     // switch sectors
     current_sector = new_sector;
-        
-    // we need to reserve some space in next sector to ensure we can successfully do a
-    // full write out on init()
-    reserved_space = reserve_size;
-    
+
+    // the data in the full sector is copied to the new sector by
+    // idle_tick(), and space is reserved in the new sector for it
+    start_compaction();
+
     write_offset = sizeof(header);
     return true;    
 }
 
+/*
+  make the blocks in the current sector pending, as it has become the
+  full sector
+ */
+void AP_FlashStorage::start_compaction(void)
+{
+    for (uint16_t b=0; b<num_blocks; b++) {
+        if (current_blocks.get(b)) {
+            set_pending(b);
+        }
+    }
+    current_blocks.clearall();
+    compact_state = COMPACT_COPYING;
+}
+
+/*
+  space needed to copy the pending groups
+ */
+uint32_t AP_FlashStorage::reserved_space(void) const
+{
+    if (compact_state == COMPACT_NONE && pending_groups == 0) {
+        return 0;
+    }
+    return pending_groups * (sizeof(struct block_header) + max_write) + max_write;
+}
+
+/*
+  return true if any block in a group is pending
+ */
+bool AP_FlashStorage::group_pending(uint16_t group) const
+{
+    const uint16_t first = group * group_blocks;
+    for (uint16_t b=first; b<first+group_blocks && b<num_blocks; b++) {
+        if (pending_blocks.get(b)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AP_FlashStorage::set_current(uint16_t block_num, uint8_t nblocks)
+{
+    for (uint16_t b=block_num; b<block_num+nblocks && b<num_blocks; b++) {
+        current_blocks.set(b);
+        if (pending_blocks.get(b)) {
+            pending_blocks.clear(b);
+            if (!group_pending(b / group_blocks)) {
+                pending_groups--;
+            }
+        }
+    }
+}
+
+void AP_FlashStorage::set_pending(uint16_t block_num)
+{
+    if (block_num >= num_blocks || pending_blocks.get(block_num)) {
+        return;
+    }
+    if (!group_pending(block_num / group_blocks)) {
+        pending_groups++;
+    }
+    pending_blocks.set(block_num);
+}
+
+void AP_FlashStorage::reset_index(void)
+{
+    current_blocks.clearall();
+    pending_blocks.clearall();
+    pending_groups = 0;
+    compact_state = COMPACT_NONE;
+    verify_offset = 0;
+}
+
+/*
+  write the first group with a pending block to the current sector.
+  The space for it was reserved when the group became pending
+ */
+bool AP_FlashStorage::write_pending_group(void)
+{
+    const int16_t first = pending_blocks.first_set();
+    if (first < 0) {
+        return true;
+    }
+    if (flash_sector_size - write_offset < sizeof(struct block_header) + max_write) {
+        return false;
+    }
+    const uint16_t block_num = (first / group_blocks) * group_blocks;
+    // local variable needed to overcome problem with MIN() macro and -O0
+    const uint8_t group_blocks_local = group_blocks;
+    const uint8_t nblocks = MIN(group_blocks_local, num_blocks - block_num);
+    return write_blocks(block_num, nblocks);
+}
+
+/*
+  write all groups with a pending block to the current sector
+ */
+bool AP_FlashStorage::write_pending(void)
+{
+    while (pending_groups > 0) {
+        if (!write_pending_group()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  background work, one step per call so that the time taken by each
+  call is small
+ */
+void AP_FlashStorage::idle_tick(void)
+{
+    if (write_error || legacy_pending) {
+        return;
+    }
+
+    if (pending_groups > 0) {
+        // if there is not enough space the copy is finished by
+        // switch_full_sector() on a later write
+        if (!write_pending_group()) {
+            debug("pending write failed\n");
+        }
+        return;
+    }
+
+    if (compact_state == COMPACT_COPYING) {
+        // nothing in the full sector is needed now. Mark it as
+        // compacted so it is not read by init()
+        struct sector_header header;
+        header.set_state(SECTOR_STATE_COMPACTED);
+        if (flash_write(current_sector ^ 1, 0, (const uint8_t *)&header, sizeof(header))) {
+            compact_state = COMPACT_ERASE_PENDING;
+        }
+        return;
+    }
+
+    if (compact_state == COMPACT_ERASE_PENDING && flash_erase_ok()) {
+        // the erase still stops the CPU, but now does so when there is
+        // nothing to write rather than on the write that fills the
+        // current sector
+        if (erase_sector(current_sector ^ 1, true)) {
+            compact_state = COMPACT_NONE;
+        }
+        return;
+    }
+
+    verify_block();
+}
+
+/*
+  check the CRC of the block at verify_offset in the current sector,
+  and move on to the next block. If the CRC is bad and there is no
+  later copy of the data then it is written again
+ */
+void AP_FlashStorage::verify_block(void)
+{
+    if (verify_offset < sizeof(struct sector_header) || verify_offset >= write_offset) {
+        verify_offset = sizeof(struct sector_header);
+        if (verify_offset >= write_offset) {
+            return;
+        }
+    }
+
+    struct block_header header;
+    if (!flash_read(current_sector, verify_offset, (uint8_t *)&header, sizeof(header))) {
+        return;
+    }
+    const uint16_t block_nbytes = (header.num_blocks_minus_one+1)*block_size;
+    const uint32_t ofs = verify_offset;
+    verify_offset = next_block_offset(ofs, header);
+
+    if (header.state != BLOCK_STATE_VALID) {
+        // an interrupted write, which is skipped by load_sector()
+        return;
+    }
+    if (block_nbytes > max_write || header.block_num >= num_blocks) {
+        // we can't follow the blocks any further
+        verify_offset = 0;
+        return;
+    }
+
+    uint8_t data[max_write];
+    if (!flash_read(current_sector, ofs+sizeof(header), data, block_nbytes)) {
+        return;
+    }
+    if (header.crc == block_crc(header, data, block_nbytes)) {
+        return;
+    }
+
+    debug("bad CRC at %u:%u\n", (unsigned)current_sector, (unsigned)ofs);
+
+    // look for later copies of the blocks, which would replace this
+    // one on load. This is slow, but only happens on corruption
+    Bitmask<max_write/block_size> replaced;
+    for (uint32_t ofs2 = verify_offset; ofs2 < write_offset; ) {
+        struct block_header header2;
+        if (!flash_read(current_sector, ofs2, (uint8_t *)&header2, sizeof(header2))) {
+            return;
+        }
+        if (header2.state == BLOCK_STATE_VALID) {
+            for (uint8_t i=0; i<=header.num_blocks_minus_one; i++) {
+                const uint16_t b = header.block_num + i;
+                if (b >= header2.block_num && b <= header2.block_num + header2.num_blocks_minus_one) {
+                    replaced.set(i);
+                }
+            }
+        }
+        ofs2 = next_block_offset(ofs2, header2);
+    }
+    for (uint8_t i=0; i<=header.num_blocks_minus_one; i++) {
+        if (!replaced.get(i)) {
+            set_pending(header.block_num + i);
+        }
+    }
+}
+
+/*
+  offset of the block after the one at ofs
+ */
+uint32_t AP_FlashStorage::next_block_offset(uint32_t ofs, const struct block_header &header) const
+{
+    ofs += sizeof(header) + (header.num_blocks_minus_one+1)*block_size;
+#if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_H7
+    // offsets must be advanced to a multiple of 32 on H7
+    ofs = (ofs + 31U) & ~31U;
+#endif
+    return ofs;
+}
+
 /*
   re-initialise, using current mem_buffer
  */
@@ -461,22 +1017,40 @@ bool AP_FlashStorage::re_initialise(void)
 /*
   H7 specific sector header functions
  */
-bool AP_FlashStorage::sector_header::signature_ok(void) const
+bool AP_FlashStorage::sector_header::signature_ok(bool legacy) const
 {
     for (uint8_t i=0; i<ARRAY_SIZE(pad1); i++) {
         if (pad1[i] != 0xFFFFFFFFU || pad2[i] != 0xFFFFFFFFU || pad3[i] != 0xFFFFFFFFU) {
             return false;
         }
+        // the legacy header is 96 bytes, followed by the first block
+        if (!legacy && pad4[i] != 0xFFFFFFFFU) {
+            return false;
+        }
     }
-    return signature1 == signature;
+    return signature1 == (legacy ? legacy_signature : signature);
 }
 
-AP_FlashStorage::SectorState AP_FlashStorage::sector_header::get_state(void) const
+AP_FlashStorage::SectorState AP_FlashStorage::sector_header::get_state(bool legacy) const
 {
+    const uint32_t sig = legacy ? legacy_signature : signature;
+    if (!legacy && (state4 != 0xFFFFFFFF || signature4 != 0xFFFFFFFF)) {
+        if (state1 == 0xFFFFFFF1 &&
+            state2 == 0xFFFFFFF2 &&
+            state3 == 0xFFFFFFF3 &&
+            state4 == 0xFFFFFFF4 &&
+            signature1 == sig &&
+            signature2 == sig &&
+            signature3 == sig &&
+            signature4 == sig) {
+            return SECTOR_STATE_COMPACTED;
+        }
+        return SECTOR_STATE_INVALID;
+    }
     if (state1 == 0xFFFFFFF1 &&
         state2 == 0xFFFFFFFF &&
         state3 == 0xFFFFFFFF &&
-        signature1 == signature &&
+        signature1 == sig &&
         signature2 == 0xFFFFFFFF &&
         signature3 == 0xFFFFFFFF) {
         return SECTOR_STATE_AVAILABLE;
@@ -484,17 +1058,17 @@ AP_FlashStorage::SectorState AP_FlashStorage::sector_header::get_state(void) con
     if (state1 == 0xFFFFFFF1 &&
         state2 == 0xFFFFFFF2 &&
         state3 == 0xFFFFFFFF &&
-        signature1 == signature &&
-        signature2 == signature &&
+        signature1 == sig &&
+        signature2 == sig &&
         signature3 == 0xFFFFFFFF) {
         return SECTOR_STATE_IN_USE;
     }
     if (state1 == 0xFFFFFFF1 &&
         state2 == 0xFFFFFFF2 &&
         state3 == 0xFFFFFFF3 &&
-        signature1 == signature &&
-        signature2 == signature &&
-        signature3 == signature) {
+        signature1 == sig &&
+        signature2 == sig &&
+        signature3 == sig) {
         return SECTOR_STATE_FULL;
     }
     return SECTOR_STATE_INVALID;
@@ -505,6 +1079,9 @@ void AP_FlashStorage::sector_header::set_state(SectorState state)
     memset(pad1, 0xff, sizeof(pad1));
     memset(pad2, 0xff, sizeof(pad2));
     memset(pad3, 0xff, sizeof(pad3));
+    memset(pad4, 0xff, sizeof(pad4));
+    signature4 = 0xFFFFFFFF;
+    state4 = 0xFFFFFFFF;
     switch (state) {
     case SECTOR_STATE_AVAILABLE:
         signature1 = signature;
@@ -530,6 +1107,16 @@ void AP_FlashStorage::sector_header::set_state(SectorState state)
         state2 = 0xFFFFFFF2;
         state3 = 0xFFFFFFF3;
         break;
+    case SECTOR_STATE_COMPACTED:
+        signature1 = signature;
+        signature2 = signature;
+        signature3 = signature;
+        signature4 = signature;
+        state1 = 0xFFFFFFF1;
+        state2 = 0xFFFFFFF2;
+        state3 = 0xFFFFFFF3;
+        state4 = 0xFFFFFFF4;
+        break;
     default:
         break;
     }
@@ -539,13 +1126,20 @@ void AP_FlashStorage::sector_header::set_state(SectorState state)
 /*
   F1/F3 specific sector header functions
  */
-bool AP_FlashStorage::sector_header::signature_ok(void) const
+bool AP_FlashStorage::sector_header::signature_ok(bool legacy) const
 {
-    return signature1 == signature;
+    return signature1 == (legacy ? legacy_signature : signature);
 }
 
-AP_FlashStorage::SectorState AP_FlashStorage::sector_header::get_state(void) const
+AP_FlashStorage::SectorState AP_FlashStorage::sector_header::get_state(bool legacy) const
 {
+    // state2 was not used in the legacy format
+    if (!legacy && state2 != 0xFFFF) {
+        if (state1 == 0xFFF2FFF1 && state2 == 0xFFF3) {
+            return SECTOR_STATE_COMPACTED;
+        }
+        return SECTOR_STATE_INVALID;
+    }
     if (state1 == 0xFFFFFFFF) {
         return SECTOR_STATE_AVAILABLE;
     }
@@ -561,6 +1155,7 @@ AP_FlashStorage::SectorState AP_FlashStorage::sector_header::get_state(void) con
 void AP_FlashStorage::sector_header::set_state(SectorState state)
 {
     signature1 = signature;
+    state2 = 0xFFFF;
     switch (state) {
     case SECTOR_STATE_AVAILABLE:
         state1 = 0xFFFFFFFF;
@@ -571,6 +1166,10 @@ void AP_FlashStorage::sector_header::set_state(SectorState state)
     case SECTOR_STATE_FULL:
         state1 = 0xFFF2FFF1;
         break;
+    case SECTOR_STATE_COMPACTED:
+        state1 = 0xFFF2FFF1;
+        state2 = 0xFFF3;
+        break;
     default:
         break;
     }
@@ -579,12 +1178,12 @@ void AP_FlashStorage::sector_header::set_state(SectorState state)
 /*
   F4 specific sector header functions
  */
-bool AP_FlashStorage::sector_header::signature_ok(void) const
+bool AP_FlashStorage::sector_header::signature_ok(bool legacy) const
 {
-    return signature1 == signature;
+    return signature1 == (legacy ? legacy_signature : signature);
 }
 
-AP_FlashStorage::SectorState AP_FlashStorage::sector_header::get_state(void) const
+AP_FlashStorage::SectorState AP_FlashStorage::sector_header::get_state(bool legacy) const
 {
     if (state1 == 0xFF) {
         return SECTOR_STATE_AVAILABLE;
@@ -595,6 +1194,9 @@ AP_FlashStorage::SectorState AP_FlashStorage::sector_header::get_state(void) con
     if (state1 == 0xFC) {
         return SECTOR_STATE_FULL;
     }
+    if (state1 == 0xF8 && !legacy) {
+        return SECTOR_STATE_COMPACTED;
+    }
     return SECTOR_STATE_INVALID;
 }
 
@@ -611,6 +1213,9 @@ void AP_FlashStorage::sector_header::set_state(SectorState state)
     case SECTOR_STATE_FULL:
         state1 = 0xFC;
         break;
+    case SECTOR_STATE_COMPACTED:
+        state1 = 0xF8;
+        break;
     default:
         break;
     }
@@ -19,13 +19,20 @@
   backend for any HAL. The basic methodology is to use a log based
   storage system over two flash sectors. Key design elements:
 
-  - erase of sectors only called on init, as erase will lock the flash
-    and prevent code execution
+  - erase of sectors only called on init, or from idle_tick() when the
+    caller allows it, as erase will lock the flash and prevent code
+    execution
 
-  - write using log based system
+  - write using log based system, with a CRC on each block
 
   - read requires scan of all log elements. This is expected to be called rarely
 
+  - when a sector fills, the data that is only in the full sector is
+    copied to the new sector a block at a time from idle_tick(). Once
+    the copy is complete the full sector is marked as compacted, and
+    is not read again. An index in RAM of the blocks in each sector
+    means only data which has not been overwritten since is copied
+
   - assumes flash that erases to 0xFF and where writing can only clear
     bits, not set them
 
@@ -34,10 +41,17 @@
     128k flash sectors with 16k storage size.
 
   - assumes two flash sectors are available
+
+  - sectors written before the block CRC was added are still read, and
+    written to in that format until the caller calls migrate(). The
+    migration is one way: earlier firmware erases all of storage when
+    it finds the current format, so the caller should warn the user
+    before migrating
  */
 #pragma once
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_Common/Bitmask.h>
 
 /*
   we support 3 different types of flash which have different restrictions
@@ -72,23 +86,30 @@
 class AP_FlashStorage {
 private:
 #if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_H7
-    // need to write in 32 byte chunks, with 2 byte header
-    static const uint8_t block_size = 30;
+    // need to write in 32 byte chunks, with 4 byte header
+    static const uint8_t block_size = 28;
     static const uint8_t max_write = block_size;
+    // block size before the block CRC was added
+    static const uint8_t legacy_block_size = 30;
+    static const uint8_t legacy_max_write = legacy_block_size;
 #else
     static const uint8_t block_size = 8;
     static const uint8_t max_write = 64;
+    static const uint8_t legacy_block_size = block_size;
+    static const uint8_t legacy_max_write = max_write;
 #endif
     static const uint16_t num_blocks = (HAL_STORAGE_SIZE+(block_size-1)) / block_size;
+    // blocks in each max_write sized group, which is the unit of copying
+    static const uint8_t group_blocks = max_write / block_size;
 
 public:
     // caller provided function to write to a flash sector
     FUNCTOR_TYPEDEF(FlashWrite, bool, uint8_t , uint32_t , const uint8_t *, uint16_t );
 
-    // caller provided function to read from a flash sector. Only called on init()
+    // caller provided function to read from a flash sector. Called on init() and from idle_tick()
     FUNCTOR_TYPEDEF(FlashRead, bool, uint8_t , uint32_t , uint8_t *, uint16_t );
     
-    // caller provided function to erase a flash sector. Only called from init()
+    // caller provided function to erase a flash sector. Called from init(), and when erasing is allowed
     FUNCTOR_TYPEDEF(FlashErase, bool, uint8_t );
 
     // caller provided function to indicate if erasing is allowed
@@ -120,6 +141,22 @@ public:
     // write some data to storage from mem_buffer
     bool write(uint16_t offset, uint16_t length) WARN_IF_UNUSED;
 
+    // true if storage was loaded from sectors in the format from before
+    // the block CRC was added, and has not been migrated yet
+    bool legacy_format(void) const { return legacy_pending; }
+
+    // rewrite sectors in the legacy format in the current format. This
+    // needs erasing to be allowed. Earlier firmware can't read the
+    // current format and erases all of storage on boot, so the caller
+    // should warn the user first
+    bool migrate(void) WARN_IF_UNUSED;
+
+    // do a small amount of background work: copy one group of blocks
+    // out of a full sector, erase the full sector once it is compacted
+    // and erasing is allowed, or check the CRC of one block. Should be
+    // called regularly when there is nothing to write
+    void idle_tick(void);
+
     // fixed storage size
     static const uint16_t storage_size = HAL_STORAGE_SIZE;
     
@@ -133,16 +170,36 @@ private:
 
     uint8_t current_sector;
     uint32_t write_offset;
-    uint32_t reserved_space;
     bool write_error;
 
+    // state of the sector we are not writing to
+    enum CompactState : uint8_t {
+        COMPACT_NONE,           // available for the next switch
+        COMPACT_COPYING,        // full, with data not yet copied
+        COMPACT_ERASE_PENDING,  // compacted, waiting to be erased
+    } compact_state;
+
+    // blocks with a copy in the current sector
+    Bitmask<num_blocks> current_blocks;
+    // blocks which need to be written to the current sector, because
+    // their latest copy is in the full sector or has a bad CRC
+    Bitmask<num_blocks> pending_blocks;
+    // number of groups with a pending block
+    uint16_t pending_groups;
+
+    // offset of the next block to check the CRC of in idle_tick()
+    uint32_t verify_offset;
+
     // 24 bit signature
 #if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F4
-    static const uint32_t signature = 0x51685B;
+    static const uint32_t signature = 0x51685C;
+    static const uint32_t legacy_signature = 0x51685B;
 #elif AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F1
-    static const uint32_t signature = 0x51;
+    static const uint32_t signature = 0x52;
+    static const uint32_t legacy_signature = 0x51;
 #elif AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_H7
-    static const uint32_t signature = 0x51685B62;
+    static const uint32_t signature = 0x51685B63;
+    static const uint32_t legacy_signature = 0x51685B62;
 #else
 #error "Unknown AP_FLASHSTORAGE_TYPE"
 #endif
@@ -152,7 +209,8 @@ private:
         SECTOR_STATE_AVAILABLE = 1,
         SECTOR_STATE_IN_USE    = 2,
         SECTOR_STATE_FULL      = 3,
-        SECTOR_STATE_INVALID   = 4
+        SECTOR_STATE_INVALID   = 4,
+        SECTOR_STATE_COMPACTED = 5
     };
 
     // header in first word of each sector
@@ -163,8 +221,9 @@ private:
 #elif AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F1
         uint32_t state1:32;
         uint32_t signature1:16;
+        uint32_t state2:16;
 #elif AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_H7
-        // needs to be 96 bytes on H7 to support 3 states
+        // needs to be 128 bytes on H7 to support 4 states
         uint32_t state1;
         uint32_t signature1;
         uint32_t pad1[6];
@@ -174,12 +233,22 @@ private:
         uint32_t state3;
         uint32_t signature3;
         uint32_t pad3[6];
+        uint32_t state4;
+        uint32_t signature4;
+        uint32_t pad4[6];
 #endif
-        bool signature_ok(void) const;
-        SectorState get_state() const;
+        // legacy is true for the format before the block CRC was added
+        bool signature_ok(bool legacy=false) const;
+        SectorState get_state(bool legacy=false) const;
         void set_state(SectorState state);
     };
 
+#if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_H7
+    static const uint8_t legacy_sector_header_size = 96;
+#else
+    static const uint8_t legacy_sector_header_size = sizeof(sector_header);
+#endif
+
 
     enum BlockState {
         BLOCK_STATE_AVAILABLE = 0x3,
@@ -187,18 +256,52 @@ private:
         BLOCK_STATE_VALID     = 0x0
     };
     
-    // header of each block of data
+    // header of each block of data. The CRC covers the block number and
+    // count and the data. The legacy format has no CRC
     struct block_header {
         uint16_t state:2;
         uint16_t block_num:11;
         uint16_t num_blocks_minus_one:3;
+        uint16_t crc;
     };
+    static const uint8_t legacy_block_header_size = 2;
+
+    // amount of space to keep free in the current sector to be able to
+    // copy the pending blocks into it
+    uint32_t reserved_space(void) const;
 
-    // amount of space needed to write full storage
-    static const uint32_t reserve_size = (storage_size / max_write) * (sizeof(block_header) + max_write) + max_write;
-        
     // load data from a sector
-    bool load_sector(uint8_t sector) WARN_IF_UNUSED;
+    bool load_sector(uint8_t sector, bool legacy) WARN_IF_UNUSED;
+
+    // write blocks from mem_buffer at write_offset, which must have
+    // room for them
+    bool write_blocks(uint16_t block_num, uint8_t nblocks) WARN_IF_UNUSED;
+
+    // write the first group with pending blocks
+    bool write_pending_group(void) WARN_IF_UNUSED;
+
+    // write all groups with pending blocks
+    bool write_pending(void) WARN_IF_UNUSED;
+
+    // mark blocks as written to the current sector
+    void set_current(uint16_t block_num, uint8_t nblocks);
+
+    // mark a block as needing to be written to the current sector
+    void set_pending(uint16_t block_num);
+
+    // return true if any block in a group is pending
+    bool group_pending(uint16_t group) const;
+
+    // make the blocks of the current sector pending when it is full
+    void start_compaction(void);
+
+    // check the CRC of the block at verify_offset
+    void verify_block(void);
+
+    // offset of the block after the one at ofs in the current sector
+    uint32_t next_block_offset(uint32_t ofs, const struct block_header &header) const;
+
+    static uint16_t block_crc(const struct block_header &header, const uint8_t *data, uint16_t nbytes);
 
     // erase a sector and write header
     bool erase_sector(uint8_t sector, bool mark_available) WARN_IF_UNUSED;
@@ -209,6 +312,30 @@ private:
     // write all of mem_buffer to current sector
     bool write_all() WARN_IF_UNUSED;
 
+    // write all of mem_buffer to current sector in the legacy format
+    bool write_all_legacy() WARN_IF_UNUSED;
+
+    // write data from mem_buffer to the current sector in the legacy format
+    bool write_legacy(uint16_t offset, uint16_t length) WARN_IF_UNUSED;
+
+    // write the group of legacy blocks at ofs in the legacy format
+    bool write_legacy_group(uint16_t ofs) WARN_IF_UNUSED;
+
+    // true while the sectors are in the legacy format, see legacy_format()
+    bool legacy_pending;
+
+    // states of the sectors in the legacy format when they were loaded
+    enum SectorState legacy_states[2];
+
+    // rewrite data loaded from legacy sectors in the current format
+    bool migrate_legacy(const enum SectorState states[2]) WARN_IF_UNUSED;
+
+    // return true if a sector header reads as erased flash
+    static bool header_erased(const struct sector_header &header);
+
+    // clear the index of blocks in each sector
+    void reset_index(void);
+
     // return true if all bytes are zero
     bool all_zero(uint16_t ofs, uint16_t size) WARN_IF_UNUSED;
 
@@ -0,0 +1,426 @@
+#include <AP_gtest.h>
+
+#include <AP_FlashStorage/AP_FlashStorage.h>
+#include <AP_Math/AP_Math.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  a simulated flash driver, where writes can only clear bits, which
+  counts the work done by each call into AP_FlashStorage
+ */
+class SimFlash {
+public:
+    static const uint32_t sector_size = 32U * 1024U;
+
+    SimFlash() {
+        memset(flash, 0xFF, sizeof(flash));
+    }
+
+    uint8_t mem_buffer[AP_FlashStorage::storage_size];
+    uint8_t mem_mirror[AP_FlashStorage::storage_size];
+    uint8_t flash[2][sector_size];
+
+    bool erase_ok = true;
+
+    // when power_loss is set, power is lost after this many more
+    // writes and erases, and the ones after it do nothing
+    bool power_loss = false;
+    uint32_t ops_before_power_loss;
+
+    // work done since the last call to clear_counts()
+    uint32_t bytes_read;
+    uint32_t bytes_written;
+    uint32_t erases;
+
+    void clear_counts() {
+        bytes_read = 0;
+        bytes_written = 0;
+        erases = 0;
+    }
+
+    AP_FlashStorage storage{mem_buffer,
+            sector_size,
+            FUNCTOR_BIND_MEMBER(&SimFlash::flash_write, bool, uint8_t, uint32_t, const uint8_t *, uint16_t),
+            FUNCTOR_BIND_MEMBER(&SimFlash::flash_read, bool, uint8_t, uint32_t, uint8_t *, uint16_t),
+            FUNCTOR_BIND_MEMBER(&SimFlash::flash_erase, bool, uint8_t),
+            FUNCTOR_BIND_MEMBER(&SimFlash::flash_erase_ok, bool)};
+
+    // write to storage and mem_mirror, as the HAL does, returning
+    // the bytes written to flash
+    uint32_t write(uint16_t offset, const uint8_t *data, uint16_t length) {
+        memcpy(&mem_mirror[offset], data, length);
+        memcpy(&mem_buffer[offset], data, length);
+        clear_counts();
+        if (!storage.write(offset, length)) {
+            // the HAL would keep trying until the vehicle is disarmed
+            erase_ok = true;
+            EXPECT_TRUE(storage.write(offset, length));
+        }
+        return bytes_written;
+    }
+
+    void random_write(void) {
+        const uint16_t ofs = get_random16() % sizeof(mem_buffer);
+        uint16_t length = (get_random16() & 0x1F) + 1;
+        length = MIN(length, sizeof(mem_buffer) - ofs);
+        uint8_t data[32];
+        for (uint8_t j=0; j<length; j++) {
+            data[j] = get_random16() & 0xFF;
+        }
+        write(ofs, data, length);
+    }
+
+    bool init(void) {
+        memset(mem_buffer, 0, sizeof(mem_buffer));
+        clear_counts();
+        return storage.init();
+    }
+
+    bool matches(void) const {
+        return memcmp(mem_buffer, mem_mirror, sizeof(mem_buffer)) == 0;
+    }
+
+private:
+    bool powered(void) {
+        if (!power_loss) {
+            return true;
+        }
+        if (ops_before_power_loss == 0) {
+            return false;
+        }
+        ops_before_power_loss--;
+        return true;
+    }
+
+    bool flash_write(uint8_t sector, uint32_t offset, const uint8_t *data, uint16_t length) {
+        if (sector > 1 || offset + length > sector_size || !powered()) {
+            return false;
+        }
+        for (uint16_t i=0; i<length; i++) {
+            // bits can only be cleared
+            EXPECT_EQ(0, data[i] & ~flash[sector][offset+i]);
+            flash[sector][offset+i] &= data[i];
+        }
+        bytes_written += length;
+        return true;
+    }
+
+    bool flash_read(uint8_t sector, uint32_t offset, uint8_t *data, uint16_t length) {
+        if (sector > 1 || offset + length > sector_size) {
+            return false;
+        }
+        memcpy(data, &flash[sector][offset], length);
+        bytes_read += length;
+        return true;
+    }
+
+    bool flash_erase(uint8_t sector) {
+        if (sector > 1 || !powered()) {
+            return false;
+        }
+        memset(flash[sector], 0xFF, sector_size);
+        erases++;
+        return true;
+    }
+
+    bool flash_erase_ok(void) {
+        return erase_ok;
+    }
+};
+
+// random writes with idle ticks between them, with erasing only allowed
+// some of the time, always load what was written
+TEST(AP_FlashStorage, write_and_reload)
+{
+    SimFlash *sim = new SimFlash();
+    ASSERT_TRUE(sim->init());
+    memset(sim->mem_mirror, 0, sizeof(sim->mem_mirror));
+
+    for (uint32_t i=0; i<50000; i++) {
+        sim->erase_ok = (i / 3000) % 2 == 0;
+        sim->random_write();
+        for (uint8_t t=0; t<4; t++) {
+            sim->storage.idle_tick();
+        }
+        if (i % 5000 == 0) {
+            ASSERT_TRUE(sim->init());
+            ASSERT_TRUE(sim->matches());
+        }
+    }
+    ASSERT_TRUE(sim->init());
+    EXPECT_TRUE(sim->matches());
+    delete sim;
+}
+
+// with idle ticks a write never erases and only writes a few blocks,
+// where without them the write that fills the sector copies all of
+// the data and erases
+TEST(AP_FlashStorage, worst_case_blocking)
+{
+    uint32_t max_write_bytes[2] {};
+    uint32_t max_write_erases[2] {};
+    uint32_t max_tick_bytes = 0;
+    uint32_t max_tick_erases = 0;
+
+    for (uint8_t use_ticks=0; use_ticks<2; use_ticks++) {
+        SimFlash *sim = new SimFlash();
+        ASSERT_TRUE(sim->init());
+        for (uint32_t i=0; i<20000; i++) {
+            sim->random_write();
+            max_write_bytes[use_ticks] = MAX(max_write_bytes[use_ticks], sim->bytes_written);
+            max_write_erases[use_ticks] = MAX(max_write_erases[use_ticks], sim->erases);
+            if (!use_ticks) {
+                continue;
+            }
+            for (uint8_t t=0; t<4; t++) {
+                sim->clear_counts();
+                sim->storage.idle_tick();
+                max_tick_bytes = MAX(max_tick_bytes, sim->bytes_written);
+                max_tick_erases = MAX(max_tick_erases, sim->erases);
+            }
+        }
+        ASSERT_TRUE(sim->init());
+        EXPECT_TRUE(sim->matches());
+        delete sim;
+    }
+
+    printf("worst write: %u bytes %u erases without ticks, %u bytes %u erases with ticks\n",
+           (unsigned)max_write_bytes[0], (unsigned)max_write_erases[0],
+           (unsigned)max_write_bytes[1], (unsigned)max_write_erases[1]);
+    printf("worst tick: %u bytes %u erases\n", (unsigned)max_tick_bytes, (unsigned)max_tick_erases);
+
+    EXPECT_GT(max_write_bytes[0], 10 * max_write_bytes[1]);
+    EXPECT_EQ(1U, max_write_erases[0]);
+    // a sector switch and the blocks of one write
+    EXPECT_LE(max_write_bytes[1], 2*128U + 3*32U);
+    EXPECT_EQ(0U, max_write_erases[1]);
+    // one group of blocks, or the header of the compacted sector, or
+    // one erase and the header of the erased sector
+    EXPECT_LE(max_tick_bytes, 128U);
+    EXPECT_LE(max_tick_erases, 1U);
+}
+
+// once the full sector is compacted init() only reads the sector in
+// use, and has nothing to write
+TEST(AP_FlashStorage, init_after_compaction)
+{
+    uint32_t init_read[2];
+    uint32_t init_written[2];
+
+    for (uint8_t compact=0; compact<2; compact++) {
+        SimFlash *sim = new SimFlash();
+        ASSERT_TRUE(sim->init());
+        sim->erase_ok = false;
+        // fill the first sector and write a little to the second
+        uint8_t available[64];
+        memcpy(available, sim->flash[1], sizeof(available));
+        uint16_t writes_after_switch = 0;
+        while (writes_after_switch < 100) {
+            sim->random_write();
+            if (memcmp(available, sim->flash[1], sizeof(available)) != 0) {
+                writes_after_switch++;
+            }
+        }
+        ASSERT_FALSE(sim->erase_ok);
+        if (compact) {
+            for (uint16_t t=0; t<1000; t++) {
+                sim->storage.idle_tick();
+            }
+        }
+        ASSERT_TRUE(sim->init());
+        EXPECT_TRUE(sim->matches());
+        init_read[compact] = sim->bytes_read;
+        init_written[compact] = sim->bytes_written;
+        delete sim;
+    }
+
+    printf("init: %u bytes read %u written without compaction, %u read %u written with compaction\n",
+           (unsigned)init_read[0], (unsigned)init_written[0],
+           (unsigned)init_read[1], (unsigned)init_written[1]);
+
+    EXPECT_LT(init_read[1], init_read[0] * 2 / 3);
+    EXPECT_GT(init_written[0], AP_FlashStorage::storage_size / 2);
+    // just the header of the erased sector
+    EXPECT_LE(init_written[1], 128U);
+}
+
+// find the last copy of some data in a sector
+static uint8_t *find_last(uint8_t *sector, const uint8_t *data, uint16_t length)
+{
+    uint8_t *ret = nullptr;
+    for (uint32_t i=0; i+length <= SimFlash::sector_size; i++) {
+        if (memcmp(&sector[i], data, length) == 0) {
+            ret = &sector[i];
+        }
+    }
+    return ret;
+}
+
+// a block with a bad CRC is not loaded, and is written again
+TEST(AP_FlashStorage, bad_crc)
+{
+    SimFlash *sim = new SimFlash();
+    ASSERT_TRUE(sim->init());
+    memset(sim->mem_mirror, 0, sizeof(sim->mem_mirror));
+
+    const uint8_t old_data[8] { 1, 2, 3, 4, 5, 6, 7, 8 };
+    const uint8_t new_data[8] { 11, 12, 13, 14, 15, 16, 17, 18 };
+    sim->write(64, old_data, sizeof(old_data));
+    sim->write(64, new_data, sizeof(new_data));
+
+    // corrupt the new data, as an interrupted write would
+    uint8_t *p = find_last(sim->flash[0], new_data, sizeof(new_data));
+    ASSERT_NE(nullptr, p);
+    p[3] &= 0xF0;
+
+    // the old data is loaded, and kept when written again
+    ASSERT_TRUE(sim->init());
+    EXPECT_EQ(0, memcmp(&sim->mem_buffer[64], old_data, sizeof(old_data)));
+    for (uint8_t t=0; t<10; t++) {
+        sim->storage.idle_tick();
+    }
+    ASSERT_TRUE(sim->init());
+    EXPECT_EQ(0, memcmp(&sim->mem_buffer[64], old_data, sizeof(old_data)));
+
+    // corruption found by idle_tick() while running is repaired from
+    // mem_buffer
+    sim->write(64, new_data, sizeof(new_data));
+    p = find_last(sim->flash[0], new_data, sizeof(new_data));
+    ASSERT_NE(nullptr, p);
+    p[5] &= 0x0F;
+    for (uint16_t t=0; t<100; t++) {
+        sim->storage.idle_tick();
+    }
+    ASSERT_TRUE(sim->init());
+    EXPECT_EQ(0, memcmp(&sim->mem_buffer[64], new_data, sizeof(new_data)));
+    delete sim;
+}
+
+#if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F4
+/*
+  storage written before the block CRC was added is loaded, and written
+  to in that format so earlier firmware can still read it, until it is
+  migrated to the current format
+ */
+TEST(AP_FlashStorage, legacy_format)
+{
+    SimFlash *sim = new SimFlash();
+
+    // a sector in use with two blocks, the second at block 3, and an
+    // available sector
+    const uint8_t sector0[] {
+        0xFE, 0x5B, 0x68, 0x51,
+        0x00, 0x00, 1, 2, 3, 4, 5, 6, 7, 8,
+        0x0C, 0x20, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+    };
+    const uint8_t sector1[] { 0xFF, 0x5B, 0x68, 0x51 };
+    memcpy(sim->flash[0], sector0, sizeof(sector0));
+    memcpy(sim->flash[1], sector1, sizeof(sector1));
+
+    memset(sim->mem_mirror, 0, sizeof(sim->mem_mirror));
+    for (uint8_t i=0; i<8; i++) {
+        sim->mem_mirror[i] = i+1;
+    }
+    for (uint8_t i=0; i<16; i++) {
+        sim->mem_mirror[24+i] = i+9;
+    }
+
+    ASSERT_TRUE(sim->init());
+    EXPECT_TRUE(sim->matches());
+    EXPECT_TRUE(sim->storage.legacy_format());
+    EXPECT_EQ(0U, sim->bytes_written);
+    EXPECT_EQ(0U, sim->erases);
+
+    // written in the legacy format, leaving the sector headers alone
+    const uint8_t data[] { 51, 52, 53, 54, 55, 56, 57, 58, 59, 60 };
+    sim->write(100, data, sizeof(data));
+    EXPECT_EQ(0U, sim->erases);
+    EXPECT_EQ(0, memcmp(sim->flash[0], sector0, 4));
+    EXPECT_EQ(0, memcmp(sim->flash[1], sector1, 4));
+    EXPECT_EQ(0, memcmp(&sim->flash[0][sizeof(sector0)+2], &sim->mem_mirror[64], 64));
+
+    ASSERT_TRUE(sim->init());
+    EXPECT_TRUE(sim->matches());
+    EXPECT_TRUE(sim->storage.legacy_format());
+
+    // migrating needs erasing to be allowed
+    sim->erase_ok = false;
+    EXPECT_FALSE(sim->storage.migrate());
+    sim->erase_ok = true;
+    sim->clear_counts();
+    ASSERT_TRUE(sim->storage.migrate());
+    EXPECT_FALSE(sim->storage.legacy_format());
+    EXPECT_EQ(2U, sim->erases);
+
+    ASSERT_TRUE(sim->init());
+    EXPECT_TRUE(sim->matches());
+    EXPECT_FALSE(sim->storage.legacy_format());
+    EXPECT_EQ(0U, sim->erases);
+    delete sim;
+}
+
+/*
+  power is lost at each point in turn while migrating from the legacy
+  format, from a sector in use, and from a full sector and the sector
+  in use after it. The data is kept, and can be migrated after the
+  next boot
+ */
+TEST(AP_FlashStorage, legacy_migration_power_loss)
+{
+    // in use, with blocks 0 and 3 to 4
+    const uint8_t in_use[] {
+        0xFE, 0x5B, 0x68, 0x51,
+        0x00, 0x00, 1, 2, 3, 4, 5, 6, 7, 8,
+        0x0C, 0x20, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+    };
+    // full, with older data for block 0 and block 6
+    const uint8_t full[] {
+        0xFC, 0x5B, 0x68, 0x51,
+        0x00, 0x00, 31, 32, 33, 34, 35, 36, 37, 38,
+        0x18, 0x00, 41, 42, 43, 44, 45, 46, 47, 48,
+    };
+    const uint8_t available[] { 0xFF, 0x5B, 0x68, 0x51 };
+
+    for (uint8_t with_full=0; with_full<2; with_full++) {
+        for (uint32_t ops=0; ; ops++) {
+            SimFlash *sim = new SimFlash();
+            if (with_full) {
+                memcpy(sim->flash[0], full, sizeof(full));
+                memcpy(sim->flash[1], in_use, sizeof(in_use));
+            } else {
+                memcpy(sim->flash[0], in_use, sizeof(in_use));
+                memcpy(sim->flash[1], available, sizeof(available));
+            }
+            memset(sim->mem_mirror, 0, sizeof(sim->mem_mirror));
+            for (uint8_t i=0; i<8; i++) {
+                sim->mem_mirror[i] = i+1;
+                sim->mem_mirror[48+i] = with_full ? i+41 : 0;
+            }
+            for (uint8_t i=0; i<16; i++) {
+                sim->mem_mirror[24+i] = i+9;
+            }
+
+            ASSERT_TRUE(sim->init());
+            sim->power_loss = true;
+            sim->ops_before_power_loss = ops;
+            const bool migrated = sim->storage.migrate();
+            sim->power_loss = false;
+
+            ASSERT_TRUE(sim->init());
+            EXPECT_TRUE(sim->matches()) << "full sector " << unsigned(with_full) << " power lost after " << ops;
+            ASSERT_TRUE(sim->storage.migrate());
+            ASSERT_TRUE(sim->init());
+            EXPECT_FALSE(sim->storage.legacy_format());
+            EXPECT_TRUE(sim->matches()) << "full sector " << unsigned(with_full) << " power lost after " << ops;
+            EXPECT_EQ(0U, sim->erases);
+            delete sim;
+            if (migrated) {
+                break;
+            }
+        }
+    }
+}
+#endif
+
+AP_GTEST_MAIN()
@@ -106,6 +106,39 @@ public:
     virtual bool transfer(const uint8_t *send, uint32_t send_len,
                           uint8_t *recv, uint32_t recv_len) = 0;
 
+    /*
+     * A transaction in a batch passed to #transfer_batch(). This sends
+     * send_len bytes and then receives recv_len bytes, as a call to
+     * #transfer() would.
+     */
+    struct Transaction {
+        const uint8_t *send;
+        uint32_t send_len;
+        uint8_t *recv;
+        uint32_t recv_len;
+    };
+
+    /*
+     * Do a batch of transactions in order. Buses which support it pass
+     * the whole batch to the bus driver in one request, otherwise each
+     * transaction is done with #transfer(), stopping at the first one that
+     * fails. On I2C the transactions may be separated by a repeated start
+     * rather than a stop, so devices which need a stop should use
+     * #set_split_transfers().
+     *
+     * Return: true if all transactions were successful, false otherwise.
+     */
+    virtual bool transfer_batch(const Transaction *transactions, uint8_t count)
+    {
+        for (uint8_t i = 0; i < count; i++) {
+            const Transaction &t = transactions[i];
+            if (!transfer(t.send, t.send_len, t.recv, t.recv_len)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     /**
      * Wrapper function over #transfer() to read recv_len registers, starting
      * by first_reg, into the array pointed by recv. The read flag passed to
@@ -188,6 +188,9 @@ public:
     // request information on dma contention
     virtual size_t dma_info(char *buf, size_t bufsize) { return 0; }
 
+    // request information on SPI and I2C bus usage
+    virtual size_t bus_info(char *buf, size_t bufsize) { return 0; }
+
 protected:
     // we start soft_armed false, so that actuators don't send any
     // values until the vehicle code has fully started
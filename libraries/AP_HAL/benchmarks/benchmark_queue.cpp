@@ -0,0 +1,125 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/RingBuffer.h>
+#include <AP_Math/AP_Math.h>
+
+#include <atomic>
+#include <thread>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+// the size of a queued statustext chunk
+struct message {
+    uint8_t bitmask;
+    uint8_t severity;
+    char text[50];
+};
+
+static const uint16_t messages_per_thread = 1000;
+static const uint8_t max_threads = 8;
+
+/*
+  the way GCS::send_textv() queued messages before: format into a
+  shared buffer and push while holding the lock
+ */
+class LockedQueue {
+public:
+    bool push(uint8_t severity, const char *fmt, uint32_t arg) {
+        WITH_SEMAPHORE(sem);
+        hal.util->snprintf(buffer, sizeof(buffer), fmt, arg);
+        message m {};
+        m.severity = severity;
+        memcpy(m.text, buffer, sizeof(m.text));
+        return queue.push(m);
+    }
+    bool pop(message &m) {
+        WITH_SEMAPHORE(sem);
+        return queue.pop(m);
+    }
+private:
+    HAL_Semaphore sem;
+    char buffer[256+1];
+    ObjectBuffer<message> queue{4096};
+};
+
+// format on the stack and push without a lock
+class LockFreeQueue {
+public:
+    bool push(uint8_t severity, const char *fmt, uint32_t arg) {
+        message m {};
+        m.severity = severity;
+        hal.util->snprintf(m.text, sizeof(m.text), fmt, arg);
+        return queue.push(m);
+    }
+    bool pop(message &m) {
+        return queue.pop(m);
+    }
+private:
+    ObjectQueueMPSC<message> queue{4096};
+};
+
+/*
+  range_x() threads each send a burst of messages, as libraries do in a
+  storm of EKF and compass warnings, then the benchmark thread pops
+  them all
+ */
+template <class Queue>
+static void BM_StatustextBurst(benchmark::State& state)
+{
+    Queue *queue = new Queue;
+    std::atomic<uint32_t> generation{0};
+    std::atomic<uint32_t> done{0};
+    std::atomic<bool> should_exit{false};
+
+    const uint8_t num_threads = MIN(state.range_x(), max_threads);
+    std::thread *threads[max_threads];
+    for (uint8_t t = 0; t < num_threads; t++) {
+        threads[t] = new std::thread([&, t] {
+            uint32_t seen = 0;
+            while (!should_exit) {
+                if (generation == seen) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                seen = generation;
+                for (uint16_t i = 0; i < messages_per_thread; i++) {
+                    queue->push(4, "EKF3 IMU%u yaw inconsistent", t);
+                }
+                done++;
+            }
+        });
+    }
+
+    uint32_t received = 0;
+    while (state.KeepRunning()) {
+        done = 0;
+        generation++;
+        message m;
+        while (done < num_threads) {
+            while (queue->pop(m)) {
+                received++;
+            }
+            std::this_thread::yield();
+        }
+        while (queue->pop(m)) {
+            received++;
+        }
+    }
+
+    should_exit = true;
+    for (uint8_t t = 0; t < num_threads; t++) {
+        threads[t]->join();
+        delete threads[t];
+    }
+    delete queue;
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * num_threads * messages_per_thread);
+    char label[32];
+    snprintf(label, sizeof(label), "%u received", unsigned(received));
+    state.SetLabel(label);
+}
+
+BENCHMARK_TEMPLATE(BM_StatustextBurst, LockedQueue)->Arg(1)->Arg(4);
+BENCHMARK_TEMPLATE(BM_StatustextBurst, LockFreeQueue)->Arg(1)->Arg(4);
+
+BENCHMARK_MAIN()
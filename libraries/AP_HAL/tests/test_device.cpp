@@ -0,0 +1,76 @@
+#include <AP_gtest.h>
+#include <AP_HAL/HAL.h>
+#include <AP_HAL/Device.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  a device recording each transfer, which fails once fail_after
+  transfers have been done
+ */
+class FakeDevice : public AP_HAL::Device {
+public:
+    FakeDevice() : AP_HAL::Device(BUS_TYPE_UNKNOWN) {}
+
+    bool set_speed(Speed speed) override { return true; }
+
+    bool transfer(const uint8_t *send, uint32_t send_len,
+                  uint8_t *recv, uint32_t recv_len) override
+    {
+        if (transfers == fail_after) {
+            return false;
+        }
+        sent[transfers] = send_len != 0 ? send[0] : 0;
+        for (uint32_t i = 0; i < recv_len; i++) {
+            recv[i] = transfers;
+        }
+        transfers++;
+        return true;
+    }
+
+    AP_HAL::Semaphore *get_semaphore() override { return nullptr; }
+    PeriodicHandle register_periodic_callback(uint32_t period_usec, PeriodicCb) override { return nullptr; }
+    bool adjust_periodic_callback(PeriodicHandle h, uint32_t period_usec) override { return false; }
+
+    uint8_t transfers;
+    uint8_t fail_after = UINT8_MAX;
+    uint8_t sent[8];
+};
+
+TEST(Device, transfer_batch)
+{
+    FakeDevice dev;
+    const uint8_t regs[3] { 0x10, 0x20, 0x30 };
+    uint8_t val[2] {};
+    const AP_HAL::Device::Transaction batch[] {
+        { &regs[0], 1, &val[0], 1 },
+        { &regs[1], 1, nullptr, 0 },
+        { &regs[2], 1, &val[1], 1 },
+    };
+
+    EXPECT_TRUE(dev.transfer_batch(batch, ARRAY_SIZE(batch)));
+    EXPECT_EQ(3, dev.transfers);
+    EXPECT_EQ(0x10, dev.sent[0]);
+    EXPECT_EQ(0x20, dev.sent[1]);
+    EXPECT_EQ(0x30, dev.sent[2]);
+    EXPECT_EQ(0, val[0]);
+    EXPECT_EQ(2, val[1]);
+}
+
+TEST(Device, transfer_batch_failure)
+{
+    FakeDevice dev;
+    dev.fail_after = 1;
+    const uint8_t regs[3] { 0x10, 0x20, 0x30 };
+    const AP_HAL::Device::Transaction batch[] {
+        { &regs[0], 1, nullptr, 0 },
+        { &regs[1], 1, nullptr, 0 },
+        { &regs[2], 1, nullptr, 0 },
+    };
+
+    // the batch stops at the first failed transaction
+    EXPECT_FALSE(dev.transfer_batch(batch, ARRAY_SIZE(batch)));
+    EXPECT_EQ(1, dev.transfers);
+}
+
+AP_GTEST_MAIN()
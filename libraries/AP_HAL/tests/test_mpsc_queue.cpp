@@ -0,0 +1,110 @@
+#include <AP_gtest.h>
+#include <AP_HAL/HAL.h>
+#include <AP_HAL/utility/RingBuffer.h>
+
+#include <thread>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+TEST(ObjectQueueMPSC, fifo)
+{
+    ObjectQueueMPSC<uint32_t> queue{5};
+    uint32_t v;
+
+    // size is rounded up to a power of 2
+    EXPECT_EQ(8, queue.size());
+    EXPECT_FALSE(queue.pop(v));
+
+    for (uint32_t lap = 0; lap < 3; lap++) {
+        for (uint32_t i = 0; i < 8; i++) {
+            EXPECT_TRUE(queue.push(lap*100 + i));
+        }
+        // full
+        EXPECT_FALSE(queue.push(99));
+        for (uint32_t i = 0; i < 8; i++) {
+            EXPECT_TRUE(queue.pop(v));
+            EXPECT_EQ(lap*100 + i, v);
+        }
+        EXPECT_FALSE(queue.pop(v));
+    }
+}
+
+// pushing several objects either pushes all of them or none
+TEST(ObjectQueueMPSC, push_n)
+{
+    ObjectQueueMPSC<uint32_t> queue{8};
+    const uint32_t objs[] { 1, 2, 3, 4, 5 };
+    uint32_t v;
+
+    EXPECT_TRUE(queue.push(objs, 5));
+    // only 3 free
+    EXPECT_FALSE(queue.push(objs, 5));
+    EXPECT_TRUE(queue.push(objs, 3));
+    EXPECT_FALSE(queue.push(objs, 1));
+    for (uint32_t i = 0; i < 5; i++) {
+        EXPECT_TRUE(queue.pop(v));
+        EXPECT_EQ(objs[i], v);
+    }
+    // wraps around the end of the slots
+    EXPECT_TRUE(queue.push(objs, 5));
+    for (uint32_t i = 0; i < 3; i++) {
+        EXPECT_TRUE(queue.pop(v));
+        EXPECT_EQ(objs[i], v);
+    }
+    for (uint32_t i = 0; i < 5; i++) {
+        EXPECT_TRUE(queue.pop(v));
+        EXPECT_EQ(objs[i], v);
+    }
+    EXPECT_FALSE(queue.pop(v));
+    // more than the queue can ever hold
+    uint32_t big[9] {};
+    EXPECT_FALSE(queue.push(big, 9));
+}
+
+/*
+  several threads push numbered objects while one thread pops them. No
+  object may be lost or duplicated and the objects from each thread
+  must arrive in order
+ */
+TEST(ObjectQueueMPSC, threads)
+{
+    const uint8_t num_threads = 4;
+    const uint32_t count = 100000;
+    ObjectQueueMPSC<uint32_t> queue{64};
+
+    std::thread *producers[num_threads];
+    for (uint8_t t = 0; t < num_threads; t++) {
+        producers[t] = new std::thread([&queue, t] {
+            for (uint32_t i = 0; i < count; i++) {
+                while (!queue.push((uint32_t(t) << 24) | i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    uint32_t next[num_threads] {};
+    uint32_t received = 0;
+    while (received < num_threads * count) {
+        uint32_t v;
+        if (!queue.pop(v)) {
+            std::this_thread::yield();
+            continue;
+        }
+        const uint8_t t = v >> 24;
+        ASSERT_LT(t, num_threads);
+        EXPECT_EQ(next[t], v & 0xFFFFFF);
+        next[t] = (v & 0xFFFFFF) + 1;
+        received++;
+    }
+
+    for (uint8_t t = 0; t < num_threads; t++) {
+        producers[t]->join();
+        delete producers[t];
+        EXPECT_EQ(count, next[t]);
+    }
+    uint32_t v;
+    EXPECT_FALSE(queue.pop(v));
+}
+
+AP_GTEST_MAIN()
@@ -570,6 +570,106 @@ private:
     uint16_t _head;  // first element
 };
 
+/*
+  bounded queue of objects which any number of threads may push to
+  without taking a lock, with one thread at a time popping. Each slot
+  has a sequence number saying whether it is free for the push at that
+  position or holds an object for the pop at that position (Vyukov's
+  bounded queue). A pusher preempted between claiming and filling a
+  slot holds up pops until it continues. size is rounded up to a power
+  of 2
+ */
+template <class T>
+class ObjectQueueMPSC {
+public:
+    ObjectQueueMPSC(uint16_t size_) {
+        _size = 1;
+        while (_size < size_) {
+            _size <<= 1;
+        }
+        _slots = new slot[_size];
+        if (_slots == nullptr) {
+            _size = 0;
+            return;
+        }
+        for (uint32_t i=0; i<_size; i++) {
+            _slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~ObjectQueueMPSC(void) {
+        delete[] _slots;
+    }
+
+    // return total number of objects
+    uint16_t size(void) const {
+        return _size;
+    }
+
+    // push one object, from any thread. Returns false if the queue is full
+    bool push(const T &object) {
+        return push(&object, 1);
+    }
+
+    // push n objects to consecutive positions, from any thread. If
+    // there is not room for all of them then none are pushed and false
+    // is returned
+    bool push(const T *objects, uint16_t n) {
+        if (n == 0 || n > _size) {
+            return n == 0;
+        }
+        uint32_t pos = _head.load(std::memory_order_relaxed);
+        while (true) {
+            // slots are freed in order, so if the last slot is free
+            // for this lap then so are the ones before it
+            const slot &last = _slots[(pos+n-1) & (_size-1)];
+            const int32_t diff = int32_t(last.seq.load(std::memory_order_acquire) - (pos+n-1));
+            if (diff == 0) {
+                // the slots are free, try to claim them
+                if (_head.compare_exchange_weak(pos, pos+n, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // the slot still holds the object from a lap ago
+                return false;
+            } else {
+                // another thread claimed the slot
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+        for (uint16_t i=0; i<n; i++) {
+            slot &s = _slots[(pos+i) & (_size-1)];
+            s.object = objects[i];
+            s.seq.store(pos+i+1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    // pop the earliest object. Only one thread may pop at a time
+    bool pop(T &object) WARN_IF_UNUSED {
+        if (_size == 0) {
+            return false;
+        }
+        slot &s = _slots[_tail & (_size-1)];
+        if (int32_t(s.seq.load(std::memory_order_acquire) - (_tail+1)) < 0) {
+            return false;
+        }
+        object = s.object;
+        s.seq.store(_tail + _size, std::memory_order_release);
+        _tail++;
+        return true;
+    }
+
+private:
+    struct slot {
+        std::atomic<uint32_t> seq;
+        T object;
+    };
+    slot *_slots;
+    uint32_t _size;
+    std::atomic<uint32_t> _head{0}; // next position to push
+    uint32_t _tail = 0;             // next position to pop
+};
+
 typedef ObjectBuffer<float> FloatBuffer;
 typedef ObjectBuffer_TS<float> FloatBuffer_TS;
 typedef ObjectArray<float> FloatArray;
\ No newline at end of file
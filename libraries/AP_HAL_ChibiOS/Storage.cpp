@@ -22,6 +22,7 @@
 #include "Scheduler.h"
 #include "hwdef/common/flash.h"
 #include <AP_Filesystem/AP_Filesystem.h>
+#include <GCS_MAVLink/GCS.h>
 #include <stdio.h>
 
 using namespace ChibiOS;
@@ -47,6 +48,11 @@ extern const AP_HAL::HAL& hal;
 
 #define STORAGE_FLASH_RETRIES 5
 
+// flash in the format of earlier firmware is migrated after warning
+// the user this many times, this far apart
+#define STORAGE_MIGRATE_WARNINGS 3
+#define STORAGE_MIGRATE_WARN_MS 10000
+
 // by default don't allow fallback to sdcard for storage
 #ifndef HAL_RAMTRON_ALLOW_FALLBACK
 #define HAL_RAMTRON_ALLOW_FALLBACK 0
@@ -251,6 +257,16 @@ void Storage::_timer_tick(void)
     }
     if (_dirty_mask.empty()) {
         _last_empty_ms = AP_HAL::millis();
+#ifdef STORAGE_FLASH_PAGE
+        if (_initialisedType == StorageBackend::Flash) {
+            if (_flash.legacy_format()) {
+                _flash_migrate();
+            } else {
+                // compact and check the flash while there is nothing to write
+                _flash.idle_tick();
+            }
+        }
+#endif
         return;
     }
 
@@ -340,6 +356,30 @@ void Storage::_flash_load(void)
 #endif
 }
 
+/*
+  migrate flash written by earlier firmware to the current format.
+  Earlier firmware erases all of storage when it finds the current
+  format, so the user is warned a few times first
+ */
+void Storage::_flash_migrate(void)
+{
+#ifdef STORAGE_FLASH_PAGE
+    const uint32_t now = AP_HAL::millis();
+    if (now - _last_migrate_warn_ms < STORAGE_MIGRATE_WARN_MS) {
+        return;
+    }
+    _last_migrate_warn_ms = now;
+    if (_migrate_warnings < STORAGE_MIGRATE_WARNINGS) {
+        _migrate_warnings++;
+        GCS_SEND_TEXT(MAV_SEVERITY_WARNING, "Storage: upgrading, older firmware resets params");
+        return;
+    }
+    if (_flash_erase_ok() && _flash.migrate()) {
+        GCS_SEND_TEXT(MAV_SEVERITY_INFO, "Storage: upgraded");
+    }
+#endif
+}
+
 /*
   write one storage line. This also updates _dirty_mask.
 */
@@ -72,6 +72,8 @@ private:
     bool _flash_failed;
     uint32_t _last_re_init_ms;
     uint32_t _last_empty_ms;
+    uint32_t _last_migrate_warn_ms;
+    uint8_t _migrate_warnings;
 
 #ifdef STORAGE_FLASH_PAGE
     AP_FlashStorage _flash{_buffer,
@@ -84,6 +86,7 @@ private:
 
     void _flash_load(void);
     bool _flash_write(uint16_t line);
+    void _flash_migrate(void);
 
 #if HAL_WITH_RAMTRON
     AP_RAMTRON fram;
@@ -822,6 +822,8 @@ def write_mcu_config(f):
 ''')
     if env_vars.get('ROMFS_UNCOMPRESSED', False):
         f.write('#define HAL_ROMFS_UNCOMPRESSED\n')
+    elif env_vars.get('ROMFS_STREAMING', False):
+        f.write('#define HAL_ROMFS_STREAMING 1\n')
 
     if not args.bootloader:
         f.write('''#define STM32_DMA_REQUIRED TRUE\n\n''')
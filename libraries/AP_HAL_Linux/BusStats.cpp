@@ -0,0 +1,43 @@
+#include "BusStats.h"
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+
+extern const AP_HAL::HAL& hal;
+
+namespace Linux {
+
+void BusStats::update(uint8_t transactions, uint32_t bytes, uint64_t start_us, bool ok)
+{
+    _requests++;
+    _transactions += transactions;
+    _bytes += bytes;
+    _busy_us += AP_HAL::micros64() - start_us;
+    if (!ok) {
+        _errors++;
+    }
+}
+
+size_t BusStats::print(char *buf, size_t bufsize, const char *type, uint8_t bus)
+{
+    const uint64_t now_us = AP_HAL::micros64();
+    const float busy_pct = 100.0f * _busy_us / MAX(now_us - _last_print_us, 1U);
+
+    const int n = hal.util->snprintf(buf, bufsize, "%s%u REQ=%7u TRANS=%7u BYTES=%9u ERR=%4u BUSY=%4.1f%%\n",
+                                     type, unsigned(bus), unsigned(_requests), unsigned(_transactions),
+                                     unsigned(_bytes), unsigned(_errors), busy_pct);
+    if (n <= 0 || size_t(n) >= bufsize) {
+        return 0;
+    }
+
+    _requests = 0;
+    _transactions = 0;
+    _bytes = 0;
+    _errors = 0;
+    _busy_us = 0;
+    _last_print_us = now_us;
+
+    return n;
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+namespace Linux {
+
+/*
+  usage of a SPI or I2C bus since it was last reported
+ */
+class BusStats {
+public:
+    /*
+     * Record a request to the bus driver for a number of transactions,
+     * started at start_us
+     */
+    void update(uint8_t transactions, uint32_t bytes, uint64_t start_us, bool ok);
+
+    /*
+     * Print a line of statistics for the bus and start counting again.
+     * Returns the number of characters printed
+     */
+    size_t print(char *buf, size_t bufsize, const char *type, uint8_t bus);
+
+private:
+    uint32_t _requests;
+    uint32_t _transactions;
+    uint32_t _bytes;
+    uint32_t _errors;
+    uint64_t _busy_us;
+    uint64_t _last_print_us;
+};
+
+}
@@ -32,11 +32,13 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <net/if.h>
 #include <linux/can/raw.h>
 #include <cstring>
+#include <climits>
 #include "Scheduler.h"
 #include <AP_CANManager/AP_CANManager.h>
 extern const AP_HAL::HAL& hal;
@@ -164,8 +166,10 @@ int16_t CANIface::send(const AP_HAL::CANFrame& frame, const uint64_t tx_deadline
     _tx_queue.emplace(tx_item);
     _tx_frame_counter++;
     stats.tx_requests++;
+#if !HAL_CAN_SOCKET_DEFER_TX
     _pollRead();     // Read poll is necessary because it can release the pending TX flag
     _pollWrite();
+#endif
     return 1;
 }
 
@@ -254,47 +258,119 @@ uint32_t CANIface::getErrorCount() const
     return ec;
 }
 
+/*
+  write the frames at the top of the queue with as few sendmmsg()
+  calls as the limit on frames in flight allows
+ */
 void CANIface::_pollWrite()
 {
     while (_hasReadyTx()) {
-        const CanTxItem tx = _tx_queue.top();
-        uint64_t curr_time = AP_HAL::native_micros64();
-        if (tx.deadline >= curr_time) {
-            // hal.console->printf("%x TDEAD: %lu CURRT: %lu DEL: %lu\n",tx.frame.id,  tx.deadline, curr_time, tx.deadline-curr_time);
-            const int res = _write(tx.frame);
-            if (res == 1) {                   // Transmitted successfully
+        CanTxItem batch[HAL_CAN_SOCKET_BATCH_SIZE];
+        can_frame sockcan_frames[HAL_CAN_SOCKET_BATCH_SIZE];
+        iovec iovs[HAL_CAN_SOCKET_BATCH_SIZE];
+        mmsghdr msgs[HAL_CAN_SOCKET_BATCH_SIZE] {};
+        unsigned count = 0;
+
+        const uint64_t curr_time = AP_HAL::native_micros64();
+        while (!_tx_queue.empty() && count < HAL_CAN_SOCKET_BATCH_SIZE &&
+               _frames_in_socket_tx_queue + count < _max_frames_in_socket_tx_queue) {
+            const CanTxItem &tx = _tx_queue.top();
+            if (tx.deadline >= curr_time) {
+                batch[count] = tx;
+                sockcan_frames[count] = makeSocketCanFrame(tx.frame);
+                iovs[count].iov_base = &sockcan_frames[count];
+                iovs[count].iov_len = sizeof(can_frame);
+                msgs[count].msg_hdr.msg_iov = &iovs[count];
+                msgs[count].msg_hdr.msg_iovlen = 1;
+                count++;
+            } else {
+                stats.tx_timedout++;
+            }
+            (void)_tx_queue.pop();
+        }
+        if (count == 0) {
+            continue;
+        }
+
+        errno = 0;
+        const int res = sendmmsg(_fd, msgs, count, MSG_DONTWAIT);
+        stats.tx_syscalls++;
+
+        unsigned done = 0;
+        if (res > 0) {
+            for (; done < unsigned(res); done++) {
                 _incrementNumFramesInSocketTxQueue();
-                if (tx.loopback) {
-                    _pending_loopback_ids.insert(tx.frame.id);
+                if (batch[done].loopback) {
+                    _pending_loopback_ids.insert(batch[done].frame.id);
                 }
                 stats.tx_success++;
-            } else if (res == 0) {            // Not transmitted, nor is it an error
-                stats.tx_full++;
-                break;                        // Leaving the loop, the frame remains enqueued for the next retry
-            } else {                          // Transmission error
-                stats.tx_write_fail++;
             }
-        } else {
-            // hal.console->printf("TDEAD: %lu CURRT: %lu DEL: %lu\n", tx.deadline, curr_time, curr_time-tx.deadline);
-            stats.tx_timedout++;
+        } else if (errno != ENOBUFS && errno != EAGAIN) {
+            // the first frame failed, it is removed from the queue
+            // as a failed write() always has been
+            stats.tx_write_fail++;
+            done = 1;
         }
 
-        // Removing the frame from the queue even if transmission failed
-        (void)_tx_queue.pop();
+        // frames the socket did not take go back with their original
+        // index, so they keep their place in the queue
+        for (unsigned i = done; i < count; i++) {
+            _tx_queue.push(batch[i]);
+        }
+        if (done < count && (res > 0 || errno == ENOBUFS || errno == EAGAIN)) {
+            // socket is full, the frames are retried on the next poll
+            stats.tx_full++;
+            break;
+        }
     }
 }
 
+/*
+  drain the socket into the rx queue, up to HAL_CAN_SOCKET_BATCH_SIZE
+  frames per recvmmsg() call
+ */
 bool CANIface::_pollRead()
 {
-    uint8_t iterations_count = 0;
-    while (iterations_count < CAN_MAX_POLL_ITERATIONS_COUNT)
-    {
-        iterations_count++;
-        CanRxItem rx;
-        rx.timestamp_us = AP_HAL::native_micros64();  // Monotonic timestamp is not required to be precise (unlike UTC)
-        bool loopback = false;
-        const int res = _read(rx.frame, rx.timestamp_us, loopback);
-        if (res == 1) {
+    if (_fd < 0) {
+        return false;
+    }
+    bool accepted = false;
+    unsigned frames_read = 0;
+    while (frames_read < CAN_MAX_POLL_ITERATIONS_COUNT) {
+        can_frame sockcan_frames[HAL_CAN_SOCKET_BATCH_SIZE];
+        iovec iovs[HAL_CAN_SOCKET_BATCH_SIZE];
+        mmsghdr msgs[HAL_CAN_SOCKET_BATCH_SIZE] {};
+        for (unsigned i = 0; i < HAL_CAN_SOCKET_BATCH_SIZE; i++) {
+            iovs[i].iov_base = &sockcan_frames[i];
+            iovs[i].iov_len = sizeof(can_frame);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        const int res = recvmmsg(_fd, msgs, HAL_CAN_SOCKET_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+        stats.rx_syscalls++;
+        if (res <= 0) {
+            if (res < 0 && errno != EWOULDBLOCK) {
+                stats.rx_errors++;
+            }
+            break;
+        }
+
+        // Monotonic timestamp is not required to be precise (unlike UTC)
+        const uint64_t timestamp_us = AP_HAL::native_micros64();
+        for (int i = 0; i < res; i++) {
+            if (msgs[i].msg_len != sizeof(can_frame)) {
+                stats.rx_errors++;
+                continue;
+            }
+            const can_frame &sockcan_frame = sockcan_frames[i];
+            const bool loopback = (msgs[i].msg_hdr.msg_flags & static_cast<int>(MSG_CONFIRM)) != 0;
+            if (!loopback && !_checkHWFilters(sockcan_frame)) {
+                continue;
+            }
+            CanRxItem rx;
+            rx.frame = makeUavcanFrame(sockcan_frame);
+            rx.timestamp_us = timestamp_us;
             bool accept = true;
             if (loopback) {           // We receive loopback for all CAN frames
                 _confirmSentFrame();
@@ -305,87 +381,24 @@ bool CANIface::_pollRead()
             if (accept) {
                 _rx_queue.push(rx);
                 stats.rx_received++;
-                return true;
+                accepted = true;
             }
-        } else if (res == 0) {
-            break;
-        } else {
-            stats.rx_errors++;
-            break;
         }
-    }
-    return false;
-}
-
-int CANIface::_write(const AP_HAL::CANFrame& frame) const
-{
-    if (_fd < 0) {
-        return -1;
-    }
-    errno = 0;
-
-    const can_frame sockcan_frame = makeSocketCanFrame(frame);
+        stats.rx_frames += res;
+        frames_read += res;
 
-    const int res = write(_fd, &sockcan_frame, sizeof(sockcan_frame));
-    if (res <= 0) {
-        if (errno == ENOBUFS || errno == EAGAIN) {  // Writing is not possible atm, not an error
-            return 0;
+        if (res < HAL_CAN_SOCKET_BATCH_SIZE) {
+            // socket is empty
+            break;
         }
-        return res;
     }
-    if (res != sizeof(sockcan_frame)) {
-        return -1;
-    }
-    return 1;
-}
-
-
-int CANIface::_read(AP_HAL::CANFrame& frame, uint64_t& timestamp_us, bool& loopback) const
-{
-    if (_fd < 0) {
-        return -1;
-    }
-    auto iov = iovec();
-    auto sockcan_frame = can_frame();
-    iov.iov_base = &sockcan_frame;
-    iov.iov_len  = sizeof(sockcan_frame);
-    union {
-        uint8_t data[CMSG_SPACE(sizeof(::timeval))];
-        struct cmsghdr align;
-    } control;
-
-    auto msg = msghdr();
-    msg.msg_iov    = &iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = control.data;
-    msg.msg_controllen = sizeof(control.data);
-
-    const int res = recvmsg(_fd, &msg, MSG_DONTWAIT);
-    if (res <= 0) {
-        return (res < 0 && errno == EWOULDBLOCK) ? 0 : res;
-    }
-    /*
-     * Flags
-     */
-    loopback = (msg.msg_flags & static_cast<int>(MSG_CONFIRM)) != 0;
-
-    if (!loopback && !_checkHWFilters(sockcan_frame)) {
-        return 0;
-    }
-
-    frame = makeUavcanFrame(sockcan_frame);
-    /*
-     * Timestamp
-     */
-    timestamp_us = AP_HAL::native_micros64();
-    return 1;
+    return accepted;
 }
 
 // Might block forever, only to be used for testing
 void CANIface::flush_tx()
 {
     do {
-        _updateDownStatusFromPollResult(_pollfd);
         _poll(true, true);
     } while(!_tx_queue.empty() && !_down);
 }
@@ -432,24 +445,45 @@ bool CANIface::_checkHWFilters(const can_frame& frame) const
     }
 }
 
-void CANIface::_updateDownStatusFromPollResult(const pollfd& pfd)
+// called by the Poller when the socket reports an error
+void CANIface::_updateDownStatus()
 {
-    if (!_down && (pfd.revents & POLLERR)) {
+    if (!_down) {
         int error = 0;
         socklen_t errlen = sizeof(error);
-        getsockopt(pfd.fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<void*>(&error), &errlen);
+        getsockopt(_fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<void*>(&error), &errlen);
 
         _down= error == ENETDOWN || error == ENODEV;
         stats.num_downs++;
         Debug("Iface %d is dead; error %d", _fd, error);
     }
+    if (_down) {
+        // stop the error being reported on every wait
+        evt_can_socket[_self_index]._poller.unregister_pollable(&_pollable);
+    }
+}
+
+// add the socket to the Poller once both it and the event handle exist
+void CANIface::_registerPollable()
+{
+    if (!_initialized || _evt_handle == nullptr) {
+        return;
+    }
+    _pollable.set_fd(_fd);
+    if (!evt_can_socket[_self_index]._poller.register_pollable(&_pollable, EPOLLIN)) {
+        Debug("Iface %d failed to register with poller", _fd);
+    }
 }
 
 bool CANIface::init(const uint32_t bitrate, const OperatingMode mode)
 {
     char iface_name[16];
-    sprintf(iface_name, "can%u", _self_index);
+    snprintf(iface_name, sizeof(iface_name), "can%u", _self_index);
+    return init(iface_name, bitrate, mode);
+}
 
+bool CANIface::init(const char *iface_name, const uint32_t bitrate, const OperatingMode mode)
+{
     if (_initialized) {
         return _initialized;
     }
@@ -461,6 +495,7 @@ bool CANIface::init(const uint32_t bitrate, const OperatingMode mode)
     if (_fd > 0) {
         _bitrate = bitrate;
         _initialized = true;
+        _registerPollable();
     } else {
         _initialized = false;
     }
@@ -480,14 +515,10 @@ bool CANIface::select(bool &read_select, bool &write_select,
     if (need_block) {
         if (_down) {
             return false;
-        } else {
-            _pollfd.fd = _fd;
-            _pollfd.events |= POLLIN;
-            stats.num_rx_poll_req++;
-            if (_hasReadyTx() && write_select) {
-                _pollfd.events |= POLLOUT;
-                stats.num_tx_poll_req++;
-            }
+        }
+        stats.num_rx_poll_req++;
+        if (_hasReadyTx() && write_select) {
+            stats.num_tx_poll_req++;
         }
         if (_evt_handle != nullptr && blocking_deadline > AP_HAL::native_micros64()) {
             _evt_handle->wait(blocking_deadline - AP_HAL::native_micros64());
@@ -514,61 +545,39 @@ bool CANIface::set_event_handle(AP_HAL::EventHandle* handle) {
     _evt_handle = handle;
     evt_can_socket[_self_index]._ifaces[_self_index] = this;
     _evt_handle->set_source(&evt_can_socket[_self_index]);
+    _registerPollable();
     return true;
 }
 
 
 bool CANIface::CANSocketEventSource::wait(uint64_t duration, AP_HAL::EventHandle* evt_handle)
 {
-    if (evt_handle == nullptr) {
+    if (evt_handle == nullptr || !_poller) {
         return false;
     }
-    pollfd pollfds[HAL_NUM_CAN_IFACES] {};
-    uint8_t pollfd_iface_map[HAL_NUM_CAN_IFACES] {};
-    unsigned long int num_pollfds = 0;
-    
-    // Poll FD set setup
+    bool have_iface = false;
     for (unsigned i = 0; i < HAL_NUM_CAN_IFACES; i++) {
-        if (_ifaces[i] == nullptr) {
+        if (_ifaces[i] == nullptr || _ifaces[i]->_down) {
             continue;
         }
-        if (_ifaces[i]->_down) {
-            continue;
+        // the socket is almost always writable, so rather than waiting
+        // for EPOLLOUT frames that can go are written before blocking.
+        // Frames held back by the in-flight limit are released by the
+        // loopback read that wakes us up
+        if (_ifaces[i]->_hasReadyTx()) {
+            _ifaces[i]->_poll(false, true);
         }
-        pollfds[num_pollfds] = _ifaces[i]->_pollfd;
-        pollfd_iface_map[num_pollfds] = i;
-        num_pollfds++;
         _ifaces[i]->stats.num_poll_waits++;
+        have_iface = true;
     }
 
-    if (num_pollfds == 0) {
+    if (!have_iface) {
         return true;
     }
 
-    // Timeout conversion
-    auto ts = timespec();
-    ts.tv_sec = duration / 1000000LL;
-    ts.tv_nsec = (duration % 1000000LL) * 1000;
-
-    // Blocking here
-    const int res = ppoll(pollfds, num_pollfds, &ts, nullptr);
-
-    if (res < 0) {
-        return false;
-    }
-
-    // Handling poll output
-    for (unsigned i = 0; i < num_pollfds; i++) {
-        if (_ifaces[pollfd_iface_map[i]] == nullptr) {
-            continue;
-        }
-        _ifaces[pollfd_iface_map[i]]->_updateDownStatusFromPollResult(pollfds[i]);
-
-        const bool poll_read  = pollfds[i].revents & POLLIN;
-        const bool poll_write = pollfds[i].revents & POLLOUT;
-        _ifaces[pollfd_iface_map[i]]->_poll(poll_read, poll_write);
-    }
-    return true;
+    // Blocking here, the Poller calls _poll() on each readable socket
+    const uint64_t timeout_ms = (duration + 999) / 1000;
+    return _poller.poll(timeout_ms > INT_MAX ? INT_MAX : int(timeout_ms)) >= 0;
 }
 
 uint32_t CANIface::get_stats(char* data, uint32_t max_size)
@@ -583,8 +592,11 @@ uint32_t CANIface::get_stats(char* data, uint32_t max_size)
                             "tx_confirmed:   %u\n"
                             "tx_success:     %u\n"
                             "tx_timedout:    %u\n"
+                            "tx_syscalls:    %u\n"
                             "rx_received:    %u\n"
                             "rx_errors:      %u\n"
+                            "rx_frames:      %u\n"
+                            "rx_syscalls:    %u\n"
                             "num_downs:      %u\n"
                             "num_rx_poll_req:  %u\n"
                             "num_tx_poll_req:  %u\n"
@@ -597,8 +609,11 @@ uint32_t CANIface::get_stats(char* data, uint32_t max_size)
                             stats.tx_confirmed,
                             stats.tx_success,
                             stats.tx_timedout,
+                            stats.tx_syscalls,
                             stats.rx_received,
                             stats.rx_errors,
+                            stats.rx_frames,
+                            stats.rx_syscalls,
                             stats.num_downs,
                             stats.num_rx_poll_req,
                             stats.num_tx_poll_req,
@@ -27,6 +27,7 @@
 #pragma once
 
 #include "AP_HAL_Linux.h"
+#include "Poller.h"
 
 #if HAL_NUM_CAN_IFACES
 
@@ -39,7 +40,6 @@
 #include <memory>
 #include <map>
 #include <unordered_set>
-#include <poll.h>
 
 namespace Linux {
 
@@ -54,12 +54,40 @@ enum class SocketCanError
 #define CAN_MAX_INIT_TRIES_COUNT 100
 #define CAN_FILTER_NUMBER 8
 
+// frames moved by each recvmmsg()/sendmmsg() call
+#ifndef HAL_CAN_SOCKET_BATCH_SIZE
+#define HAL_CAN_SOCKET_BATCH_SIZE 16
+#endif
+
+// leave writing to the event source, which writes the frames queued
+// since it last blocked with as few sendmmsg() calls as it can. Only
+// for CAN drivers which wait on the event handle, as UAVCAN does.
+// Off by default: each send() then writes straight away, with at most
+// HAL_CAN_SOCKET_MAX_TX_IN_FLIGHT frames in the socket, so sendmmsg()
+// writes one or two frames and only receiving is batched
+#ifndef HAL_CAN_SOCKET_DEFER_TX
+#define HAL_CAN_SOCKET_DEFER_TX 0
+#endif
+
+// frames written to the socket that have not come back through
+// loopback yet. Deferred writes allow more, so that a single
+// sendmmsg() writes several frames, at the cost of a higher priority
+// frame queued afterwards waiting behind the ones already in the socket
+#ifndef HAL_CAN_SOCKET_MAX_TX_IN_FLIGHT
+#if HAL_CAN_SOCKET_DEFER_TX
+#define HAL_CAN_SOCKET_MAX_TX_IN_FLIGHT 8
+#else
+#define HAL_CAN_SOCKET_MAX_TX_IN_FLIGHT 2
+#endif
+#endif
+
 class CANIface: public AP_HAL::CANIface {
 public:
     CANIface(int index)
       : _self_index(index)
+      , _max_frames_in_socket_tx_queue(HAL_CAN_SOCKET_MAX_TX_IN_FLIGHT)
       , _frames_in_socket_tx_queue(0)
-      , _max_frames_in_socket_tx_queue(2)
+      , _pollable(*this)
     { }
 
     ~CANIface() { }
@@ -67,6 +95,9 @@ public:
     // Initialise CAN Peripheral
     bool init(const uint32_t bitrate, const OperatingMode mode) override;
 
+    // Initialise on a named SocketCAN interface, e.g. vcan0
+    bool init(const char *iface_name, const uint32_t bitrate, const OperatingMode mode);
+
     // Put frame into Tx FIFO returns negative on error, 0 on buffer full, 
     // 1 on successfully pushing a frame into FIFO
     int16_t send(const AP_HAL::CANFrame& frame, uint64_t tx_deadline,
@@ -118,21 +149,36 @@ public:
     class CANSocketEventSource : public AP_HAL::EventSource {
         friend class CANIface;
         CANIface *_ifaces[HAL_NUM_CAN_IFACES];
-        
+        Poller _poller;
+
     public:
-        // we just poll fd, no signaling is done
-        void signal(uint32_t evt_mask) override { return; }
+        // wake up the thread waiting on the sockets
+        void signal(uint32_t evt_mask) override { _poller.wakeup(); }
         bool wait(uint64_t duration, AP_HAL::EventHandle* evt_handle) override;
     };
 
 private:
-    void _pollWrite();
+    friend class CANSocketIfaceTest;
 
-    bool _pollRead();
+    // the socket as registered with the Poller of the event source.
+    // The file descriptor is owned by CANIface
+    class SocketPollable : public Pollable {
+    public:
+        SocketPollable(CANIface &iface) : _iface(iface) { }
+        ~SocketPollable() { _fd = -1; }
 
-    int _write(const AP_HAL::CANFrame& frame) const;
+        void set_fd(int fd) { _fd = fd; }
 
-    int _read(AP_HAL::CANFrame& frame, uint64_t& ts_usec, bool& loopback) const;
+        void on_can_read() override { _iface._poll(true, false); }
+        void on_error() override { _iface._updateDownStatus(); }
+
+    private:
+        CANIface &_iface;
+    };
+
+    void _pollWrite();
+
+    bool _pollRead();
 
     void _incrementNumFramesInSocketTxQueue();
 
@@ -150,7 +196,9 @@ private:
 
     int _openSocket(const std::string& iface_name);
 
-    void _updateDownStatusFromPollResult(const pollfd& pfd);
+    void _updateDownStatus();
+
+    void _registerPollable();
 
     uint32_t _bitrate;
 
@@ -167,7 +215,7 @@ private:
     AP_HAL::EventHandle *_evt_handle;
     static CANSocketEventSource evt_can_socket[HAL_NUM_CAN_IFACES];
 
-    pollfd _pollfd;
+    SocketPollable _pollable;
     std::map<SocketCanError, uint64_t> _errors;
     std::priority_queue<CanTxItem> _tx_queue;
     std::queue<CanRxItem> _rx_queue;
@@ -181,8 +229,11 @@ private:
         uint32_t tx_write_fail;
         uint32_t tx_success;
         uint32_t tx_timedout;
+        uint32_t tx_syscalls;
         uint32_t rx_received;
         uint32_t rx_errors;
+        uint32_t rx_frames;
+        uint32_t rx_syscalls;
         uint32_t num_downs;
         uint32_t num_rx_poll_req;
         uint32_t num_tx_poll_req;
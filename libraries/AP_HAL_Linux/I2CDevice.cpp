@@ -45,6 +45,7 @@
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Math/AP_Math.h>
 
+#include "BusStats.h"
 #include "PollerThread.h"
 #include "Scheduler.h"
 #include "Semaphores.h"
@@ -94,6 +95,7 @@ public:
     int fd = -1;
     uint8_t bus;
     uint8_t ref;
+    BusStats stats;
 };
 
 I2CBus::~I2CBus()
@@ -190,15 +192,84 @@ bool I2CDevice::transfer(const uint8_t *send, uint32_t send_len,
     i2c_data.msgs = msgs;
     i2c_data.nmsgs = nmsgs;
 
+    const uint64_t start_us = AP_HAL::micros64();
     int r;
     unsigned retries = _retries;
     do {
         r = ::ioctl(_bus.fd, I2C_RDWR, &i2c_data);
     } while (r == -1 && retries-- > 0);
+    _bus.stats.update(1, msgs[0].len + msgs[1].len, start_us, r != -1);
 
     return r != -1;
 }
 
+bool I2CDevice::transfer_batch(const AP_HAL::Device::Transaction *transactions,
+                               uint8_t count)
+{
+    if (_split_transfers) {
+        return AP_HAL::I2CDevice::transfer_batch(transactions, count);
+    }
+
+    const uint8_t max_transactions = I2C_RDRW_IOCTL_MAX_MSGS / 2;
+    struct i2c_msg msgs[I2C_RDRW_IOCTL_MAX_MSGS];
+
+    assert(_bus.fd >= 0);
+
+    while (count > 0) {
+        const uint8_t n = MIN(count, max_transactions);
+        struct i2c_rdwr_ioctl_data i2c_data = { };
+        uint32_t bytes = 0;
+
+        memset(msgs, 0, sizeof(msgs));
+        i2c_data.msgs = msgs;
+
+        for (uint8_t i = 0; i < n; i++) {
+            const AP_HAL::Device::Transaction &t = transactions[i];
+            const unsigned first = i2c_data.nmsgs;
+
+            if (t.send && t.send_len != 0) {
+                msgs[i2c_data.nmsgs].addr = _address;
+                msgs[i2c_data.nmsgs].flags = 0;
+                msgs[i2c_data.nmsgs].buf = const_cast<uint8_t*>(t.send);
+                msgs[i2c_data.nmsgs].len = t.send_len;
+                bytes += t.send_len;
+                i2c_data.nmsgs++;
+            }
+
+            if (t.recv && t.recv_len != 0) {
+                msgs[i2c_data.nmsgs].addr = _address;
+                msgs[i2c_data.nmsgs].flags = I2C_M_RD;
+                msgs[i2c_data.nmsgs].buf = t.recv;
+                msgs[i2c_data.nmsgs].len = t.recv_len;
+                bytes += t.recv_len;
+                i2c_data.nmsgs++;
+            }
+
+            /* interpret it as an input error if nothing has to be done */
+            if (i2c_data.nmsgs == first) {
+                return false;
+            }
+        }
+
+        const uint64_t start_us = AP_HAL::micros64();
+        int r;
+        unsigned retries = _retries;
+        do {
+            r = ::ioctl(_bus.fd, I2C_RDWR, &i2c_data);
+        } while (r == -1 && retries-- > 0);
+        _bus.stats.update(n, bytes, start_us, r != -1);
+
+        if (r == -1) {
+            return false;
+        }
+
+        transactions += n;
+        count -= n;
+    }
+
+    return true;
+}
+
 bool I2CDevice::read_registers_multiple(uint8_t first_reg, uint8_t *recv,
                                         uint32_t recv_len, uint8_t times)
 {
@@ -229,11 +300,13 @@ bool I2CDevice::read_registers_multiple(uint8_t first_reg, uint8_t *recv,
             recv += recv_len;
         };
 
+        const uint64_t start_us = AP_HAL::micros64();
         int r;
         unsigned retries = _retries;
         do {
             r = ::ioctl(_bus.fd, I2C_RDWR, &i2c_data);
         } while (r == -1 && retries-- > 0);
+        _bus.stats.update(n, n * (1 + recv_len), start_us, r != -1);
 
         if (r == -1) {
             return false;
@@ -263,6 +336,7 @@ AP_HAL::Device::PeriodicHandle I2CDevice::register_periodic_callback(
         snprintf(name, sizeof(name), "ap-i2c-%u", _bus.bus);
 
         _bus.thread.set_stack_size(AP_LINUX_SENSORS_STACK_SIZE);
+        Scheduler::from(hal.scheduler)->place_bus_thread(_bus.thread);
         _bus.thread.start(name, AP_LINUX_SENSORS_SCHED_POLICY,
                           AP_LINUX_SENSORS_SCHED_PRIO);
     }
@@ -404,6 +478,22 @@ void I2CDeviceManager::_unregister(I2CBus &b)
     }
 }
 
+size_t I2CDeviceManager::bus_info(char *buf, size_t bufsize)
+{
+    size_t total = 0;
+
+    for (auto it = _buses.begin(); it != _buses.end(); it++) {
+        WITH_SEMAPHORE((*it)->sem);
+        size_t n = (*it)->stats.print(buf + total, bufsize - total, "I2C", (*it)->bus);
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+
+    return total;
+}
+
 void I2CDeviceManager::teardown()
 {
     for (auto it = _buses.begin(); it != _buses.end(); it++) {
@@ -57,6 +57,10 @@ public:
     bool transfer(const uint8_t *send, uint32_t send_len,
                   uint8_t *recv, uint32_t recv_len) override;
 
+    /* See AP_HAL::Device::transfer_batch() */
+    bool transfer_batch(const AP_HAL::Device::Transaction *transactions,
+                        uint8_t count) override;
+
     bool read_registers_multiple(uint8_t first_reg, uint8_t *recv,
                                  uint32_t recv_len, uint8_t times) override;
 
@@ -124,6 +128,11 @@ public:
       get mask of bus numbers for all configured internal I2C buses
      */
     uint32_t get_bus_mask_internal(void) const override;
+
+    /*
+     * Print usage of each bus since the last call
+     */
+    size_t bus_info(char *buf, size_t bufsize);
     
 protected:
     void _unregister(I2CBus &b);
@@ -108,8 +108,10 @@ public:
      * Wait for events on all Pollable objects registered with
      * register_pollable(). New Pollable objects can be registered at any
      * time, including when a thread is sleeping on a poll() call.
+     * Returns 0 if @timeout_ms passes with no event, a negative
+     * @timeout_ms waits forever.
      */
-    int poll() const;
+    int poll(int timeout_ms = -1) const;
 
     /*
      * Wake up the thread sleeping on a poll() call if it is in fact
@@ -29,7 +29,9 @@
 
 #include <AP_HAL/AP_HAL.h>
 #include <AP_HAL/utility/OwnPtr.h>
+#include <AP_Math/AP_Math.h>
 
+#include "BusStats.h"
 #include "GPIO.h"
 #include "PollerThread.h"
 #include "Scheduler.h"
@@ -159,6 +161,11 @@ SPIDesc SPIDeviceManager::_device[] = {
 
 #define MAX_SUBDEVS 6
 
+// maximum number of transactions in each request to the bus driver
+#ifndef LINUX_SPI_BATCH_MAX
+#define LINUX_SPI_BATCH_MAX 32
+#endif
+
 const uint8_t SPIDeviceManager::_n_device_desc = LINUX_SPI_DEVICE_NUM_DEVICES;
 
 
@@ -183,6 +190,7 @@ public:
     uint16_t bus;
     int16_t last_mode = -1;
     uint8_t ref;
+    BusStats stats;
 };
 
 SPIBus::SPIBus(uint16_t bus_)
@@ -302,6 +310,102 @@ bool SPIDevice::transfer(const uint8_t *send, uint32_t send_len,
         return false;
     }
 
+    if (!_set_mode(fd)) {
+        return false;
+    }
+
+    const uint64_t start_us = AP_HAL::micros64();
+    _cs_assert();
+    int r = ioctl(fd, SPI_IOC_MESSAGE(nmsgs), &msgs);
+    _cs_release();
+    _bus.stats.update(1, msgs[0].len + msgs[1].len, start_us, r != -1);
+
+    if (r == -1) {
+        hal.console->printf("SPIDevice: error transferring data fd=%d (%s)\n",
+                            fd, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+bool SPIDevice::transfer_batch(const AP_HAL::Device::Transaction *transactions,
+                               uint8_t count)
+{
+    /*
+     * with a userspace CS the device can't be deselected between the
+     * transactions of a single request
+     */
+    if (_desc.cs_pin != SPI_CS_KERNEL) {
+        return AP_HAL::SPIDevice::transfer_batch(transactions, count);
+    }
+
+    int fd = _bus.fd[_desc.subdev];
+
+    assert(fd >= 0);
+
+    if (!_set_mode(fd)) {
+        return false;
+    }
+
+    struct spi_ioc_transfer msgs[2 * LINUX_SPI_BATCH_MAX];
+
+    while (count > 0) {
+        const uint8_t n = MIN(count, LINUX_SPI_BATCH_MAX);
+        unsigned nmsgs = 0;
+        uint32_t bytes = 0;
+
+        memset(msgs, 0, sizeof(msgs));
+
+        for (uint8_t i = 0; i < n; i++) {
+            const AP_HAL::Device::Transaction &t = transactions[i];
+            const unsigned first = nmsgs;
+
+            if (t.send && t.send_len != 0) {
+                msgs[nmsgs].tx_buf = (uint64_t) t.send;
+                msgs[nmsgs].len = t.send_len;
+                msgs[nmsgs].speed_hz = _speed;
+                msgs[nmsgs].bits_per_word = _desc.bits_per_word;
+                bytes += t.send_len;
+                nmsgs++;
+            }
+
+            if (t.recv && t.recv_len != 0) {
+                msgs[nmsgs].rx_buf = (uint64_t) t.recv;
+                msgs[nmsgs].len = t.recv_len;
+                msgs[nmsgs].speed_hz = _speed;
+                msgs[nmsgs].bits_per_word = _desc.bits_per_word;
+                bytes += t.recv_len;
+                nmsgs++;
+            }
+
+            if (nmsgs == first) {
+                return false;
+            }
+
+            /* deselect the device between transactions */
+            msgs[nmsgs - 1].cs_change = i != n - 1;
+        }
+
+        const uint64_t start_us = AP_HAL::micros64();
+        int r = ioctl(fd, SPI_IOC_MESSAGE(nmsgs), msgs);
+        _bus.stats.update(n, bytes, start_us, r != -1);
+
+        if (r == -1) {
+            hal.console->printf("SPIDevice: error transferring data fd=%d (%s)\n",
+                                fd, strerror(errno));
+            return false;
+        }
+
+        transactions += n;
+        count -= n;
+    }
+
+    return true;
+}
+
+bool SPIDevice::_set_mode(int fd)
+{
 #if DEBUG
     if (_desc.mode == _bus.last_mode) {
         /*
@@ -325,9 +429,8 @@ bool SPIDevice::transfer(const uint8_t *send, uint32_t send_len,
     }
 #endif
 
-    int r;
     if (_desc.mode != _bus.last_mode) {
-        r = ioctl(fd, SPI_IOC_WR_MODE, &_desc.mode);
+        int r = ioctl(fd, SPI_IOC_WR_MODE, &_desc.mode);
         if (r < 0) {
             hal.console->printf("SPIDevice: error on setting mode fd=%d (%s)\n",
                                 fd, strerror(errno));
@@ -336,16 +439,6 @@ bool SPIDevice::transfer(const uint8_t *send, uint32_t send_len,
         _bus.last_mode = _desc.mode;
     }
 
-    _cs_assert();
-    r = ioctl(fd, SPI_IOC_MESSAGE(nmsgs), &msgs);
-    _cs_release();
-
-    if (r == -1) {
-        hal.console->printf("SPIDevice: error transferring data fd=%d (%s)\n",
-                            fd, strerror(errno));
-        return false;
-    }
-
     return true;
 }
 
@@ -376,9 +469,11 @@ bool SPIDevice::transfer_fullduplex(const uint8_t *send, uint8_t *recv,
         return false;
     }
 
+    const uint64_t start_us = AP_HAL::micros64();
     _cs_assert();
     r = ioctl(fd, SPI_IOC_MESSAGE(1), &msgs);
     _cs_release();
+    _bus.stats.update(1, len, start_us, r != -1);
 
     if (r == -1) {
         hal.console->printf("SPIDevice: error transferring data fd=%d (%s)\n",
@@ -426,6 +521,7 @@ AP_HAL::Device::PeriodicHandle SPIDevice::register_periodic_callback(
         snprintf(name, sizeof(name), "ap-spi-%u", _bus.bus);
 
         _bus.thread.set_stack_size(AP_LINUX_SENSORS_STACK_SIZE);
+        Scheduler::from(hal.scheduler)->place_bus_thread(_bus.thread);
         _bus.thread.start(name, AP_LINUX_SENSORS_SCHED_POLICY,
                           AP_LINUX_SENSORS_SCHED_PRIO);
     }
@@ -522,6 +618,22 @@ void SPIDeviceManager::_unregister(SPIBus &b)
     }
 }
 
+size_t SPIDeviceManager::bus_info(char *buf, size_t bufsize)
+{
+    size_t total = 0;
+
+    for (auto it = _buses.begin(); it != _buses.end(); it++) {
+        WITH_SEMAPHORE((*it)->sem);
+        size_t n = (*it)->stats.print(buf + total, bufsize - total, "SPI", (*it)->bus);
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+
+    return total;
+}
+
 void SPIDeviceManager::teardown()
 {
     for (auto it = _buses.begin(); it != _buses.end(); it++) {
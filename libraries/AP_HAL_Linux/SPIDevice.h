@@ -42,6 +42,10 @@ public:
     bool transfer(const uint8_t *send, uint32_t send_len,
                   uint8_t *recv, uint32_t recv_len) override;
 
+    /* See AP_HAL::Device::transfer_batch() */
+    bool transfer_batch(const AP_HAL::Device::Transaction *transactions,
+                        uint8_t count) override;
+
     /* See AP_HAL::SPIDevice::transfer_fullduplex() */
     bool transfer_fullduplex(const uint8_t *send, uint8_t *recv,
                              uint32_t len) override;
@@ -63,6 +67,12 @@ protected:
     AP_HAL::DigitalSource *_cs;
     uint32_t _speed;
 
+    /*
+     * Set the SPI mode for this device if the bus was last used with
+     * another mode
+     */
+    bool _set_mode(int fd);
+
     /*
      * Select device if using userspace CS
      */
@@ -105,6 +115,11 @@ public:
     /* See AP_HAL::SPIDeviceManager::get_device_name() */
     const char *get_device_name(uint8_t idx) override;
 
+    /*
+     * Print usage of each bus since the last call
+     */
+    size_t bus_info(char *buf, size_t bufsize);
+
 protected:
     void _unregister(SPIBus &b);
     AP_HAL::OwnPtr<AP_HAL::SPIDevice> _create_device(SPIBus &b, SPIDesc &device_desc) const;
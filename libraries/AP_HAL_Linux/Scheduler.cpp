@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <errno.h>
 #include <poll.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
@@ -52,11 +53,219 @@ extern const AP_HAL::HAL& hal;
         .policy = SCHED_FIFO,                                   \
         .prio = APM_LINUX_##UPPER_NAME_##_PRIORITY,             \
         .rate = APM_LINUX_##UPPER_NAME_##_RATE,                 \
+        .cls = THREAD_CLASS_##UPPER_NAME_,                      \
     }
 
+const char *Scheduler::_thread_class_names[THREAD_CLASS_NUM] = {
+    "main",
+    "timer",
+    "uart",
+    "rcin",
+    "io",
+    "sensors",
+    "can",
+    "storage",
+    "scripting",
+};
+
 Scheduler::Scheduler()
 { }
 
+/*
+  parse a list of CPUs in the format used by the kernel, e.g. "0-2,4"
+ */
+static bool parse_cpulist(const char *list, size_t len, cpu_set_t &cpus)
+{
+    const char *end = list + len;
+
+    CPU_ZERO(&cpus);
+    while (list < end) {
+        char *p;
+        unsigned long first = strtoul(list, &p, 10);
+        unsigned long last = first;
+        if (p == list) {
+            return false;
+        }
+        if (p < end && *p == '-') {
+            list = p + 1;
+            last = strtoul(list, &p, 10);
+            if (p == list || last < first) {
+                return false;
+            }
+        }
+        if (last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (unsigned long cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, &cpus);
+        }
+        if (p < end && *p != ',' && *p != '\n') {
+            return false;
+        }
+        list = p + 1;
+    }
+
+    return true;
+}
+
+/*
+  read a list of CPUs from sysfs, returning false if it is missing or empty
+ */
+static bool read_cpulist(const char *path, cpu_set_t &cpus)
+{
+    char buf[256];
+
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) {
+        return false;
+    }
+    const bool ok = fgets(buf, sizeof(buf), f) != nullptr;
+    fclose(f);
+
+    return ok && parse_cpulist(buf, strlen(buf), cpus) && CPU_COUNT(&cpus) > 0;
+}
+
+/*
+  parse a --cpu-affinity spec. Each list is limited to the CPUs the
+  process may run on (e.g. under taskset or a cpuset cgroup), and a
+  class left with no CPUs is rejected here rather than failing when
+  its threads start
+ */
+bool Scheduler::set_cpu_affinity(const char *spec)
+{
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        fprintf(stderr, "WARNING: failed to get CPU affinity: %s\n", strerror(errno));
+        CPU_ZERO(&allowed);
+    }
+
+    while (*spec) {
+        const char *eq = strchr(spec, '=');
+        if (eq == nullptr) {
+            return false;
+        }
+        const char *end = strchrnul(eq, ':');
+
+        uint8_t i;
+        for (i = 0; i < THREAD_CLASS_NUM; i++) {
+            if (strlen(_thread_class_names[i]) == size_t(eq - spec) &&
+                strncmp(_thread_class_names[i], spec, eq - spec) == 0) {
+                break;
+            }
+        }
+        if (i == THREAD_CLASS_NUM ||
+            !parse_cpulist(eq + 1, end - (eq + 1), _placement[i].cpus) ||
+            CPU_COUNT(&_placement[i].cpus) == 0) {
+            return false;
+        }
+        if (CPU_COUNT(&allowed) > 0) {
+            CPU_AND(&_placement[i].cpus, &_placement[i].cpus, &allowed);
+            if (CPU_COUNT(&_placement[i].cpus) == 0) {
+                fprintf(stderr, "CPU affinity for %s: none of the CPUs are available to this process\n",
+                        _thread_class_names[i]);
+                return false;
+            }
+        }
+        _placement[i].set = true;
+
+        spec = *end ? end + 1 : end;
+    }
+
+    return true;
+}
+
+/*
+  if the kernel was booted with isolcpus, run the main thread alone on
+  the first isolated CPU and the other realtime threads on the rest of
+  them, leaving the housekeeping CPUs to IO, storage and scripting.
+  The kernel doesn't balance load across isolated CPUs, so each thread
+  stays on the first CPU it starts on. Without isolated CPUs placement
+  is left to the kernel
+ */
+void Scheduler::_init_default_placement()
+{
+    // threads inherit the affinity of the thread that creates them, so
+    // keep the CPUs the process may use for threads that aren't placed
+    if (sched_getaffinity(0, sizeof(_allowed_cpus), &_allowed_cpus) != 0) {
+        CPU_ZERO(&_allowed_cpus);
+    }
+
+    cpu_set_t isolated, online;
+
+    if (!read_cpulist("/sys/devices/system/cpu/isolated", isolated) ||
+        !read_cpulist("/sys/devices/system/cpu/online", online)) {
+        return;
+    }
+    if (CPU_COUNT(&_allowed_cpus) > 0) {
+        CPU_AND(&isolated, &isolated, &_allowed_cpus);
+        CPU_AND(&online, &online, &_allowed_cpus);
+        if (CPU_COUNT(&isolated) == 0) {
+            // none of the isolated CPUs are ours to use
+            return;
+        }
+    }
+
+    cpu_set_t main_cpu, rt_cpus, other_cpus;
+    CPU_ZERO(&main_cpu);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &isolated)) {
+            CPU_SET(cpu, &main_cpu);
+            break;
+        }
+    }
+    CPU_XOR(&rt_cpus, &isolated, &main_cpu);
+    if (CPU_COUNT(&rt_cpus) == 0) {
+        rt_cpus = main_cpu;
+    }
+    CPU_XOR(&other_cpus, &online, &isolated);
+    CPU_AND(&other_cpus, &other_cpus, &online);
+
+    for (uint8_t i = 0; i < THREAD_CLASS_NUM; i++) {
+        if (_placement[i].set) {
+            continue;
+        }
+        switch (i) {
+        case THREAD_CLASS_MAIN:
+            _placement[i].cpus = main_cpu;
+            break;
+        case THREAD_CLASS_IO:
+        case THREAD_CLASS_STORAGE:
+        case THREAD_CLASS_SCRIPTING:
+            if (CPU_COUNT(&other_cpus) == 0) {
+                continue;
+            }
+            _placement[i].cpus = other_cpus;
+            break;
+        default:
+            _placement[i].cpus = rt_cpus;
+            break;
+        }
+        _placement[i].set = true;
+    }
+}
+
+void Scheduler::_place_thread(Thread &thread, enum thread_class cls)
+{
+    if (_placement[cls].set) {
+        thread.set_cpu_affinity(_placement[cls].cpus);
+    } else if (_placement[THREAD_CLASS_MAIN].set && CPU_COUNT(&_allowed_cpus) > 0) {
+        // don't inherit the main thread's CPU
+        thread.set_cpu_affinity(_allowed_cpus);
+    }
+}
+
+/*
+  touch the main thread stack so it is resident before we start flying
+ */
+static void __attribute__((noinline)) prefault_stack()
+{
+    volatile uint8_t stack[AP_LINUX_PREFAULT_STACK_SIZE];
+
+    for (size_t i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
+
 
 void Scheduler::init_realtime()
 {
@@ -72,7 +281,19 @@ void Scheduler::init_realtime()
     }
 #endif
 
-    mlockall(MCL_CURRENT|MCL_FUTURE);
+    /*
+      lock all memory, including the stacks and buffers of threads
+      created later, such as the logging buffer
+     */
+    if (mlockall(MCL_CURRENT|MCL_FUTURE) == -1) {
+        fprintf(stderr, "WARNING: failed to lock memory: %s\n", strerror(errno));
+    }
+    prefault_stack();
+
+    if (_placement[THREAD_CLASS_MAIN].set &&
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &_placement[THREAD_CLASS_MAIN].cpus) != 0) {
+        fprintf(stderr, "WARNING: failed to set CPU affinity of main thread\n");
+    }
 
     struct sched_param param = { .sched_priority = APM_LINUX_MAIN_PRIORITY };
     if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == -1) {
@@ -90,6 +311,7 @@ void Scheduler::init()
         int policy;
         int prio;
         uint32_t rate;
+        enum thread_class cls;
     } sched_table[] = {
         SCHED_THREAD(timer, TIMER),
         SCHED_THREAD(uart, UART),
@@ -99,6 +321,8 @@ void Scheduler::init()
 
     _main_ctx = pthread_self();
 
+    _init_default_placement();
+
     init_realtime();
 
     /* set barrier to N + 1 threads: worker threads + main */
@@ -114,6 +338,7 @@ void Scheduler::init()
 
         t->thread->set_rate(t->rate);
         t->thread->set_stack_size(1024 * 1024);
+        _place_thread(*t->thread, t->cls);
         t->thread->start(t->name, t->policy, t->prio);
     }
 
@@ -359,28 +584,32 @@ bool Scheduler::thread_create(AP_HAL::MemberProc proc, const char *name, uint32_
     }
 
     uint8_t thread_priority = APM_LINUX_IO_PRIORITY;
+    enum thread_class cls = THREAD_CLASS_IO;
     static const struct {
         priority_base base;
         uint8_t p;
+        enum thread_class cls;
     } priority_map[] = {
-        { PRIORITY_BOOST, APM_LINUX_MAIN_PRIORITY},
-        { PRIORITY_MAIN, APM_LINUX_MAIN_PRIORITY},
-        { PRIORITY_SPI, AP_LINUX_SENSORS_SCHED_PRIO},
-        { PRIORITY_I2C, AP_LINUX_SENSORS_SCHED_PRIO},
-        { PRIORITY_CAN, APM_LINUX_TIMER_PRIORITY},
-        { PRIORITY_TIMER, APM_LINUX_TIMER_PRIORITY},
-        { PRIORITY_RCIN, APM_LINUX_RCIN_PRIORITY},
-        { PRIORITY_IO, APM_LINUX_IO_PRIORITY},
-        { PRIORITY_UART, APM_LINUX_UART_PRIORITY},
-        { PRIORITY_STORAGE, APM_LINUX_IO_PRIORITY},
-        { PRIORITY_SCRIPTING, APM_LINUX_SCRIPTING_PRIORITY},
+        { PRIORITY_BOOST, APM_LINUX_MAIN_PRIORITY, THREAD_CLASS_MAIN},
+        { PRIORITY_MAIN, APM_LINUX_MAIN_PRIORITY, THREAD_CLASS_MAIN},
+        { PRIORITY_SPI, AP_LINUX_SENSORS_SCHED_PRIO, THREAD_CLASS_SENSORS},
+        { PRIORITY_I2C, AP_LINUX_SENSORS_SCHED_PRIO, THREAD_CLASS_SENSORS},
+        { PRIORITY_CAN, APM_LINUX_TIMER_PRIORITY, THREAD_CLASS_CAN},
+        { PRIORITY_TIMER, APM_LINUX_TIMER_PRIORITY, THREAD_CLASS_TIMER},
+        { PRIORITY_RCIN, APM_LINUX_RCIN_PRIORITY, THREAD_CLASS_RCIN},
+        { PRIORITY_IO, APM_LINUX_IO_PRIORITY, THREAD_CLASS_IO},
+        { PRIORITY_UART, APM_LINUX_UART_PRIORITY, THREAD_CLASS_UART},
+        { PRIORITY_STORAGE, APM_LINUX_IO_PRIORITY, THREAD_CLASS_STORAGE},
+        { PRIORITY_SCRIPTING, APM_LINUX_SCRIPTING_PRIORITY, THREAD_CLASS_SCRIPTING},
     };
     for (uint8_t i=0; i<ARRAY_SIZE(priority_map); i++) {
         if (priority_map[i].base == base) {
             thread_priority = constrain_int16(priority_map[i].p + priority, 1, APM_LINUX_MAX_PRIORITY);
+            cls = priority_map[i].cls;
             break;
         }
     }
+    _place_thread(*thread, cls);
 
     // Add 256k to HAL-independent requested stack size
     thread->set_stack_size(256 * 1024 + stack_size);
@@ -15,6 +15,12 @@
 #define AP_LINUX_SENSORS_SCHED_POLICY  SCHED_FIFO
 #define AP_LINUX_SENSORS_SCHED_PRIO 12
 
+// size of the main thread stack touched at startup, so that it is
+// resident before the vehicle starts running
+#ifndef AP_LINUX_PREFAULT_STACK_SIZE
+#define AP_LINUX_PREFAULT_STACK_SIZE  512 * 1024
+#endif
+
 namespace Linux {
 
 class Scheduler : public AP_HAL::Scheduler {
@@ -52,8 +58,47 @@ public:
       create a new thread
      */
     bool thread_create(AP_HAL::MemberProc, const char *name, uint32_t stack_size, priority_base base, int8_t priority) override;
-    
+
+    /*
+      set the CPUs threads may run on from a list of name=cpulist
+      entries separated by ':', e.g. "main=3:timer=2:io=0-1". Names are
+      those in _thread_class_names. Must be called before init()
+     */
+    bool set_cpu_affinity(const char *spec);
+
+    /*
+      restrict a SPI or I2C bus thread to the CPUs for sensor threads
+     */
+    void place_bus_thread(Thread &thread) { _place_thread(thread, THREAD_CLASS_SENSORS); }
+
 private:
+    /*
+      classes of threads which can be placed on their own CPUs
+     */
+    enum thread_class {
+        THREAD_CLASS_MAIN,
+        THREAD_CLASS_TIMER,
+        THREAD_CLASS_UART,
+        THREAD_CLASS_RCIN,
+        THREAD_CLASS_IO,
+        THREAD_CLASS_SENSORS,
+        THREAD_CLASS_CAN,
+        THREAD_CLASS_STORAGE,
+        THREAD_CLASS_SCRIPTING,
+        THREAD_CLASS_NUM,
+    };
+    static const char *_thread_class_names[THREAD_CLASS_NUM];
+
+    struct {
+        cpu_set_t cpus;
+        bool set;
+    } _placement[THREAD_CLASS_NUM];
+    // CPUs the process may use, for threads of classes not placed
+    cpu_set_t _allowed_cpus;
+
+    void _init_default_placement();
+    void _place_thread(Thread &thread, enum thread_class cls);
+
     class SchedulerThread : public PeriodicThread {
     public:
         SchedulerThread(Thread::task_t t, Scheduler &sched)
@@ -9,18 +9,34 @@
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_Math/crc.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
 
 using namespace Linux;
 
 /*
-  This stores 'eeprom' data on the SD card, with a 4k size, and a
+  This stores 'eeprom' data on the SD card, with a 16k size, and a
   in-memory buffer. This keeps the latency down.
+
+  Changes are appended to a journal file as they are made and the
+  journal is replayed over the image on boot. Once the journal gets
+  large the image is rewritten and the journal truncated. The image is
+  only ever replaced by renaming a complete copy over it, so a crash at
+  any point leaves the image plus the valid records of the journal
+  consistent.
+
+  The image may hold changes that were never journaled, so the image
+  and journal both carry a generation number, and a journal is only
+  replayed over the image it was started for. A journal left behind by
+  a crash between replacing the image and truncating the journal is
+  ignored.
  */
 
 // name the storage file after the sketch so you can use the same board
 // card for ArduCopter and ArduPlane
 #define STORAGE_FILE SKETCHNAME ".stg"
+#define STORAGE_TMP_FILE SKETCHNAME ".stg.tmp"
+#define JOURNAL_FILE SKETCHNAME ".jnl"
 
 extern const AP_HAL::HAL& hal;
 
@@ -91,48 +107,6 @@ static int mkdir_p(const char *path, int len, mode_t mode)
     return 0;
 }
 
-int Storage::_storage_create(const char *dpath)
-{
-    int dfd = -1;
-
-    mkdir_p(dpath, strlen(dpath), 0777);
-    dfd = open(dpath, O_RDONLY|O_CLOEXEC);
-    if (dfd == -1) {
-        fprintf(stderr, "Failed to open storage directory: %s (%m)\n", dpath);
-        return -1;
-    }
-
-    unlinkat(dfd, dpath, 0);
-    int fd = openat(dfd, STORAGE_FILE, O_RDWR|O_CREAT|O_CLOEXEC, 0666);
-
-    close(dfd);
-
-    if (fd == -1) {
-        fprintf(stderr, "Failed to create storage file %s/%s\n", dpath,
-                STORAGE_FILE);
-        goto fail;
-    }
-
-    // take up all needed space
-    if (ftruncate(fd, sizeof(_buffer)) == -1) {
-        fprintf(stderr, "Failed to set file size to %u kB (%m)\n",
-                unsigned(sizeof(_buffer) / 1024));
-        goto fail;
-    }
-
-    // ensure the directory is updated with the new size
-    fsync(fd);
-    fsync(dfd);
-
-    close(dfd);
-
-    return fd;
-
-fail:
-    close(dfd);
-    return -1;
-}
-
 void Storage::init()
 {
     const char *dpath;
@@ -141,57 +115,128 @@ void Storage::init()
         return;
     }
 
-    _dirty_mask = 0;
-
     dpath = hal.util->get_custom_storage_directory();
     if (!dpath) {
         dpath = HAL_BOARD_STORAGE_DIRECTORY;
     }
 
-    int fd = open(dpath, O_RDWR|O_CLOEXEC);
-    if (fd == -1) {
-        fd = _storage_create(dpath);
-        if (fd == -1) {
-            AP_HAL::panic("Cannot create storage %s (%m)", dpath);
-        }
+    mkdir_p(dpath, strlen(dpath), 0777);
+    _dfd = open(dpath, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (_dfd == -1) {
+        AP_HAL::panic("Cannot open storage directory %s (%m)", dpath);
     }
 
-    ssize_t ret = read(fd, _buffer, sizeof(_buffer));
-
-    if (ret != sizeof(_buffer)) {
+    // load the image and its generation. A missing or short image
+    // reads as zeros
+    memset(_buffer, 0, sizeof(_buffer));
+    _generation = 0;
+    bool rewrite_image = true;
+    int fd = openat(_dfd, STORAGE_FILE, O_RDONLY|O_CLOEXEC);
+    if (fd != -1) {
+        rewrite_image = read(fd, _buffer, sizeof(_buffer)) != sizeof(_buffer) ||
+            read(fd, &_generation, sizeof(_generation)) != sizeof(_generation);
         close(fd);
-        _storage_create(dpath);
-        fd = open(dpath, O_RDONLY|O_CLOEXEC);
-        if (fd == -1) {
-            AP_HAL::panic("Failed to open %s (%m)", dpath);
-        }
-        if (read(fd, _buffer, sizeof(_buffer)) != sizeof(_buffer)) {
-            AP_HAL::panic("Failed to read %s (%m)", dpath);
+    }
+
+    _fd = openat(_dfd, JOURNAL_FILE, O_RDWR|O_CREAT|O_APPEND|O_CLOEXEC, 0666);
+    if (_fd == -1) {
+        AP_HAL::panic("Cannot open storage journal %s/%s (%m)", dpath, JOURNAL_FILE);
+    }
+    const bool journal_used = _replay_journal();
+
+    // start with a journal holding nothing but its header
+    if (rewrite_image || journal_used) {
+        memcpy(_image_buffer, _buffer, sizeof(_buffer));
+        if (!_compact()) {
+            AP_HAL::panic("Failed to write storage %s/%s (%m)", dpath, STORAGE_FILE);
         }
     }
 
-    _fd = fd;
+    _pending_len = 0;
+    _compact_needed = false;
     _initialised = true;
 }
 
 /*
-  mark some lines as dirty. Note that there is no attempt to avoid
-  the race condition between this code and the _timer_tick() code
-  below, which both update _dirty_mask. If we lose the race then the
-  result is that a line is written more than once, but it won't result
-  in a line not being written.
+  apply all valid records in the journal to the image, if the journal
+  was started for the image's generation. Replay stops at the first
+  bad record, which can only be a partial write at the end. Returns
+  true if the journal holds anything other than its header
  */
-void Storage::_mark_dirty(uint16_t loc, uint16_t length)
+bool Storage::_replay_journal(void)
 {
-    if (length == 0) {
-        return;
+    _journal_size = 0;
+    if (lseek(_fd, 0, SEEK_SET) != 0) {
+        return true;
+    }
+    struct journal_header header;
+    if (read(_fd, &header, sizeof(header)) != sizeof(header) ||
+        header.magic != JOURNAL_HEADER_MAGIC ||
+        header.generation != _generation) {
+        // empty, or left behind by a crash after the image was
+        // replaced, in which case its records are already in the image
+        return true;
+    }
+    struct journal_record *rec = (struct journal_record *)_write_buffer;
+    while (true) {
+        if (read(_fd, rec, sizeof(*rec)) != sizeof(*rec) ||
+            rec->magic != JOURNAL_MAGIC ||
+            rec->length > sizeof(_write_buffer) - sizeof(*rec) ||
+            uint32_t(rec->offset) + rec->length > sizeof(_buffer)) {
+            break;
+        }
+        uint8_t *data = &_write_buffer[sizeof(*rec)];
+        if (read(_fd, data, rec->length) != rec->length) {
+            break;
+        }
+        const uint32_t crc = rec->crc;
+        rec->crc = 0;
+        if (crc_crc32(0, _write_buffer, sizeof(*rec) + rec->length) != crc) {
+            break;
+        }
+        memcpy(&_buffer[rec->offset], data, rec->length);
+        _journal_size += sizeof(*rec) + rec->length;
+    }
+    return lseek(_fd, 0, SEEK_END) != sizeof(header);
+}
+
+/*
+  replace the image with the contents of _image_buffer as the next
+  generation and empty the journal
+ */
+bool Storage::_compact(void)
+{
+    const uint32_t generation = _generation + 1;
+    int fd = openat(_dfd, STORAGE_TMP_FILE, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
+    if (fd == -1) {
+        return false;
+    }
+    const bool ok = write(fd, _image_buffer, sizeof(_image_buffer)) == sizeof(_image_buffer) &&
+        write(fd, &generation, sizeof(generation)) == sizeof(generation) &&
+        fsync(fd) == 0;
+    close(fd);
+    if (!ok) {
+        return false;
     }
-    uint16_t end = loc + length - 1;
-    for (uint8_t line=loc>>LINUX_STORAGE_LINE_SHIFT;
-         line <= end>>LINUX_STORAGE_LINE_SHIFT;
-         line++) {
-        _dirty_mask |= 1U << line;
+
+    // the rename is atomic, and must be on disk before the journal is
+    // truncated
+    if (renameat(_dfd, STORAGE_TMP_FILE, _dfd, STORAGE_FILE) != 0 ||
+        fsync(_dfd) != 0) {
+        return false;
+    }
+
+    // all journal records are now in the image, and are not replayed
+    // over it even if the truncate below never happens
+    _generation = generation;
+    const struct journal_header header { JOURNAL_HEADER_MAGIC, generation };
+    if (ftruncate(_fd, 0) != 0 ||
+        write(_fd, &header, sizeof(header)) != sizeof(header) ||
+        fsync(_fd) != 0) {
+        return false;
     }
+    _journal_size = 0;
+    return true;
 }
 
 void Storage::read_block(void *dst, uint16_t loc, size_t n)
@@ -208,61 +253,98 @@ void Storage::write_block(uint16_t loc, const void *src, size_t n)
     if (loc >= sizeof(_buffer)-(n-1)) {
         return;
     }
-    if (memcmp(src, &_buffer[loc], n) != 0) {
-        init();
-        memcpy(&_buffer[loc], src, n);
-        _mark_dirty(loc, n);
+    if (memcmp(src, &_buffer[loc], n) == 0) {
+        return;
     }
-}
+    init();
 
-void Storage::_timer_tick(void)
-{
-    if (!_initialised || _dirty_mask == 0 || _fd == -1) {
+    WITH_SEMAPHORE(_sem);
+
+    memcpy(&_buffer[loc], src, n);
+
+    if (_compact_needed) {
+        // the whole image will be written
         return;
     }
 
-    // write out the first dirty set of lines. We don't write more
-    // than one to keep the latency of this call to a minimum
-    uint8_t i, n;
-    for (i=0; i<LINUX_STORAGE_NUM_LINES; i++) {
-        if (_dirty_mask & (1<<i)) {
-            break;
+    // extend the last record if this change follows on from it, which
+    // is common when uploading missions
+    if (_pending_len != 0) {
+        struct journal_record *last = (struct journal_record *)&_pending[_last_record];
+        if (last->offset + last->length == loc &&
+            _pending_len + n <= sizeof(_pending)) {
+            memcpy(&_pending[_pending_len], src, n);
+            last->length += n;
+            _pending_len += n;
+            return;
         }
     }
-    if (i == LINUX_STORAGE_NUM_LINES) {
-        // this shouldn't be possible
+
+    if (_pending_len + sizeof(journal_record) + n > sizeof(_pending)) {
+        // too many changes for one journal write, write the whole
+        // image instead
+        _compact_needed = true;
+        _pending_len = 0;
         return;
     }
-    uint32_t write_mask = (1U<<i);
-    // see how many lines to write
-    for (n=1; (i+n) < LINUX_STORAGE_NUM_LINES &&
-             n < (LINUX_STORAGE_MAX_WRITE>>LINUX_STORAGE_LINE_SHIFT); n++) {
-        if (!(_dirty_mask & (1<<(n+i)))) {
-            break;
-        }
-        // mark that line clean
-        write_mask |= (1<<(n+i));
+
+    struct journal_record *rec = (struct journal_record *)&_pending[_pending_len];
+    rec->magic = JOURNAL_MAGIC;
+    rec->offset = loc;
+    rec->length = n;
+    rec->crc = 0;
+    _last_record = _pending_len;
+    _pending_len += sizeof(*rec);
+    memcpy(&_pending[_pending_len], src, n);
+    _pending_len += n;
+}
+
+void Storage::_timer_tick(void)
+{
+    if (!_initialised || _fd == -1 || !write_pending()) {
+        return;
     }
 
     /*
-      write the lines. This also updates _dirty_mask. Note that
-      because this is a SCHED_FIFO thread it will not be preempted
-      by the main task except during blocking calls. This means we
-      don't need a semaphore around the _dirty_mask updates.
+      take a copy of the pending changes, or of the whole image if
+      compacting, so the semaphore is not held while writing
      */
-    if (lseek(_fd, i<<LINUX_STORAGE_LINE_SHIFT, SEEK_SET) == (i<<LINUX_STORAGE_LINE_SHIFT)) {
-        _dirty_mask &= ~write_mask;
-        if (write(_fd, &_buffer[i<<LINUX_STORAGE_LINE_SHIFT], n<<LINUX_STORAGE_LINE_SHIFT) != n<<LINUX_STORAGE_LINE_SHIFT) {
-            // write error - likely EINTR
-            _dirty_mask |= write_mask;
+    uint16_t len = 0;
+    bool compact;
+    {
+        WITH_SEMAPHORE(_sem);
+        compact = _compact_needed ||
+            _journal_size + _pending_len > LINUX_STORAGE_JOURNAL_MAX;
+        if (compact) {
+            memcpy(_image_buffer, _buffer, sizeof(_buffer));
+        } else {
+            memcpy(_write_buffer, _pending, _pending_len);
+            len = _pending_len;
+        }
+        _pending_len = 0;
+        _compact_needed = false;
+    }
+
+    if (compact) {
+        if (!_compact()) {
             close(_fd);
             _fd = -1;
         }
-        if (_dirty_mask == 0) {
-            if (fsync(_fd) != 0) {
-                close(_fd);
-                _fd = -1;
-            }
-        }
+        return;
+    }
+
+    for (uint16_t ofs = 0; ofs < len; ) {
+        struct journal_record *rec = (struct journal_record *)&_write_buffer[ofs];
+        rec->crc = crc_crc32(0, &_write_buffer[ofs], sizeof(*rec) + rec->length);
+        ofs += sizeof(*rec) + rec->length;
+    }
+
+    // all changes go out with one sequential write
+    if (write(_fd, _write_buffer, len) != len || fdatasync(_fd) != 0) {
+        // write error - likely EINTR
+        close(_fd);
+        _fd = -1;
+        return;
     }
+    _journal_size += len;
 }
@@ -1,19 +1,32 @@
 #pragma once
 
 #include <AP_HAL/AP_HAL.h>
+#include "Semaphores.h"
 
 #define LINUX_STORAGE_SIZE HAL_STORAGE_SIZE
-#define LINUX_STORAGE_MAX_WRITE 512
-#define LINUX_STORAGE_LINE_SHIFT 9
-#define LINUX_STORAGE_LINE_SIZE (1<<LINUX_STORAGE_LINE_SHIFT)
-#define LINUX_STORAGE_NUM_LINES (LINUX_STORAGE_SIZE/LINUX_STORAGE_LINE_SIZE)
+
+// size of the buffer for changes waiting to be written to the journal
+#ifndef LINUX_STORAGE_JOURNAL_BUFFER
+#define LINUX_STORAGE_JOURNAL_BUFFER 4096
+#endif
+
+// the journal is compacted into the image once it grows past this size
+#ifndef LINUX_STORAGE_JOURNAL_MAX
+#define LINUX_STORAGE_JOURNAL_MAX (4*LINUX_STORAGE_SIZE)
+#endif
 
 namespace Linux {
 
+/*
+  Storage is kept as an image file plus a write-ahead journal of
+  changes. Each _timer_tick() appends all pending changes to the
+  journal with a single write, and the journal is periodically
+  compacted by atomically replacing the image.
+ */
 class Storage : public AP_HAL::Storage
 {
 public:
-    Storage() : _fd(-1),_dirty_mask(0) { }
+    Storage() { }
 
     static Storage *from(AP_HAL::Storage *storage) {
         return static_cast<Storage*>(storage);
@@ -34,13 +47,51 @@ public:
 
     virtual void _timer_tick(void) override;
 
+    bool healthy(void) override { return _initialised && _fd != -1; }
+
+    // true if there are changes not yet written to the journal
+    bool write_pending(void) const { return _pending_len != 0 || _compact_needed; }
+
 protected:
-    void _mark_dirty(uint16_t loc, uint16_t length);
-    int _storage_create(const char *dpath);
+    // journal record header, followed by length bytes of data. The
+    // crc covers the header (with crc zero) and data
+    struct PACKED journal_record {
+        uint16_t magic;
+        uint16_t offset;
+        uint16_t length;
+        uint32_t crc;
+    };
+    static const uint16_t JOURNAL_MAGIC = 0x4A53;
+
+    // start of the journal, naming the generation of the image it
+    // applies to
+    struct PACKED journal_header {
+        uint32_t magic;
+        uint32_t generation;
+    };
+    static const uint32_t JOURNAL_HEADER_MAGIC = 0x4C4E4A53;
+
+    bool _replay_journal(void);
+    bool _compact(void);
+
+    int _dfd = -1;
+    int _fd = -1;
+    volatile bool _initialised = false;
+    uint32_t _journal_size = 0;
+    uint32_t _generation = 0;       // generation of the image on disk
+
+    // changes waiting to be written, protected by _sem
+    HAL_Semaphore _sem;
+    uint8_t _pending[LINUX_STORAGE_JOURNAL_BUFFER];
+    uint16_t _pending_len = 0;
+    uint16_t _last_record = 0;
+    bool _compact_needed = false;
+
+    // copies used by _timer_tick() so the semaphore is not held
+    // while writing
+    uint8_t _write_buffer[LINUX_STORAGE_JOURNAL_BUFFER];
+    uint8_t _image_buffer[LINUX_STORAGE_SIZE];
 
-    int _fd;
-    volatile bool _initialised;
-    volatile uint32_t _dirty_mask;
     uint8_t _buffer[LINUX_STORAGE_SIZE];
 };
 
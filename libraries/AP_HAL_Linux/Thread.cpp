@@ -17,6 +17,7 @@
 #include "Thread.h"
 
 #include <alloca.h>
+#include <errno.h>
 #include <limits.h>
 #include <sys/types.h>
 #include <stdio.h>
@@ -191,7 +192,24 @@ bool Thread::start(const char *name, int policy, int prio)
         }
     }
 
+    if (_cpus_set) {
+        if ((r = pthread_attr_setaffinity_np(&attr, sizeof(_cpus), &_cpus)) != 0) {
+            fprintf(stderr, "WARNING: failed to set CPU affinity for thread '%s': %s\n",
+                    name, strerror(r));
+        }
+    }
+
     r = pthread_create(&_ctx, &attr, &Thread::_run_trampoline, this);
+    if (r == EINVAL && _cpus_set) {
+        // the CPUs may have gone offline since the affinity was
+        // checked; run the thread where its creator may run instead
+        fprintf(stderr, "WARNING: CPU affinity for thread '%s' not usable, ignoring it\n", name);
+        cpu_set_t cpus;
+        if (pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0) {
+            pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+        }
+        r = pthread_create(&_ctx, &attr, &Thread::_run_trampoline, this);
+    }
     if (r != 0) {
         AP_HAL::panic("Failed to create thread '%s': %s",
                       name, strerror(r));
@@ -207,6 +225,18 @@ bool Thread::start(const char *name, int policy, int prio)
     return true;
 }
 
+bool Thread::set_cpu_affinity(const cpu_set_t &cpus)
+{
+    if (_started || CPU_COUNT(&cpus) == 0) {
+        return false;
+    }
+
+    _cpus = cpus;
+    _cpus_set = true;
+
+    return true;
+}
+
 bool Thread::is_current_thread()
 {
     return pthread_equal(pthread_self(), _ctx);
@@ -18,6 +18,7 @@
 
 #include <pthread.h>
 #include <inttypes.h>
+#include <sched.h>
 #include <stdlib.h>
 
 #include <AP_HAL/utility/functor.h>
@@ -47,6 +48,11 @@ public:
 
     void set_auto_free(bool auto_free) { _auto_free = auto_free; }
 
+    /*
+     * Restrict the thread to the given CPUs. Must be called before start()
+     */
+    bool set_cpu_affinity(const cpu_set_t &cpus);
+
     virtual bool stop() { return false; }
 
     bool join();
@@ -75,6 +81,9 @@ protected:
     } _stack_debug;
 
     size_t _stack_size = 0;
+
+    cpu_set_t _cpus;
+    bool _cpus_set = false;
 };
 
 class PeriodicThread : public Thread {
@@ -1,5 +1,8 @@
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,8 +11,11 @@
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
 
 #include "Heat_Pwm.h"
+#include "I2CDevice.h"
+#include "SPIDevice.h"
 #include "ToneAlarm_Disco.h"
 #include "Util.h"
 
@@ -145,6 +151,148 @@ bool Util::get_system_id(char buf[40])
     return get_system_id_unformatted((uint8_t *)buf, len);
 }
 
+/*
+  format a set of CPUs as a list in the format used by the kernel
+ */
+static void format_cpulist(const cpu_set_t &cpus, char *buf, size_t bufsize)
+{
+    size_t len = 0;
+
+    buf[0] = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && len < bufsize; cpu++) {
+        if (!CPU_ISSET(cpu, &cpus)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &cpus)) {
+            last++;
+        }
+        int n;
+        if (last == cpu) {
+            n = snprintf(buf + len, bufsize - len, "%s%d", len ? "," : "", cpu);
+        } else {
+            n = snprintf(buf + len, bufsize - len, "%s%d-%d", len ? "," : "", cpu, last);
+        }
+        if (n <= 0) {
+            break;
+        }
+        len += n;
+        cpu = last;
+    }
+}
+
+/*
+  report priority, CPU, time spent running and waiting to run, number
+  of migrations between CPUs and allowed CPUs for each thread. Times
+  are in seconds since the thread started. MIG is -1 when the kernel
+  doesn't report migrations (no CONFIG_SCHED_DEBUG)
+ */
+size_t Util::thread_info(char *buf, size_t bufsize)
+{
+    // a header to allow for machine parsers to determine format
+    int n = snprintf(buf, bufsize, "ThreadsLinuxV1\n");
+    if (n <= 0 || size_t(n) >= bufsize) {
+        return 0;
+    }
+    size_t total = n;
+
+    DIR *d = opendir("/proc/self/task");
+    if (d == nullptr) {
+        return total;
+    }
+
+    struct dirent *de;
+    while ((de = readdir(d)) != nullptr && total < bufsize) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+        const pid_t tid = atoi(de->d_name);
+        char path[64];
+        char line[512];
+
+        // name, last CPU and priority from stat. The name is in
+        // parentheses and may contain spaces
+        snprintf(path, sizeof(path), "/proc/self/task/%d/stat", int(tid));
+        FILE *f = fopen(path, "r");
+        if (f == nullptr) {
+            continue;
+        }
+        const bool ok = fgets(line, sizeof(line), f) != nullptr;
+        fclose(f);
+        const char *name_start = strchr(line, '(');
+        char *name_end = strrchr(line, ')');
+        if (!ok || name_start == nullptr || name_end == nullptr || name_end < name_start) {
+            continue;
+        }
+        char name[16];
+        strncpy(name, name_start + 1, MIN(size_t(name_end - name_start - 1), sizeof(name) - 1));
+        name[MIN(size_t(name_end - name_start - 1), sizeof(name) - 1)] = 0;
+        int cpu = -1;
+        int prio = 0;
+        char *saveptr;
+        char *tok = strtok_r(name_end + 2, " ", &saveptr);
+        // fields after the name start at field 3 (state)
+        for (uint8_t field = 3; tok != nullptr && field <= 40; field++) {
+            if (field == 39) {
+                cpu = atoi(tok);
+            } else if (field == 40) {
+                prio = atoi(tok);
+            }
+            tok = strtok_r(nullptr, " ", &saveptr);
+        }
+
+        uint64_t run_ns = 0, wait_ns = 0;
+        snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", int(tid));
+        read_file(path, "%" SCNu64 " %" SCNu64, &run_ns, &wait_ns);
+
+        long migrations = -1;
+        snprintf(path, sizeof(path), "/proc/self/task/%d/sched", int(tid));
+        f = fopen(path, "r");
+        if (f != nullptr) {
+            while (fgets(line, sizeof(line), f) != nullptr) {
+                if (sscanf(line, "se.nr_migrations : %ld", &migrations) == 1) {
+                    break;
+                }
+            }
+            fclose(f);
+        }
+
+        char affinity[32] = "?";
+        cpu_set_t cpus;
+        if (sched_getaffinity(tid, sizeof(cpus), &cpus) == 0) {
+            format_cpulist(cpus, affinity, sizeof(affinity));
+        }
+
+        n = snprintf(buf + total, bufsize - total,
+                     "%-15.15s PRI=%2d CPU=%2d RUN=%9.2f WAIT=%8.2f MIG=%5ld AFF=%s\n",
+                     name, prio, cpu, run_ns * 1.0e-9, wait_ns * 1.0e-9,
+                     migrations, affinity);
+        if (n <= 0) {
+            break;
+        }
+        total = MIN(total + n, bufsize);
+    }
+    closedir(d);
+
+    return total;
+}
+
+/*
+  usage of each SPI and I2C bus since the last call
+ */
+size_t Util::bus_info(char *buf, size_t bufsize)
+{
+    // a header to allow for machine parsers to determine format
+    int n = snprintf(buf, bufsize, "BUSV1\n");
+    if (n <= 0 || size_t(n) >= bufsize) {
+        return 0;
+    }
+    size_t total = n;
+    total += SPIDeviceManager::from(hal.spi)->bus_info(buf + total, bufsize - total);
+    total += I2CDeviceManager::from(hal.i2c_mgr)->bus_info(buf + total, bufsize - total);
+    return total;
+}
+
 
 int Util::write_file(const char *path, const char *fmt, ...)
 {
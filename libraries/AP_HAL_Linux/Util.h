@@ -60,6 +60,12 @@ public:
     bool get_system_id(char buf[40]) override;
     bool get_system_id_unformatted(uint8_t buf[], uint8_t &len) override;
 
+    // request information on running threads
+    size_t thread_info(char *buf, size_t bufsize) override;
+
+    // request information on SPI and I2C bus usage
+    size_t bus_info(char *buf, size_t bufsize) override;
+
 #ifdef ENABLE_HEAP
     // heap functions, note that a heap once alloc'd cannot be dealloc'd
     virtual void *allocate_heap_memory(size_t size) override;
@@ -0,0 +1,143 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+
+#include <errno.h>
+#include <math.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <AP_HAL_Linux/Thread.h>
+
+using namespace Linux;
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+// period of the main loop waiting for the IMU at 400Hz
+static const uint32_t loop_period_us = 2500;
+
+/*
+  a thread thrashing the caches with copies between two 4MB buffers,
+  like logging and networking threads do
+ */
+class LoadThread : public Thread {
+public:
+    LoadThread() : Thread(nullptr) { }
+
+    volatile bool should_exit = false;
+
+protected:
+    bool _run() override {
+        const size_t size = 4 * 1024 * 1024;
+        uint8_t *a = (uint8_t *)malloc(size);
+        uint8_t *b = (uint8_t *)malloc(size);
+        while (a != nullptr && b != nullptr && !should_exit) {
+            memcpy(b, a, size);
+            memcpy(a, b, size);
+        }
+        free(a);
+        free(b);
+        return true;
+    }
+};
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+  run a 400Hz loop while range_x() threads load the CPUs. With
+  range_y() set the loop runs alone on the last CPU and the load on
+  the others, as with --cpu-affinity. The label gives the standard
+  deviation and the worst error of the loop period. Run as root to
+  get the realtime priority of the main loop
+ */
+static void BM_LoopJitter(benchmark::State& state)
+{
+    cpu_set_t allowed, loop_cpu, load_cpus;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    CPU_ZERO(&loop_cpu);
+    for (int i = CPU_SETSIZE - 1; i >= 0; i--) {
+        if (CPU_ISSET(i, &allowed)) {
+            CPU_SET(i, &loop_cpu);
+            break;
+        }
+    }
+    CPU_XOR(&load_cpus, &allowed, &loop_cpu);
+    const bool pin = state.range_y() != 0 && CPU_COUNT(&load_cpus) > 0;
+
+    LoadThread *load = new LoadThread[state.range_x()];
+    for (int i = 0; i < state.range_x(); i++) {
+        if (pin) {
+            load[i].set_cpu_affinity(load_cpus);
+        }
+        load[i].start("load", SCHED_OTHER, 0);
+    }
+
+    if (pin) {
+        pthread_setaffinity_np(pthread_self(), sizeof(loop_cpu), &loop_cpu);
+    }
+    if (geteuid() == 0) {
+        struct sched_param param = { .sched_priority = 12 };
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    }
+
+    double sum = 0, sum_sq = 0;
+    uint64_t worst_ns = 0;
+    uint32_t count = 0;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    uint64_t last_ns = now_ns();
+    while (state.KeepRunning()) {
+        next.tv_nsec += loop_period_us * 1000;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr) == EINTR) ;
+
+        const uint64_t t = now_ns();
+        const int64_t err_ns = int64_t(t - last_ns) - int64_t(loop_period_us) * 1000;
+        last_ns = t;
+        sum += err_ns;
+        sum_sq += double(err_ns) * err_ns;
+        worst_ns = MAX(worst_ns, uint64_t(labs(err_ns)));
+        count++;
+    }
+
+    if (geteuid() == 0) {
+        struct sched_param param = { .sched_priority = 0 };
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(allowed), &allowed);
+
+    for (int i = 0; i < state.range_x(); i++) {
+        load[i].should_exit = true;
+    }
+    for (int i = 0; i < state.range_x(); i++) {
+        load[i].join();
+    }
+    delete[] load;
+
+    if (count > 0) {
+        const double mean = sum / count;
+        char label[64];
+        snprintf(label, sizeof(label), "sd %.1fus worst %.1fus",
+                 sqrt(MAX(sum_sq / count - mean * mean, 0.0)) * 1.0e-3,
+                 worst_ns * 1.0e-3);
+        state.SetLabel(label);
+    }
+}
+
+BENCHMARK(BM_LoopJitter)
+    ->ArgPair(0, 0)
+    ->ArgPair(4, 0)
+    ->ArgPair(4, 1);
+
+BENCHMARK_MAIN()
@@ -0,0 +1,72 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+
+#include <stdlib.h>
+
+#include <AP_HAL_Linux/Storage.h>
+#include <AP_HAL_Linux/Util.h>
+
+using namespace Linux;
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+// mission items are stored as 15 byte records
+static const uint16_t mission_items = 700;
+static const uint8_t mission_item_size = 15;
+static const uint16_t mission_start = 4096;
+
+static Storage *new_storage()
+{
+    static char dir[32];
+    strcpy(dir, "/tmp/ap_storage_XXXXXX");
+    if (mkdtemp(dir) == nullptr) {
+        return nullptr;
+    }
+    Util::from(hal.util)->set_custom_storage_directory(dir);
+    Storage *storage = new Storage();
+    storage->init();
+    return storage;
+}
+
+/*
+  upload a 700 item mission and wait until it is on disk. With an
+  argument of 0 the whole mission is written before the storage timer
+  runs, otherwise the timer runs after every item as it would with a
+  mission uploaded over MAVLink
+ */
+static void BM_MissionUpload(benchmark::State& state)
+{
+    Storage *storage = new_storage();
+    if (storage == nullptr) {
+        fprintf(stderr, "error: couldn't create storage\n");
+        return;
+    }
+
+    uint8_t item[mission_item_size];
+    uint32_t upload = 0;
+    uint32_t ticks = 0;
+    while (state.KeepRunning()) {
+        upload++;
+        for (uint16_t i=0; i<mission_items; i++) {
+            memset(item, upload + i, sizeof(item));
+            storage->write_block(mission_start + i*mission_item_size, item, sizeof(item));
+            if (state.range_x() != 0) {
+                storage->_timer_tick();
+                ticks++;
+            }
+        }
+        while (storage->write_pending()) {
+            storage->_timer_tick();
+            ticks++;
+        }
+    }
+
+    char label[32];
+    snprintf(label, sizeof(label), "%.1f ticks/upload", double(ticks) / upload);
+    state.SetLabel(label);
+    state.SetBytesProcessed(int64_t(state.iterations()) * mission_items * mission_item_size);
+}
+
+BENCHMARK(BM_MissionUpload)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN()
@@ -0,0 +1,260 @@
+#include <AP_gtest.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL_Linux/Storage.h>
+#include <AP_HAL_Linux/Util.h>
+
+using namespace Linux;
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+// use a fresh storage directory
+static void new_storage_directory(char *dir)
+{
+    strcpy(dir, "/tmp/ap_storage_XXXXXX");
+    ASSERT_NE(nullptr, mkdtemp(dir));
+    Util::from(hal.util)->set_custom_storage_directory(dir);
+}
+
+static void flush(Storage &storage)
+{
+    while (storage.write_pending()) {
+        storage._timer_tick();
+    }
+}
+
+// deterministic pseudo-random writes, so the expected contents can be
+// recomputed after a crash
+struct random_write {
+    uint16_t loc;
+    uint8_t len;
+    uint8_t data[64];
+};
+
+static const uint8_t writes_per_step = 8;
+
+static void step_write(uint32_t step, uint8_t i, random_write &w)
+{
+    uint32_t seed = step * writes_per_step + i + 1;
+    auto next = [&seed]() {
+        seed = seed * 1103515245U + 12345U;
+        return seed >> 16;
+    };
+    w.len = 1 + next() % sizeof(w.data);
+    w.loc = next() % (LINUX_STORAGE_SIZE - w.len);
+    for (uint8_t j=0; j<w.len; j++) {
+        w.data[j] = next();
+    }
+}
+
+TEST(LinuxStorage, persist)
+{
+    char dir[32];
+    new_storage_directory(dir);
+
+    uint8_t expected[LINUX_STORAGE_SIZE] {};
+    {
+        Storage storage;
+        storage.init();
+        for (uint32_t step=0; step<10; step++) {
+            for (uint8_t i=0; i<writes_per_step; i++) {
+                random_write w;
+                step_write(step, i, w);
+                storage.write_block(w.loc, w.data, w.len);
+                memcpy(&expected[w.loc], w.data, w.len);
+            }
+            flush(storage);
+        }
+        EXPECT_TRUE(storage.healthy());
+
+        // changes not yet flushed are lost
+        const uint8_t lost[4] { 1, 2, 3, 4 };
+        storage.write_block(0, lost, sizeof(lost));
+    }
+
+    Storage storage;
+    storage.init();
+    uint8_t data[LINUX_STORAGE_SIZE];
+    storage.read_block(data, 0, sizeof(data));
+    EXPECT_EQ(0, memcmp(data, expected, sizeof(data)));
+}
+
+TEST(LinuxStorage, compaction)
+{
+    char dir[32];
+    new_storage_directory(dir);
+
+    // rewrite the whole storage several times, which must compact
+    // the journal
+    uint8_t data[LINUX_STORAGE_SIZE];
+    {
+        Storage storage;
+        storage.init();
+        for (uint8_t pass=0; pass<8; pass++) {
+            for (uint16_t ofs=0; ofs<sizeof(data); ofs += 256) {
+                memset(&data[ofs], pass+1, 256);
+                storage.write_block(ofs, &data[ofs], 256);
+                flush(storage);
+            }
+        }
+    }
+
+    char path[64];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s.jnl", dir, SKETCHNAME);
+    ASSERT_EQ(0, stat(path, &st));
+    EXPECT_LE(st.st_size, LINUX_STORAGE_JOURNAL_MAX);
+
+    Storage storage;
+    storage.init();
+    uint8_t check[LINUX_STORAGE_SIZE];
+    storage.read_block(check, 0, sizeof(check));
+    EXPECT_EQ(0, memcmp(data, check, sizeof(check)));
+}
+
+/*
+  a crash after compaction has renamed the new image into place but
+  before it truncates the journal leaves the old journal next to the
+  new image. Its records must not be replayed over changes that only
+  went into the new image
+ */
+TEST(LinuxStorage, crash_after_image_replaced)
+{
+    char dir[32];
+    new_storage_directory(dir);
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s.jnl", dir, SKETCHNAME);
+
+    const uint8_t old_value[4] { 1, 1, 1, 1 };
+    const uint8_t new_value[4] { 2, 2, 2, 2 };
+    uint8_t fill[LINUX_STORAGE_JOURNAL_BUFFER];
+    memset(fill, 3, sizeof(fill));
+    uint8_t journal[256];
+    ssize_t journal_len;
+    {
+        Storage storage;
+        storage.init();
+        storage.write_block(0, old_value, sizeof(old_value));
+        flush(storage);
+
+        // keep the journal as it was before compaction
+        int fd = open(path, O_RDONLY);
+        ASSERT_NE(-1, fd);
+        journal_len = read(fd, journal, sizeof(journal));
+        close(fd);
+        ASSERT_GT(journal_len, 0);
+
+        // too many changes for one journal write, so these only go
+        // into the new image
+        storage.write_block(0, new_value, sizeof(new_value));
+        storage.write_block(1024, fill, sizeof(fill));
+        flush(storage);
+    }
+
+    // put the old journal back, as if it was never truncated
+    int fd = open(path, O_WRONLY|O_TRUNC);
+    ASSERT_NE(-1, fd);
+    ASSERT_EQ(journal_len, write(fd, journal, journal_len));
+    close(fd);
+
+    Storage storage;
+    storage.init();
+    uint8_t data[sizeof(fill)];
+    storage.read_block(data, 0, sizeof(new_value));
+    EXPECT_EQ(0, memcmp(data, new_value, sizeof(new_value)));
+    storage.read_block(data, 1024, sizeof(fill));
+    EXPECT_EQ(0, memcmp(data, fill, sizeof(fill)));
+}
+
+/*
+  a child process writes to storage and reports each step once it
+  has been flushed, and is killed at a random point. The recovered
+  storage must contain all reported steps and a prefix of the writes
+  of the step that was in progress
+ */
+static void crash_writer(int report_fd)
+{
+    Storage storage;
+    storage.init();
+    for (uint32_t step=0; ; step++) {
+        for (uint8_t i=0; i<writes_per_step; i++) {
+            random_write w;
+            step_write(step, i, w);
+            storage.write_block(w.loc, w.data, w.len);
+        }
+        flush(storage);
+        if (write(report_fd, &step, sizeof(step)) != ssize_t(sizeof(step))) {
+            break;
+        }
+    }
+    _exit(0);
+}
+
+TEST(LinuxStorage, crash_consistency)
+{
+    srandom(1);
+    for (uint8_t run=0; run<10; run++) {
+        char dir[32];
+        new_storage_directory(dir);
+
+        int fds[2];
+        ASSERT_EQ(0, pipe(fds));
+        const pid_t pid = fork();
+        ASSERT_NE(-1, pid);
+        if (pid == 0) {
+            close(fds[0]);
+            crash_writer(fds[1]);
+        }
+        close(fds[1]);
+
+        // kill the writer part way through, collecting the reports
+        // so a full pipe doesn't stall it
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        int32_t last_step = -1;
+        uint32_t step;
+        const uint32_t run_us = 1000 + random() % 100000;
+        for (uint32_t t=0; t<run_us; t+=500) {
+            while (read(fds[0], &step, sizeof(step)) == ssize_t(sizeof(step))) {
+                last_step = step;
+            }
+            usleep(500);
+        }
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        while (read(fds[0], &step, sizeof(step)) == ssize_t(sizeof(step))) {
+            last_step = step;
+        }
+        close(fds[0]);
+
+        Storage storage;
+        storage.init();
+        uint8_t data[LINUX_STORAGE_SIZE];
+        storage.read_block(data, 0, sizeof(data));
+
+        uint8_t expected[LINUX_STORAGE_SIZE] {};
+        for (int32_t s=0; s<=last_step; s++) {
+            for (uint8_t i=0; i<writes_per_step; i++) {
+                random_write w;
+                step_write(s, i, w);
+                memcpy(&expected[w.loc], w.data, w.len);
+            }
+        }
+        bool match = memcmp(data, expected, sizeof(data)) == 0;
+        for (uint8_t i=0; i<writes_per_step && !match; i++) {
+            random_write w;
+            step_write(last_step+1, i, w);
+            memcpy(&expected[w.loc], w.data, w.len);
+            match = memcmp(data, expected, sizeof(data)) == 0;
+        }
+        EXPECT_TRUE(match) << "run " << unsigned(run) << " last step " << last_step;
+    }
+}
+
+AP_GTEST_MAIN()
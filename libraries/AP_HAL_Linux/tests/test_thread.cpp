@@ -117,4 +117,49 @@ TEST(LinuxThread, periodic_thread)
     EXPECT_TRUE(thr.join());
 }
 
+class TestThread3 : public Thread {
+public:
+    TestThread3() : Thread{FUNCTOR_BIND_MEMBER(&TestThread3::_task, void)} { }
+
+    volatile int cpu = -1;
+    cpu_set_t cpus;
+
+protected:
+    void _task() {
+        sched_getaffinity(0, sizeof(cpus), &cpus);
+        cpu = sched_getcpu();
+    }
+};
+
+TEST(LinuxThread, cpu_affinity)
+{
+    cpu_set_t allowed, cpus;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+
+    // pin to the last CPU we are allowed to run on
+    int last = -1;
+    for (int i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &allowed)) {
+            last = i;
+        }
+    }
+    ASSERT_GE(last, 0);
+    CPU_ZERO(&cpus);
+
+    TestThread3 thr;
+    // an empty set is rejected
+    EXPECT_FALSE(thr.set_cpu_affinity(cpus));
+    CPU_SET(last, &cpus);
+    EXPECT_TRUE(thr.set_cpu_affinity(cpus));
+    EXPECT_TRUE(thr.start(nullptr, 0, 0));
+
+    // this must fail as the thread already started
+    EXPECT_FALSE(thr.set_cpu_affinity(cpus));
+
+    EXPECT_TRUE(thr.join());
+    EXPECT_EQ(thr.cpu, last);
+    EXPECT_EQ(CPU_COUNT(&thr.cpus), 1);
+    EXPECT_TRUE(CPU_ISSET(last, &thr.cpus));
+}
+
 AP_GTEST_MAIN()
@@ -206,6 +206,21 @@ void SITL_State::wait_clock(uint64_t wait_time_usec)
         if (hal.scheduler->in_main_thread() ||
             Scheduler::from(hal.scheduler)->semaphore_wait_hack_required()) {
             _fdm_input_step();
+        } else if (_max_speed) {
+            // the clock steps much faster than a fixed sleep, so wait
+            // for the main thread to step it
+            pthread_mutex_lock(&_clock_lock);
+            if (AP_HAL::micros64() < wait_time_usec) {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                ts.tv_nsec += 1000000;
+                if (ts.tv_nsec >= 1000000000) {
+                    ts.tv_sec++;
+                    ts.tv_nsec -= 1000000000;
+                }
+                pthread_cond_timedwait(&_clock_cond, &_clock_lock, &ts);
+            }
+            pthread_mutex_unlock(&_clock_lock);
         } else {
             usleep(1000);
         }
@@ -213,8 +228,8 @@ void SITL_State::wait_clock(uint64_t wait_time_usec)
     // check the outbound TCP queue size.  If it is too long then
     // MAVProxy/pymavlink take too long to process packets and it ends
     // up seeing traffic well into our past and hits time-out
-    // conditions.
-    if (sitl_model->get_speedup() > 1) {
+    // conditions.  In max speed mode the GCS has to keep up on its own
+    if (sitl_model->get_speedup() > 1 && !_max_speed) {
         while (true) {
             const int queue_length = ((HALSITL::UARTDriver*)hal.serial(0))->get_system_outqueue_length();
             // ::fprintf(stderr, "queue_length=%d\n", (signed)queue_length);
@@ -715,6 +730,11 @@ void SITL_State::_fdm_input_local(void)
     } else {
         hal.scheduler->stop_clock(AP_HAL::micros64()+100);
     }
+    if (_max_speed) {
+        pthread_mutex_lock(&_clock_lock);
+        pthread_cond_broadcast(&_clock_cond);
+        pthread_mutex_unlock(&_clock_lock);
+    }
 
     set_height_agl();
 
@@ -17,6 +17,7 @@
 #include <netinet/in.h>
 #include <netinet/udp.h>
 #include <arpa/inet.h>
+#include <pthread.h>
 #include <vector>
 
 #include <AP_Baro/AP_Baro.h>
@@ -206,6 +207,12 @@ private:
 
     bool _use_rtscts;
     bool _use_fg_view;
+
+    // run without syncing to the wall clock (--max-speed).  Threads
+    // waiting for simulated time are woken each time the clock steps
+    bool _max_speed;
+    pthread_mutex_t _clock_lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t _clock_cond = PTHREAD_COND_INITIALIZER;
     
     const char *_fg_address;
 
@@ -100,6 +100,7 @@ void SITL_State::_usage(void)
            "\t--irlock-port PORT       set port num for irlock\n"
            "\t--start-time TIMESTR     set simulation start time in UNIX timestamp\n"
            "\t--sysid ID               set SYSID_THISMAV\n"
+           "\t--max-speed              run as fast as possible, ignoring speedup, and disable Flight Gear view\n"
         );
 }
 
@@ -237,6 +238,7 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
         CMDLINE_IRLOCK_PORT,
         CMDLINE_START_TIME,
         CMDLINE_SYSID,
+        CMDLINE_MAX_SPEED,
     };
 
     const struct GetOptLong::option options[] = {
@@ -275,6 +277,7 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
         {"irlock-port",     true,   0, CMDLINE_IRLOCK_PORT},
         {"start-time",      true,   0, CMDLINE_START_TIME},
         {"sysid",           true,   0, CMDLINE_SYSID},
+        {"max-speed",       false,  0, CMDLINE_MAX_SPEED},
         {0, false, 0, 0}
     };
 
@@ -411,6 +414,10 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
             printf("Setting SYSID_THISMAV=%d\n", sysid);
             break;
         }
+        case CMDLINE_MAX_SPEED:
+            _max_speed = true;
+            _use_fg_view = false;
+            break;
         default:
             _usage();
             exit(1);
@@ -443,6 +450,9 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
             }
             sitl_model->set_interface_ports(simulator_address, simulator_port_in, simulator_port_out);
             sitl_model->set_speedup(speedup);
+            if (_max_speed) {
+                sitl_model->set_max_speed();
+            }
             sitl_model->set_instance(_instance);
             sitl_model->set_autotest_dir(autotest_dir);
             sitl_model->set_config(config);
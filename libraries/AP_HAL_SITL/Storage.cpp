@@ -2,6 +2,7 @@
 
 #include <AP_Vehicle/AP_Vehicle_Type.h>
 #include <AP_HAL/AP_HAL.h>
+#include <GCS_MAVLink/GCS.h>
 
 #include <assert.h>
 #include <sys/types.h>
@@ -43,6 +44,11 @@ extern const AP_HAL::HAL& hal;
 #define HAL_FLASH_ALLOW_UPDATE 1
 #endif
 
+// flash in the format of earlier firmware is migrated after warning
+// the user this many times, this far apart
+#define STORAGE_MIGRATE_WARNINGS 3
+#define STORAGE_MIGRATE_WARN_MS 10000
+
 void Storage::_storage_open(void)
 {
     if (_initialised) {
@@ -141,6 +147,14 @@ void Storage::_timer_tick(void)
     }
     if (_dirty_mask.empty()) {
         _last_empty_ms = AP_HAL::millis();
+#if STORAGE_USE_FLASH
+        if (_flash.legacy_format()) {
+            _flash_migrate();
+        } else {
+            // compact and check the flash while there is nothing to write
+            _flash.idle_tick();
+        }
+#endif
         return;
     }
 
@@ -338,6 +352,27 @@ bool Storage::_flash_erase_ok(void)
     // only allow erase while disarmed
     return !hal.util->get_soft_armed();
 }
+
+/*
+  migrate flash written by earlier firmware to the current format,
+  after warning the user as the ChibiOS HAL does
+ */
+void Storage::_flash_migrate(void)
+{
+    const uint32_t now = AP_HAL::millis();
+    if (now - _last_migrate_warn_ms < STORAGE_MIGRATE_WARN_MS) {
+        return;
+    }
+    _last_migrate_warn_ms = now;
+    if (_migrate_warnings < STORAGE_MIGRATE_WARNINGS) {
+        _migrate_warnings++;
+        GCS_SEND_TEXT(MAV_SEVERITY_WARNING, "Storage: upgrading, older firmware resets params");
+        return;
+    }
+    if (_flash_erase_ok() && _flash.migrate()) {
+        GCS_SEND_TEXT(MAV_SEVERITY_INFO, "Storage: upgraded");
+    }
+}
 #endif // STORAGE_USE_FLASH
 
 /*
@@ -41,6 +41,9 @@ private:
     bool _flash_read_data(uint8_t sector, uint32_t offset, uint8_t *data, uint16_t length);
     bool _flash_erase_sector(uint8_t sector);
     bool _flash_erase_ok(void);
+    void _flash_migrate(void);
+    uint32_t _last_migrate_warn_ms;
+    uint8_t _migrate_warnings;
 #endif
 
     bool _flash_failed;
@@ -787,6 +787,12 @@ AP_InertialSensor::init(uint16_t loop_rate)
         // initialise default settings, these will be subsequently changed in AP_InertialSensor_Backend::update_gyro()
         _gyro_harmonic_notch_filter[i].init(_gyro_raw_sample_rates[i], _calculated_harmonic_notch_freq_hz[0],
              _harmonic_notch_filter.bandwidth_hz(), _harmonic_notch_filter.attenuation_dB());
+        if (_harmonic_notch_filter.hasOption(HarmonicNotchFilterParams::Options::PerMotor)) {
+            _gyro_motor_notch_filter[i].allocate_filters(HNF_MAX_MOTOR_FILTERS);
+            _gyro_motor_notch_filter[i].init(_gyro_raw_sample_rates[i], _calculated_harmonic_notch_freq_hz[0],
+                 _harmonic_notch_filter.bandwidth_hz(), _harmonic_notch_filter.attenuation_dB(),
+                 _harmonic_notch_filter.harmonics(), _harmonic_notch_filter.hasOption(HarmonicNotchFilterParams::Options::DoubleNotch));
+        }
     }
 }
 
@@ -1876,6 +1882,36 @@ void AP_InertialSensor::update_harmonic_notch_frequencies_hz(uint8_t num_freqs,
     _num_calculated_harmonic_notch_frequencies = num_freqs;
 }
 
+// Update the fundamental frequency of each motor for the per-motor harmonic notch
+void AP_InertialSensor::update_motor_notch_frequencies_hz(uint8_t num_motors, const float motor_freq[]) {
+    float sum = 0;
+    _num_motor_notch_frequencies = 0;
+    for (uint8_t i = 0; i < num_motors && i < INS_MAX_MOTOR_NOTCHES; i++) {
+        // protect against zero as a motor frequency
+        if (is_positive(motor_freq[i])) {
+            _motor_notch_freq_hz[_num_motor_notch_frequencies++] = motor_freq[i];
+            sum += motor_freq[i];
+        }
+    }
+    _motor_notch_update_count++;
+
+    if (_num_motor_notch_frequencies == 0) {
+        return;
+    }
+    // the shared harmonic notch follows the average motor frequency, so
+    // that it can be used when there are too many notches for the
+    // per-motor bank
+    update_harmonic_notch_freq_hz(sum / _num_motor_notch_frequencies);
+
+    const MotorNotchFilterBank &bank = _gyro_motor_notch_filter[0];
+    if (!_motor_notch_overload_reported &&
+        _num_motor_notch_frequencies * bank.filters_per_motor() > bank.max_filters()) {
+        gcs().send_text(MAV_SEVERITY_WARNING, "INS: %u motor notches over limit %u, using average",
+                         unsigned(_num_motor_notch_frequencies * bank.filters_per_motor()), unsigned(bank.max_filters()));
+        _motor_notch_overload_reported = true;
+    }
+}
+
 /*
     set and save accelerometer bias along with trim calculation
 */
@@ -18,6 +18,7 @@
 #endif
 #define INS_MAX_BACKENDS  2*INS_MAX_INSTANCES
 #define INS_MAX_NOTCHES 4
+#define INS_MAX_MOTOR_NOTCHES 12
 #ifndef INS_VIBRATION_CHECK_INSTANCES
   #if HAL_MEM_CLASS >= HAL_MEM_CLASS_300
     #define INS_VIBRATION_CHECK_INSTANCES INS_MAX_INSTANCES
@@ -41,6 +42,7 @@
 #include <Filter/LowPassFilter.h>
 #include <Filter/NotchFilter.h>
 #include <Filter/HarmonicNotchFilter.h>
+#include <Filter/MotorNotchFilterBank.h>
 
 class AP_InertialSensor_Backend;
 class AuxiliaryBus;
@@ -234,6 +236,8 @@ public:
     void update_harmonic_notch_freq_hz(float scaled_freq);
     // Update the harmonic notch frequencies
     void update_harmonic_notch_frequencies_hz(uint8_t num_freqs, const float scaled_freq[]);
+    // Update the fundamental frequency of each motor for the per-motor harmonic notch
+    void update_motor_notch_frequencies_hz(uint8_t num_motors, const float motor_freq[]);
 
     // enable HIL mode
     void set_hil_mode(void) { _hil_mode = true; }
@@ -486,6 +490,17 @@ private:
     float _calculated_harmonic_notch_freq_hz[INS_MAX_NOTCHES];
     uint8_t _num_calculated_harmonic_notch_frequencies;
 
+    // optional harmonic notch for each motor, used in place of the
+    // harmonic notch above while there is room for all of the notches
+    MotorNotchFilterBank _gyro_motor_notch_filter[INS_MAX_INSTANCES];
+    bool _motor_notch_active[INS_MAX_INSTANCES];
+    uint16_t _motor_notch_applied_count[INS_MAX_INSTANCES];
+    // the current fundamental frequency of each motor
+    float _motor_notch_freq_hz[INS_MAX_MOTOR_NOTCHES];
+    uint8_t _num_motor_notch_frequencies;
+    uint16_t _motor_notch_update_count;
+    bool _motor_notch_overload_reported;
+
     // Most recent gyro reading
     Vector3f _gyro[INS_MAX_INSTANCES];
     Vector3f _delta_angle[INS_MAX_INSTANCES];
@@ -305,6 +305,8 @@ void AP_InertialSensor_BMI088::read_fifo_accel(void)
     // assume configured for 24g range
     const float scale = (1.0/32768.0) * GRAVITY_MSS * 24.0;
     const uint8_t *p = &data[0];
+    Vector3f accel[8];
+    uint8_t n_accel = 0;
     while (fifo_length >= 7) {
         /*
           the fifo frames are variable length, with the frame type in the first byte
@@ -319,12 +321,7 @@ void AP_InertialSensor_BMI088::read_fifo_accel(void)
                 int16_t(uint16_t(d[0] | (d[1]<<8))),
                 int16_t(uint16_t(d[2] | (d[3]<<8))),
                 int16_t(uint16_t(d[4] | (d[5]<<8)))};
-            Vector3f accel(xyz[0], xyz[1], xyz[2]);
-
-            accel *= scale;
-
-            _rotate_and_correct_accel(accel_instance, accel);
-            _notify_new_accel_raw_sample(accel_instance, accel);
+            accel[n_accel++] = Vector3f(xyz[0], xyz[1], xyz[2]) * scale;
             break;
         }
         case 0x40:
@@ -348,6 +345,8 @@ void AP_InertialSensor_BMI088::read_fifo_accel(void)
         fifo_length -= frame_len;
     }
 
+    _notify_new_accel_raw_samples(accel_instance, accel, n_accel);
+
     if (temperature_counter++ == 100) {
         temperature_counter = 0;
         uint8_t tbuf[2];
@@ -389,18 +388,16 @@ void AP_InertialSensor_BMI088::read_fifo_gyro(void)
 
     // data is 16 bits with 2000dps range
     const float scale = radians(2000.0f) / 32767.0f;
+    Vector3f gyro[8];
     for (uint8_t i = 0; i < num_frames; i++) {
         const uint8_t *d = &data[i*6];
         int16_t xyz[3] {
                     int16_t(uint16_t(d[0] | d[1]<<8)),
                     int16_t(uint16_t(d[2] | d[3]<<8)),
                     int16_t(uint16_t(d[4] | d[5]<<8)) };
-        Vector3f gyro(xyz[0], xyz[1], xyz[2]);
-        gyro *= scale;
-
-        _rotate_and_correct_gyro(gyro_instance, gyro);
-        _notify_new_gyro_raw_sample(gyro_instance, gyro);
+        gyro[i] = Vector3f(xyz[0], xyz[1], xyz[2]) * scale;
     }
+    _notify_new_gyro_raw_samples(gyro_instance, gyro, num_frames);
 
     if (!dev_gyro->check_next_register()) {
         _inc_gyro_error_count(gyro_instance);
@@ -54,14 +54,14 @@ void AP_InertialSensor_Backend::_set_gyro_oversampling(uint8_t instance, uint8_t
   sensor may vary slightly from the system clock. This slowly adjusts
   the rate to the observed rate
 */
-void AP_InertialSensor_Backend::_update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz) const
+void AP_InertialSensor_Backend::_update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz, uint8_t n) const
 {
     uint32_t now = AP_HAL::micros();
     if (start_us == 0) {
         count = 0;
         start_us = now;
     } else {
-        count++;
+        count += n;
         if (now - start_us > 1000000UL) {
             float observed_rate_hz = count * 1.0e6f / (now - start_us);
 #if 0
@@ -144,6 +144,35 @@ void AP_InertialSensor_Backend::_publish_gyro(uint8_t instance, const Vector3f &
     _imu._delta_angle_valid[instance] = true;
 }
 
+/*
+  get the dt of each of n new samples, and the time of the last of
+  them.
+
+  we have two classes of sensors. FIFO based sensors produce data
+  at a very predictable overall rate, but the data comes in
+  bunches, so we use the provided sample rate for deltaT. Non-FIFO
+  sensors don't bunch up samples, but also tend to vary in actual
+  rate, so we use the provided sample_us to get the deltaT. The
+  difference between the two is whether sample_us is provided.
+ */
+bool AP_InertialSensor_Backend::_raw_sample_dt(uint64_t &last_sample_us, float rate_hz, uint8_t n, uint64_t &sample_us, float &dt) const
+{
+    if (sample_us != 0 && last_sample_us != 0) {
+        dt = (sample_us - last_sample_us) * 1.0e-6f / n;
+        last_sample_us = sample_us;
+    } else {
+        // don't accept below 100Hz
+        if (rate_hz < 100) {
+            return false;
+        }
+
+        dt = 1.0f / rate_hz;
+        last_sample_us = AP_HAL::micros64();
+        sample_us = last_sample_us;
+    }
+    return true;
+}
+
 void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
                                                             const Vector3f &gyro,
                                                             uint64_t sample_us)
@@ -158,26 +187,8 @@ void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
 
     uint64_t last_sample_us = _imu._gyro_last_sample_us[instance];
 
-    /*
-      we have two classes of sensors. FIFO based sensors produce data
-      at a very predictable overall rate, but the data comes in
-      bunches, so we use the provided sample rate for deltaT. Non-FIFO
-      sensors don't bunch up samples, but also tend to vary in actual
-      rate, so we use the provided sample_us to get the deltaT. The
-      difference between the two is whether sample_us is provided.
-     */
-    if (sample_us != 0 && _imu._gyro_last_sample_us[instance] != 0) {
-        dt = (sample_us - _imu._gyro_last_sample_us[instance]) * 1.0e-6f;
-        _imu._gyro_last_sample_us[instance] = sample_us;
-    } else {
-        // don't accept below 100Hz
-        if (_imu._gyro_raw_sample_rates[instance] < 100) {
-            return;
-        }
-
-        dt = 1.0f / _imu._gyro_raw_sample_rates[instance];
-        _imu._gyro_last_sample_us[instance] = AP_HAL::micros64();
-        sample_us = _imu._gyro_last_sample_us[instance];
+    if (!_raw_sample_dt(_imu._gyro_last_sample_us[instance], _imu._gyro_raw_sample_rates[instance], 1, sample_us, dt)) {
+        return;
     }
 
 #if AP_MODULE_SUPPORTED
@@ -189,19 +200,6 @@ void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
     if (hal.opticalflow) {
         hal.opticalflow->push_gyro(gyro.x, gyro.y, dt);
     }
-    
-    // compute delta angle
-    Vector3f delta_angle = (gyro + _imu._last_raw_gyro[instance]) * 0.5f * dt;
-
-    // compute coning correction
-    // see page 26 of:
-    // Tian et al (2010) Three-loop Integration of GPS and Strapdown INS with Coning and Sculling Compensation
-    // Available: http://www.sage.unsw.edu.au/snap/publications/tian_etal2010b.pdf
-    // see also examples/coning.py
-    Vector3f delta_coning = (_imu._delta_angle_acc[instance] +
-                             _imu._last_delta_angle[instance] * (1.0f / 6.0f));
-    delta_coning = delta_coning % delta_angle;
-    delta_coning *= 0.5f;
 
     {
         WITH_SEMAPHORE(_sem);
@@ -212,61 +210,147 @@ void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
             _imu._delta_angle_acc[instance].zero();
             _imu._delta_angle_acc_dt[instance] = 0;
             dt = 0;
-            delta_angle.zero();
         }
 
-        // integrate delta angle accumulator
-        // the angles and coning corrections are accumulated separately in the
-        // referenced paper, but in simulation little difference was found between
-        // integrating together and integrating separately (see examples/coning.py)
-        _imu._delta_angle_acc[instance] += delta_angle + delta_coning;
-        _imu._delta_angle_acc_dt[instance] += dt;
+        _accumulate_gyro_sample(instance, gyro, dt);
+    }
 
-        // save previous delta angle for coning correction
-        _imu._last_delta_angle[instance] = delta_angle;
-        _imu._last_raw_gyro[instance] = gyro;
-#if HAL_WITH_DSP
-        // capture gyro window for FFT analysis
-        if (_imu._gyro_window_size > 0) {
-            const Vector3f& scaled_gyro = gyro * _imu._gyro_raw_sampling_multiplier[instance];
-            _imu._gyro_window[instance][0].push(scaled_gyro.x);
-            _imu._gyro_window[instance][1].push(scaled_gyro.y);
-            _imu._gyro_window[instance][2].push(scaled_gyro.z);
-        }
+    if (!_imu.batchsampler.doing_post_filter_logging()) {
+        log_gyro_raw(instance, sample_us, gyro);
+    }
+    else {
+        log_gyro_raw(instance, sample_us, _imu._gyro_filtered[instance]);
+    }
+}
+
+void AP_InertialSensor_Backend::_notify_new_gyro_raw_samples(uint8_t instance,
+                                                             Vector3f *gyro,
+                                                             uint8_t n,
+                                                             uint64_t sample_us)
+{
+    if (n == 0 || ((1U<<instance) & _imu.imu_kill_mask)) {
+        return;
+    }
+    float dt;
+
+    _update_sensor_rate(_imu._sample_gyro_count[instance], _imu._sample_gyro_start_us[instance],
+                        _imu._gyro_raw_sample_rates[instance], n);
+
+    uint64_t last_sample_us = _imu._gyro_last_sample_us[instance];
+
+    if (!_raw_sample_dt(_imu._gyro_last_sample_us[instance], _imu._gyro_raw_sample_rates[instance], n, sample_us, dt)) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+        _rotate_and_correct_gyro(instance, gyro[i]);
+
+#if AP_MODULE_SUPPORTED
+        // call gyro_sample hook if any
+        AP_Module::call_hook_gyro_sample(instance, dt, gyro[i]);
 #endif
-        Vector3f gyro_filtered = gyro;
 
-        // apply the notch filter
-        if (_gyro_notch_enabled()) {
-            gyro_filtered = _imu._gyro_notch_filter[instance].apply(gyro_filtered);
+        // push gyros if optical flow present
+        if (hal.opticalflow) {
+            hal.opticalflow->push_gyro(gyro[i].x, gyro[i].y, dt);
         }
+    }
 
-        // apply the harmonic notch filter
-        if (gyro_harmonic_notch_enabled()) {
-            gyro_filtered = _imu._gyro_harmonic_notch_filter[instance].apply(gyro_filtered);
-        }
+    const bool post_filter_logging = _imu.batchsampler.doing_post_filter_logging();
+    {
+        WITH_SEMAPHORE(_sem);
+        uint64_t now = AP_HAL::micros64();
 
-        // apply the low pass filter last to attentuate any notch induced noise
-        gyro_filtered = _imu._gyro_filter[instance].apply(gyro_filtered);
+        float first_dt = dt;
+        if (now - last_sample_us > 100000U) {
+            // zero accumulator if sensor was unhealthy for 0.1s
+            _imu._delta_angle_acc[instance].zero();
+            _imu._delta_angle_acc_dt[instance] = 0;
+            first_dt = 0;
+        }
 
-        // if the filtering failed in any way then reset the filters and keep the old value
-        if (gyro_filtered.is_nan() || gyro_filtered.is_inf()) {
-            _imu._gyro_filter[instance].reset();
-            _imu._gyro_notch_filter[instance].reset();
-            _imu._gyro_harmonic_notch_filter[instance].reset();
-        } else {
-            _imu._gyro_filtered[instance] = gyro_filtered;
+        for (uint8_t i = 0; i < n; i++) {
+            _accumulate_gyro_sample(instance, gyro[i], i == 0 ? first_dt : dt);
+            if (post_filter_logging) {
+                gyro[i] = _imu._gyro_filtered[instance];
+            }
         }
+    }
 
-        _imu._new_gyro_data[instance] = true;
+    // samples in the block are spaced dt apart, ending at sample_us
+    const uint32_t dt_us = dt * 1.0e6f;
+    for (uint8_t i = 0; i < n; i++) {
+        log_gyro_raw(instance, sample_us - (n - 1 - i) * dt_us, gyro[i]);
     }
+}
 
-    if (!_imu.batchsampler.doing_post_filter_logging()) {
-        log_gyro_raw(instance, sample_us, gyro);
+/*
+  integrate delta angle and apply filters for one raw gyro sample
+ */
+void AP_InertialSensor_Backend::_accumulate_gyro_sample(uint8_t instance, const Vector3f &gyro, float dt)
+{
+    // compute delta angle
+    Vector3f delta_angle = (gyro + _imu._last_raw_gyro[instance]) * 0.5f * dt;
+
+    // compute coning correction
+    // see page 26 of:
+    // Tian et al (2010) Three-loop Integration of GPS and Strapdown INS with Coning and Sculling Compensation
+    // Available: http://www.sage.unsw.edu.au/snap/publications/tian_etal2010b.pdf
+    // see also examples/coning.py
+    Vector3f delta_coning = (_imu._delta_angle_acc[instance] +
+                             _imu._last_delta_angle[instance] * (1.0f / 6.0f));
+    delta_coning = delta_coning % delta_angle;
+    delta_coning *= 0.5f;
+
+    // integrate delta angle accumulator
+    // the angles and coning corrections are accumulated separately in the
+    // referenced paper, but in simulation little difference was found between
+    // integrating together and integrating separately (see examples/coning.py)
+    _imu._delta_angle_acc[instance] += delta_angle + delta_coning;
+    _imu._delta_angle_acc_dt[instance] += dt;
+
+    // save previous delta angle for coning correction
+    _imu._last_delta_angle[instance] = delta_angle;
+    _imu._last_raw_gyro[instance] = gyro;
+#if HAL_WITH_DSP
+    // capture gyro window for FFT analysis
+    if (_imu._gyro_window_size > 0) {
+        const Vector3f& scaled_gyro = gyro * _imu._gyro_raw_sampling_multiplier[instance];
+        _imu._gyro_window[instance][0].push(scaled_gyro.x);
+        _imu._gyro_window[instance][1].push(scaled_gyro.y);
+        _imu._gyro_window[instance][2].push(scaled_gyro.z);
     }
-    else {
-        log_gyro_raw(instance, sample_us, _imu._gyro_filtered[instance]);
+#endif
+    Vector3f gyro_filtered = gyro;
+
+    // apply the notch filter
+    if (_gyro_notch_enabled()) {
+        gyro_filtered = _imu._gyro_notch_filter[instance].apply(gyro_filtered);
+    }
+
+    // apply the harmonic notch filter
+    if (gyro_harmonic_notch_enabled()) {
+        if (_imu._motor_notch_active[instance]) {
+            gyro_filtered = _imu._gyro_motor_notch_filter[instance].apply(gyro_filtered);
+        } else {
+            gyro_filtered = _imu._gyro_harmonic_notch_filter[instance].apply(gyro_filtered);
+        }
+    }
+
+    // apply the low pass filter last to attentuate any notch induced noise
+    gyro_filtered = _imu._gyro_filter[instance].apply(gyro_filtered);
+
+    // if the filtering failed in any way then reset the filters and keep the old value
+    if (gyro_filtered.is_nan() || gyro_filtered.is_inf()) {
+        _imu._gyro_filter[instance].reset();
+        _imu._gyro_notch_filter[instance].reset();
+        _imu._gyro_harmonic_notch_filter[instance].reset();
+        _imu._gyro_motor_notch_filter[instance].reset();
+    } else {
+        _imu._gyro_filtered[instance] = gyro_filtered;
     }
+
+    _imu._new_gyro_data[instance] = true;
 }
 
 void AP_InertialSensor_Backend::log_gyro_raw(uint8_t instance, const uint64_t sample_us, const Vector3f &gyro)
@@ -346,26 +430,8 @@ void AP_InertialSensor_Backend::_notify_new_accel_raw_sample(uint8_t instance,
 
     uint64_t last_sample_us = _imu._accel_last_sample_us[instance];
 
-    /*
-      we have two classes of sensors. FIFO based sensors produce data
-      at a very predictable overall rate, but the data comes in
-      bunches, so we use the provided sample rate for deltaT. Non-FIFO
-      sensors don't bunch up samples, but also tend to vary in actual
-      rate, so we use the provided sample_us to get the deltaT. The
-      difference between the two is whether sample_us is provided.
-     */
-    if (sample_us != 0 && _imu._accel_last_sample_us[instance] != 0) {
-        dt = (sample_us - _imu._accel_last_sample_us[instance]) * 1.0e-6f;
-        _imu._accel_last_sample_us[instance] = sample_us;
-    } else {
-        // don't accept below 100Hz
-        if (_imu._accel_raw_sample_rates[instance] < 100) {
-            return;
-        }
-
-        dt = 1.0f / _imu._accel_raw_sample_rates[instance];
-        _imu._accel_last_sample_us[instance] = AP_HAL::micros64();
-        sample_us = _imu._accel_last_sample_us[instance];
+    if (!_raw_sample_dt(_imu._accel_last_sample_us[instance], _imu._accel_raw_sample_rates[instance], 1, sample_us, dt)) {
+        return;
     }
 
 #if AP_MODULE_SUPPORTED
@@ -386,19 +452,8 @@ void AP_InertialSensor_Backend::_notify_new_accel_raw_sample(uint8_t instance,
             _imu._delta_velocity_acc_dt[instance] = 0;
             dt = 0;
         }
-        
-        // delta velocity
-        _imu._delta_velocity_acc[instance] += accel * dt;
-        _imu._delta_velocity_acc_dt[instance] += dt;
-
-        _imu._accel_filtered[instance] = _imu._accel_filter[instance].apply(accel);
-        if (_imu._accel_filtered[instance].is_nan() || _imu._accel_filtered[instance].is_inf()) {
-            _imu._accel_filter[instance].reset();
-        }
 
-        _imu.set_accel_peak_hold(instance, _imu._accel_filtered[instance]);
-
-        _imu._new_accel_data[instance] = true;
+        _accumulate_accel_sample(instance, accel, dt);
     }
 
     if (!_imu.batchsampler.doing_post_filter_logging()) {
@@ -408,6 +463,85 @@ void AP_InertialSensor_Backend::_notify_new_accel_raw_sample(uint8_t instance,
     }
 }
 
+void AP_InertialSensor_Backend::_notify_new_accel_raw_samples(uint8_t instance,
+                                                              Vector3f *accel,
+                                                              uint8_t n,
+                                                              uint64_t sample_us,
+                                                              uint32_t fsync_mask)
+{
+    if (n == 0 || ((1U<<instance) & _imu.imu_kill_mask)) {
+        return;
+    }
+    float dt;
+
+    _update_sensor_rate(_imu._sample_accel_count[instance], _imu._sample_accel_start_us[instance],
+                        _imu._accel_raw_sample_rates[instance], n);
+
+    uint64_t last_sample_us = _imu._accel_last_sample_us[instance];
+
+    if (!_raw_sample_dt(_imu._accel_last_sample_us[instance], _imu._accel_raw_sample_rates[instance], n, sample_us, dt)) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+        _rotate_and_correct_accel(instance, accel[i]);
+
+#if AP_MODULE_SUPPORTED
+        // call accel_sample hook if any
+        AP_Module::call_hook_accel_sample(instance, dt, accel[i], i < 32 && (fsync_mask & (1U<<i)) != 0);
+#endif
+
+        _imu.calc_vibration_and_clipping(instance, accel[i], dt);
+    }
+
+    const bool post_filter_logging = _imu.batchsampler.doing_post_filter_logging();
+    {
+        WITH_SEMAPHORE(_sem);
+
+        uint64_t now = AP_HAL::micros64();
+
+        float first_dt = dt;
+        if (now - last_sample_us > 100000U) {
+            // zero accumulator if sensor was unhealthy for 0.1s
+            _imu._delta_velocity_acc[instance].zero();
+            _imu._delta_velocity_acc_dt[instance] = 0;
+            first_dt = 0;
+        }
+
+        for (uint8_t i = 0; i < n; i++) {
+            _accumulate_accel_sample(instance, accel[i], i == 0 ? first_dt : dt);
+            if (post_filter_logging) {
+                accel[i] = _imu._accel_filtered[instance];
+            }
+        }
+    }
+
+    // samples in the block are spaced dt apart, ending at sample_us
+    const uint32_t dt_us = dt * 1.0e6f;
+    for (uint8_t i = 0; i < n; i++) {
+        log_accel_raw(instance, sample_us - (n - 1 - i) * dt_us, accel[i]);
+    }
+}
+
+/*
+  integrate delta velocity and apply filters for one raw accel sample
+ */
+void AP_InertialSensor_Backend::_accumulate_accel_sample(uint8_t instance, const Vector3f &accel, float dt)
+{
+    // delta velocity
+    _imu._delta_velocity_acc[instance] += accel * dt;
+    _imu._delta_velocity_acc_dt[instance] += dt;
+
+    _imu._accel_filtered[instance] = _imu._accel_filter[instance].apply(accel);
+    if (_imu._accel_filtered[instance].is_nan() || _imu._accel_filtered[instance].is_inf()) {
+        _imu._accel_filter[instance].reset();
+    }
+
+    _imu.set_accel_peak_hold(instance, _imu._accel_filtered[instance]);
+
+    _imu._new_accel_data[instance] = true;
+}
+
 void AP_InertialSensor_Backend::_notify_new_accel_sensor_rate_sample(uint8_t instance, const Vector3f &accel)
 {
     if (!_imu.batchsampler.doing_sensor_rate_logging()) {
@@ -535,9 +669,10 @@ void AP_InertialSensor_Backend::update_gyro(uint8_t instance)
     }
 
     // possily update the harmonic notch filter parameters
-    if (!is_equal(_last_harmonic_notch_bandwidth_hz, gyro_harmonic_notch_bandwidth_hz()) ||
+    const bool harmonic_notch_shape_changed = !is_equal(_last_harmonic_notch_bandwidth_hz, gyro_harmonic_notch_bandwidth_hz()) ||
         !is_equal(_last_harmonic_notch_attenuation_dB, gyro_harmonic_notch_attenuation_dB()) ||
-        sensors_converging()) {
+        sensors_converging();
+    if (harmonic_notch_shape_changed) {
         _imu._gyro_harmonic_notch_filter[instance].init(_gyro_raw_sample_rate(instance), gyro_harmonic_notch_center_freq_hz(), gyro_harmonic_notch_bandwidth_hz(), gyro_harmonic_notch_attenuation_dB());
         _last_harmonic_notch_center_freq_hz = gyro_harmonic_notch_center_freq_hz();
         _last_harmonic_notch_bandwidth_hz = gyro_harmonic_notch_bandwidth_hz();
@@ -550,6 +685,30 @@ void AP_InertialSensor_Backend::update_gyro(uint8_t instance)
         }
         _last_harmonic_notch_center_freq_hz = gyro_harmonic_notch_center_freq_hz();
     }
+    // possibly update the per-motor harmonic notch, falling back to the
+    // shared harmonic notch on the average motor frequency when there are
+    // no motor frequencies or too many notches
+    MotorNotchFilterBank &motor_notch = _imu._gyro_motor_notch_filter[instance];
+    if (motor_notch.max_filters() > 0) {
+        if (harmonic_notch_shape_changed) {
+            motor_notch.init(_gyro_raw_sample_rate(instance), gyro_harmonic_notch_center_freq_hz(),
+                             gyro_harmonic_notch_bandwidth_hz(), gyro_harmonic_notch_attenuation_dB(),
+                             _imu._harmonic_notch_filter.harmonics(),
+                             _imu._harmonic_notch_filter.hasOption(HarmonicNotchFilterParams::Options::DoubleNotch));
+        }
+        if (harmonic_notch_shape_changed || _imu._motor_notch_applied_count[instance] != _imu._motor_notch_update_count) {
+            const bool active = _imu._num_motor_notch_frequencies > 0 &&
+                motor_notch.update(_imu._num_motor_notch_frequencies, _imu._motor_notch_freq_hz);
+            // the filter switched to has not seen the recent samples
+            if (active && !_imu._motor_notch_active[instance]) {
+                motor_notch.reset();
+            } else if (!active && _imu._motor_notch_active[instance]) {
+                _imu._gyro_harmonic_notch_filter[instance].reset();
+            }
+            _imu._motor_notch_active[instance] = active;
+            _imu._motor_notch_applied_count[instance] = _imu._motor_notch_update_count;
+        }
+    }
     // possily update the notch filter parameters
     if (!is_equal(_last_notch_center_freq_hz, _gyro_notch_center_freq_hz()) ||
         !is_equal(_last_notch_bandwidth_hz, _gyro_notch_bandwidth_hz()) ||
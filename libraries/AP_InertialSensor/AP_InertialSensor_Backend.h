@@ -149,6 +149,18 @@ protected:
     // sensors, and should be set to zero for FIFO based sensors
     void _notify_new_accel_raw_sample(uint8_t instance, const Vector3f &accel, uint64_t sample_us=0, bool fsync_set=false);
 
+    // batch versions of _notify_new_gyro_raw_sample() and
+    // _notify_new_accel_raw_sample() for a block of samples from one
+    // FIFO read. The samples must be scaled but not rotated or
+    // corrected; the array is rotated, corrected and (when doing post
+    // filter logging) filtered in place. The backend semaphore is
+    // taken once for the whole block.
+    // sample_us is the time of the last sample in the block, and should
+    // be zero for FIFO based sensors. Bit i of fsync_mask gives the
+    // fsync state of sample i
+    void _notify_new_gyro_raw_samples(uint8_t instance, Vector3f *gyro, uint8_t n, uint64_t sample_us=0);
+    void _notify_new_accel_raw_samples(uint8_t instance, Vector3f *accel, uint8_t n, uint64_t sample_us=0, uint32_t fsync_mask=0);
+
     // set the amount of oversamping a accel is doing
     void _set_accel_oversampling(uint8_t instance, uint8_t n);
 
@@ -181,8 +193,8 @@ protected:
         _imu._gyro_raw_sampling_multiplier[instance] = mul;
     }
 
-    // update the sensor rate for FIFO sensors
-    void _update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz) const;
+    // update the sensor rate for FIFO sensors, n is the number of new samples
+    void _update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz, uint8_t n=1) const;
 
     // return true if the sensors are still converging and sampling rates could change significantly
     bool sensors_converging() const { return AP_HAL::millis() < 30000; }
@@ -327,6 +339,14 @@ protected:
 private:
 
     bool should_log_imu_raw() const;
+
+    // integrate and filter one raw sample, called with _sem held
+    void _accumulate_gyro_sample(uint8_t instance, const Vector3f &gyro, float dt);
+    void _accumulate_accel_sample(uint8_t instance, const Vector3f &accel, float dt);
+
+    // get dt for a new sample and update the last sample time,
+    // returning false if the sample rate is too low to use
+    bool _raw_sample_dt(uint64_t &last_sample_us, float rate_hz, uint8_t n, uint64_t &sample_us, float &dt) const;
     void log_accel_raw(uint8_t instance, const uint64_t sample_us, const Vector3f &accel);
     void log_gyro_raw(uint8_t instance, const uint64_t sample_us, const Vector3f &gryo);
 
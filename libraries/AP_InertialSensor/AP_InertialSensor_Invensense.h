@@ -172,6 +172,13 @@ private:
         uint8_t gyro_count;
         LowPassFilterVector3f accel_filter{4000, 188};
     } _accum;
+
+    /*
+      samples from one FIFO read, passed to the frontend as a block
+    */
+    static const uint8_t FIFO_BATCH_LEN = 16;
+    Vector3f _accel_batch[FIFO_BATCH_LEN];
+    Vector3f _gyro_batch[FIFO_BATCH_LEN];
 };
 
 class AP_Invensense_AuxiliaryBusSlave : public AuxiliaryBusSlave
@@ -308,44 +308,50 @@ void AP_InertialSensor_Invensensev2::_poll_data()
 
 bool AP_InertialSensor_Invensensev2::_accumulate(uint8_t *samples, uint8_t n_samples)
 {
+    static_assert(INV2_FIFO_BUFFER_LEN <= FIFO_BATCH_LEN, "batch too small for FIFO reads");
+    uint32_t fsync_mask = 0;
+    uint8_t n = 0;
+    int16_t t2 = 0;
+    bool ret = true;
+
     for (uint8_t i = 0; i < n_samples; i++) {
         const uint8_t *data = samples + INV2_SAMPLE_SIZE * i;
-        Vector3f accel, gyro;
-        bool fsync_set = false;
 
-#if INVENSENSE_EXT_SYNC_ENABLE
-        fsync_set = (int16_val(data, 2) & 1U) != 0;
-#endif
-        
-        accel = Vector3f(int16_val(data, 1),
-                         int16_val(data, 0),
-                         -int16_val(data, 2));
-        accel *= _accel_scale;
-
-        int16_t t2 = int16_val(data, 6);
+        t2 = int16_val(data, 6);
         if (!_check_raw_temp(t2)) {
-            if (!hal.scheduler->in_expected_delay()) {
-                debug("temp reset IMU[%u] %d %d", _accel_instance, _raw_temp, t2);
-            }
-            _fifo_reset();
-            return false;
+            ret = false;
+            break;
         }
         float temp = t2 * temp_sensitivity + temp_zero;
-        
-        gyro = Vector3f(int16_val(data, 4),
-                        int16_val(data, 3),
-                        -int16_val(data, 5));
-        gyro *= GYRO_SCALE;
 
-        _rotate_and_correct_accel(_accel_instance, accel);
-        _rotate_and_correct_gyro(_gyro_instance, gyro);
+#if INVENSENSE_EXT_SYNC_ENABLE
+        if ((int16_val(data, 2) & 1U) != 0) {
+            fsync_mask |= (1U<<n);
+        }
+#endif
 
-        _notify_new_accel_raw_sample(_accel_instance, accel, 0, fsync_set);
-        _notify_new_gyro_raw_sample(_gyro_instance, gyro);
+        _accel_batch[n] = Vector3f(int16_val(data, 1),
+                                   int16_val(data, 0),
+                                   -int16_val(data, 2)) * _accel_scale;
+        _gyro_batch[n] = Vector3f(int16_val(data, 4),
+                                  int16_val(data, 3),
+                                  -int16_val(data, 5)) * GYRO_SCALE;
+        n++;
 
         _temp_filtered = _temp_filter.apply(temp);
     }
-    return true;
+
+    // samples before any FIFO corruption are still good
+    _notify_new_accel_raw_samples(_accel_instance, _accel_batch, n, 0, fsync_mask);
+    _notify_new_gyro_raw_samples(_gyro_instance, _gyro_batch, n);
+
+    if (!ret) {
+        if (!hal.scheduler->in_expected_delay()) {
+            debug("temp reset IMU[%u] %d %d", _accel_instance, _raw_temp, t2);
+        }
+        _fifo_reset();
+    }
+    return ret;
 }
 
 /*
@@ -362,6 +368,8 @@ bool AP_InertialSensor_Invensensev2::_accumulate_sensor_rate_sampling(uint8_t *s
     int32_t unscaled_clip_limit = _clip_limit / _accel_scale;
     bool clipped = false;
     bool ret = true;
+    uint8_t n_accel = 0;
+    uint8_t n_gyro = 0;
 
     for (uint8_t i = 0; i < n_samples; i++) {
         const uint8_t *data = samples + INV2_SAMPLE_SIZE * i;
@@ -372,7 +380,6 @@ bool AP_InertialSensor_Invensensev2::_accumulate_sensor_rate_sampling(uint8_t *s
             if (!hal.scheduler->in_expected_delay()) {
                 debug("temp reset IMU[%u] %d %d", _accel_instance, _raw_temp, t2);
             }
-            _fifo_reset();
             ret = false;
             break;
         }
@@ -395,9 +402,7 @@ bool AP_InertialSensor_Invensensev2::_accumulate_sensor_rate_sampling(uint8_t *s
             _accum.accel_count++;
 
             if (_accum.accel_count % _accel_fifo_downsample_rate == 0) {
-                _accum.accel *= _fifo_accel_scale;
-                _rotate_and_correct_accel(_accel_instance, _accum.accel);
-                _notify_new_accel_raw_sample(_accel_instance, _accum.accel, 0, false);
+                _accel_batch[n_accel++] = _accum.accel * _fifo_accel_scale;
                 _accum.accel.zero();
                 _accum.accel_count = 0;
                 // we assume that the gyro rate is always >= and a multiple of the accel rate
@@ -417,13 +422,19 @@ bool AP_InertialSensor_Invensensev2::_accumulate_sensor_rate_sampling(uint8_t *s
         _accum.gyro += g;
 
         if (_accum.gyro_count % _gyro_fifo_downsample_rate == 0) {
-            _accum.gyro *= _fifo_gyro_scale;
-            _rotate_and_correct_gyro(_gyro_instance, _accum.gyro);
-            _notify_new_gyro_raw_sample(_gyro_instance, _accum.gyro);
+            _gyro_batch[n_gyro++] = _accum.gyro * _fifo_gyro_scale;
             _accum.gyro.zero();
         }
     }
 
+    // samples before any FIFO corruption are still good
+    _notify_new_accel_raw_samples(_accel_instance, _accel_batch, n_accel);
+    _notify_new_gyro_raw_samples(_gyro_instance, _gyro_batch, n_gyro);
+
+    if (!ret) {
+        _fifo_reset();
+    }
+
     if (clipped) {
         increment_clip_count(_accel_instance);
     }
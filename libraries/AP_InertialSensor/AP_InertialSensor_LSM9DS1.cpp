@@ -174,6 +174,7 @@ extern const AP_HAL::HAL& hal;
 #   define LSM9DS1XG_FIFO_SRC_FTH                 (0x1 << 7)
 #   define LSM9DS1XG_FIFO_SRC_OVRN                (0x1 << 6)
 #   define LSM9DS1XG_FIFO_SRC_UNREAD_SAMPLES            0x3F
+#define LSM9DS1XG_FIFO_DEPTH                            32
 #define LSM9DS1XG_INT_GEN_CFG_G                         0x30
 #   define LSM9DS1XG_INT_GEN_CFG_G_AOI_G          (0x1 << 7)
 #   define LSM9DS1XG_INT_GEN_CFG_G_LIR_G          (0x1 << 6)
@@ -415,7 +416,7 @@ void AP_InertialSensor_LSM9DS1::_poll_data()
     uint16_t samples = _register_read(LSM9DS1XG_FIFO_SRC);
 
 
-    samples = samples & LSM9DS1XG_FIFO_SRC_UNREAD_SAMPLES;
+    samples = MIN(samples & LSM9DS1XG_FIFO_SRC_UNREAD_SAMPLES, LSM9DS1XG_FIFO_DEPTH);
     if (samples > 1) {
         _read_data_transaction_g(samples);
         _read_data_transaction_x(samples);
@@ -431,26 +432,43 @@ void AP_InertialSensor_LSM9DS1::_poll_data()
     }
 }
 
-void AP_InertialSensor_LSM9DS1::_read_data_transaction_x(uint16_t samples)
+/*
+ *  read samples from the FIFO starting at register reg and sum them. All
+ *  samples are read with a single batch of transfers
+ */
+bool AP_InertialSensor_LSM9DS1::_read_fifo_sum(uint8_t reg, uint16_t samples, int32_t sum[3])
 {
-    struct sensor_raw_data raw_data = { };
-    int32_t _accel_bias[3] = {0, 0, 0};
+    struct sensor_raw_data raw_data[LSM9DS1XG_FIFO_DEPTH];
+    AP_HAL::Device::Transaction batch[LSM9DS1XG_FIFO_DEPTH];
 
-    const uint8_t _reg = LSM9DS1XG_OUT_X_L_XL | 0x80;
+    reg |= 0x80;
+    for (uint16_t i = 0; i < samples; i++) {
+        batch[i] = { &reg, 1, (uint8_t *) &raw_data[i], sizeof(raw_data[i]) };
+    }
 
-    // Read the accel data stored in the FIFO
-    for (int i = 0; i < samples; i++)
-    {
-        struct sensor_raw_data raw_data_temp = { };
+    if (!_dev->transfer_batch(batch, samples)) {
+        return false;
+    }
 
-        if (!_dev->transfer(&_reg, 1, (uint8_t *) &raw_data_temp, sizeof(raw_data_temp))) {
-            hal.console->printf("LSM9DS1: error reading accelerometer\n");
-            return;
-        }
+    sum[0] = sum[1] = sum[2] = 0;
+    for (uint16_t i = 0; i < samples; i++) {
+        sum[0] += (int32_t) raw_data[i].x; // Sum individual signed 16-bit biases to get accumulated signed 32-bit biases
+        sum[1] += (int32_t) raw_data[i].y;
+        sum[2] += (int32_t) raw_data[i].z;
+    }
 
-        _accel_bias[0] += (int32_t) raw_data_temp.x; // Sum individual signed 16-bit biases to get accumulated signed 32-bit biases
-        _accel_bias[1] += (int32_t) raw_data_temp.y;
-        _accel_bias[2] += (int32_t) raw_data_temp.z;
+    return true;
+}
+
+void AP_InertialSensor_LSM9DS1::_read_data_transaction_x(uint16_t samples)
+{
+    struct sensor_raw_data raw_data = { };
+    int32_t _accel_bias[3];
+
+    // Read the accel data stored in the FIFO
+    if (!_read_fifo_sum(LSM9DS1XG_OUT_X_L_XL, samples, _accel_bias)) {
+        hal.console->printf("LSM9DS1: error reading accelerometer\n");
+        return;
     }
 
     raw_data.x = _accel_bias[0] / samples; // average the data
@@ -471,23 +489,12 @@ void AP_InertialSensor_LSM9DS1::_read_data_transaction_x(uint16_t samples)
 void AP_InertialSensor_LSM9DS1::_read_data_transaction_g(uint16_t samples)
 {
     struct sensor_raw_data raw_data = { };
-    int32_t _gyro_bias[3] = {0, 0, 0};
-
-    const uint8_t _reg = LSM9DS1XG_OUT_X_L_G |  0x80;
+    int32_t _gyro_bias[3];
 
     // Read the gyro data stored in the FIFO
-    for (int i = 0; i < samples; i++)
-    {
-        struct sensor_raw_data raw_data_temp = { };
-
-        if (!_dev->transfer(&_reg, 1, (uint8_t *) &raw_data_temp, sizeof(raw_data_temp))) {
-            hal.console->printf("LSM9DS1: error reading gyroscope\n");
-            return;
-        }
-
-        _gyro_bias[0] += (int32_t) raw_data_temp.x; // Sum individual signed 16-bit biases to get accumulated signed 32-bit biases
-        _gyro_bias[1] += (int32_t) raw_data_temp.y;
-        _gyro_bias[2] += (int32_t) raw_data_temp.z;
+    if (!_read_fifo_sum(LSM9DS1XG_OUT_X_L_G, samples, _gyro_bias)) {
+        hal.console->printf("LSM9DS1: error reading gyroscope\n");
+        return;
     }
 
     raw_data.x = _gyro_bias[0] / samples; // average the data
@@ -55,6 +55,7 @@ private:
     uint8_t _register_read(uint8_t reg);
     void _register_write(uint8_t reg, uint8_t val, bool checked=false);
 
+    bool _read_fifo_sum(uint8_t reg, uint16_t samples, int32_t sum[3]);
     void _read_data_transaction_x(uint16_t samples);
     void _read_data_transaction_g(uint16_t samples);
 
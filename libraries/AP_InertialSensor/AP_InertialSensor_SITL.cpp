@@ -149,8 +149,7 @@ void AP_InertialSensor_SITL::generate_accel()
     }
 
     accel_accum /= nsamples;
-    _rotate_and_correct_accel(accel_instance, accel_accum);
-    _notify_new_accel_raw_sample(accel_instance, accel_accum, AP_HAL::micros64());
+    _notify_new_accel_raw_samples(accel_instance, &accel_accum, 1, AP_HAL::micros64());
 
     _publish_temperature(accel_instance, 23);
 }
@@ -234,8 +233,7 @@ void AP_InertialSensor_SITL::generate_gyro()
         _notify_new_gyro_sensor_rate_sample(gyro_instance, gyro);
     }
     gyro_accum /= nsamples;
-    _rotate_and_correct_gyro(gyro_instance, gyro_accum);
-    _notify_new_gyro_raw_sample(gyro_instance, gyro_accum, AP_HAL::micros64());
+    _notify_new_gyro_raw_samples(gyro_instance, &gyro_accum, 1, AP_HAL::micros64());
 }
 
 void AP_InertialSensor_SITL::timer_update(void)
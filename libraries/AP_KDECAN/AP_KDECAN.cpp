@@ -28,6 +28,7 @@
 #include <AP_Math/AP_Math.h>
 #include <AP_Motors/AP_Motors.h>
 #include <AP_Logger/AP_Logger.h>
+#include <AP_ESC_Telem/AP_ESC_Telem.h>
 #include <stdio.h>
 #include "AP_KDECAN.h"
 #include <AP_CANManager/AP_CANManager.h>
@@ -457,6 +458,19 @@ void AP_KDECAN::loop()
                             _telemetry[id.source_id - ESC_NODE_ID_FIRST].temp = frame.data[6];
                             _telemetry[id.source_id - ESC_NODE_ID_FIRST].new_data = true;
                             _telem_sem.give();
+
+                            AP_ESC_Telem *esc_telem = AP_ESC_Telem::get_singleton();
+                            if (esc_telem != nullptr) {
+                                const uint8_t num_poles = _num_poles > 0 ? _num_poles : DEFAULT_NUM_POLES;
+                                AP_ESC_Telem::TelemetryData t {};
+                                t.voltage = (frame.data[0] << 8 | frame.data[1]) * 0.01f;
+                                t.current = (frame.data[2] << 8 | frame.data[3]) * 0.01f;
+                                t.rpm = (frame.data[4] << 8 | frame.data[5]) * 60.0f * 2 / num_poles;
+                                t.temperature_cdeg = int16_t(frame.data[6] * 100);
+                                esc_telem->update_telem_data(id.source_id - ESC_NODE_ID_FIRST, t,
+                                                             AP_ESC_Telem::VOLTAGE | AP_ESC_Telem::CURRENT |
+                                                             AP_ESC_Telem::RPM | AP_ESC_Telem::TEMPERATURE);
+                            }
                             break;
                         }
                         default:
@@ -15,6 +15,10 @@ const extern AP_HAL::HAL& hal;
 // this if (and only if!) the low level format changes
 #define DF_LOGGING_FORMAT    0x1901201B
 
+// the first page of the log index holds its format in the first 4
+// bytes. Change this if the layout of the index changes
+#define DF_LOG_INDEX_FORMAT  0x1902201B
+
 AP_Logger_Block::AP_Logger_Block(AP_Logger &front, LoggerMessageWriter_DFLogStart *writer) :
     writebuf(0),
     AP_Logger_Backend(front, writer)
@@ -31,7 +35,7 @@ AP_Logger_Block::AP_Logger_Block(AP_Logger &front, LoggerMessageWriter_DFLogStar
 void AP_Logger_Block::Init(void)
 {
     if (CardInserted()) {
-        // reserve space for version in last sector
+        // reserve the last block for the format version and the log index
         df_NumPages -= df_PagePerBlock;
 
         // determine and limit file backend buffersize
@@ -286,6 +290,7 @@ void AP_Logger_Block::EraseAll()
     // throw away everything
     log_write_started = false;
     writebuf.clear();
+    index_valid = false;
 
     // reset the format version and wrapped status so that any incomplete erase will be caught
     Sector4kErase(get_sector(df_NumPages));
@@ -359,6 +364,10 @@ void AP_Logger_Block::Prep()
         EraseAll();
     } else {
         validate_log_structure();
+        // a corrupt log is erased first, then the index is rebuilt
+        if (df_EraseFrom == 0) {
+            index_load();
+        }
     }
 }
 
@@ -535,6 +544,8 @@ void AP_Logger_Block::stop_logging(void)
 
     // nuke writing any previous log
     writebuf.clear();
+
+    index_stop_log();
 }
 
 // stop logging and flush any remaining data
@@ -585,7 +596,9 @@ void AP_Logger_Block::start_new_log(void)
             last_page=0;
         }
         StartLogFile(new_log_num);
-        StartWrite(last_page + 1);
+        // a log ending on the last page wrapped to the first page,
+        // which has already been erased
+        StartWrite(last_page % df_NumPages + 1);
     }
 
     // save UTC time in the first 4 bytes so that we can retrieve it later
@@ -614,6 +627,14 @@ void AP_Logger_Block::get_log_boundaries(uint16_t list_entry, uint32_t & start_p
     }
 
     WITH_SEMAPHORE(sem);
+
+    LogIndexEntry entry;
+    if (index_valid && index_find(log_num, entry)) {
+        start_page = entry.start_page;
+        end_page = index_end_page(entry);
+        return;
+    }
+
     uint16_t num = get_num_logs();
     uint32_t look;
 
@@ -671,6 +692,20 @@ uint16_t AP_Logger_Block::find_last_log(void)
 
 // This function finds the last page of the last file
 uint32_t AP_Logger_Block::find_last_page(void)
+{
+    WITH_SEMAPHORE(sem);
+
+    if (!index_valid) {
+        return scan_last_page();
+    }
+    if (index_count == 0) {
+        return 1;
+    }
+    return index_end_page(index_last);
+}
+
+// search the chip for the last page of the last file
+uint32_t AP_Logger_Block::scan_last_page(void)
 {
     uint32_t look;
     uint32_t bottom = 1;
@@ -717,6 +752,18 @@ uint32_t AP_Logger_Block::find_last_page(void)
 
 // This function finds the last page of a particular log file
 uint32_t AP_Logger_Block::find_last_page_of_log(uint16_t log_number)
+{
+    WITH_SEMAPHORE(sem);
+
+    LogIndexEntry entry;
+    if (index_valid && index_find(log_number, entry)) {
+        return index_end_page(entry);
+    }
+    return scan_last_page_of_log(log_number);
+}
+
+// search the chip for the last page of a particular log file
+uint32_t AP_Logger_Block::scan_last_page_of_log(uint16_t log_number)
 {
     uint32_t look;
     uint32_t bottom;
@@ -771,6 +818,231 @@ uint32_t AP_Logger_Block::find_last_page_of_log(uint16_t log_number)
     return 0;
 }
 
+// find the last page of a log by searching from its start page up to
+// the last page of the last log
+uint32_t AP_Logger_Block::scan_end_of_log(uint16_t log_number, uint32_t start_page, uint32_t last_page)
+{
+    // the pages of a log are contiguous, so search the offsets from
+    // its start page. The page at bottom is in the log and the page
+    // at top is not
+    uint32_t bottom = 0;
+    uint32_t top = (last_page + df_NumPages - start_page) % df_NumPages + 1;
+
+    while (top - bottom > 1) {
+        const uint32_t look = (top + bottom) / 2;
+        if (StartRead((start_page + look - 1) % df_NumPages + 1) == log_number) {
+            bottom = look;
+        } else {
+            top = look;
+        }
+    }
+
+    return (start_page + bottom - 1) % df_NumPages + 1;
+}
+
+/*
+  log index handling. The index is only used while it is valid,
+  otherwise the functions above search the chip
+ */
+
+// read an entry of the log index
+void AP_Logger_Block::index_read(uint16_t slot, LogIndexEntry &entry)
+{
+    PageToBuffer(index_first_page() + 1 + slot / index_entries_per_page());
+    BlockRead((slot % index_entries_per_page()) * sizeof(entry), &entry, sizeof(entry));
+}
+
+// write an entry of the log index. The rest of the page is written
+// back unchanged, which leaves it alone on flash
+void AP_Logger_Block::index_write(uint16_t slot, const LogIndexEntry &entry)
+{
+    const uint32_t page = index_first_page() + 1 + slot / index_entries_per_page();
+    PageToBuffer(page);
+    memcpy(&buffer[(slot % index_entries_per_page()) * sizeof(entry)], &entry, sizeof(entry));
+    BufferToPage(page);
+    if (slot + 1U >= index_count) {
+        index_last = entry;
+    }
+}
+
+// start an empty index in erased index pages
+void AP_Logger_Block::index_write_header(void)
+{
+    const uint32_t format = DF_LOG_INDEX_FORMAT;
+    memset(buffer, 0xff, df_PageSize);
+    memcpy(buffer, &format, sizeof(format));
+    BufferToPage(index_first_page());
+    index_count = 0;
+}
+
+// find the last entry of a log. A log too short to keep is restarted
+// with the same number, so a log can have more than one entry
+bool AP_Logger_Block::index_find(uint16_t log_num, LogIndexEntry &entry)
+{
+    if (index_count == 0 || index_last.log_num < log_num) {
+        return false;
+    }
+    if (index_last.log_num == log_num) {
+        entry = index_last;
+        return true;
+    }
+
+    // log numbers go up by one per entry, so look where that puts the
+    // log and at the entry after it before searching. The entry at
+    // bottom is for the log or an earlier one, the entry at top is
+    // for a later one
+    int32_t bottom = -1;
+    int32_t top = index_count - 1;
+    int32_t guess = top - (index_last.log_num - log_num);
+    while (top - bottom > 1) {
+        const int32_t look = (guess > bottom && guess < top) ? guess : (top + bottom) / 2;
+        LogIndexEntry look_entry;
+        index_read(look, look_entry);
+        if (look_entry.log_num <= log_num) {
+            bottom = look;
+            entry = look_entry;
+            guess = (guess == look) ? look + 1 : -1;
+        } else {
+            top = look;
+            guess = -1;
+        }
+    }
+
+    return bottom >= 0 && entry.log_num == log_num;
+}
+
+// load the log index at boot, rebuilding it if it does not match the
+// logs on the chip
+void AP_Logger_Block::index_load(void)
+{
+    index_valid = false;
+    index_count = 0;
+
+    uint32_t format = 0;
+    PageToBuffer(index_first_page());
+    BlockRead(0, &format, sizeof(format));
+    if (format != DF_LOG_INDEX_FORMAT) {
+        index_rebuild();
+        return;
+    }
+
+    // entries are written in order so the first erased one gives the count
+    uint16_t bottom = 0;
+    uint16_t top = index_capacity();
+    while (bottom < top) {
+        const uint16_t look = (bottom + top) / 2;
+        LogIndexEntry entry;
+        index_read(look, entry);
+        if (entry.log_num != 0xFFFF) {
+            bottom = look + 1;
+        } else {
+            top = look;
+        }
+    }
+    index_count = bottom;
+    if (index_count == index_capacity()) {
+        // start again with only the logs still on the chip
+        index_rebuild();
+        return;
+    }
+
+    // the last entry must be the last log on the chip, as a firmware
+    // without the index may have written logs since
+    const uint32_t last_page = scan_last_page();
+    const uint16_t last_log = StartRead(last_page);
+    if (index_count == 0) {
+        if (last_page != 1 && last_log != 0xFFFF) {
+            index_rebuild();
+            return;
+        }
+        index_valid = true;
+        return;
+    }
+    LogIndexEntry &entry = index_last;
+    index_read(index_count - 1, entry);
+    if (entry.log_num != last_log ||
+        (entry.end_page != last_page && entry.end_page != 0xFFFFFFFF) ||
+        StartRead(entry.start_page) != last_log || df_FilePage != 1) {
+        index_rebuild();
+        return;
+    }
+    if (entry.end_page == 0xFFFFFFFF) {
+        // the log was still being written at power off
+        entry.end_page = last_page;
+        index_write(index_count - 1, entry);
+    }
+    index_valid = true;
+}
+
+// erase the log index and add the logs on the chip to it
+void AP_Logger_Block::index_rebuild(void)
+{
+    index_valid = false;
+
+    for (uint32_t sector = get_sector(index_first_page()); sector <= get_sector(df_NumPages + df_PagePerBlock); sector++) {
+        Sector4kErase(sector);
+    }
+    index_write_header();
+
+    const uint16_t num_logs = get_num_logs();
+    if (num_logs > index_capacity()) {
+        return;
+    }
+    if (num_logs > 0) {
+        const uint32_t last_page = find_last_page();
+        uint16_t log_num = StartRead(last_page) - num_logs + 1;
+
+        // the first log may wrap around the end of the chip
+        uint32_t end_page = find_last_page_of_log(log_num);
+        if (end_page == 0) {
+            return;
+        }
+        StartRead(end_page);
+        uint32_t start_page = (end_page + df_NumPages - df_FilePage) % df_NumPages + 1;
+
+        for (uint16_t i = 0; i < num_logs; i++, log_num++) {
+            if (StartRead(start_page) != log_num || df_FilePage != 1) {
+                hal.console->printf("Log index: no start of log %d at 0x%04X\n", int(log_num), unsigned(start_page));
+                return;
+            }
+            end_page = scan_end_of_log(log_num, start_page, last_page);
+            const LogIndexEntry entry { log_num, start_page, end_page };
+            index_write(index_count++, entry);
+            start_page = end_page % df_NumPages + 1;
+        }
+    }
+
+    hal.console->printf("Log index: rebuilt with %d logs\n", int(num_logs));
+    index_valid = true;
+}
+
+// add the log being written to the index as its first page is written
+void AP_Logger_Block::index_start_log(void)
+{
+    if (!index_valid) {
+        return;
+    }
+    index_stop_log();
+    if (index_count >= index_capacity()) {
+        // the index is rebuilt at the next boot
+        index_valid = false;
+        return;
+    }
+    const LogIndexEntry entry { df_Write_FileNumber, df_PageAdr, 0xFFFFFFFF };
+    index_write(index_count++, entry);
+}
+
+// fill in the end page of the log being written
+void AP_Logger_Block::index_stop_log(void)
+{
+    if (!index_valid || index_count == 0 || index_last.end_page != 0xFFFFFFFF) {
+        return;
+    }
+    LogIndexEntry entry = index_last;
+    entry.end_page = last_written_page();
+    index_write(index_count - 1, entry);
+}
+
 void AP_Logger_Block::get_log_info(uint16_t list_entry, uint32_t &size, uint32_t &time_utc)
 {
     uint32_t start, end;
@@ -859,6 +1131,9 @@ void AP_Logger_Block::io_timer(void)
         memset(buffer, 0, df_PageSize);
         memcpy(buffer, &version, sizeof(version));
         FinishWrite();
+        // the chip erase also erased the log index
+        index_write_header();
+        index_valid = true;
         erase_started = false;
         chip_full = false;
         status_msg = StatusMessage::ERASE_COMPLETE;
@@ -886,6 +1161,7 @@ void AP_Logger_Block::io_timer(void)
         }
         status_msg = StatusMessage::RECOVERY_COMPLETE;
         df_EraseFrom = 0;
+        index_rebuild();
     }
 
     if (!CardInserted() || new_log_pending || chip_full) {
@@ -904,6 +1180,7 @@ void AP_Logger_Block::io_timer(void)
         } else {
             writebuf.clear();
             stop_log_pending = false;
+            index_stop_log();
         }
 
     // write at most one page
@@ -917,6 +1194,10 @@ void AP_Logger_Block::io_timer(void)
 // write out a page of log data
 void AP_Logger_Block::write_log_page()
 {
+    if (df_Write_FilePage == 1) {
+        index_start_log();
+    }
+
     struct PageHeader ph;
     ph.FileNumber = df_Write_FileNumber;
     ph.FilePage = df_Write_FilePage;
@@ -8,6 +8,8 @@
 #define BLOCK_LOG_VALIDATE 0
 
 class AP_Logger_Block : public AP_Logger_Backend {
+    friend class AP_Logger_Block_Test;
+
 public:
     AP_Logger_Block(AP_Logger &front, LoggerMessageWriter_DFLogStart *writer);
 
@@ -86,6 +88,21 @@ private:
         uint32_t utc_secs;
     };
 
+    /*
+      the log index is kept in the reserved block after the sector
+      holding the format version. The first page holds the index
+      format, followed by one entry per log in the order the logs were
+      started. An entry is written when the first page of a log is
+      written and its end page is filled in when the log stops, so
+      index pages are only ever programmed over erased bits
+     */
+    struct PACKED LogIndexEntry {
+        uint16_t log_num;
+        uint32_t start_page;
+        // 0xFFFFFFFF while the log is being written
+        uint32_t end_page;
+    };
+
     // semaphore to mediate access to the chip
     HAL_Semaphore sem;
     // semaphore to mediate access to the ring buffer
@@ -109,6 +126,13 @@ private:
     // offset from adding FMT messages to log data
     bool adding_fmt_headers;
 
+    // true when the log index matches the logs on the chip
+    bool index_valid;
+    // number of entries in the log index
+    uint16_t index_count;
+    // copy of the last entry of the log index
+    LogIndexEntry index_last;
+
     // are we waiting on an erase to finish?
     volatile bool erase_started;
     // were we logging before the erase started?
@@ -144,6 +168,10 @@ private:
     uint16_t ReadHeaders();
     uint32_t find_last_page(void);
     uint32_t find_last_page_of_log(uint16_t log_number);
+    // search the chip for the last pages, used when there is no valid index
+    uint32_t scan_last_page(void);
+    uint32_t scan_last_page_of_log(uint16_t log_number);
+    uint32_t scan_end_of_log(uint16_t log_number, uint32_t start_page, uint32_t last_page);
     bool is_wrapped(void);
     void StartWrite(uint32_t PageAdr);
     void FinishWrite(void);
@@ -157,6 +185,23 @@ private:
 
     void _print_log_formats(AP_HAL::BetterStream *port);
 
+    // log index handling
+    uint32_t index_first_page() const { return df_NumPages + df_PagePerSector + 1; }
+    uint16_t index_entries_per_page() const { return df_PageSize / sizeof(LogIndexEntry); }
+    uint16_t index_capacity() const { return (df_PagePerBlock - df_PagePerSector - 1) * index_entries_per_page(); }
+    uint32_t last_written_page() const { return df_PageAdr > 1 ? df_PageAdr - 1 : df_NumPages; }
+    uint32_t index_end_page(const LogIndexEntry &entry) const {
+        return entry.end_page != 0xFFFFFFFF ? entry.end_page : last_written_page();
+    }
+    void index_read(uint16_t slot, LogIndexEntry &entry);
+    void index_write(uint16_t slot, const LogIndexEntry &entry);
+    void index_write_header(void);
+    bool index_find(uint16_t log_num, LogIndexEntry &entry);
+    void index_load(void);
+    void index_rebuild(void);
+    void index_start_log(void);
+    void index_stop_log(void);
+
     // callback on IO thread
     bool io_thread_alive() const;
     void io_timer(void);
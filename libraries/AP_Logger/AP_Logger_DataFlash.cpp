@@ -210,7 +210,7 @@ void AP_Logger_DataFlash::send_command_addr(uint8_t command, uint32_t PageAdr)
 
 void AP_Logger_DataFlash::PageToBuffer(uint32_t pageNum)
 {
-    if (pageNum == 0 || pageNum > df_NumPages+1) {
+    if (pageNum == 0 || pageNum > df_NumPages+df_PagePerBlock) {
         printf("Invalid page read %u\n", pageNum);
         memset(buffer, 0xFF, df_PageSize);
         return;
@@ -228,7 +228,7 @@ void AP_Logger_DataFlash::PageToBuffer(uint32_t pageNum)
 
 void AP_Logger_DataFlash::BufferToPage(uint32_t pageNum)
 {
-    if (pageNum == 0 || pageNum > df_NumPages+1) {
+    if (pageNum == 0 || pageNum > df_NumPages+df_PagePerBlock) {
         printf("Invalid page write %u\n", pageNum);
         return;
     }
@@ -52,7 +52,7 @@ bool AP_Logger_SITL::CardInserted(void) const
 
 void AP_Logger_SITL::PageToBuffer(uint32_t PageAdr)
 {
-    assert(PageAdr>0 && PageAdr <= df_NumPages+1);
+    assert(PageAdr>0 && PageAdr <= df_NumPages+df_PagePerBlock);
     if (pread(flash_fd, buffer, DF_PAGE_SIZE, (PageAdr-1)*DF_PAGE_SIZE) != DF_PAGE_SIZE) {
         printf("Failed flash read");
     }
@@ -60,7 +60,7 @@ void AP_Logger_SITL::PageToBuffer(uint32_t PageAdr)
 
 void AP_Logger_SITL::BufferToPage(uint32_t PageAdr)
 {
-    assert(PageAdr>0 && PageAdr <= df_NumPages+1);
+    assert(PageAdr>0 && PageAdr <= df_NumPages+df_PagePerBlock);
     if (pwrite(flash_fd, buffer, DF_PAGE_SIZE, (PageAdr-1)*DF_PAGE_SIZE) != DF_PAGE_SIZE) {
         printf("Failed flash write");
     }
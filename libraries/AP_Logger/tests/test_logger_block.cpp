@@ -0,0 +1,288 @@
+#include <AP_gtest.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#include <AP_Logger/AP_Logger.h>
+#include <AP_Logger/AP_Logger_Block.h>
+#include <AP_RTC/AP_RTC.h>
+#include <AP_SerialManager/AP_SerialManager.h>
+#include <GCS_MAVLink/GCS.h>
+#include <GCS_MAVLink/GCS_Dummy.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+AP_SerialManager _serialmanager;
+GCS_Dummy _gcs;
+AP_RTC _rtc;
+
+const AP_Param::GroupInfo GCS_MAVLINK_Parameters::var_info[] = {
+    AP_GROUPEND
+};
+
+static AP_Int32 log_bitmask;
+static AP_Logger logger{log_bitmask};
+
+// DF_LOGGING_FORMAT in AP_Logger_Block.cpp
+static const uint32_t logging_format = 0x1901201B;
+
+static const uint16_t page_size = 256;
+static const uint16_t pages_per_sector = 16;
+
+/*
+  a flash chip in memory. As on NOR flash, writing a page can only
+  clear bits, so anything written over data that was not erased first
+  is corrupted
+ */
+class AP_Logger_Block_Test : public AP_Logger_Block {
+public:
+    AP_Logger_Block_Test(uint8_t *_flash, uint16_t _blocks, uint16_t _pages_per_block) :
+        AP_Logger_Block(logger, new LoggerMessageWriter_DFLogStart()),
+        flash(_flash),
+        blocks(_blocks),
+        pages_per_block(_pages_per_block) {}
+
+    void Init() override {
+        df_PageSize = page_size;
+        df_PagePerSector = pages_per_sector;
+        df_PagePerBlock = pages_per_block;
+        df_NumPages = blocks * pages_per_block;
+        AP_Logger_Block::Init();
+    }
+    bool CardInserted() const override { return true; }
+
+    // erase the chip and write the logging format, as the IO thread
+    // does after EraseAll()
+    static uint8_t *format(uint16_t blocks, uint16_t pages_per_block) {
+        const uint32_t size = uint32_t(blocks) * pages_per_block * page_size;
+        uint8_t *flash = new uint8_t[size];
+        memset(flash, 0xff, size);
+        uint8_t *version_page = &flash[size - pages_per_block * page_size];
+        memset(version_page, 0, page_size);
+        memcpy(version_page, &logging_format, sizeof(logging_format));
+        return flash;
+    }
+
+    // write a log of npages pages as the IO thread would. Without stop
+    // the log is left open, as at a power off
+    void write_log(uint16_t npages, bool stop=true) {
+        start_new_log();
+        const uint16_t page_data = df_PageSize - sizeof(PageHeader);
+        uint8_t data[page_size];
+        memset(data, df_Write_FileNumber, sizeof(data));
+        for (uint16_t i=0; i<npages; i++) {
+            writebuf.write(data, page_data - writebuf.available());
+            write_log_page();
+        }
+        if (stop) {
+            stop_logging();
+        }
+    }
+
+    bool index_is_valid() const { return index_valid; }
+    uint16_t index_entries() const { return index_count; }
+    void set_index_valid(bool valid) { index_valid = valid; }
+
+    struct log_info {
+        uint32_t start_page;
+        uint32_t end_page;
+        uint32_t size;
+    };
+
+    /*
+      list the logs as for a LOG_REQUEST_LIST followed by the start
+      of a download of each log, returning the number of page reads
+     */
+    uint32_t list_logs(log_info *logs, uint16_t max_logs, uint16_t &num_logs) {
+        const uint32_t reads = page_reads;
+        num_logs = get_num_logs();
+        for (uint16_t i=0; i<num_logs && i<max_logs; i++) {
+            uint32_t time_utc;
+            get_log_info(i+1, logs[i].size, time_utc);
+            get_log_boundaries(i+1, logs[i].start_page, logs[i].end_page);
+        }
+        return page_reads - reads;
+    }
+
+    uint32_t page_reads;
+
+private:
+    void BufferToPage(uint32_t PageAdr) override {
+        uint8_t *page = &flash[(PageAdr-1) * page_size];
+        for (uint16_t i=0; i<page_size; i++) {
+            page[i] &= buffer[i];
+        }
+    }
+    void PageToBuffer(uint32_t PageAdr) override {
+        memcpy(buffer, &flash[(PageAdr-1) * page_size], page_size);
+        page_reads++;
+    }
+    void SectorErase(uint32_t BlockAdr) override {
+        memset(&flash[BlockAdr * pages_per_block * page_size], 0xff, pages_per_block * page_size);
+    }
+    void Sector4kErase(uint32_t SectorAdr) override {
+        memset(&flash[SectorAdr * pages_per_sector * page_size], 0xff, pages_per_sector * page_size);
+    }
+    void StartErase() override {
+        memset(flash, 0xff, uint32_t(blocks) * pages_per_block * page_size);
+    }
+    bool InErase() override { return false; }
+
+    uint8_t *flash;
+    uint16_t blocks;
+    uint16_t pages_per_block;
+};
+
+static AP_Logger_Block_Test *boot(uint8_t *flash, uint16_t blocks, uint16_t pages_per_block=256)
+{
+    AP_Logger_Block_Test *backend = new AP_Logger_Block_Test(flash, blocks, pages_per_block);
+    backend->Init();
+    backend->Prep();
+    return backend;
+}
+
+static const uint16_t max_logs = 1000;
+static AP_Logger_Block_Test::log_info indexed_logs[max_logs];
+static AP_Logger_Block_Test::log_info scanned_logs[max_logs];
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// list the logs with the index and by searching the chip, which must agree
+static void check_listing(AP_Logger_Block_Test &backend, uint16_t expected_logs, bool print=false)
+{
+    ASSERT_TRUE(backend.index_is_valid());
+
+    uint16_t num_indexed, num_scanned;
+    uint64_t t0 = now_us();
+    const uint32_t indexed_reads = backend.list_logs(indexed_logs, max_logs, num_indexed);
+    const uint64_t indexed_us = now_us() - t0;
+
+    backend.set_index_valid(false);
+    t0 = now_us();
+    const uint32_t scanned_reads = backend.list_logs(scanned_logs, max_logs, num_scanned);
+    const uint64_t scanned_us = now_us() - t0;
+    backend.set_index_valid(true);
+
+    EXPECT_EQ(expected_logs, num_indexed);
+    ASSERT_EQ(num_scanned, num_indexed);
+    for (uint16_t i=0; i<num_indexed && i<max_logs; i++) {
+        EXPECT_EQ(scanned_logs[i].start_page, indexed_logs[i].start_page) << "list entry " << i+1;
+        EXPECT_EQ(scanned_logs[i].end_page, indexed_logs[i].end_page) << "list entry " << i+1;
+        EXPECT_EQ(scanned_logs[i].size, indexed_logs[i].size) << "list entry " << i+1;
+    }
+
+    if (print) {
+        printf("listing %u logs: %u page reads %uus with the index, %u page reads %uus searching\n",
+               unsigned(num_indexed),
+               unsigned(indexed_reads), unsigned(indexed_us),
+               unsigned(scanned_reads), unsigned(scanned_us));
+    }
+    if (num_indexed > 10) {
+        EXPECT_LT(indexed_reads * 10, scanned_reads);
+    }
+}
+
+TEST(AP_Logger_Block, list_many_logs)
+{
+    const uint16_t blocks = 64;
+    uint8_t *flash = AP_Logger_Block_Test::format(blocks, 256);
+
+    AP_Logger_Block_Test *backend = boot(flash, blocks);
+    check_listing(*backend, 0);
+
+    for (uint16_t i=0; i<500; i++) {
+        backend->write_log(2 + i % 29);
+    }
+    EXPECT_EQ(500, backend->index_entries());
+    check_listing(*backend, 500, true);
+
+    // the index is kept over a reboot
+    backend = boot(flash, blocks);
+    EXPECT_EQ(500, backend->index_entries());
+    check_listing(*backend, 500);
+
+    delete[] flash;
+}
+
+TEST(AP_Logger_Block, wrapped_chip)
+{
+    const uint16_t blocks = 8;
+    uint8_t *flash = AP_Logger_Block_Test::format(blocks, 256);
+
+    AP_Logger_Block_Test *backend = boot(flash, blocks);
+    for (uint16_t i=0; i<400; i++) {
+        backend->write_log(3 + i % 17);
+        if (i % 50 == 49) {
+            check_listing(*backend, backend->get_num_logs());
+        }
+    }
+
+    // a log being written is listed up to its last page
+    backend->write_log(5, false);
+    check_listing(*backend, backend->get_num_logs());
+
+    delete[] flash;
+}
+
+TEST(AP_Logger_Block, recovery)
+{
+    const uint16_t blocks = 16;
+    uint8_t *flash = AP_Logger_Block_Test::format(blocks, 256);
+
+    // power off while logging
+    AP_Logger_Block_Test *backend = boot(flash, blocks);
+    for (uint16_t i=0; i<20; i++) {
+        backend->write_log(4);
+    }
+    backend->write_log(7, false);
+    backend = boot(flash, blocks);
+    EXPECT_EQ(21, backend->index_entries());
+    check_listing(*backend, 21);
+
+    // logs written by a firmware without the index
+    backend->set_index_valid(false);
+    for (uint16_t i=0; i<5; i++) {
+        backend->write_log(6);
+    }
+    backend = boot(flash, blocks);
+    EXPECT_EQ(26, backend->index_entries());
+    check_listing(*backend, 26);
+
+    // no index on the chip
+    const uint32_t index_page = (blocks - 1) * 256 + pages_per_sector;
+    memset(&flash[index_page * page_size], 0xff, page_size);
+    backend = boot(flash, blocks);
+    EXPECT_EQ(26, backend->index_entries());
+    check_listing(*backend, 26);
+
+    delete[] flash;
+}
+
+TEST(AP_Logger_Block, index_full)
+{
+    // small blocks leave room in the index for fewer logs than the
+    // 500 log numbers that can be listed
+    const uint16_t blocks = 16;
+    const uint16_t pages_per_block = 32;
+    uint8_t *flash = AP_Logger_Block_Test::format(blocks, pages_per_block);
+
+    AP_Logger_Block_Test *backend = boot(flash, blocks, pages_per_block);
+    while (backend->index_is_valid()) {
+        backend->write_log(2);
+    }
+
+    // the index is rebuilt with the logs still on the chip
+    const uint16_t num_logs = backend->get_num_logs();
+    backend = boot(flash, blocks, pages_per_block);
+    EXPECT_EQ(num_logs, backend->index_entries());
+    check_listing(*backend, num_logs);
+
+    delete[] flash;
+}
+
+AP_GTEST_MAIN()
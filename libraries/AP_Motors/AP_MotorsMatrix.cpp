@@ -129,44 +129,102 @@ uint16_t AP_MotorsMatrix::get_motor_mask()
 // includes new scaling stability patch
 void AP_MotorsMatrix::output_armed_stabilizing()
 {
-    uint8_t i;                          // general purpose counter
-    float   roll_thrust;                // roll thrust input value, +/- 1.0
-    float   pitch_thrust;               // pitch thrust input value, +/- 1.0
-    float   yaw_thrust;                 // yaw thrust input value, +/- 1.0
-    float   throttle_thrust;            // throttle thrust input value, 0.0 - 1.0
-    float   throttle_avg_max;           // throttle thrust average maximum value, 0.0 - 1.0
-    float   throttle_thrust_max;        // throttle thrust maximum value, 0.0 - 1.0
-    float   throttle_thrust_best_rpy;   // throttle providing maximum roll, pitch and yaw range without climbing
-    float   rpy_scale = 1.0f;           // this is used to scale the roll, pitch and yaw to fit within the motor limits
-    float   yaw_allowed = 1.0f;         // amount of yaw we can fit in
-    float   thr_adj;                    // the difference between the pilot's desired throttle and throttle_thrust_best_rpy
+    if (_mixer == nullptr) {
+        setup_mixer();
+    }
+    (this->*_mixer)();
+}
 
+// get compensated and limited inputs to the mixer
+void AP_MotorsMatrix::get_mixer_input(mixer_input &in)
+{
     // apply voltage and air pressure compensation
-    const float compensation_gain = get_compensation_gain(); // compensation for battery voltage and altitude
-    roll_thrust = (_roll_in + _roll_in_ff) * compensation_gain;
-    pitch_thrust = (_pitch_in + _pitch_in_ff) * compensation_gain;
-    yaw_thrust = (_yaw_in + _yaw_in_ff) * compensation_gain;
-    throttle_thrust = get_throttle() * compensation_gain;
-    throttle_avg_max = _throttle_avg_max * compensation_gain;
+    in.compensation_gain = get_compensation_gain(); // compensation for battery voltage and altitude
+    in.roll_thrust = (_roll_in + _roll_in_ff) * in.compensation_gain;
+    in.pitch_thrust = (_pitch_in + _pitch_in_ff) * in.compensation_gain;
+    in.yaw_thrust = (_yaw_in + _yaw_in_ff) * in.compensation_gain;
+    in.throttle_thrust = get_throttle() * in.compensation_gain;
+    in.throttle_avg_max = _throttle_avg_max * in.compensation_gain;
 
     // If thrust boost is active then do not limit maximum thrust
-    throttle_thrust_max = _thrust_boost_ratio + (1.0f - _thrust_boost_ratio) * _throttle_thrust_max * compensation_gain;
+    const float throttle_thrust_max = _thrust_boost_ratio + (1.0f - _thrust_boost_ratio) * _throttle_thrust_max * in.compensation_gain;
 
     // sanity check throttle is above zero and below current limited throttle
-    if (throttle_thrust <= 0.0f) {
-        throttle_thrust = 0.0f;
+    if (in.throttle_thrust <= 0.0f) {
+        in.throttle_thrust = 0.0f;
         limit.throttle_lower = true;
     }
-    if (throttle_thrust >= throttle_thrust_max) {
-        throttle_thrust = throttle_thrust_max;
+    if (in.throttle_thrust >= throttle_thrust_max) {
+        in.throttle_thrust = throttle_thrust_max;
         limit.throttle_upper = true;
     }
 
     // ensure that throttle_avg_max is between the input throttle and the maximum throttle
-    throttle_avg_max = constrain_float(throttle_avg_max, throttle_thrust, throttle_thrust_max);
+    in.throttle_avg_max = constrain_float(in.throttle_avg_max, in.throttle_thrust, throttle_thrust_max);
 
     // calculate the highest allowed average thrust that will provide maximum control range
-    throttle_thrust_best_rpy = MIN(0.5f, throttle_avg_max);
+    in.throttle_thrust_best_rpy = MIN(0.5f, in.throttle_avg_max);
+
+    // calculate the maximum yaw control that can be used
+    // todo: make _yaw_headroom 0 to 1
+    const float yaw_allowed_min = (float)_yaw_headroom / 1000.0f;
+
+    // increase yaw headroom to 50% if thrust boost enabled
+    in.yaw_allowed_min = _thrust_boost_ratio * 0.5f + (1.0f - _thrust_boost_ratio) * yaw_allowed_min;
+}
+
+// calculate any scaling needed to make the combined thrust outputs fit
+// within the output range, and how close the motors can come to the
+// desired throttle. Returns the throttle to add to the scaled roll,
+// pitch and yaw of each motor
+float AP_MotorsMatrix::fit_thrust_range(const mixer_input &in, float rpy_low, float rpy_high, float &rpy_scale)
+{
+    rpy_scale = 1.0f;
+    if (rpy_high - rpy_low > 1.0f) {
+        rpy_scale = 1.0f / (rpy_high - rpy_low);
+    }
+    if (in.throttle_avg_max + rpy_low < 0) {
+        rpy_scale = MIN(rpy_scale, -in.throttle_avg_max / rpy_low);
+    }
+
+    // calculate how close the motors can come to the desired throttle
+    rpy_high *= rpy_scale;
+    rpy_low *= rpy_scale;
+    const float throttle_thrust_best_rpy = -rpy_low;
+    float thr_adj = in.throttle_thrust - throttle_thrust_best_rpy;
+    if (rpy_scale < 1.0f) {
+        // Full range is being used by roll, pitch, and yaw.
+        limit.roll = true;
+        limit.pitch = true;
+        limit.yaw = true;
+        if (thr_adj > 0.0f) {
+            limit.throttle_upper = true;
+        }
+        thr_adj = 0.0f;
+    } else {
+        if (thr_adj < 0.0f) {
+            // Throttle can't be reduced to desired value
+            // todo: add lower limit flag and ensure it is handled correctly in altitude controller
+            thr_adj = 0.0f;
+        } else if (thr_adj > 1.0f - (throttle_thrust_best_rpy + rpy_high)) {
+            // Throttle can't be increased to desired value
+            thr_adj = 1.0f - (throttle_thrust_best_rpy + rpy_high);
+            limit.throttle_upper = true;
+        }
+    }
+
+    return throttle_thrust_best_rpy + thr_adj;
+}
+
+// mixer for any motor layout
+void AP_MotorsMatrix::output_armed_stabilizing_generic()
+{
+    uint8_t i;                          // general purpose counter
+    float   yaw_allowed = 1.0f;         // amount of yaw we can fit in
+
+    mixer_input in;
+    get_mixer_input(in);
+    float yaw_thrust = in.yaw_thrust;
 
     // calculate throttle that gives most possible room for yaw which is the lower of:
     //      1. 0.5f - (rpy_low+rpy_high)/2.0 - this would give the maximum possible margin above the highest motor and below the lowest
@@ -191,57 +249,35 @@ void AP_MotorsMatrix::output_armed_stabilizing()
 
     // calculate amount of yaw we can fit into the throttle range
     // this is always equal to or less than the requested yaw from the pilot or rate controller
-    float rp_low = 1.0f;    // lowest thrust value
-    float rp_high = -1.0f;  // highest thrust value
     for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
         if (motor_enabled[i]) {
             // calculate the thrust outputs for roll and pitch
-            _thrust_rpyt_out[i] = roll_thrust * _roll_factor[i] + pitch_thrust * _pitch_factor[i];
-            // record lowest roll + pitch command
-            if (_thrust_rpyt_out[i] < rp_low) {
-                rp_low = _thrust_rpyt_out[i];
-            }
-            // record highest roll + pitch command
-            if (_thrust_rpyt_out[i] > rp_high && (!_thrust_boost || i != _motor_lost_index)) {
-                rp_high = _thrust_rpyt_out[i];
-            }
+            _thrust_rpyt_out[i] = in.roll_thrust * _roll_factor[i] + in.pitch_thrust * _pitch_factor[i];
 
             // Check the maximum yaw control that can be used on this channel
             // Exclude any lost motors if thrust boost is enabled
             if (!is_zero(_yaw_factor[i]) && (!_thrust_boost || i != _motor_lost_index)){
                 if (is_positive(yaw_thrust * _yaw_factor[i])) {
-                    yaw_allowed = MIN(yaw_allowed, fabsf(MAX(1.0f - (throttle_thrust_best_rpy + _thrust_rpyt_out[i]), 0.0f)/_yaw_factor[i]));
+                    yaw_allowed = MIN(yaw_allowed, fabsf(MAX(1.0f - (in.throttle_thrust_best_rpy + _thrust_rpyt_out[i]), 0.0f)/_yaw_factor[i]));
                 } else {
-                    yaw_allowed = MIN(yaw_allowed, fabsf(MAX(throttle_thrust_best_rpy + _thrust_rpyt_out[i], 0.0f)/_yaw_factor[i]));
+                    yaw_allowed = MIN(yaw_allowed, fabsf(MAX(in.throttle_thrust_best_rpy + _thrust_rpyt_out[i], 0.0f)/_yaw_factor[i]));
                 }
             }
         }
     }
 
-    // calculate the maximum yaw control that can be used
-    // todo: make _yaw_headroom 0 to 1
-    float yaw_allowed_min = (float)_yaw_headroom / 1000.0f;
-
-    // increase yaw headroom to 50% if thrust boost enabled
-    yaw_allowed_min = _thrust_boost_ratio * 0.5f + (1.0f - _thrust_boost_ratio) * yaw_allowed_min;
-
     // Let yaw access minimum amount of head room
-    yaw_allowed = MAX(yaw_allowed, yaw_allowed_min);
+    yaw_allowed = MAX(yaw_allowed, in.yaw_allowed_min);
 
     // Include the lost motor scaled by _thrust_boost_ratio to smoothly transition this motor in and out of the calculation
     if (_thrust_boost && motor_enabled[_motor_lost_index]) {
-        // record highest roll + pitch command
-        if (_thrust_rpyt_out[_motor_lost_index] > rp_high) {
-            rp_high = _thrust_boost_ratio * rp_high + (1.0f - _thrust_boost_ratio) * _thrust_rpyt_out[_motor_lost_index];
-        }
-
         // Check the maximum yaw control that can be used on this channel
         // Exclude any lost motors if thrust boost is enabled
         if (!is_zero(_yaw_factor[_motor_lost_index])){
             if (is_positive(yaw_thrust * _yaw_factor[_motor_lost_index])) {
-                yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(1.0f - (throttle_thrust_best_rpy + _thrust_rpyt_out[_motor_lost_index]), 0.0f)/_yaw_factor[_motor_lost_index]));
+                yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(1.0f - (in.throttle_thrust_best_rpy + _thrust_rpyt_out[_motor_lost_index]), 0.0f)/_yaw_factor[_motor_lost_index]));
             } else {
-                yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(throttle_thrust_best_rpy + _thrust_rpyt_out[_motor_lost_index], 0.0f)/_yaw_factor[_motor_lost_index]));
+                yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(in.throttle_thrust_best_rpy + _thrust_rpyt_out[_motor_lost_index], 0.0f)/_yaw_factor[_motor_lost_index]));
             }
         }
     }
@@ -278,54 +314,157 @@ void AP_MotorsMatrix::output_armed_stabilizing()
         }
     }
 
-    // calculate any scaling needed to make the combined thrust outputs fit within the output range
-    if (rpy_high - rpy_low > 1.0f) {
-        rpy_scale = 1.0f / (rpy_high - rpy_low);
+    float rpy_scale;
+    const float throttle_thrust_best_plus_adj = fit_thrust_range(in, rpy_low, rpy_high, rpy_scale);
+
+    // add scaled roll, pitch, constrained yaw and throttle for each motor
+    for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
+        if (motor_enabled[i]) {
+            _thrust_rpyt_out[i] = throttle_thrust_best_plus_adj + (rpy_scale * _thrust_rpyt_out[i]);
+        }
     }
-    if (throttle_avg_max + rpy_low < 0) {
-        rpy_scale = MIN(rpy_scale, -throttle_avg_max / rpy_low);
+
+    // determine throttle thrust for harmonic notch
+    // compensation_gain can never be zero
+    _throttle_out = throttle_thrust_best_plus_adj / in.compensation_gain;
+
+    // check for failed motor
+    check_for_failed_motor(throttle_thrust_best_plus_adj);
+}
+
+/*
+  mixer for exactly N motors. This gives the same outputs as
+  output_armed_stabilizing_generic(), but loops over the packed mixing
+  matrix of the enabled motors and fuses the output and motor failure
+  passes
+ */
+template <uint8_t N>
+void AP_MotorsMatrix::output_armed_stabilizing_fixed()
+{
+    float yaw_allowed = 1.0f;           // amount of yaw we can fit in
+    float rpy_out[N];                   // roll, pitch and yaw thrust of each motor
+
+    mixer_input in;
+    get_mixer_input(in);
+    float yaw_thrust = in.yaw_thrust;
+
+    // row of the lost motor, which is excluded from the limits while
+    // thrust boost is active
+    const uint8_t lost = _thrust_boost ? _mix.row[_motor_lost_index] : UINT8_MAX;
+
+    // calculate amount of yaw we can fit into the throttle range
+    for (uint8_t i = 0; i < N; i++) {
+        rpy_out[i] = in.roll_thrust * _mix.roll[i] + in.pitch_thrust * _mix.pitch[i];
+        if (!is_zero(_mix.yaw[i]) && i != lost) {
+            if (is_positive(yaw_thrust * _mix.yaw[i])) {
+                yaw_allowed = MIN(yaw_allowed, fabsf(MAX(1.0f - (in.throttle_thrust_best_rpy + rpy_out[i]), 0.0f)/_mix.yaw[i]));
+            } else {
+                yaw_allowed = MIN(yaw_allowed, fabsf(MAX(in.throttle_thrust_best_rpy + rpy_out[i], 0.0f)/_mix.yaw[i]));
+            }
+        }
     }
 
-    // calculate how close the motors can come to the desired throttle
-    rpy_high *= rpy_scale;
-    rpy_low *= rpy_scale;
-    throttle_thrust_best_rpy = -rpy_low;
-    thr_adj = throttle_thrust - throttle_thrust_best_rpy;
-    if (rpy_scale < 1.0f) {
-        // Full range is being used by roll, pitch, and yaw.
-        limit.roll = true;
-        limit.pitch = true;
+    // Let yaw access minimum amount of head room
+    yaw_allowed = MAX(yaw_allowed, in.yaw_allowed_min);
+
+    // Include the lost motor scaled by _thrust_boost_ratio
+    if (lost != UINT8_MAX && !is_zero(_mix.yaw[lost])) {
+        if (is_positive(yaw_thrust * _mix.yaw[lost])) {
+            yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(1.0f - (in.throttle_thrust_best_rpy + rpy_out[lost]), 0.0f)/_mix.yaw[lost]));
+        } else {
+            yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(in.throttle_thrust_best_rpy + rpy_out[lost], 0.0f)/_mix.yaw[lost]));
+        }
+    }
+
+    if (fabsf(yaw_thrust) > yaw_allowed) {
+        // not all commanded yaw can be used
+        yaw_thrust = constrain_float(yaw_thrust, -yaw_allowed, yaw_allowed);
         limit.yaw = true;
-        if (thr_adj > 0.0f) {
-            limit.throttle_upper = true;
+    }
+
+    // add yaw control to thrust outputs
+    float rpy_low = 1.0f;   // lowest thrust value
+    float rpy_high = -1.0f; // highest thrust value
+    for (uint8_t i = 0; i < N; i++) {
+        rpy_out[i] = rpy_out[i] + yaw_thrust * _mix.yaw[i];
+        if (rpy_out[i] < rpy_low) {
+            rpy_low = rpy_out[i];
         }
-        thr_adj = 0.0f;
-    } else {
-        if (thr_adj < 0.0f) {
-            // Throttle can't be reduced to desired value
-            // todo: add lower limit flag and ensure it is handled correctly in altitude controller
-            thr_adj = 0.0f;
-        } else if (thr_adj > 1.0f - (throttle_thrust_best_rpy + rpy_high)) {
-            // Throttle can't be increased to desired value
-            thr_adj = 1.0f - (throttle_thrust_best_rpy + rpy_high);
-            limit.throttle_upper = true;
+        if (rpy_out[i] > rpy_high && i != lost) {
+            rpy_high = rpy_out[i];
         }
     }
+    if (lost != UINT8_MAX && rpy_out[lost] > rpy_high) {
+        rpy_high = _thrust_boost_ratio * rpy_high + (1.0f - _thrust_boost_ratio) * rpy_out[lost];
+    }
 
-    // add scaled roll, pitch, constrained yaw and throttle for each motor
-    for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            _thrust_rpyt_out[i] = throttle_thrust_best_rpy + thr_adj + (rpy_scale * _thrust_rpyt_out[i]);
+    float rpy_scale;
+    const float throttle_thrust_best_plus_adj = fit_thrust_range(in, rpy_low, rpy_high, rpy_scale);
+
+    // add scaled roll, pitch, constrained yaw and throttle for each
+    // motor, and record filtered thrust outputs for motor loss monitoring
+    const float alpha = 1.0f / (1.0f + _loop_rate * 0.5f);
+    float rpyt_high = 0.0f;
+    float rpyt_sum = 0.0f;
+    for (uint8_t i = 0; i < N; i++) {
+        const uint8_t m = _mix.motor[i];
+        _thrust_rpyt_out[m] = throttle_thrust_best_plus_adj + (rpy_scale * rpy_out[i]);
+        _thrust_rpyt_out_filt[m] += alpha * (_thrust_rpyt_out[m] - _thrust_rpyt_out_filt[m]);
+        rpyt_sum += _thrust_rpyt_out_filt[m];
+        if (_thrust_rpyt_out_filt[m] > rpyt_high) {
+            rpyt_high = _thrust_rpyt_out_filt[m];
+            // hold motor lost index constant while thrust boost is active
+            if (!_thrust_boost) {
+                _motor_lost_index = m;
+            }
         }
     }
 
     // determine throttle thrust for harmonic notch
-    const float throttle_thrust_best_plus_adj = throttle_thrust_best_rpy + thr_adj;
     // compensation_gain can never be zero
-    _throttle_out = throttle_thrust_best_plus_adj / compensation_gain;
+    _throttle_out = throttle_thrust_best_plus_adj / in.compensation_gain;
 
-    // check for failed motor
-    check_for_failed_motor(throttle_thrust_best_plus_adj);
+    update_thrust_balance(rpyt_high, rpyt_sum, N, throttle_thrust_best_plus_adj);
+}
+
+// pack the mixing matrix and select the mixer for the number of motors
+void AP_MotorsMatrix::setup_mixer()
+{
+    _mix.num_motors = 0;
+    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
+        _mix.row[i] = UINT8_MAX;
+        if (motor_enabled[i]) {
+            const uint8_t row = _mix.num_motors++;
+            _mix.motor[row] = i;
+            _mix.row[i] = row;
+            _mix.roll[row] = _roll_factor[i];
+            _mix.pitch[row] = _pitch_factor[i];
+            _mix.yaw[row] = _yaw_factor[i];
+        }
+    }
+
+    switch (_mix.num_motors) {
+#if AP_MOTORS_MATRIX_FIXED_MIXERS
+    case 4:
+        _mixer = &AP_MotorsMatrix::output_armed_stabilizing_fixed<4>;
+        break;
+    case 6:
+        _mixer = &AP_MotorsMatrix::output_armed_stabilizing_fixed<6>;
+        break;
+    case 8:
+        _mixer = &AP_MotorsMatrix::output_armed_stabilizing_fixed<8>;
+        break;
+    case 10:
+        _mixer = &AP_MotorsMatrix::output_armed_stabilizing_fixed<10>;
+        break;
+    case 12:
+        _mixer = &AP_MotorsMatrix::output_armed_stabilizing_fixed<12>;
+        break;
+#endif
+    default:
+        _mixer = &AP_MotorsMatrix::output_armed_stabilizing_generic;
+        break;
+    }
 }
 
 // check for failed motor
@@ -364,6 +503,13 @@ void AP_MotorsMatrix::check_for_failed_motor(float throttle_thrust_best_plus_adj
         }
     }
 
+    update_thrust_balance(rpyt_high, rpyt_sum, number_motors, throttle_thrust_best_plus_adj);
+}
+
+// sets thrust_balanced to true if motors are balanced, false if a motor failure is detected
+// and stops thrust boost once it is no longer needed
+void AP_MotorsMatrix::update_thrust_balance(float rpyt_high, float rpyt_sum, uint8_t number_motors, float throttle_thrust_best_plus_adj)
+{
     float thrust_balance = 1.0f;
     if (rpyt_sum > 0.1f) {
         thrust_balance = rpyt_high * number_motors / rpyt_sum;
@@ -445,6 +591,9 @@ void AP_MotorsMatrix::add_motor_raw(int8_t motor_num, float roll_fac, float pitc
         // set order that motor appears in test
         _test_order[motor_num] = testing_order;
 
+        // mixing matrix needs to be set up again
+        _mixer = nullptr;
+
         // call parent class method
         add_motor_num(motor_num);
     }
@@ -477,6 +626,7 @@ void AP_MotorsMatrix::remove_motor(int8_t motor_num)
         _roll_factor[motor_num] = 0;
         _pitch_factor[motor_num] = 0;
         _yaw_factor[motor_num] = 0;
+        _mixer = nullptr;
     }
 }
 
@@ -955,6 +1105,7 @@ void AP_MotorsMatrix::normalise_rpy_factors()
             }
         }
     }
+    _mixer = nullptr;
 }
 
 
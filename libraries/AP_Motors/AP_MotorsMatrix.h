@@ -10,6 +10,11 @@
 #define AP_MOTORS_MATRIX_YAW_FACTOR_CW   -1
 #define AP_MOTORS_MATRIX_YAW_FACTOR_CCW   1
 
+// use mixers specialised for the number of motors, at the cost of flash
+#ifndef AP_MOTORS_MATRIX_FIXED_MIXERS
+#define AP_MOTORS_MATRIX_FIXED_MIXERS !HAL_MINIMIZE_FEATURES
+#endif
+
 /// @class      AP_MotorsMatrix
 class AP_MotorsMatrix : public AP_MotorsMulticopter {
 public:
@@ -59,9 +64,39 @@ protected:
     // output - sends commands to the motors
     void                output_armed_stabilizing() override;
 
+    // mixer for any motor layout, working on all motor slots
+    void                output_armed_stabilizing_generic();
+
+    // mixer for exactly N motors, working on the packed mixing matrix
+    template <uint8_t N>
+    void                output_armed_stabilizing_fixed();
+
+    // compensated and limited inputs to the mixer
+    struct mixer_input {
+        float roll_thrust;              // roll thrust input value, +/- 1.0
+        float pitch_thrust;             // pitch thrust input value, +/- 1.0
+        float yaw_thrust;               // yaw thrust input value, +/- 1.0
+        float throttle_thrust;          // throttle thrust input value, 0.0 - 1.0
+        float throttle_avg_max;         // throttle thrust average maximum value, 0.0 - 1.0
+        float throttle_thrust_best_rpy; // throttle providing maximum roll, pitch and yaw range without climbing
+        float yaw_allowed_min;          // yaw headroom always allowed
+        float compensation_gain;        // compensation for battery voltage and altitude
+    };
+    void                get_mixer_input(mixer_input &in);
+
+    // find the scaling of roll, pitch and yaw and the throttle which fit the
+    // thrust outputs within the motor range, returning the throttle
+    float               fit_thrust_range(const mixer_input &in, float rpy_low, float rpy_high, float &rpy_scale);
+
+    // select the mixer and pack the mixing matrix for the enabled motors
+    void                setup_mixer();
+
     // check for failed motor
     void                check_for_failed_motor(float throttle_thrust_best);
 
+    // update thrust balance and boost from the filtered thrust outputs
+    void                update_thrust_balance(float rpyt_high, float rpyt_sum, uint8_t number_motors, float throttle_thrust_best_plus_adj);
+
     // add_motor using raw roll, pitch, throttle and yaw factors
     void                add_motor_raw(int8_t motor_num, float roll_fac, float pitch_fac, float yaw_fac, uint8_t testing_order);
 
@@ -94,4 +129,16 @@ protected:
     // motor failure handling
     float               _thrust_rpyt_out_filt[AP_MOTORS_MAX_NUM_MOTORS];    // filtered thrust outputs with 1 second time constant
     uint8_t             _motor_lost_index;  // index number of the lost motor
+
+    // mixing matrix of the enabled motors in motor number order, set
+    // up by setup_mixer() when the motors change
+    void                (AP_MotorsMatrix::*_mixer)() = nullptr;
+    struct {
+        uint8_t         num_motors;
+        uint8_t         motor[AP_MOTORS_MAX_NUM_MOTORS];    // motor number of each row
+        uint8_t         row[AP_MOTORS_MAX_NUM_MOTORS];      // row of each motor number, 255 if disabled
+        float           roll[AP_MOTORS_MAX_NUM_MOTORS];
+        float           pitch[AP_MOTORS_MAX_NUM_MOTORS];
+        float           yaw[AP_MOTORS_MAX_NUM_MOTORS];
+    } _mix;
 };
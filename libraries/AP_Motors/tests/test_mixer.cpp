@@ -0,0 +1,230 @@
+#include <AP_gtest.h>
+
+#include <AP_Motors/AP_Motors.h>
+#include <SRV_Channel/SRV_Channel.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+static SRV_Channels srvs;
+
+class AP_MotorsMatrix_Test : public AP_MotorsMatrix {
+public:
+    using AP_MotorsMatrix::AP_MotorsMatrix;
+
+    // everything the mixer changes
+    struct state {
+        float thrust_rpyt_out[AP_MOTORS_MAX_NUM_MOTORS];
+        float thrust_rpyt_out_filt[AP_MOTORS_MAX_NUM_MOTORS];
+        float throttle_out;
+        uint8_t motor_lost_index;
+        bool thrust_boost;
+        bool thrust_balanced;
+        AP_Motors_limit limit;
+    };
+
+    void get_state(state &s) const {
+        memcpy(s.thrust_rpyt_out, _thrust_rpyt_out, sizeof(s.thrust_rpyt_out));
+        memcpy(s.thrust_rpyt_out_filt, _thrust_rpyt_out_filt, sizeof(s.thrust_rpyt_out_filt));
+        s.throttle_out = _throttle_out;
+        s.motor_lost_index = _motor_lost_index;
+        s.thrust_boost = _thrust_boost;
+        s.thrust_balanced = _thrust_balanced;
+        s.limit = limit;
+    }
+
+    void set_state(const state &s) {
+        memcpy(_thrust_rpyt_out, s.thrust_rpyt_out, sizeof(_thrust_rpyt_out));
+        memcpy(_thrust_rpyt_out_filt, s.thrust_rpyt_out_filt, sizeof(_thrust_rpyt_out_filt));
+        _throttle_out = s.throttle_out;
+        _motor_lost_index = s.motor_lost_index;
+        _thrust_boost = s.thrust_boost;
+        _thrust_balanced = s.thrust_balanced;
+        limit = s.limit;
+    }
+
+    void set_throttle_filtered(float throttle) { _throttle_filter.reset(throttle); }
+    void set_throttle_thrust_max(float thrust_max) { _throttle_thrust_max = thrust_max; }
+    void set_thrust_boost_ratio(float ratio) { _thrust_boost_ratio = ratio; }
+    void set_yaw_headroom(int16_t headroom) { _yaw_headroom.set(headroom); }
+
+    void mix_generic() { output_armed_stabilizing_generic(); }
+    void mix() { output_armed_stabilizing(); }
+};
+
+static AP_MotorsMatrix_Test motors(400);
+
+static float random_float(float min, float max)
+{
+    return min + (max - min) * (random() / (float)RAND_MAX);
+}
+
+static void random_state(AP_MotorsMatrix_Test::state &s)
+{
+    for (uint8_t i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++) {
+        s.thrust_rpyt_out[i] = random_float(0, 1);
+        s.thrust_rpyt_out_filt[i] = random_float(0, 1);
+    }
+    s.throttle_out = 0;
+    s.motor_lost_index = random() % AP_MOTORS_MAX_NUM_MOTORS;
+    s.thrust_boost = random() % 2;
+    s.thrust_balanced = random() % 2;
+    memset(&s.limit, 0, sizeof(s.limit));
+}
+
+static void expect_equal(const AP_MotorsMatrix_Test::state &a, const AP_MotorsMatrix_Test::state &b)
+{
+    for (uint8_t i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++) {
+        EXPECT_FLOAT_EQ(a.thrust_rpyt_out[i], b.thrust_rpyt_out[i]) << "motor " << unsigned(i);
+        EXPECT_FLOAT_EQ(a.thrust_rpyt_out_filt[i], b.thrust_rpyt_out_filt[i]) << "motor " << unsigned(i);
+    }
+    EXPECT_FLOAT_EQ(a.throttle_out, b.throttle_out);
+    EXPECT_EQ(a.motor_lost_index, b.motor_lost_index);
+    EXPECT_EQ(a.thrust_boost, b.thrust_boost);
+    EXPECT_EQ(a.thrust_balanced, b.thrust_balanced);
+    EXPECT_EQ(0, memcmp(&a.limit, &b.limit, sizeof(a.limit)));
+}
+
+/*
+  the mixer selected for each frame gives the same outputs as the
+  generic mixer, including saturated inputs and motor loss handling
+ */
+TEST(AP_MotorsMatrix, mixer_equivalence)
+{
+    srandom(1);
+    uint8_t frames = 0;
+    for (uint8_t frame_class=AP_Motors::MOTOR_FRAME_QUAD; frame_class<=AP_Motors::MOTOR_FRAME_DECA; frame_class++) {
+        for (uint8_t frame_type=AP_Motors::MOTOR_FRAME_TYPE_PLUS; frame_type<=AP_Motors::MOTOR_FRAME_TYPE_BF_X_REV; frame_type++) {
+            motors.init(AP_Motors::motor_frame_class(frame_class), AP_Motors::motor_frame_type(frame_type));
+            if (!motors.initialised_ok()) {
+                continue;
+            }
+            frames++;
+            for (uint16_t n=0; n<2000; n++) {
+                motors.set_roll(random_float(-1.2f, 1.2f));
+                motors.set_pitch(random_float(-1.2f, 1.2f));
+                motors.set_yaw(random_float(-1.2f, 1.2f));
+                motors.set_roll_ff(random_float(-0.1f, 0.1f));
+                motors.set_pitch_ff(random_float(-0.1f, 0.1f));
+                motors.set_yaw_ff(random_float(-0.1f, 0.1f));
+                motors.set_throttle_filtered(random_float(-0.1f, 1.1f));
+                motors.set_throttle_avg_max(random_float(0, 1));
+                motors.set_throttle_thrust_max(random_float(0.5f, 1));
+                motors.set_thrust_boost_ratio(random_float(0, 1));
+                motors.set_yaw_headroom(random() % 2 ? 0 : 200);
+
+                AP_MotorsMatrix_Test::state initial, generic, fixed;
+                random_state(initial);
+
+                motors.set_state(initial);
+                motors.mix_generic();
+                motors.get_state(generic);
+
+                motors.set_state(initial);
+                motors.mix();
+                motors.get_state(fixed);
+
+                expect_equal(generic, fixed);
+            }
+        }
+    }
+    EXPECT_GT(frames, 20);
+}
+
+/*
+  outputs of output_armed_stabilizing() from before it was specialised
+  for the number of motors, so both mixers are checked against more
+  than each other. The filtered thrust of the third motor starts high,
+  as if it had failed
+ */
+static const struct {
+    AP_Motors::motor_frame_class frame_class;
+    AP_Motors::motor_frame_type frame_type;
+    float roll, pitch, yaw;
+    float throttle, throttle_avg_max;
+    bool thrust_boost;
+    // expected outputs
+    float thrust_rpyt_out[AP_MOTORS_MAX_NUM_MOTORS];
+    float throttle_out;
+    uint8_t motor_lost_index;
+    bool thrust_balanced;
+    AP_Motors::AP_Motors_limit limit;
+} golden_cases[] {
+    { AP_Motors::MOTOR_FRAME_QUAD, AP_Motors::MOTOR_FRAME_TYPE_X, 0.1f, -0.05f, 0.02f, 0.5f, 0.6f, false,
+      { 0.4219500f, 0.5674500f, 0.4995500f, 0.4510500f },
+      0.5f, 2, true, { 0, 0, 0, 0, 0 } },
+    // saturated
+    { AP_Motors::MOTOR_FRAME_QUAD, AP_Motors::MOTOR_FRAME_TYPE_X, 1.0f, 0.8f, -0.9f, 0.9f, 1.0f, false,
+      { 0.3298969f, 0.4410080f, 1.0f, 0.0f },
+      0.4564188f, 2, true, { 1, 1, 1, 0, 1 } },
+    { AP_Motors::MOTOR_FRAME_HEXA, AP_Motors::MOTOR_FRAME_TYPE_X, 0.2f, 0.2f, 0.8f, 0.3f, 0.5f, false,
+      { 0.0f, 0.97f, 0.2425f, 0.7275f, 0.9215f, 0.0485f },
+      0.5f, 2, false, { 0, 0, 0, 0, 0 } },
+    { AP_Motors::MOTOR_FRAME_OCTA, AP_Motors::MOTOR_FRAME_TYPE_PLUS, -0.3f, 0.1f, 0.1f, 0.02f, 0.3f, false,
+      { 0.194f, 0.097f, 0.3796787f, 0.3110894f, 0.1739106f, 0.1053213f, 0.0f, 0.291f },
+      0.2f, 2, false, { 0, 0, 0, 0, 0 } },
+    { AP_Motors::MOTOR_FRAME_Y6, AP_Motors::MOTOR_FRAME_TYPE_Y6B, 0.15f, -0.25f, 0.35f, 0.6f, 0.7f, false,
+      { 0.278875f, 0.618375f, 0.5335f, 0.873f, 0.424375f, 0.763875f },
+      0.6f, 2, false, { 0, 0, 0, 0, 0 } },
+    // saturated, with thrust boost
+    { AP_Motors::MOTOR_FRAME_OCTAQUAD, AP_Motors::MOTOR_FRAME_TYPE_X, -0.5f, 0.6f, -0.2f, 0.8f, 0.9f, true,
+      { 0.8461539f, 0.6153846f, 0.0f, 0.5384616f, 0.4615385f, 1.0f, 0.3846154f, 0.1538461f },
+      0.5154639f, 0, false, { 1, 1, 1, 0, 1 } },
+    { AP_Motors::MOTOR_FRAME_DECA, AP_Motors::MOTOR_FRAME_TYPE_X, 0.4f, -0.2f, 0.3f, 0.7f, 0.8f, true,
+      { 0.6261521f, 0.2752028f, 0.5891014f, 0.3951014f, 0.8201520f, 0.6490507f, 1.0f, 0.6861014f, 0.8801014f, 0.4550506f },
+      0.6573210f, 0, false, { 0, 0, 0, 0, 1 } },
+    { AP_Motors::MOTOR_FRAME_DODECAHEXA, AP_Motors::MOTOR_FRAME_TYPE_X, 0.05f, 0.05f, -0.5f, 0.4f, 0.5f, false,
+      { 0.157625f, 0.642625f, 0.60625f, 0.12125f, 0.109125f, 0.594125f, 0.618375f, 0.133375f, 0.16975f, 0.65475f, 0.666875f, 0.181875f },
+      0.4f, 2, false, { 0, 0, 0, 0, 0 } },
+};
+
+/*
+  both the mixer selected for each frame and the generic mixer give
+  the outputs of the mixer they replaced
+ */
+TEST(AP_MotorsMatrix, mixer_golden)
+{
+    for (const auto &g : golden_cases) {
+        motors.init(g.frame_class, g.frame_type);
+        ASSERT_TRUE(motors.initialised_ok());
+        motors.set_roll(g.roll);
+        motors.set_pitch(g.pitch);
+        motors.set_yaw(g.yaw);
+        motors.set_roll_ff(0);
+        motors.set_pitch_ff(0);
+        motors.set_yaw_ff(0);
+        motors.set_throttle_filtered(g.throttle);
+        motors.set_throttle_avg_max(g.throttle_avg_max);
+        motors.set_throttle_thrust_max(1);
+        motors.set_thrust_boost_ratio(0);
+        motors.set_yaw_headroom(200);
+
+        AP_MotorsMatrix_Test::state initial {};
+        for (uint8_t i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++) {
+            initial.thrust_rpyt_out_filt[i] = 0.5f;
+        }
+        initial.thrust_rpyt_out_filt[2] = 0.9f;
+        initial.thrust_boost = g.thrust_boost;
+        initial.thrust_balanced = true;
+
+        for (uint8_t generic=0; generic<2; generic++) {
+            motors.set_state(initial);
+            if (generic) {
+                motors.mix_generic();
+            } else {
+                motors.mix();
+            }
+            AP_MotorsMatrix_Test::state out;
+            motors.get_state(out);
+
+            for (uint8_t i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++) {
+                EXPECT_NEAR(g.thrust_rpyt_out[i], out.thrust_rpyt_out[i], 1.0e-5f) << "frame " << unsigned(g.frame_class) << " motor " << unsigned(i);
+            }
+            EXPECT_NEAR(g.throttle_out, out.throttle_out, 1.0e-5f) << "frame " << unsigned(g.frame_class);
+            EXPECT_EQ(g.motor_lost_index, out.motor_lost_index) << "frame " << unsigned(g.frame_class);
+            EXPECT_EQ(g.thrust_balanced, out.thrust_balanced) << "frame " << unsigned(g.frame_class);
+            EXPECT_EQ(0, memcmp(&g.limit, &out.limit, sizeof(g.limit))) << "frame " << unsigned(g.frame_class);
+        }
+    }
+}
+
+AP_GTEST_MAIN()
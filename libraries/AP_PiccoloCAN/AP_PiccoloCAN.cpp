@@ -32,6 +32,7 @@
 #include <SRV_Channel/SRV_Channel.h>
 #include <GCS_MAVLink/GCS.h>
 #include <AP_Logger/AP_Logger.h>
+#include <AP_ESC_Telem/AP_ESC_Telem.h>
 
 #include <stdio.h>
 
@@ -481,9 +482,14 @@ bool AP_PiccoloCAN::handle_esc_message(AP_HAL::CANFrame &frame)
     ESC_LegacyErrorBits_t legacyErrors;
 
     // Throw the packet against each decoding routine
+    // the types decoded from this frame for AP_ESC_Telem
+    uint16_t telem_mask = 0;
+
     if (decodeESC_StatusAPacket(&frame, &esc.mode, &esc.status, &esc.setpoint, &esc.rpm)) {
         esc.newTelemetry = true;
+        telem_mask = AP_ESC_Telem::RPM;
     } else if (decodeESC_LegacyStatusAPacket(&frame, &esc.mode, &legacyStatus, &legacyWarnings, &legacyErrors, &esc.setpoint, &esc.rpm)) {
+        telem_mask = AP_ESC_Telem::RPM;
         // The status / warning / error bits need to be converted to modern values
         // Note: Not *all* of the modern status bits are available in the Gen-1 packet
         esc.status.hwInhibit = legacyStatus.hwInhibit;
@@ -508,6 +514,8 @@ bool AP_PiccoloCAN::handle_esc_message(AP_HAL::CANFrame &frame)
         // There are no common error bits between the Gen-1 and Gen-2 ICD
     } else if (decodeESC_StatusBPacket(&frame, &esc.voltage, &esc.current, &esc.dutyCycle, &esc.escTemperature, &esc.motorTemperature)) {
         esc.newTelemetry = true;
+        telem_mask = AP_ESC_Telem::VOLTAGE | AP_ESC_Telem::CURRENT |
+            AP_ESC_Telem::TEMPERATURE | AP_ESC_Telem::MOTOR_TEMPERATURE;
     } else if (decodeESC_StatusCPacket(&frame, &esc.fetTemperature, &esc.pwmFrequency, &esc.timingAdvance)) {
         esc.newTelemetry = true;
     } else if (decodeESC_WarningErrorStatusPacket(&frame, &esc.warnings, &esc.errors)) {
@@ -527,6 +535,17 @@ bool AP_PiccoloCAN::handle_esc_message(AP_HAL::CANFrame &frame)
         esc.last_rx_msg_timestamp = timestamp;
     }
 
+    AP_ESC_Telem *esc_telem = AP_ESC_Telem::get_singleton();
+    if (telem_mask != 0 && esc_telem != nullptr) {
+        AP_ESC_Telem::TelemetryData t {};
+        t.rpm = esc.rpm;
+        t.voltage = esc.voltage * 0.01f;
+        t.current = esc.current * 0.01f;
+        t.temperature_cdeg = int16_t(esc.escTemperature * 100);
+        t.motor_temp_cdeg = int16_t(esc.motorTemperature * 100);
+        esc_telem->update_telem_data(addr, t, telem_mask);
+    }
+
     return result;
 }
 
@@ -63,8 +63,16 @@ AP_RCProtocol::~AP_RCProtocol()
     }
 }
 
-void AP_RCProtocol::process_pulse(uint32_t width_s0, uint32_t width_s1)
+/*
+  process pairs of pulse widths. The time and enabled protocols are
+  only looked up once for all of them
+ */
+void AP_RCProtocol::process_pulses(const uint32_t *widths, uint16_t n)
 {
+    if (n & 1) {
+        return;
+    }
+
     uint32_t now = AP_HAL::millis();
     bool searching = (now - _last_input_ms >= 200);
 
@@ -83,7 +91,7 @@ void AP_RCProtocol::process_pulse(uint32_t width_s0, uint32_t width_s1)
     }
     // first try current protocol
     if (_detected_protocol != AP_RCProtocol::NONE && !searching) {
-        backend[_detected_protocol]->process_pulse(width_s0, width_s1);
+        backend[_detected_protocol]->process_pulses(widths, n);
         if (backend[_detected_protocol]->new_input()) {
             _new_input = true;
             _last_input_ms = now;
@@ -103,7 +111,7 @@ void AP_RCProtocol::process_pulse(uint32_t width_s0, uint32_t width_s1)
             }
             const uint32_t frame_count = backend[i]->get_rc_frame_count();
             const uint32_t input_count = backend[i]->get_rc_input_count();
-            backend[i]->process_pulse(width_s0, width_s1);
+            backend[i]->process_pulses(widths, n);
             const uint32_t frame_count2 = backend[i]->get_rc_frame_count();
             if (frame_count2 > frame_count) {
                 if (requires_3_frames((rcprotocol_t)i) && frame_count2 < 3) {
@@ -132,23 +140,38 @@ void AP_RCProtocol::process_pulse_list(const uint32_t *widths, uint16_t n, bool
     if (n & 1) {
         return;
     }
+    // convert to pairs of widths in chunks
+    uint32_t pulses[32];
     while (n) {
-        uint32_t widths0 = widths[0];
-        uint32_t widths1 = widths[1];
-        if (need_swap) {
-            uint32_t tmp = widths1;
-            widths1 = widths0;
-            widths0 = tmp;
+        const uint16_t count = MIN(n, ARRAY_SIZE(pulses));
+        for (uint16_t i = 0; i < count; i += 2) {
+            uint32_t widths0 = widths[i];
+            uint32_t widths1 = widths[i+1];
+            if (need_swap) {
+                uint32_t tmp = widths1;
+                widths1 = widths0;
+                widths0 = tmp;
+            }
+            pulses[i] = widths0;
+            pulses[i+1] = widths1 - widths0;
         }
-        widths1 -= widths0;
-        process_pulse(widths0, widths1);
-        widths += 2;
-        n -= 2;
+        process_pulses(pulses, count);
+        widths += count;
+        n -= count;
     }
 }
 
-bool AP_RCProtocol::process_byte(uint8_t byte, uint32_t baudrate)
+/*
+  process bytes received together. The time and enabled protocols are
+  only looked up once for all of them, and each backend gets them all
+  in one call
+ */
+bool AP_RCProtocol::process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate)
 {
+    if (n == 0) {
+        return false;
+    }
+
     uint32_t now = AP_HAL::millis();
     bool searching = (now - _last_input_ms >= 200);
 
@@ -167,7 +190,7 @@ bool AP_RCProtocol::process_byte(uint8_t byte, uint32_t baudrate)
     }
     // first try current protocol
     if (_detected_protocol != AP_RCProtocol::NONE && !searching) {
-        backend[_detected_protocol]->process_byte(byte, baudrate);
+        backend[_detected_protocol]->process_bytes(bytes, n, baudrate);
         if (backend[_detected_protocol]->new_input()) {
             _new_input = true;
             _last_input_ms = now;
@@ -183,7 +206,7 @@ bool AP_RCProtocol::process_byte(uint8_t byte, uint32_t baudrate)
             }
             const uint32_t frame_count = backend[i]->get_rc_frame_count();
             const uint32_t input_count = backend[i]->get_rc_input_count();
-            backend[i]->process_byte(byte, baudrate);
+            backend[i]->process_bytes(bytes, n, baudrate);
             const uint32_t frame_count2 = backend[i]->get_rc_frame_count();
             if (frame_count2 > frame_count) {
                 if (requires_3_frames((rcprotocol_t)i) && frame_count2 < 3) {
@@ -257,13 +280,16 @@ void AP_RCProtocol::check_added_uart(void)
         added.uart->begin(added.baudrate, 128, 128);
         added.last_baud_change_ms = AP_HAL::millis();
     }
+    uint8_t b[32];
     uint32_t n = added.uart->available();
     n = MIN(n, 255U);
-    for (uint8_t i=0; i<n; i++) {
-        int16_t b = added.uart->read();
-        if (b >= 0) {
-            process_byte(uint8_t(b), added.baudrate);
+    while (n > 0) {
+        const ssize_t nread = added.uart->read(b, MIN(n, sizeof(b)));
+        if (nread <= 0) {
+            break;
         }
+        process_bytes(b, nread, added.baudrate);
+        n -= nread;
     }
     if (!_detected_with_bytes) {
         if (now - added.last_baud_change_ms > 1000) {
@@ -49,9 +49,18 @@ public:
     {
         return _valid_serial_prot;
     }
-    void process_pulse(uint32_t width_s0, uint32_t width_s1);
+    void process_pulse(uint32_t width_s0, uint32_t width_s1) {
+        const uint32_t widths[2] { width_s0, width_s1 };
+        process_pulses(widths, 2);
+    }
+    // process n/2 pairs of high and low widths. n must be even
+    void process_pulses(const uint32_t *widths, uint16_t n);
     void process_pulse_list(const uint32_t *widths, uint16_t n, bool need_swap);
-    bool process_byte(uint8_t byte, uint32_t baudrate);
+    bool process_byte(uint8_t byte, uint32_t baudrate) {
+        return process_bytes(&byte, 1, baudrate);
+    }
+    // process n bytes received together
+    bool process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate);
     void update(void);
 
     void disable_for_pulses(enum rcprotocol_t protocol) {
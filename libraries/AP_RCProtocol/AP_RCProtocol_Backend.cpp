@@ -37,6 +37,20 @@ bool AP_RCProtocol_Backend::new_input()
     return ret;
 }
 
+void AP_RCProtocol_Backend::process_pulses(const uint32_t *widths, uint16_t n)
+{
+    for (uint16_t i = 0; i + 1 < n; i += 2) {
+        process_pulse(widths[i], widths[i+1]);
+    }
+}
+
+void AP_RCProtocol_Backend::process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate)
+{
+    for (uint16_t i = 0; i < n; i++) {
+        process_byte(bytes[i], baudrate);
+    }
+}
+
 uint8_t AP_RCProtocol_Backend::num_channels()
 {
     return _num_channels;
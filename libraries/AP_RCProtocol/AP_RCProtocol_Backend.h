@@ -28,6 +28,11 @@ public:
     virtual ~AP_RCProtocol_Backend() {}
     virtual void process_pulse(uint32_t width_s0, uint32_t width_s1) {}
     virtual void process_byte(uint8_t byte, uint32_t baudrate) {}
+    // process n/2 pairs of high and low widths
+    virtual void process_pulses(const uint32_t *widths, uint16_t n);
+    // process bytes received together. Backends can override this to
+    // scan a whole buffer for the next frame boundary
+    virtual void process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate);
     uint16_t read(uint8_t chan);
     void read(uint16_t *pwm, uint8_t n);
     bool new_input();
@@ -380,6 +380,42 @@ void AP_RCProtocol_CRSF::process_byte(uint8_t byte, uint32_t baudrate)
     _process_byte(AP_HAL::micros(), byte);
 }
 
+void AP_RCProtocol_CRSF::process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate)
+{
+    // reject RC data if we have been configured for standalone mode
+    if (baudrate != CRSF_BAUDRATE || _uart) {
+        return;
+    }
+    _process_bytes(AP_HAL::micros(), bytes, n);
+}
+
+/*
+  process bytes received together. Once the length of a frame is known
+  all but its last byte are copied in one go, the last byte goes through
+  _process_byte() to decode the frame
+ */
+void AP_RCProtocol_CRSF::_process_bytes(uint32_t timestamp_us, const uint8_t *bytes, uint16_t n)
+{
+    while (n > 0) {
+        if (_frame_ofs >= CSRF_HEADER_LEN &&
+            (timestamp_us - _start_frame_time_us) <= CRSF_MAX_FRAME_TIME_US) {
+            const uint8_t frame_end = MIN(_frame.length + CSRF_HEADER_LEN - 1U, CRSF_FRAMELEN_MAX);
+            if (_frame_ofs < frame_end) {
+                const uint8_t len = MIN(n, frame_end - _frame_ofs);
+                memcpy(((uint8_t*)&_frame) + _frame_ofs, bytes, len);
+                _frame_ofs += len;
+                _last_rx_time_us = timestamp_us;
+                bytes += len;
+                n -= len;
+                continue;
+            }
+        }
+        _process_byte(timestamp_us, bytes[0]);
+        bytes++;
+        n--;
+    }
+}
+
 // start the uart if we have one
 void AP_RCProtocol_CRSF::start_uart()
 {
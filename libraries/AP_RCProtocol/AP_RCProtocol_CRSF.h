@@ -31,6 +31,7 @@ public:
     AP_RCProtocol_CRSF(AP_RCProtocol &_frontend);
     virtual ~AP_RCProtocol_CRSF();
     void process_byte(uint8_t byte, uint32_t baudrate) override;
+    void process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate) override;
     void process_pulse(uint32_t width_s0, uint32_t width_s1) override;
     void update(void) override;
     // get singleton instance
@@ -171,6 +172,7 @@ private:
     static AP_RCProtocol_CRSF* _singleton;
 
     void _process_byte(uint32_t timestamp_us, uint8_t byte);
+    void _process_bytes(uint32_t timestamp_us, const uint8_t *bytes, uint16_t n);
     bool decode_csrf_packet();
     bool process_telemetry(bool check_constraint = true);
     void process_link_stats_frame(const void* data);
@@ -530,3 +530,15 @@ void AP_RCProtocol_DSM::process_byte(uint8_t b, uint32_t baudrate)
     }
     _process_byte(AP_HAL::millis(), b);
 }
+
+// support byte input, with one timestamp for all of the bytes
+void AP_RCProtocol_DSM::process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate)
+{
+    if (baudrate != 115200) {
+        return;
+    }
+    const uint32_t timestamp_ms = AP_HAL::millis();
+    for (uint16_t i = 0; i < n; i++) {
+        _process_byte(timestamp_ms, bytes[i]);
+    }
+}
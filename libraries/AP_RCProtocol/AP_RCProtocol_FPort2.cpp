@@ -294,3 +294,15 @@ void AP_RCProtocol_FPort2::process_byte(uint8_t b, uint32_t baudrate)
     }
     _process_byte(AP_HAL::micros(), b);
 }
+
+// support byte input, with one timestamp for all of the bytes
+void AP_RCProtocol_FPort2::process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate)
+{
+    if (baudrate != 115200) {
+        return;
+    }
+    const uint32_t timestamp_us = AP_HAL::micros();
+    for (uint16_t i = 0; i < n; i++) {
+        _process_byte(timestamp_us, bytes[i]);
+    }
+}
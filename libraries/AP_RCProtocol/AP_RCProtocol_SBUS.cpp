@@ -52,6 +52,7 @@
  */
 
 #include "AP_RCProtocol_SBUS.h"
+#include <AP_Math/AP_Math.h>
 
 #define SBUS_FRAME_SIZE		25
 #define SBUS_INPUT_CHANNELS	16
@@ -212,3 +213,35 @@ void AP_RCProtocol_SBUS::process_byte(uint8_t b, uint32_t baudrate)
     }
     _process_byte(AP_HAL::micros(), b);
 }
+
+/*
+  support byte input of several bytes at once. All of the bytes get
+  the same timestamp, so only the first can follow a frame gap. After
+  that we only need to copy the rest of a frame that has been started
+ */
+void AP_RCProtocol_SBUS::process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate)
+{
+    if (baudrate != 100000 || n == 0) {
+        return;
+    }
+    const uint32_t timestamp_us = AP_HAL::micros();
+    _process_byte(timestamp_us, bytes[0]);
+    bytes++;
+    n--;
+
+    while (n > 0 && byte_input.ofs > 0) {
+        // copy all but the last byte of the frame, which decodes it
+        const uint8_t len = MIN(n, sizeof(byte_input.buf) - 1U - byte_input.ofs);
+        memcpy(&byte_input.buf[byte_input.ofs], bytes, len);
+        byte_input.ofs += len;
+        bytes += len;
+        n -= len;
+        if (n > 0) {
+            _process_byte(timestamp_us, bytes[0]);
+            bytes++;
+            n--;
+        }
+    }
+    // any remaining bytes have no frame gap before them so can't
+    // start a frame
+}
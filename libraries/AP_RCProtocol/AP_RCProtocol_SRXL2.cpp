@@ -231,6 +231,41 @@ void AP_RCProtocol_SRXL2::process_byte(uint8_t byte, uint32_t baudrate)
     _process_byte(AP_HAL::micros(), byte);
 }
 
+/*
+  process bytes received together. Between frames we search for the
+  next header byte, and once the length of a frame is known all but its
+  last byte are copied in one go
+ */
+void AP_RCProtocol_SRXL2::process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate)
+{
+    if (baudrate != 115200) {
+        return;
+    }
+    const uint32_t timestamp_us = AP_HAL::micros();
+    while (n > 0) {
+        if (_decode_state == STATE_IDLE) {
+            const uint8_t *start = (const uint8_t *)memchr(bytes, SPEKTRUM_SRXL_ID, n);
+            if (start == nullptr) {
+                return;
+            }
+            n -= start - bytes;
+            bytes = start;
+        } else if (_decode_state == STATE_COLLECT &&
+                   _buflen >= SRXL2_HEADER_LEN &&
+                   _buflen + 1U < _frame_len_full) {
+            const uint8_t len = MIN(n, _frame_len_full - 1U - _buflen);
+            memcpy(&_buffer[_buflen], bytes, len);
+            _buflen += len;
+            bytes += len;
+            n -= len;
+            continue;
+        }
+        _process_byte(timestamp_us, bytes[0]);
+        bytes++;
+        n--;
+    }
+}
+
 // send data to the uart
 void AP_RCProtocol_SRXL2::send_on_uart(uint8_t* pBuffer, uint8_t length)
 {
@@ -233,3 +233,14 @@ void AP_RCProtocol_ST24::process_byte(uint8_t byte, uint32_t baudrate)
     }
     _process_byte(byte);
 }
+
+// support byte input
+void AP_RCProtocol_ST24::process_bytes(const uint8_t *bytes, uint16_t n, uint32_t baudrate)
+{
+    if (baudrate != 115200) {
+        return;
+    }
+    for (uint16_t i = 0; i < n; i++) {
+        _process_byte(bytes[i]);
+    }
+}
@@ -0,0 +1,124 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_RCProtocol/AP_RCProtocol.h>
+
+#include <unistd.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+// SUMD frame captured from a receiver, from the RCProtocolTest example
+static const uint8_t sumd_bytes[] = {0xA8, 0x01, 0x08, 0x2F, 0x50, 0x31, 0xE8, 0x21, 0xA0,
+                                     0x2F, 0x50, 0x22, 0x60, 0x22, 0x60, 0x2E, 0xE0, 0x2E,
+                                     0xE0, 0x87, 0xC6};
+
+// CRSF RC channels frame with all channels at 1500
+static const uint8_t crsf_bytes[] = {0xC8, 0x18, 0x16,
+                                     0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C,
+                                     0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C,
+                                     0xAD};
+
+/*
+  frames back to back, as read from a UART that has not been polled for
+  a while. There is a gap before each burst so that parsers that lost
+  sync when the benchmark was preempted can find the start of a frame
+ */
+static const uint16_t stream_frames = 32;
+static const uint32_t burst_gap_us = 6000;
+
+struct SUMD {
+    static const uint32_t baudrate = 115200;
+    static const uint8_t *frame() { return sumd_bytes; }
+    static const uint8_t frame_len = sizeof(sumd_bytes);
+};
+
+struct CRSF {
+    static const uint32_t baudrate = 416666;
+    static const uint8_t *frame() { return crsf_bytes; }
+    static const uint8_t frame_len = sizeof(crsf_bytes);
+};
+
+/*
+  give a stream of frames to the frontend in spans of range_x() bytes,
+  or one byte at a time with process_byte() when range_x() is 1
+ */
+static void feed(AP_RCProtocol &rcprot, const uint8_t *stream, uint16_t len, uint32_t baudrate, uint16_t span)
+{
+    if (span == 1) {
+        for (uint16_t i=0; i<len; i++) {
+            rcprot.process_byte(stream[i], baudrate);
+        }
+        return;
+    }
+    for (uint16_t ofs=0; ofs<len; ofs += span) {
+        rcprot.process_bytes(&stream[ofs], MIN(span, len - ofs), baudrate);
+    }
+}
+
+// decode a detected protocol
+template <class Protocol>
+static void BM_RCProtocolDecode(benchmark::State& state)
+{
+    const uint16_t len = stream_frames * Protocol::frame_len;
+    uint8_t *stream = new uint8_t[len];
+    for (uint16_t i=0; i<stream_frames; i++) {
+        memcpy(&stream[i * Protocol::frame_len], Protocol::frame(), Protocol::frame_len);
+    }
+
+    AP_RCProtocol *rcprot = new AP_RCProtocol();
+    rcprot->init();
+    // detect the protocol before timing
+    for (uint8_t i=0; i<4; i++) {
+        feed(*rcprot, stream, len, Protocol::baudrate, 1);
+    }
+
+    uint32_t decoded = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        usleep(burst_gap_us);
+        state.ResumeTiming();
+        feed(*rcprot, stream, len, Protocol::baudrate, state.range_x());
+        if (rcprot->new_input()) {
+            decoded++;
+        }
+    }
+
+    state.SetBytesProcessed(int64_t(state.iterations()) * len);
+    char label[48];
+    snprintf(label, sizeof(label), "%s %u/%u decoded", rcprot->protocol_name(),
+             unsigned(decoded), unsigned(state.iterations()));
+    state.SetLabel(label);
+
+    delete rcprot;
+    delete[] stream;
+}
+
+/*
+  bytes that none of the protocols accept, so all of the backends see
+  every byte while the frontend searches
+ */
+static void BM_RCProtocolSearch(benchmark::State& state)
+{
+    uint8_t stream[1024];
+    for (uint16_t i=0; i<sizeof(stream); i++) {
+        stream[i] = uint8_t(i * 37);
+    }
+
+    AP_RCProtocol *rcprot = new AP_RCProtocol();
+    rcprot->init();
+
+    while (state.KeepRunning()) {
+        feed(*rcprot, stream, sizeof(stream), 115200, state.range_x());
+    }
+
+    state.SetBytesProcessed(int64_t(state.iterations()) * sizeof(stream));
+    state.SetLabel(rcprot->protocol_name() ? rcprot->protocol_name() : "none");
+
+    delete rcprot;
+}
+
+BENCHMARK_TEMPLATE(BM_RCProtocolDecode, SUMD)->Arg(1)->Arg(16)->Arg(64)->MinTime(0.05);
+BENCHMARK_TEMPLATE(BM_RCProtocolDecode, CRSF)->Arg(1)->Arg(16)->Arg(64)->MinTime(0.05);
+BENCHMARK(BM_RCProtocolSearch)->Arg(1)->Arg(16)->Arg(64);
+
+BENCHMARK_MAIN()
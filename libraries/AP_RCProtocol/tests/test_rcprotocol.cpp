@@ -0,0 +1,264 @@
+#include <AP_gtest.h>
+
+#include <AP_RCProtocol/AP_RCProtocol.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/crc.h>
+#include <unistd.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  frames captured from receivers, from the RCProtocolTest example
+ */
+static const uint8_t srxl_bytes[] = { 0xa5, 0x03, 0x0c, 0x04, 0x2f, 0x6c, 0x10, 0xb4, 0x26,
+                                      0x16, 0x34, 0x01, 0x04, 0x76, 0x1c, 0x40, 0xf5, 0x3b };
+static const uint16_t srxl_output[] = { 1567, 1502, 1019, 1536, 1804, 2000, 1500 };
+
+static const uint8_t sbus_bytes[] = {0x0F, 0x4C, 0x1C, 0x5F, 0x32, 0x34, 0x38, 0xDD, 0x89,
+                                     0x83, 0x0F, 0x7C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+static const uint16_t sbus_output[] = {1562, 1496, 1000, 1531, 1806, 2006, 1495, 1495, 875,
+                                       875, 875, 875, 875, 875, 875, 875};
+
+static const uint8_t dsm_bytes[] = {0x00, 0xab, 0x00, 0xae, 0x08, 0xbf, 0x10, 0xd0, 0x18,
+                                   0xe1, 0x20, 0xf2, 0x29, 0x03, 0x31, 0x14, 0x00, 0xab,
+                                   0x39, 0x25, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+                                   0xff, 0xff, 0xff, 0xff, 0xff};
+static const uint16_t dsm_output[] = {1010, 1020, 1000, 1030, 1040, 1050, 1060, 1070};
+
+// DSMX_2048_11MS
+static const uint8_t dsm_bytes2[] = {0x00, 0xb2, 0x80, 0x94, 0x3c, 0x02, 0x1b, 0xfe,
+                                     0x44, 0x00, 0x4c, 0x00, 0x5c, 0x00, 0xff, 0xff,
+                                     0x00, 0xb2, 0x0c, 0x03, 0x2e, 0xaa, 0x14, 0x00,
+                                     0x21, 0x56, 0x34, 0x02, 0x54, 0x00, 0xff, 0xff };
+static const uint16_t dsm_output2[] = {1501, 1500, 985, 1499, 1099, 1901, 1501, 1501, 1500, 1500, 1500, 1500};
+
+static const uint8_t sumd_bytes[] = {0xA8, 0x01, 0x08, 0x2F, 0x50, 0x31, 0xE8, 0x21, 0xA0,
+                                     0x2F, 0x50, 0x22, 0x60, 0x22, 0x60, 0x2E, 0xE0, 0x2E,
+                                     0xE0, 0x87, 0xC6};
+static const uint16_t sumd_output[] = {1597, 1076, 1514, 1514, 1100, 1100, 1500, 1500};
+
+static const uint8_t ibus_bytes[] = {0x20, 0x40, 0xdc, 0x05, 0xdc, 0x05, 0xe8, 0x03, 0xdc, 0x05, 0xdc, 0x05,
+                                     0xdc, 0x05, 0xdc, 0x05, 0xdc, 0x05, 0xdc, 0x05, 0xdc, 0x05, 0xdc, 0x05,
+                                     0xdc, 0x05, 0xdc, 0x05, 0xdc, 0x05, 0x47, 0xf3};
+static const uint16_t ibus_output[] = {1500, 1500, 1000, 1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500};
+
+static const uint8_t fport_bytes[] = {0x7e, 0x19, 0x00, 0xe7, 0x3b, 0xdf, 0x5a, 0xce,
+                                      0x07, 0x10, 0x75, 0x49, 0x9c, 0x15, 0xe0, 0x03,
+                                      0x1f, 0xf8, 0xc0, 0x07, 0x3e, 0xf0, 0x81, 0x0f,
+                                      0x7c, 0x00, 0x38, 0xfa, 0x7e};
+static const uint16_t fport_output[] = {1499, 1499, 1101, 1499, 1035, 1341, 2006, 982, 1495, 1495, 1495, 1495, 1495, 1495, 1495, 1495};
+
+static const uint8_t fport2_16ch_bytes[] = {0x18, 0xff,
+                                            0xac, 0x00, 0x5f, 0xf8, 0xc0, 0x07, 0x3e, 0xf0, 0x81, 0x0f, 0x7c,
+                                            0xe0, 0x03, 0x1f, 0xf8, 0xc0, 0x07, 0x3e, 0xf0, 0x81, 0x0f, 0x7c,
+                                            0x00, 0x5e, 0x98};
+static const uint16_t fport2_16ch_output[] = {982, 1495, 1495, 1495, 1495, 1495, 1495, 1495, 1495, 1495, 1495, 1495, 1495, 1495, 1495, 1495};
+
+// CRSF RC channels frame, filled in by make_crsf_frame()
+static uint8_t crsf_bytes[26];
+static uint16_t crsf_output[16];
+
+struct Capture {
+    const char *protocol;
+    uint32_t baudrate;
+    const uint8_t *bytes;
+    uint8_t nbytes;
+    const uint16_t *values;
+    uint8_t nvalues;
+    uint8_t repeats;
+    uint8_t pause_at;
+};
+
+static const Capture captures[] {
+    { "SRXL", 115200, srxl_bytes, sizeof(srxl_bytes), srxl_output, ARRAY_SIZE(srxl_output), 1, 0 },
+    { "SUMD", 115200, sumd_bytes, sizeof(sumd_bytes), sumd_output, ARRAY_SIZE(sumd_output), 1, 0 },
+    { "IBUS", 115200, ibus_bytes, sizeof(ibus_bytes), ibus_output, ARRAY_SIZE(ibus_output), 1, 0 },
+    { "SBUS", 100000, sbus_bytes, sizeof(sbus_bytes), sbus_output, ARRAY_SIZE(sbus_output), 3, 0 },
+    { "DSM", 115200, dsm_bytes, sizeof(dsm_bytes), dsm_output, ARRAY_SIZE(dsm_output), 9, 0 },
+    { "DSM", 115200, dsm_bytes2, sizeof(dsm_bytes2), dsm_output2, ARRAY_SIZE(dsm_output2), 9, 16 },
+    { "FPORT", 115200, fport_bytes, sizeof(fport_bytes), fport_output, ARRAY_SIZE(fport_output), 3, 0 },
+    { "FPORT2", 115200, fport2_16ch_bytes, sizeof(fport2_16ch_bytes), fport2_16ch_output, ARRAY_SIZE(fport2_16ch_output), 3, 0 },
+    { "CRSF", 416666, crsf_bytes, sizeof(crsf_bytes), crsf_output, ARRAY_SIZE(crsf_output), 1, 0 },
+};
+
+/*
+  build a CRSF frame of 16 channels of 11 bits each
+ */
+static void make_crsf_frame()
+{
+    crsf_bytes[0] = 0xC8; // flight controller address
+    crsf_bytes[1] = 24;   // type, payload and crc
+    crsf_bytes[2] = 0x16; // RC channels packed
+    memset(&crsf_bytes[3], 0, 22);
+    for (uint8_t i=0; i<16; i++) {
+        // scaled as (x * 5 / 8) + 880
+        crsf_output[i] = 1000 + i*50;
+        const uint16_t v = (crsf_output[i] - 880) * 8 / 5;
+        for (uint8_t b=0; b<11; b++) {
+            if (v & (1U<<b)) {
+                const uint16_t bit = i*11 + b;
+                crsf_bytes[3 + bit/8] |= 1U<<(bit%8);
+            }
+        }
+    }
+    uint8_t crc = 0;
+    for (uint8_t i=2; i<25; i++) {
+        crc = crc8_dvb_s2(crc, crsf_bytes[i]);
+    }
+    crsf_bytes[25] = crc;
+}
+
+static void check_result(AP_RCProtocol &rcprot, const Capture &c)
+{
+    EXPECT_TRUE(rcprot.new_input());
+    EXPECT_STREQ(c.protocol, rcprot.protocol_name());
+    ASSERT_EQ(c.nvalues, rcprot.num_channels());
+    for (uint8_t i=0; i<c.nvalues; i++) {
+        EXPECT_EQ(c.values[i], rcprot.read(i));
+    }
+}
+
+/*
+  feed a capture to the frontend, with a pause between frames and at
+  pause_at. The bytes between pauses are given in spans of at most
+  span_len bytes, or one at a time with process_byte() when span_len
+  is 1
+ */
+static void test_capture(const Capture &c, uint8_t span_len)
+{
+    SCOPED_TRACE(c.protocol);
+    AP_RCProtocol *rcprot = new AP_RCProtocol();
+    rcprot->init();
+
+    for (uint8_t repeat=0; repeat<c.repeats+4; repeat++) {
+        uint8_t ofs = 0;
+        while (ofs < c.nbytes) {
+            if (c.pause_at > 0 && ofs > 0 && (ofs % c.pause_at) == 0) {
+                usleep(10000);
+            }
+            uint8_t n = MIN(c.nbytes - ofs, span_len);
+            if (c.pause_at > 0) {
+                n = MIN(n, c.pause_at - (ofs % c.pause_at));
+            }
+            if (span_len == 1) {
+                rcprot->process_byte(c.bytes[ofs], c.baudrate);
+            } else {
+                rcprot->process_bytes(&c.bytes[ofs], n, c.baudrate);
+            }
+            ofs += n;
+        }
+        usleep(10000);
+        if (repeat > c.repeats) {
+            check_result(*rcprot, c);
+        }
+    }
+    delete rcprot;
+}
+
+TEST(RCProtocol, bytes)
+{
+    make_crsf_frame();
+    for (const Capture &c : captures) {
+        test_capture(c, 1);
+    }
+}
+
+TEST(RCProtocol, spans)
+{
+    make_crsf_frame();
+    for (const Capture &c : captures) {
+        test_capture(c, UINT8_MAX);
+    }
+}
+
+// spans that start and end inside frames
+TEST(RCProtocol, split_spans)
+{
+    make_crsf_frame();
+    for (const Capture &c : captures) {
+        for (uint8_t span_len = 2; span_len < 8; span_len++) {
+            test_capture(c, span_len);
+        }
+    }
+}
+
+/*
+  encode a byte as pairs of pulse widths, for process_pulse_list()
+ */
+class PulseEncoder {
+public:
+    PulseEncoder(uint32_t _baudrate) : baudrate(_baudrate) {}
+
+    void send_byte(uint8_t b) {
+        send_bit(0); // start bit
+        uint8_t parity = 0;
+        for (uint8_t i=0; i<8; i++) {
+            const uint8_t bit = (b & (1U<<i))?1:0;
+            send_bit(bit);
+            parity ^= bit;
+        }
+        send_bit(parity);
+        send_bit(1); // two stop bits
+        send_bit(1);
+    }
+
+    void send_pause(uint32_t pause_us) {
+        const uint32_t nbits = pause_us * baudrate / 1000000U;
+        for (uint32_t i=0; i<nbits; i++) {
+            send_bit(1);
+        }
+    }
+
+    // widths given as the low time and the time to the next low edge
+    uint32_t widths[2048];
+    uint16_t n;
+
+private:
+    void send_bit(uint8_t bit) {
+        if (bit == 0) {
+            if (bits_1 > 0 && n + 2 <= ARRAY_SIZE(widths)) {
+                const uint32_t w0 = (bits_0 * 1000000U) / baudrate;
+                const uint32_t w1 = (bits_1 * 1000000U) / baudrate;
+                widths[n++] = w0;
+                widths[n++] = w0 + w1;
+                bits_0 = 1;
+                bits_1 = 0;
+            } else {
+                bits_0++;
+            }
+        } else {
+            bits_1++;
+        }
+    }
+
+    uint32_t baudrate;
+    uint32_t bits_0;
+    uint32_t bits_1;
+};
+
+// a list of pulses is given to the backends in chunks
+TEST(RCProtocol, pulse_list)
+{
+    const Capture &c = captures[3];
+    ASSERT_STREQ("SBUS", c.protocol);
+
+    PulseEncoder enc(c.baudrate);
+    for (uint8_t repeat=0; repeat<c.repeats+4; repeat++) {
+        enc.send_pause(6000);
+        for (uint8_t i=0; i<c.nbytes; i++) {
+            enc.send_byte(c.bytes[i]);
+        }
+    }
+    enc.send_pause(6000);
+    enc.send_byte(0);
+    ASSERT_LT(enc.n, ARRAY_SIZE(enc.widths));
+
+    AP_RCProtocol *rcprot = new AP_RCProtocol();
+    rcprot->init();
+    rcprot->process_pulse_list(enc.widths, enc.n, false);
+    check_result(*rcprot, c);
+    delete rcprot;
+}
+
+AP_GTEST_MAIN()
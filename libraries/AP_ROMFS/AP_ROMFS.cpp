@@ -18,6 +18,7 @@
 
 #include "AP_ROMFS.h"
 #include "tinf.h"
+#include <AP_Math/AP_Math.h>
 
 #ifdef HAL_HAVE_AP_ROMFS_EMBEDDED_H
 #include <ap_romfs_embedded.h>
@@ -25,6 +26,11 @@
 const AP_ROMFS::embedded_file AP_ROMFS::files[] = {};
 #endif
 
+uint16_t AP_ROMFS::num_files(void)
+{
+    return ARRAY_SIZE(files);
+}
+
 /*
   find an embedded file
 */
@@ -39,24 +45,18 @@ const uint8_t *AP_ROMFS::find_file(const char *name, uint32_t &size)
     return nullptr;
 }
 
+#ifndef HAL_ROMFS_UNCOMPRESSED
+AP_ROMFS::cache_entry AP_ROMFS::cache[HAL_ROMFS_CACHE_ENTRIES];
+uint32_t AP_ROMFS::cache_counter;
+HAL_Semaphore AP_ROMFS::cache_sem;
+#endif
+
 /*
-  find a compressed file and uncompress it. Space for decompressed
-  data comes from malloc. Caller must be careful to free the resulting
-  data after use. The next byte after the file data is guaranteed to
-  be null
+  decompress a gzip file. Space for decompressed data comes from
+  malloc. The next byte after the file data is guaranteed to be null
 */
-const uint8_t *AP_ROMFS::find_decompress(const char *name, uint32_t &size)
+uint8_t *AP_ROMFS::decompress(const uint8_t *compressed_data, uint32_t compressed_size, uint32_t &size)
 {
-    uint32_t compressed_size = 0;
-    const uint8_t *compressed_data = find_file(name, compressed_size);
-    if (!compressed_data) {
-        return nullptr;
-    }
-
-#ifdef HAL_ROMFS_UNCOMPRESSED
-    size = compressed_size;
-    return compressed_data;
-#else
     // last 4 bytes of gzip file are length of decompressed data
     const uint8_t *p = &compressed_data[compressed_size-4];
     uint32_t decompressed_size = p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24;
@@ -103,6 +103,71 @@ const uint8_t *AP_ROMFS::find_decompress(const char *name, uint32_t &size)
 
     size = decompressed_size;
     return decompressed_data;
+}
+
+/*
+  find a compressed file and uncompress it. Space for decompressed
+  data comes from malloc. Caller must be careful to free the resulting
+  data after use. The next byte after the file data is guaranteed to
+  be null
+*/
+const uint8_t *AP_ROMFS::find_decompress(const char *name, uint32_t &size)
+{
+    uint32_t compressed_size = 0;
+    const uint8_t *compressed_data = find_file(name, compressed_size);
+    if (!compressed_data) {
+        return nullptr;
+    }
+
+#ifdef HAL_ROMFS_UNCOMPRESSED
+    size = compressed_size;
+    return compressed_data;
+#else
+    {
+        WITH_SEMAPHORE(cache_sem);
+        for (auto &c : cache) {
+            if (c.compressed == compressed_data) {
+                c.refcount++;
+                c.last_use = ++cache_counter;
+                size = c.size;
+                return c.data;
+            }
+        }
+    }
+
+    // decompress without holding the semaphore, so other files can
+    // be opened meanwhile
+    uint8_t *decompressed_data = decompress(compressed_data, compressed_size, size);
+    if (decompressed_data == nullptr) {
+        return nullptr;
+    }
+
+    WITH_SEMAPHORE(cache_sem);
+    cache_entry *slot = nullptr;
+    for (auto &c : cache) {
+        if (c.compressed == compressed_data) {
+            // another thread decompressed the same file
+            ::free(decompressed_data);
+            c.refcount++;
+            c.last_use = ++cache_counter;
+            return c.data;
+        }
+        // use an empty slot or evict the least recently used unused file
+        if (c.refcount == 0 && (slot == nullptr || c.last_use < slot->last_use)) {
+            slot = &c;
+        }
+    }
+    if (slot == nullptr) {
+        // all slots in use, the data is not shared
+        return decompressed_data;
+    }
+    ::free(slot->data);
+    slot->compressed = compressed_data;
+    slot->data = decompressed_data;
+    slot->size = size;
+    slot->refcount = 1;
+    slot->last_use = ++cache_counter;
+    return decompressed_data;
 #endif
 }
 
@@ -110,10 +175,173 @@ const uint8_t *AP_ROMFS::find_decompress(const char *name, uint32_t &size)
 void AP_ROMFS::free(const uint8_t *data)
 {
 #ifndef HAL_ROMFS_UNCOMPRESSED
+    if (data == nullptr) {
+        return;
+    }
+    WITH_SEMAPHORE(cache_sem);
+    for (auto &c : cache) {
+        if (c.data == data) {
+            if (c.refcount > 0) {
+                c.refcount--;
+            }
+            cache_trim();
+            return;
+        }
+    }
     ::free(const_cast<uint8_t *>(data));
 #endif
 }
 
+#ifndef HAL_ROMFS_UNCOMPRESSED
+/*
+  free the least recently used files which are no longer in use until
+  the rest fit in HAL_ROMFS_CACHE_SIZE. Called with cache_sem held
+*/
+void AP_ROMFS::cache_trim(void)
+{
+    while (true) {
+        uint32_t unused_size = 0;
+        cache_entry *oldest = nullptr;
+        for (auto &c : cache) {
+            if (c.data == nullptr || c.refcount != 0) {
+                continue;
+            }
+            unused_size += c.size;
+            if (oldest == nullptr || c.last_use < oldest->last_use) {
+                oldest = &c;
+            }
+        }
+        if (oldest == nullptr || unused_size <= HAL_ROMFS_CACHE_SIZE) {
+            return;
+        }
+        ::free(oldest->data);
+        memset(oldest, 0, sizeof(*oldest));
+    }
+}
+#endif
+
+// find the decompressed size of a file without decompressing it
+bool AP_ROMFS::find_size(const char *name, uint32_t &size)
+{
+    uint32_t compressed_size = 0;
+    const uint8_t *compressed_data = find_file(name, compressed_size);
+    if (!compressed_data) {
+        return false;
+    }
+#ifdef HAL_ROMFS_UNCOMPRESSED
+    size = compressed_size;
+#else
+    // last 4 bytes of gzip file are length of decompressed data
+    const uint8_t *p = &compressed_data[compressed_size-4];
+    size = p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24;
+#endif
+    return true;
+}
+
+/*
+  open a file for reading in order. Files which fit in the compression
+  window are decompressed in full as that needs less memory than the
+  decompressor state. Without HAL_ROMFS_STREAMING the files may use a
+  larger window, so all files are decompressed in full
+*/
+AP_ROMFS::Stream *AP_ROMFS::open_stream(const char *name)
+{
+    uint32_t size;
+    if (!find_size(name, size)) {
+        return nullptr;
+    }
+    Stream *s = new Stream();
+    if (s == nullptr) {
+        return nullptr;
+    }
+#if HAL_ROMFS_STREAMING && !defined(HAL_ROMFS_UNCOMPRESSED)
+    if (size > AP_ROMFS_WINDOW_SIZE) {
+        s->_compressed = find_file(name, s->_compressed_size);
+        s->_size = size;
+        s->_d = (TINF_DATA *)malloc(sizeof(TINF_DATA));
+        s->_dict = (uint8_t *)malloc(AP_ROMFS_WINDOW_SIZE);
+        if (s->_d == nullptr || s->_dict == nullptr || !s->rewind()) {
+            delete s;
+            return nullptr;
+        }
+        return s;
+    }
+#endif
+    s->_data = find_decompress(name, s->_size);
+    if (s->_data == nullptr) {
+        delete s;
+        return nullptr;
+    }
+    return s;
+}
+
+AP_ROMFS::Stream::~Stream()
+{
+    AP_ROMFS::free(_data);
+    ::free(_d);
+    ::free(_dict);
+}
+
+// restart decompression from the start of the file
+bool AP_ROMFS::Stream::rewind()
+{
+    _ofs = 0;
+    if (_d == nullptr) {
+        return true;
+    }
+    uzlib_uncompress_init(_d, _dict, AP_ROMFS_WINDOW_SIZE);
+    _d->source = _compressed;
+    _d->source_limit = _compressed + _compressed_size - 4;
+    return uzlib_gzip_parse_header(_d) == TINF_OK;
+}
+
+// read up to count bytes, returning the number of bytes read or -1 on error
+int32_t AP_ROMFS::Stream::read(uint8_t *buf, uint32_t count)
+{
+    count = MIN(count, _size - _ofs);
+    if (count == 0) {
+        return 0;
+    }
+    if (_d == nullptr) {
+        memcpy(buf, &_data[_ofs], count);
+    } else {
+        // decompress straight into the caller's buffer, with back
+        // references coming from the window
+        _d->dest = buf;
+        _d->destSize = count;
+        const int res = uzlib_uncompress(_d);
+        if (res != TINF_OK && res != TINF_DONE) {
+            return -1;
+        }
+        count = _d->dest - buf;
+    }
+    _ofs += count;
+    return count;
+}
+
+/*
+  move to an offset in the file. Seeking backwards in a large file
+  restarts decompression from the start
+*/
+bool AP_ROMFS::Stream::seek(uint32_t offset)
+{
+    offset = MIN(offset, _size);
+    if (_d == nullptr) {
+        _ofs = offset;
+        return true;
+    }
+    if (offset < _ofs && !rewind()) {
+        return false;
+    }
+    uint8_t skip[64];
+    while (_ofs < offset) {
+        if (read(skip, MIN(uint32_t(sizeof(skip)), offset - _ofs)) <= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /*
   directory listing interface. Start with ofs=0. Returns pathnames
   that match dirname prefix. Ends with nullptr return when no more
@@ -5,17 +5,93 @@
 
 #include <AP_HAL/AP_HAL.h>
 
+// decompress large files as they are read. This needs the files to be
+// compressed with a small window, which is done by
+// Tools/ardupilotwaf/embed.py when the board sets env ROMFS_STREAMING
+#ifndef HAL_ROMFS_STREAMING
+#define HAL_ROMFS_STREAMING 0
+#endif
+
+// size of the window used to compress embedded files when streaming.
+// This must match stream_window_bits in Tools/ardupilotwaf/embed.py
+#define AP_ROMFS_WINDOW_SIZE 4096
+
+// total size of decompressed files kept after their last user has freed them
+#ifndef HAL_ROMFS_CACHE_SIZE
+#if HAL_MEM_CLASS >= HAL_MEM_CLASS_1000
+#define HAL_ROMFS_CACHE_SIZE 32768
+#else
+#define HAL_ROMFS_CACHE_SIZE 0
+#endif
+#endif
+
+// number of decompressed files which can be shared between users
+#ifndef HAL_ROMFS_CACHE_ENTRIES
+#define HAL_ROMFS_CACHE_ENTRIES 8
+#endif
+
+struct TINF_DATA;
+
 class AP_ROMFS {
+    friend class AP_ROMFS_Benchmark;
 public:
     // find a file and de-compress, assumning gzip format. The
     // decompressed data will be allocated with malloc(). You must
     // call AP_ROMFS::free() on the return value after use. The next byte after
-    // the file data is guaranteed to be null.
+    // the file data is guaranteed to be null. Decompressed data is
+    // shared between callers asking for the same file, so must not be
+    // modified
     static const uint8_t *find_decompress(const char *name, uint32_t &size);
 
     // free returned data
     static void free(const uint8_t *data);
 
+    // find the decompressed size of a file without decompressing it
+    static bool find_size(const char *name, uint32_t &size);
+
+    /*
+      a file being read in order. With HAL_ROMFS_STREAMING, files
+      larger than the compression window are decompressed as they are
+      read, so only the window and decompressor state are held in
+      memory. Other files are decompressed in full with
+      find_decompress()
+     */
+    class Stream {
+    public:
+        ~Stream();
+
+        // read up to count bytes, returning the number of bytes read
+        // or -1 on error
+        int32_t read(uint8_t *buf, uint32_t count);
+
+        // move to an offset in the file, returns false on error
+        bool seek(uint32_t offset);
+
+        uint32_t size() const { return _size; }
+        uint32_t offset() const { return _ofs; }
+
+    private:
+        friend class AP_ROMFS;
+
+        bool rewind();
+
+        const uint8_t *_compressed = nullptr;
+        uint32_t _compressed_size = 0;
+        uint32_t _size = 0;
+        uint32_t _ofs = 0;
+
+        // data from find_decompress() for small files
+        const uint8_t *_data = nullptr;
+
+        // decompressor state for large files
+        struct TINF_DATA *_d = nullptr;
+        uint8_t *_dict = nullptr;
+    };
+
+    // open a file for reading, returns nullptr if not found or out of
+    // memory. Use delete to close the stream
+    static Stream *open_stream(const char *name);
+
     /*
       directory listing interface. Start with ofs=0. Returns pathnames
       that match dirname prefix. Ends with nullptr return when no more
@@ -27,10 +103,31 @@ private:
     // find an embedded file
     static const uint8_t *find_file(const char *name, uint32_t &size);
 
+    // decompress a whole file into memory from malloc()
+    static uint8_t *decompress(const uint8_t *compressed_data, uint32_t compressed_size, uint32_t &size);
+
     struct embedded_file {
         const char *filename;
         uint32_t size;
         const uint8_t *contents;
     };
     static const struct embedded_file files[];
+    static uint16_t num_files(void);
+
+#ifndef HAL_ROMFS_UNCOMPRESSED
+    // decompressed files, kept while in use and then while they fit
+    // in HAL_ROMFS_CACHE_SIZE
+    struct cache_entry {
+        const uint8_t *compressed;
+        uint8_t *data;
+        uint32_t size;
+        uint32_t last_use;
+        uint16_t refcount;
+    };
+    static struct cache_entry cache[HAL_ROMFS_CACHE_ENTRIES];
+    static uint32_t cache_counter;
+    static HAL_Semaphore cache_sem;
+
+    static void cache_trim(void);
+#endif
 };
@@ -0,0 +1,114 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+
+#include <AP_ROMFS/AP_ROMFS.h>
+#include <AP_ROMFS/tinf.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  open and read every file embedded in ROMFS. Peak memory is the
+  largest allocation needed to read any one file
+ */
+class AP_ROMFS_Benchmark {
+public:
+    static uint16_t num_files() {
+        return AP_ROMFS::num_files();
+    }
+
+    static const char *filename(uint16_t i) {
+        return AP_ROMFS::files[i].filename;
+    }
+
+    // decompress each file in full, bypassing the cache
+    static uint32_t decompress_all(uint32_t &peak) {
+        uint32_t total = 0;
+        for (uint16_t i=0; i<num_files(); i++) {
+            uint32_t size = 0;
+            uint8_t *data = AP_ROMFS::decompress(AP_ROMFS::files[i].contents, AP_ROMFS::files[i].size, size);
+            if (data == nullptr) {
+                continue;
+            }
+            total += size;
+            peak = MAX(peak, size + 1 + sizeof(TINF_DATA));
+            free(data);
+        }
+        return total;
+    }
+};
+
+static void BM_ROMFSDecompress(benchmark::State& state)
+{
+    uint32_t total = 0;
+    uint32_t peak = 0;
+    while (state.KeepRunning()) {
+        total = AP_ROMFS_Benchmark::decompress_all(peak);
+    }
+    char label[32];
+    snprintf(label, sizeof(label), "peak %u bytes", unsigned(peak));
+    state.SetLabel(label);
+    state.SetBytesProcessed(int64_t(state.iterations()) * total);
+}
+
+// open each file and read it in 512 byte chunks
+static void BM_ROMFSStream(benchmark::State& state)
+{
+    uint8_t buf[512];
+    uint32_t total = 0;
+    uint32_t peak = 0;
+    while (state.KeepRunning()) {
+        total = 0;
+        for (uint16_t i=0; i<AP_ROMFS_Benchmark::num_files(); i++) {
+            AP_ROMFS::Stream *s = AP_ROMFS::open_stream(AP_ROMFS_Benchmark::filename(i));
+            if (s == nullptr) {
+                continue;
+            }
+            if (HAL_ROMFS_STREAMING && s->size() > AP_ROMFS_WINDOW_SIZE) {
+                peak = MAX(peak, sizeof(*s) + sizeof(TINF_DATA) + AP_ROMFS_WINDOW_SIZE);
+            } else {
+                peak = MAX(peak, sizeof(*s) + s->size() + 1 + sizeof(TINF_DATA));
+            }
+            int32_t n;
+            while ((n = s->read(buf, sizeof(buf))) > 0) {
+                total += n;
+            }
+            delete s;
+        }
+    }
+    char label[32];
+    snprintf(label, sizeof(label), "peak %u bytes", unsigned(peak));
+    state.SetLabel(label);
+    state.SetBytesProcessed(int64_t(state.iterations()) * total);
+}
+
+/*
+  find_decompress() of each file, repeated the given number of times
+  in a row. Repeats are served from the cache while the file is in use
+  or fits in HAL_ROMFS_CACHE_SIZE
+ */
+static void BM_ROMFSCached(benchmark::State& state)
+{
+    uint32_t total = 0;
+    while (state.KeepRunning()) {
+        total = 0;
+        for (uint16_t i=0; i<AP_ROMFS_Benchmark::num_files(); i++) {
+            for (int r=0; r<state.range_x(); r++) {
+                uint32_t size;
+                const uint8_t *data = AP_ROMFS::find_decompress(AP_ROMFS_Benchmark::filename(i), size);
+                if (data == nullptr) {
+                    continue;
+                }
+                total += size;
+                AP_ROMFS::free(data);
+            }
+        }
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * total);
+}
+
+BENCHMARK(BM_ROMFSDecompress);
+BENCHMARK(BM_ROMFSStream);
+BENCHMARK(BM_ROMFSCached)->Arg(1)->Arg(4);
+
+BENCHMARK_MAIN()
@@ -30,12 +30,19 @@ const AP_Param::GroupInfo AP_SmartRTL::var_info[] = {
 
     // @Param: POINTS
     // @DisplayName: SmartRTL maximum number of points on path
-    // @Description: SmartRTL maximum number of points on path. Set to 0 to disable SmartRTL.  100 points consumes about 3k of memory.
+    // @Description: SmartRTL maximum number of points on path. Set to 0 to disable SmartRTL.  100 points consumes about 3k of memory.  Higher values are limited to 500 points on most boards, but boards with at least 500k of RAM accept up to 2000 points and boards with at least 1M of RAM accept up to 5000 points.
     // @Range: 0 500
     // @User: Advanced
     // @RebootRequired: True
     AP_GROUPINFO("POINTS", 1, AP_SmartRTL, _points_max, SMARTRTL_POINTS_DEFAULT),
 
+    // @Param: OPTIONS
+    // @DisplayName: SmartRTL options
+    // @Description: Bitmask of SmartRTL options
+    // @Bitmask: 0:Disable online simplification
+    // @User: Advanced
+    AP_GROUPINFO("OPTIONS", 2, AP_SmartRTL, _options, 0),
+
     AP_GROUPEND
 };
 
@@ -69,6 +76,11 @@ const AP_Param::GroupInfo AP_SmartRTL::var_info[] = {
 *    before they complete which is helpful when memory is filling up and we just
 *    need to quickly identify a handful of points which can be deleted.
 *
+*    In addition, points are simplified online as they are added: while the
+*    vehicle flies a straight leg the last point of the path is replaced by
+*    each new point rather than a new point being appended.  This keeps long
+*    surveys from filling the path before the background cleanup can run.
+*
 *    Once the algorithms have completed the simplify.complete and
 *    prune.complete flags are set to true.  The "thorough cleanup" procedure,
 *    which is run as the vehicle initiates the SmartRTL flight mode, waits for
@@ -179,6 +191,8 @@ void AP_SmartRTL::set_home(bool position_ok, const Vector3f& current_pos)
 
     // clear path
     _path_points_count = 0;
+    _background_points_count = 0;
+    reset_online_simplify();
 
     // reset simplification and pruning.  These functions access members that should normally only
     // be touched by the background thread but it will not be running because active should be false
@@ -299,6 +313,12 @@ bool AP_SmartRTL::add_point(const Vector3f& point)
         }
     }
 
+    // extend the last segment of the path if possible
+    if (online_simplify(point)) {
+        _path_sem.give();
+        return true;
+    }
+
     // check we have space in the path
     if (_path_points_count >= _path_points_max) {
         _path_sem.give();
@@ -310,10 +330,71 @@ bool AP_SmartRTL::add_point(const Vector3f& point)
     _path[_path_points_count++] = point;
     log_action(SRTL_POINT_ADD, point);
 
+    // the new point starts a new segment
+    reset_online_simplify();
+
     _path_sem.give();
     return true;
 }
 
+// try to replace the last point on the path with point, returns true on success
+// the path semaphore must be held by the caller
+bool AP_SmartRTL::online_simplify(const Vector3f& point)
+{
+    if ((_options.get() & int32_t(Options::DisableOnlineSimplify)) != 0) {
+        return false;
+    }
+
+    // we need a segment to extend, and the background cleanup must not be
+    // working on its last point.  If the background cleanup has changed the
+    // path since we last looked we can't trust the merged points either
+    const uint16_t count = _path_points_count;
+    if (count < 2 || (count - 1) < _background_points_count ||
+        _online.path_points_count != count || _path[count-2] != _online.anchor ||
+        _online.merged_count >= ARRAY_SIZE(_online.merged)) {
+        return false;
+    }
+
+    // the last point and all points already merged into the segment must
+    // stay close to the extended segment
+    const Vector3f &last = _path[count-1];
+    if (last.distance_to_segment(_online.anchor, point) > SMARTRTL_SIMPLIFY_EPSILON) {
+        return false;
+    }
+    for (uint8_t i = 0; i < _online.merged_count; i++) {
+        if (_online.merged[i].distance_to_segment(_online.anchor, point) > SMARTRTL_SIMPLIFY_EPSILON) {
+            return false;
+        }
+    }
+
+    // replace the last point
+    _online.merged[_online.merged_count++] = last;
+    log_action(SRTL_POINT_SIMPLIFY, last);
+    _path[count-1] = point;
+    log_action(SRTL_POINT_ADD, point);
+    return true;
+}
+
+// restart online simplification from the end of the path
+void AP_SmartRTL::reset_online_simplify()
+{
+    _online.merged_count = 0;
+    _online.path_points_count = _path_points_count;
+    if (_path_points_count >= 2) {
+        _online.anchor = _path[_path_points_count-2];
+    }
+}
+
+// enable or disable online simplification as points are added, used by the example sketch
+void AP_SmartRTL::set_online_simplify(bool enable)
+{
+    if (enable) {
+        _options.set(_options.get() & ~int32_t(Options::DisableOnlineSimplify));
+    } else {
+        _options.set(_options.get() | int32_t(Options::DisableOnlineSimplify));
+    }
+}
+
 // run background cleanup - should be run regularly from the IO thread
 void AP_SmartRTL::run_background_cleanup()
 {
@@ -329,6 +410,8 @@ void AP_SmartRTL::run_background_cleanup()
     const uint16_t path_points_count = _path_points_count;
     const uint16_t path_points_completed_limit = _path_points_completed_limit;
     _path_points_completed_limit = SMARTRTL_POINTS_MAX;
+    // online simplification must leave the whole path alone while this pass runs
+    _background_points_count = path_points_count;
     _path_sem.give();
 
     // check if thorough cleanup is required
@@ -342,6 +425,7 @@ void AP_SmartRTL::run_background_cleanup()
         }
         // we do not perform any further detection or cleanup until the requester acknowledges
         // they have what they need by setting _thorough_clean_request_ms back to zero
+        release_background_points();
         return;
     }
 
@@ -350,6 +434,7 @@ void AP_SmartRTL::run_background_cleanup()
 
     // perform routine cleanup which removes 10 to 50 points if possible
     routine_cleanup(path_points_count, path_points_completed_limit);
+    release_background_points();
 
     // warn if buffer is about to be filled
     uint32_t now_ms = AP_HAL::millis();
@@ -360,6 +445,26 @@ void AP_SmartRTL::run_background_cleanup()
 
 }
 
+// let online simplification change points the background cleanup no longer depends on
+// these are the points it has simplified, or is simplifying or pruning
+void AP_SmartRTL::release_background_points()
+{
+    uint16_t points_in_use = _simplify.path_points_completed;
+    if (!_simplify.complete || _simplify.removal_required) {
+        points_in_use = MAX(points_in_use, _simplify.path_points_count);
+    }
+    if (!_prune.complete || _prune.loops_count > 0) {
+        points_in_use = MAX(points_in_use, _prune.path_points_count);
+    }
+
+    if (!_path_sem.take_nonblocking()) {
+        // the whole path stays reserved until the next pass
+        return;
+    }
+    _background_points_count = points_in_use;
+    _path_sem.give();
+}
+
 // routine cleanup is called regularly from run_background_cleanup
 //   simplifies the path after SMARTRTL_CLEANUP_POINT_TRIGGER points (50 points) have been added OR
 //   SMARTRTL_CLEANUP_POINT_MIN (10 points) have been added and the path has less than SMARTRTL_CLEANUP_START_MARGIN spaces (10 spaces) remaining
@@ -558,6 +663,12 @@ void AP_SmartRTL::detect_loops()
             }
         }
 
+        // quickly reject segments whose bounding boxes are too far apart
+        // to be a loop before doing the full distance calculation
+        if (segments_apart(_path[_prune.i], _path[_prune.i-1], _path[_prune.j-1], _path[_prune.j], SMARTRTL_PRUNING_DELTA)) {
+            continue;
+        }
+
         // find the closest distance between two line segments and the mid-point
         dist_point dp = segment_segment_dist(_path[_prune.i], _path[_prune.i-1], _path[_prune.j-1], _path[_prune.j]);
         if (dp.distance < SMARTRTL_PRUNING_DELTA) {
@@ -825,6 +936,21 @@ AP_SmartRTL::dist_point AP_SmartRTL::segment_segment_dist(const Vector3f &p1, co
     return {dP.length(), midpoint};
 }
 
+// returns true if the bounding boxes of the segments p1-p2 and p3-p4 are more than margin apart on any axis
+bool AP_SmartRTL::segments_apart(const Vector3f &p1, const Vector3f &p2, const Vector3f &p3, const Vector3f &p4, float margin)
+{
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        const float min_a = MIN(p1[axis], p2[axis]);
+        const float max_a = MAX(p1[axis], p2[axis]);
+        const float min_b = MIN(p3[axis], p4[axis]);
+        const float max_b = MAX(p3[axis], p4[axis]);
+        if (min_a - max_b > margin || min_b - max_a > margin) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // de-activate SmartRTL, send warning to GCS and logger
 void AP_SmartRTL::deactivate(SRTL_Actions action, const char *reason)
 {
@@ -7,7 +7,15 @@
 // definitions and macros
 #define SMARTRTL_ACCURACY_DEFAULT        2.0f   // default _ACCURACY parameter value.  Points will be no closer than this distance (in meters) together.
 #define SMARTRTL_POINTS_DEFAULT          300    // default _POINTS parameter value.  High numbers improve path pruning but use more memory and CPU for cleanup. Memory used will be 20bytes * this number.
-#define SMARTRTL_POINTS_MAX              500    // the absolute maximum number of points this library can support.
+#ifndef SMARTRTL_POINTS_MAX
+#if HAL_MEM_CLASS >= HAL_MEM_CLASS_1000
+#define SMARTRTL_POINTS_MAX              5000   // the absolute maximum number of points this library can support.
+#elif HAL_MEM_CLASS >= HAL_MEM_CLASS_500
+#define SMARTRTL_POINTS_MAX              2000
+#else
+#define SMARTRTL_POINTS_MAX              500
+#endif
+#endif
 #define SMARTRTL_TIMEOUT                 15000  // the time in milliseconds with no points saved to the path (for whatever reason), before SmartRTL is disabled for the flight
 #define SMARTRTL_CLEANUP_POINT_TRIGGER   50     // simplification will trigger when this many points are added to the path
 #define SMARTRTL_CLEANUP_START_MARGIN    10     // routine cleanup algorithms begin when the path array has only this many empty slots remaining
@@ -20,6 +28,7 @@
 #define SMARTRTL_PRUNING_DELTA (_accuracy * 0.99)   // How many meters apart must two points be, such that we can assume that there is no obstacle between them.  must be smaller than _ACCURACY parameter
 #define SMARTRTL_PRUNING_LOOP_BUFFER_LEN_MULT 0.25f // pruning loop buffer size as compared to maximum number of points
 #define SMARTRTL_PRUNING_LOOP_TIME_US    200    // maximum time (in microseconds) that the loop finding algorithm will run before returning
+#define SMARTRTL_ONLINE_SIMPLIFY_POINTS  16     // maximum number of points online simplification will merge into the last segment of the path
 
 class AP_SmartRTL {
 
@@ -74,6 +83,9 @@ public:
     // run background cleanup - should be run regularly from the IO thread
     void run_background_cleanup();
 
+    // enable or disable online simplification as points are added, used by the example sketch
+    void set_online_simplify(bool enable);
+
     // parameter var table
     static const struct AP_Param::GroupInfo var_info[];
 
@@ -97,6 +109,9 @@ private:
     // add point to end of path
     bool add_point(const Vector3f& point);
 
+    // let online simplification change points the background cleanup no longer depends on
+    void release_background_points();
+
     // routine cleanup attempts to remove 10 points (see SMARTRTL_CLEANUP_POINT_MIN definition) by simplification or loop pruning
     void routine_cleanup(uint16_t path_points_count, uint16_t path_points_complete_limit);
 
@@ -155,15 +170,30 @@ private:
     // get the closest distance between 2 line segments and the point midway between the closest points
     static dist_point segment_segment_dist(const Vector3f& p1, const Vector3f& p2, const Vector3f& p3, const Vector3f& p4);
 
+    // returns true if the bounding boxes of 2 line segments are more than margin apart, in which case the segments cannot form a loop
+    static bool segments_apart(const Vector3f& p1, const Vector3f& p2, const Vector3f& p3, const Vector3f& p4, float margin);
+
     // de-activate SmartRTL, send warning to GCS and logger
     void deactivate(SRTL_Actions action, const char *reason);
 
     // logging
     void log_action(SRTL_Actions action, const Vector3f &point = Vector3f());
 
+    // try to replace the last point on the path with point, returns true on success
+    // the path semaphore must be held by the caller
+    bool online_simplify(const Vector3f& point);
+
+    // restart online simplification from the end of the path
+    void reset_online_simplify();
+
+    enum class Options : int32_t {
+        DisableOnlineSimplify = (1U<<0),
+    };
+
     // parameters
     AP_Float _accuracy;
     AP_Int16 _points_max;
+    AP_Int32 _options;
 
     // SmartRTL State Variables
     bool _active;       // true if SmartRTL is usable.  may become unusable if the path becomes too long to keep in memory, and too convoluted to be cleaned up, SmartRTL will be permanently deactivated (for the remainder of the flight)
@@ -182,6 +212,19 @@ private:
     uint16_t _path_points_count;// number of points in the path array
     uint16_t _path_points_completed_limit;  // set by main thread to the path_point_count when a point is popped.  used by simplify and prune algorithms to detect path shrinking
     HAL_Semaphore _path_sem;   // semaphore for updating path
+    uint16_t _background_points_count;  // number of points at the start of the path the background cleanup depends on, points beyond this may be modified by online simplification
+
+    // Online simplification
+    // the last segment of the path runs from anchor to the last point.  As each new point arrives, the last point is
+    // replaced by it if the last point and all points previously merged into the segment are within
+    // SMARTRTL_SIMPLIFY_EPSILON of the new segment.  This keeps straight legs to a single segment without
+    // needing the background cleanup
+    struct {
+        Vector3f anchor;        // first point of the last path segment
+        Vector3f merged[SMARTRTL_ONLINE_SIMPLIFY_POINTS];  // points merged into the last path segment
+        uint8_t merged_count;   // number of elements in the merged array
+        uint16_t path_points_count; // _path_points_count when the state was last updated, used to detect changes made by the background cleanup
+    } _online;
 
     // Simplify
     // structure and buffer to hold the "to-do list" for the simplify algorithm.
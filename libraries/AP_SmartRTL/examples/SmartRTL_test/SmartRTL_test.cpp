@@ -33,6 +33,7 @@ void setup();
 void loop();
 void reset();
 void check_path(const std::vector<Vector3f> &correct_path, const char* test_name, uint32_t time_us);
+void benchmark_survey(bool online_simplify);
 
 void setup()
 {
@@ -50,6 +51,9 @@ void loop()
 
     hal.console->printf("--------------------\n");
 
+    // the expected paths below assume points are only simplified by the background cleanup
+    smart_rtl.set_online_simplify(false);
+
     // reset path and upload "test_path_before" to smart_rtl
     reference_time = AP_HAL::micros();
     reset();
@@ -76,6 +80,11 @@ void loop()
     run_time = AP_HAL::micros() - reference_time;
     check_path(test_path_complete, "simplify and pruning", run_time);
 
+    // compare recording a long survey with and without online simplification
+    benchmark_survey(false);
+    benchmark_survey(true);
+    smart_rtl.set_online_simplify(false);
+
     // delay before next display
     hal.scheduler->delay(5e3); // 5 seconds
 }
@@ -89,6 +98,60 @@ void reset()
     }
 }
 
+// record a lawnmower survey with small position noise, running the background
+// cleanup after each update as the IO thread would, and measure the number of
+// points stored and the time taken to add and clean up the path
+void benchmark_survey(bool online_simplify)
+{
+    smart_rtl.set_online_simplify(online_simplify);
+    hal.scheduler->delay(5);    // delay 5 milliseconds because request_through_cleanup uses millisecond timestamps
+    smart_rtl.set_home(true, Vector3f{0.0f, 0.0f, 0.0f});
+
+    const uint16_t legs = 20;
+    const float leg_length = 200.0f;    // meters
+    const float leg_spacing = 20.0f;    // meters
+    const float step = 2.5f;            // meters between position updates
+    uint32_t num_updates = 0;
+    uint32_t seed = 1;
+
+    uint32_t reference_time = AP_HAL::micros();
+    for (uint16_t leg = 0; leg < legs; leg++) {
+        const float y = leg * leg_spacing;
+        for (float d = 0; d <= leg_length; d += step) {
+            // deterministic noise of up to +-0.1m
+            seed = seed * 1103515245U + 12345U;
+            const float noise = ((seed >> 16) % 200) * 0.001f - 0.1f;
+            const float x = (leg % 2 == 0) ? d : leg_length - d;
+            smart_rtl.update(true, Vector3f{x, y + noise, -10.0f + noise});
+            smart_rtl.run_background_cleanup();
+            num_updates++;
+        }
+        // turn onto the next leg
+        for (float d = step; d < leg_spacing; d += step) {
+            const float x = (leg % 2 == 0) ? leg_length : 0.0f;
+            smart_rtl.update(true, Vector3f{x, y + d, -10.0f});
+            smart_rtl.run_background_cleanup();
+            num_updates++;
+        }
+    }
+    const uint32_t add_time = AP_HAL::micros() - reference_time;
+    const uint16_t points_added = smart_rtl.get_num_points();
+
+    reference_time = AP_HAL::micros();
+    while (!smart_rtl.request_thorough_cleanup(AP_SmartRTL::THOROUGH_CLEAN_ALL)) {
+        smart_rtl.run_background_cleanup();
+    }
+    const uint32_t cleanup_time = AP_HAL::micros() - reference_time;
+
+    hal.console->printf("survey online:%u updates:%u points:%u after cleanup:%u add:%u us cleanup:%u us\n",
+                        (unsigned)online_simplify,
+                        (unsigned)num_updates,
+                        (unsigned)points_added,
+                        (unsigned)smart_rtl.get_num_points(),
+                        (unsigned)add_time,
+                        (unsigned)cleanup_time);
+}
+
 // compare the vector array passed in with the path held in the smart_rtl object
 void check_path(const std::vector<Vector3f>& correct_path, const char* test_name, uint32_t time_us)
 {
@@ -0,0 +1,94 @@
+#include <AP_gtest.h>
+
+#include <AP_SmartRTL/AP_SmartRTL.h>
+
+#include <vector>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  record a lawnmower survey with small position noise, running the
+  background cleanup between position updates as the IO thread does.
+  Returns the largest number of points the path held
+ */
+static uint16_t record_survey(AP_SmartRTL &smart_rtl, std::vector<Vector3f> &positions)
+{
+    const uint16_t legs = 6;
+    const float leg_length = 200.0f;    // meters
+    const float leg_spacing = 20.0f;    // meters
+    const float step = 2.5f;            // meters between position updates
+    uint32_t seed = 1;
+    uint16_t max_points = 0;
+
+    smart_rtl.set_home(true, Vector3f{0.0f, 0.0f, 0.0f});
+    positions.clear();
+    positions.push_back(Vector3f{0.0f, 0.0f, 0.0f});
+
+    for (uint16_t leg = 0; leg < legs; leg++) {
+        const float y = leg * leg_spacing;
+        for (float d = step; d <= leg_length + leg_spacing; d += step) {
+            // fly along the leg then turn onto the next one
+            Vector3f pos;
+            if (d <= leg_length) {
+                // deterministic noise of up to +-0.1m
+                seed = seed * 1103515245U + 12345U;
+                const float noise = ((seed >> 16) % 200) * 0.001f - 0.1f;
+                pos = Vector3f{(leg % 2 == 0) ? d : leg_length - d, y + noise, -10.0f + noise};
+            } else {
+                pos = Vector3f{(leg % 2 == 0) ? leg_length : 0.0f, y + d - leg_length, -10.0f};
+            }
+            smart_rtl.update(true, pos);
+            positions.push_back(pos);
+            max_points = MAX(max_points, smart_rtl.get_num_points());
+            smart_rtl.run_background_cleanup();
+        }
+    }
+    return max_points;
+}
+
+// smallest distance from a point to the path held by smart_rtl
+static float distance_to_path(const AP_SmartRTL &smart_rtl, const Vector3f &point)
+{
+    float dist = point.distance_to_segment(smart_rtl.get_point(0), smart_rtl.get_point(0));
+    for (uint16_t i = 1; i < smart_rtl.get_num_points(); i++) {
+        dist = MIN(dist, point.distance_to_segment(smart_rtl.get_point(i-1), smart_rtl.get_point(i)));
+    }
+    return dist;
+}
+
+// online simplification keeps extending the last segment while the
+// background cleanup runs between points, and the path still follows
+// every position recorded
+TEST(AP_SmartRTL, online_simplify_with_background_cleanup)
+{
+    AP_SmartRTL *smart_rtl = new AP_SmartRTL(true);
+    smart_rtl->init();
+    std::vector<Vector3f> positions;
+
+    uint16_t max_points[2];
+    for (uint8_t online = 0; online < 2; online++) {
+        smart_rtl->set_online_simplify(online);
+        max_points[online] = record_survey(*smart_rtl, positions);
+        ASSERT_TRUE(smart_rtl->is_active());
+
+        // the path passes within accuracy of each position
+        const float epsilon = SMARTRTL_ACCURACY_DEFAULT * 0.5f;
+        for (const Vector3f &pos : positions) {
+            EXPECT_LE(distance_to_path(*smart_rtl, pos), 2 * epsilon);
+        }
+    }
+
+    printf("most points on path: %u without online simplification, %u with\n",
+           (unsigned)max_points[0], (unsigned)max_points[1]);
+
+    // without online simplification the path grows until the background
+    // cleanup simplifies it
+    EXPECT_GE(max_points[0], SMARTRTL_CLEANUP_POINT_TRIGGER);
+    // with it each segment takes up to SMARTRTL_ONLINE_SIMPLIFY_POINTS
+    // updates, so the path never grows enough to trigger the cleanup
+    EXPECT_LT(max_points[1], SMARTRTL_CLEANUP_POINT_TRIGGER);
+    EXPECT_LT(max_points[1], max_points[0] * 2 / 3);
+    delete smart_rtl;
+}
+
+AP_GTEST_MAIN()
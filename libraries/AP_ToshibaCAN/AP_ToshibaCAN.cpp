@@ -27,6 +27,7 @@
 #include <GCS_MAVLink/GCS.h>
 #include "AP_ToshibaCAN.h"
 #include <AP_Logger/AP_Logger.h>
+#include <AP_ESC_Telem/AP_ESC_Telem.h>
 #include <stdio.h>
 
 extern const AP_HAL::HAL& hal;
@@ -295,6 +296,7 @@ void AP_ToshibaCAN::loop()
 
         // check for replies from ESCs
         if (send_stage == 8) {
+            AP_ESC_Telem *esc_telem = AP_ESC_Telem::get_singleton();
             AP_HAL::CANFrame recv_frame;
             while (read_frame(recv_frame, timeout)) {
                 // decode rpm and voltage data
@@ -320,6 +322,17 @@ void AP_ToshibaCAN::loop()
                         }
                         _telemetry[esc_id].last_update_ms = now_ms;
                         _esc_present_bitmask_recent |= ((uint32_t)1 << esc_id);
+
+                        if (esc_telem != nullptr) {
+                            AP_ESC_Telem::TelemetryData t {};
+                            t.rpm = _telemetry[esc_id].rpm;
+                            t.voltage = _telemetry[esc_id].voltage_cv * 0.01f;
+                            t.current = _telemetry[esc_id].current_ca * 0.01f;
+                            t.consumption_mah = _telemetry[esc_id].current_tot_mah;
+                            esc_telem->update_telem_data(esc_id, t,
+                                                         AP_ESC_Telem::RPM | AP_ESC_Telem::VOLTAGE |
+                                                         AP_ESC_Telem::CURRENT | AP_ESC_Telem::CONSUMPTION);
+                        }
                     }
                 }
 
@@ -344,6 +357,14 @@ void AP_ToshibaCAN::loop()
                         _telemetry[esc_id].esc_temp = temp_max < 100 ? 0 : temp_max / 5 - 20;
                         _telemetry[esc_id].motor_temp = motor_temp < 100 ? 0 : motor_temp / 5 - 20;
                         _esc_present_bitmask_recent |= ((uint32_t)1 << esc_id);
+
+                        if (esc_telem != nullptr) {
+                            AP_ESC_Telem::TelemetryData t {};
+                            t.temperature_cdeg = int16_t(_telemetry[esc_id].esc_temp * 100);
+                            t.motor_temp_cdeg = int16_t(_telemetry[esc_id].motor_temp * 100);
+                            esc_telem->update_telem_data(esc_id, t,
+                                                         AP_ESC_Telem::TEMPERATURE | AP_ESC_Telem::MOTOR_TEMPERATURE);
+                        }
                     }
                 }
 
@@ -361,6 +382,12 @@ void AP_ToshibaCAN::loop()
                         WITH_SEMAPHORE(_telem_sem);
                         _telemetry[esc_id].usage_sec = usage_sec;
                         _esc_present_bitmask_recent |= ((uint32_t)1 << esc_id);
+
+                        if (esc_telem != nullptr) {
+                            AP_ESC_Telem::TelemetryData t {};
+                            t.usage_s = usage_sec;
+                            esc_telem->update_telem_data(esc_id, t, AP_ESC_Telem::USAGE);
+                        }
                     }
                 }
             }
@@ -54,6 +54,7 @@
 #include <AP_ADSB/AP_ADSB.h>
 #include "AP_UAVCAN_DNA_Server.h"
 #include <AP_Logger/AP_Logger.h>
+#include <AP_ESC_Telem/AP_ESC_Telem.h>
 
 #define LED_DELAY_US 50000
 
@@ -857,6 +858,18 @@ void AP_UAVCAN::handle_ESC_status(AP_UAVCAN* ap_uavcan, uint8_t node_id, const E
                                  cb.msg->rpm,
                                  cb.msg->power_rating_pct);
 
+    AP_ESC_Telem *esc_telem = AP_ESC_Telem::get_singleton();
+    if (esc_telem != nullptr) {
+        AP_ESC_Telem::TelemetryData t {};
+        t.temperature_cdeg = int16_t((cb.msg->temperature - C_TO_KELVIN) * 100);
+        t.voltage = cb.msg->voltage;
+        t.current = cb.msg->current;
+        t.rpm = cb.msg->rpm;
+        esc_telem->update_telem_data(esc_index, t,
+                                     AP_ESC_Telem::TEMPERATURE | AP_ESC_Telem::VOLTAGE |
+                                     AP_ESC_Telem::CURRENT | AP_ESC_Telem::RPM);
+    }
+
     WITH_SEMAPHORE(_telem_sem);
 
     if (!is_esc_data_index_valid(esc_index)) {
@@ -82,6 +82,7 @@ public:
     enum class Options {
         DoubleNotch = 1<<0,
         DynamicHarmonic = 1<<1,
+        PerMotor = 1<<2,
     };
 
     HarmonicNotchFilterParams(void);
@@ -0,0 +1,175 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MotorNotchFilterBank.h"
+#include "HarmonicNotchFilter.h"
+#include <GCS_MAVLink/GCS.h>
+
+MotorNotchFilterBank::~MotorNotchFilterBank()
+{
+    delete[] _filters;
+    _num_filters = 0;
+    _num_enabled_filters = 0;
+}
+
+/*
+  allocate the notches, at most HNF_MAX_MOTOR_FILTERS
+ */
+void MotorNotchFilterBank::allocate_filters(uint8_t max_filters)
+{
+    max_filters = MIN(max_filters, HNF_MAX_MOTOR_FILTERS);
+    if (max_filters == 0 || _filters != nullptr) {
+        return;
+    }
+    _filters = new Filter[max_filters];
+    if (_filters == nullptr) {
+        GCS_SEND_TEXT(MAV_SEVERITY_WARNING, "Failed to allocate %u bytes for MotorNotchFilterBank", (unsigned int)(max_filters * sizeof(Filter)));
+        return;
+    }
+    _num_filters = max_filters;
+    reset();
+}
+
+/*
+  set the attenuation and quality of the notches from the shaping
+  constraints, in the same way as HarmonicNotchFilter
+ */
+void MotorNotchFilterBank::init(float sample_freq_hz, float center_freq_hz, float bandwidth_hz, float attenuation_dB,
+                                uint8_t harmonics, bool double_notch)
+{
+    // sanity check the input
+    if (_filters == nullptr || is_zero(sample_freq_hz) || isnan(sample_freq_hz)) {
+        return;
+    }
+
+    _sample_freq_hz = sample_freq_hz;
+    _harmonics = harmonics;
+    _double_notch = double_notch;
+
+    const float nyquist_limit = sample_freq_hz * 0.48f;
+    const float bandwidth_limit = bandwidth_hz * 0.52f;
+    center_freq_hz = constrain_float(center_freq_hz, bandwidth_limit, nyquist_limit);
+    _notch_spread = bandwidth_hz / (32 * center_freq_hz);
+
+    if (_double_notch) {
+        NotchFilter<float>::calculate_A_and_Q(center_freq_hz, bandwidth_hz * 0.5, attenuation_dB, _A, _Q);
+    } else {
+        NotchFilter<float>::calculate_A_and_Q(center_freq_hz, bandwidth_hz, attenuation_dB, _A, _Q);
+    }
+
+    _num_enabled_filters = 0;
+    _initialised = true;
+}
+
+uint8_t MotorNotchFilterBank::filters_per_motor(void) const
+{
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < HNF_MAX_HARMONICS; i++) {
+        if ((1U<<i) & _harmonics) {
+            n++;
+        }
+    }
+    return _double_notch ? n * 2 : n;
+}
+
+/*
+  set the coefficients of the next notch. Notches at or above the
+  nyquist limit are left out
+ */
+void MotorNotchFilterBank::set_notch(float center_freq_hz)
+{
+    if (center_freq_hz >= _sample_freq_hz * 0.48f || _Q <= 0.0f) {
+        return;
+    }
+    const float omega = 2.0 * M_PI * center_freq_hz / _sample_freq_hz;
+    const float alpha = sinf(omega) / (2 * _Q);
+    const float a0_inv = 1.0 / (1.0 + alpha);
+    Filter &f = _filters[_num_enabled_filters++];
+    f.b0 = (1.0 + alpha*sq(_A)) * a0_inv;
+    f.b1 = -2.0 * cosf(omega) * a0_inv;
+    f.b2 = (1.0 - alpha*sq(_A)) * a0_inv;
+    f.a2 = (1.0 - alpha) * a0_inv;
+}
+
+/*
+  update the notches of every motor from its fundamental frequency.
+  This is cheaper than init() because A & Q do not need to be
+  recalculated. A notch keeps its state when its frequency changes
+ */
+bool MotorNotchFilterBank::update(uint8_t num_motors, const float motor_freq_hz[])
+{
+    if (!_initialised) {
+        return false;
+    }
+    if (num_motors * filters_per_motor() > _num_filters) {
+        return false;
+    }
+
+    const float nyquist_limit = _sample_freq_hz * 0.48f;
+
+    _num_enabled_filters = 0;
+    for (uint8_t m = 0; m < num_motors; m++) {
+        const float motor_freq = constrain_float(motor_freq_hz[m], 1.0f, nyquist_limit);
+        for (uint8_t i = 0; i < HNF_MAX_HARMONICS; i++) {
+            if (((1U<<i) & _harmonics) == 0) {
+                continue;
+            }
+            const float notch_center = motor_freq * (i+1);
+            if (_double_notch) {
+                set_notch(notch_center * (1.0 - _notch_spread));
+                set_notch(notch_center * (1.0 + _notch_spread));
+            } else {
+                set_notch(notch_center);
+            }
+        }
+    }
+    return true;
+}
+
+/*
+  apply a sample to each of the notches in turn and return the output.
+  The notches depend on each other so they are done in order, with the
+  three axes of each notch in one loop the compiler can vectorise
+ */
+Vector3f MotorNotchFilterBank::apply(const Vector3f &sample)
+{
+    if (!_initialised) {
+        return sample;
+    }
+
+    float x[4] { sample.x, sample.y, sample.z, 0 };
+    for (uint8_t i = 0; i < _num_enabled_filters; i++) {
+        Filter &f = _filters[i];
+        for (uint8_t j = 0; j < 4; j++) {
+            const float y = f.b0 * x[j] + f.s1[j];
+            f.s1[j] = f.b1 * (x[j] - y) + f.s2[j];
+            f.s2[j] = f.b2 * x[j] - f.a2 * y;
+            x[j] = y;
+        }
+    }
+    return Vector3f(x[0], x[1], x[2]);
+}
+
+/*
+  clear the state of all of the notches
+ */
+void MotorNotchFilterBank::reset()
+{
+    for (uint8_t i = 0; i < _num_filters; i++) {
+        Filter &f = _filters[i];
+        memset(f.s1, 0, sizeof(f.s1));
+        memset(f.s2, 0, sizeof(f.s2));
+    }
+}
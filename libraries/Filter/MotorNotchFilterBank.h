@@ -0,0 +1,81 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <AP_Math/AP_Math.h>
+
+// limit on the notches of all motors together, which bounds the cost
+// of filtering a gyro sample whatever the number of motors
+#ifndef HNF_MAX_MOTOR_FILTERS
+#define HNF_MAX_MOTOR_FILTERS 32
+#endif
+
+/*
+  a set of harmonic notches with a separate fundamental frequency for
+  each motor, for vehicles whose motors do not all turn at the same
+  speed.
+
+  Every notch is applied to every gyro sample in turn. Each notch is a
+  biquad in transposed direct form II with coefficients normalised by
+  a0, and keeps the state of the three axes side by side with a fourth
+  unused lane, so the three axes of a notch are computed together in
+  one vector on targets that have them.
+ */
+class MotorNotchFilterBank {
+public:
+    ~MotorNotchFilterBank();
+    // allocate space for up to max_filters notches
+    void allocate_filters(uint8_t max_filters);
+    // set the shape of the notches. harmonics is a bitmask of the
+    // multiples of each motor frequency to notch
+    void init(float sample_freq_hz, float center_freq_hz, float bandwidth_hz, float attenuation_dB,
+              uint8_t harmonics, bool double_notch);
+    // set the fundamental frequency of each motor. Returns false, leaving
+    // the notches as they were, if there is not room for all of them
+    bool update(uint8_t num_motors, const float motor_freq_hz[]);
+    // apply a sample to each of the notches in turn
+    Vector3f apply(const Vector3f &sample);
+    // clear the state of all notches
+    void reset();
+
+    // notches needed for each motor
+    uint8_t filters_per_motor(void) const;
+    uint8_t max_filters(void) const { return _num_filters; }
+    uint8_t num_enabled_filters(void) const { return _num_enabled_filters; }
+
+private:
+    // one notch. For a notch a1 is equal to b1
+    struct Filter {
+        float b0, b1, b2, a2;
+        float s1[4];
+        float s2[4];
+    };
+
+    void set_notch(float center_freq_hz);
+
+    Filter *_filters;
+    float _sample_freq_hz;
+    // base double notch bandwidth for each filter
+    float _notch_spread;
+    // attenuation and quality factor of each filter
+    float _A;
+    float _Q;
+    // a bitmask of the harmonics to use
+    uint8_t _harmonics;
+    bool _double_notch;
+    uint8_t _num_filters;
+    uint8_t _num_enabled_filters;
+    bool _initialised;
+};
@@ -0,0 +1,77 @@
+#include <AP_gbenchmark.h>
+
+#include <Filter/MotorNotchFilterBank.h>
+#include <Filter/NotchFilter.h>
+
+/*
+  the cost of filtering one gyro sample with the first and second
+  harmonic of each motor notched, with the per-motor bank and with a
+  NotchFilter<Vector3f> for each notch as HarmonicNotchFilter uses
+ */
+
+static const float sample_freq = 1000;
+static const float motor_freq[] { 70, 85, 100, 115, 130, 145, 160, 175 };
+
+static Vector3f gyro_sample(uint32_t n)
+{
+    const float s = sinf(n * 0.3f);
+    return Vector3f(s, 0.5f * s, -s);
+}
+
+static void BM_NotchFilterCascade(benchmark::State& state)
+{
+    const uint8_t num_filters = state.range(0) * 2;
+    float A, Q;
+    NotchFilter<Vector3f>::calculate_A_and_Q(80, 40, 40, A, Q);
+    NotchFilter<Vector3f> *notches = new NotchFilter<Vector3f>[num_filters];
+    for (uint8_t i = 0; i < num_filters; i++) {
+        notches[i].init_with_A_and_Q(sample_freq, motor_freq[i/2] * (1 + i%2), A, Q);
+    }
+    uint32_t n = 0;
+
+    while (state.KeepRunning()) {
+        Vector3f v = gyro_sample(n++);
+        for (uint8_t i = 0; i < num_filters; i++) {
+            v = notches[i].apply(v);
+        }
+        gbenchmark_escape(&v);
+    }
+    delete[] notches;
+}
+
+static void BM_MotorNotchFilterBank(benchmark::State& state)
+{
+    const uint8_t num_motors = state.range(0);
+    MotorNotchFilterBank *bank = new MotorNotchFilterBank();
+    bank->allocate_filters(HNF_MAX_MOTOR_FILTERS);
+    bank->init(sample_freq, 80, 40, 40, 0x3, false);
+    bank->update(num_motors, motor_freq);
+    uint32_t n = 0;
+
+    while (state.KeepRunning()) {
+        Vector3f v = bank->apply(gyro_sample(n++));
+        gbenchmark_escape(&v);
+    }
+    delete bank;
+}
+
+// the cost of moving the notches of all motors to new frequencies
+static void BM_MotorNotchFilterBankUpdate(benchmark::State& state)
+{
+    const uint8_t num_motors = state.range(0);
+    MotorNotchFilterBank *bank = new MotorNotchFilterBank();
+    bank->allocate_filters(HNF_MAX_MOTOR_FILTERS);
+    bank->init(sample_freq, 80, 40, 40, 0x3, false);
+
+    while (state.KeepRunning()) {
+        bank->update(num_motors, motor_freq);
+        gbenchmark_escape(bank);
+    }
+    delete bank;
+}
+
+BENCHMARK(BM_NotchFilterCascade)->Arg(1)->Arg(4)->Arg(8);
+BENCHMARK(BM_MotorNotchFilterBank)->Arg(1)->Arg(4)->Arg(8);
+BENCHMARK(BM_MotorNotchFilterBankUpdate)->Arg(1)->Arg(4)->Arg(8);
+
+BENCHMARK_MAIN();
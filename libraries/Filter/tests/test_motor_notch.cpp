@@ -0,0 +1,102 @@
+#include <AP_gtest.h>
+
+#include <Filter/MotorNotchFilterBank.h>
+#include <Filter/NotchFilter.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+static const float sample_freq = 1000;
+static const float center_freq = 80;
+static const float bandwidth = 40;
+static const float attenuation = 40;
+
+// a gyro sample with some noise at each of the motor frequencies
+static Vector3f sample(uint16_t n, uint8_t num_motors, const float motor_freq[])
+{
+    Vector3f v { 0.1f, -0.2f, 0.3f };
+    for (uint8_t m = 0; m < num_motors; m++) {
+        const float s = sinf(2 * M_PI * motor_freq[m] * n / sample_freq);
+        v += Vector3f(s, 0.5f * s, -s);
+    }
+    return v;
+}
+
+// the bank gives the same output as a NotchFilter for each notch in turn
+TEST(MotorNotchFilterBank, matches_notch_cascade)
+{
+    const float motor_freq[] { 80, 95, 110, 123 };
+    const uint8_t num_motors = ARRAY_SIZE(motor_freq);
+
+    MotorNotchFilterBank *bank = new MotorNotchFilterBank();
+    bank->allocate_filters(HNF_MAX_MOTOR_FILTERS);
+    bank->init(sample_freq, center_freq, bandwidth, attenuation, 0x3, false);
+    EXPECT_TRUE(bank->update(num_motors, motor_freq));
+    EXPECT_EQ(num_motors * 2, bank->num_enabled_filters());
+
+    float A, Q;
+    NotchFilter<Vector3f>::calculate_A_and_Q(center_freq, bandwidth, attenuation, A, Q);
+    NotchFilter<Vector3f> *notches = new NotchFilter<Vector3f>[num_motors * 2];
+    for (uint8_t m = 0; m < num_motors; m++) {
+        notches[m*2].init_with_A_and_Q(sample_freq, motor_freq[m], A, Q);
+        notches[m*2+1].init_with_A_and_Q(sample_freq, motor_freq[m] * 2, A, Q);
+    }
+
+    for (uint16_t n = 0; n < 2000; n++) {
+        const Vector3f input = sample(n, num_motors, motor_freq);
+        Vector3f expected = input;
+        for (uint8_t i = 0; i < num_motors * 2; i++) {
+            expected = notches[i].apply(expected);
+        }
+        const Vector3f output = bank->apply(input);
+        EXPECT_NEAR(expected.x, output.x, 1.0e-4f);
+        EXPECT_NEAR(expected.y, output.y, 1.0e-4f);
+        EXPECT_NEAR(expected.z, output.z, 1.0e-4f);
+    }
+    delete[] notches;
+    delete bank;
+}
+
+// noise at every motor frequency is removed, leaving the constant rate
+TEST(MotorNotchFilterBank, attenuates_each_motor)
+{
+    const float motor_freq[] { 70, 85, 100, 115, 130, 145 };
+    const uint8_t num_motors = ARRAY_SIZE(motor_freq);
+
+    MotorNotchFilterBank *bank = new MotorNotchFilterBank();
+    bank->allocate_filters(HNF_MAX_MOTOR_FILTERS);
+    bank->init(sample_freq, center_freq, bandwidth, attenuation, 0x1, true);
+    EXPECT_TRUE(bank->update(num_motors, motor_freq));
+
+    float max_error = 0;
+    for (uint16_t n = 0; n < 3000; n++) {
+        const Vector3f output = bank->apply(sample(n, num_motors, motor_freq));
+        if (n > 2000) {
+            max_error = MAX(max_error, (output - Vector3f(0.1f, -0.2f, 0.3f)).length());
+        }
+    }
+    EXPECT_LT(max_error, 0.05f);
+    delete bank;
+}
+
+// an update needing more notches than were allocated is refused
+TEST(MotorNotchFilterBank, overload)
+{
+    const float motor_freq[] { 70, 85, 100, 115, 130, 145, 160, 175 };
+
+    MotorNotchFilterBank *bank = new MotorNotchFilterBank();
+    bank->allocate_filters(8);
+    bank->init(sample_freq, center_freq, bandwidth, attenuation, 0x3, false);
+    EXPECT_EQ(2, bank->filters_per_motor());
+    EXPECT_TRUE(bank->update(4, motor_freq));
+    EXPECT_EQ(8, bank->num_enabled_filters());
+    EXPECT_FALSE(bank->update(5, motor_freq));
+    EXPECT_EQ(8, bank->num_enabled_filters());
+
+    // notches above the nyquist limit are left out
+    const float fast_motor[] { 300 };
+    EXPECT_TRUE(bank->update(1, fast_motor));
+    EXPECT_EQ(1, bank->num_enabled_filters());
+    delete bank;
+}
+
+AP_GTEST_MAIN()
@@ -27,6 +27,14 @@
 
 #define GCS_DEBUG_SEND_MESSAGE_TIMINGS 0
 
+#ifndef HAL_GCS_MESSAGE_STATS_ENABLED
+#ifdef HAL_NO_GCS
+#define HAL_GCS_MESSAGE_STATS_ENABLED 0
+#else
+#define HAL_GCS_MESSAGE_STATS_ENABLED !HAL_MINIMIZE_FEATURES
+#endif
+#endif
+
 #ifndef HAL_NO_GCS
 
 // macros used to determine if a message will fit in the space available.
@@ -337,6 +345,13 @@ public:
 
     MAV_RESULT set_message_interval(uint32_t msg_id, int32_t interval_us);
 
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+    // display per-message send statistics as text buffer for @SYS/mavlink.txt
+    size_t message_stats_info(char *buf, size_t bufsize) const;
+    // display FTP read statistics as text buffer for @SYS/mavlink.txt
+    static size_t ftp_stats_info(char *buf, size_t bufsize);
+#endif
+
 protected:
 
     virtual bool in_hil_mode() const { return false; }
@@ -604,6 +619,7 @@ private:
         Bitmask<MSG_LAST> ap_message_ids;
         uint16_t interval_ms;
         uint16_t last_sent_ms; // from AP_HAL::millis16()
+        uint8_t weight;        // share of a saturated link, see ap_message_weight()
     };
     deferred_message_bucket_t deferred_message_bucket[10];
     static const uint8_t no_bucket_to_send = -1;
@@ -614,6 +630,36 @@ private:
     ap_message next_deferred_bucket_message_to_send(uint16_t now16_ms);
     void find_next_bucket_to_send(uint16_t now16_ms);
     void remove_message_from_bucket(int8_t bucket, ap_message id);
+    static uint8_t ap_message_weight(ap_message id);
+    void update_bucket_weight(uint8_t bucket);
+
+    // link bandwidth budget for streamed messages.  The budget is
+    // refilled at the link rate and every message sent is charged its
+    // encoded size; bucket messages are held back when the budget
+    // can't cover them rather than failing payload-space checks at
+    // random.
+    struct {
+        uint32_t tokens;
+        uint32_t max_tokens;
+        uint32_t last_refill_us;
+        bool unlimited;                // port bandwidth unknown, budget not applied
+        uint8_t radio_scale_pct = 100; // reduced when RADIO_STATUS reports a filling txbuf
+    } send_budget;
+    void refill_send_budget(void);
+    bool send_budget_available(const ap_message id) const;
+
+    // encoded size of each ap_message as last sent on this link
+    uint16_t ap_message_size[MSG_LAST] {};
+
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+    struct ap_message_stats_t {
+        uint32_t sent;
+        uint32_t deferred; // intervals held back by the budget or lack of payload space
+        uint16_t last_deferred_ms;
+        bool deferring;
+    } ap_message_stats[MSG_LAST] {};
+    void note_message_deferred(ap_message id);
+#endif
 
     // bitmask of IDs the code has spontaneously decided it wants to
     // send out.  Examples include HEARTBEAT (gcs_send_heartbeat)
@@ -762,12 +808,34 @@ private:
         int16_t current_session;
         uint32_t last_send_ms;
         uint8_t need_banner_send_mask;
+
+        // prefetch ring holding the file from read_ring_offset on.
+        // Blocks are read into it while the link is busy sending
+        // earlier replies, and FTP packets are sliced out of it
+        uint8_t *read_ring;
+        uint32_t read_ring_offset;  // file offset of the oldest byte held
+        uint16_t read_ring_head;    // index of that byte in read_ring
+        uint16_t read_ring_len;     // number of bytes held
+        bool read_ring_eof;         // the file ends after the bytes held
+
+        // read statistics of the current session, the last complete
+        // session and all sessions, for @SYS/mavlink.txt
+        struct read_stats {
+            uint32_t bytes;
+            uint32_t ms;
+            uint32_t fs_reads;
+        } session_stats, last_stats, total_stats;
+        uint32_t session_start_ms;
     };
     static struct ftp_state ftp;
 
     static void ftp_error(struct pending_ftp &response, FTP_ERROR error); // FTP helper method for packing a NAK
     static int gen_dir_entry(char *dest, size_t space, const char * path, const struct dirent * entry); // FTP helper for emitting a dir response
     static void ftp_list_dir(struct pending_ftp &request, struct pending_ftp &response);
+    static bool ftp_ring_fill(void);
+    static bool ftp_prefetch(void);
+    static int32_t ftp_read(uint32_t offset, uint8_t *dest, uint8_t len);
+    static void ftp_close_file(void);
 
     bool ftp_init(void);
     void handle_file_transfer_protocol(const mavlink_message_t &msg);
@@ -886,6 +954,11 @@ public:
     virtual void send_textv(MAV_SEVERITY severity, const char *fmt, va_list arg_list, uint8_t mask);
     uint8_t statustext_send_channel_mask() const;
 
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+    // display per-link message statistics as text buffer for @SYS/mavlink.txt
+    size_t message_stats_info(char *buf, size_t bufsize) const;
+#endif
+
     virtual GCS_MAVLINK *chan(const uint8_t ofs) = 0;
     virtual const GCS_MAVLINK *chan(const uint8_t ofs) const = 0;
     // return the number of valid GCS objects
@@ -977,8 +1050,10 @@ private:
 
     struct statustext_t {
         uint8_t                 bitmask;
+        uint8_t                 repeats;    // identical messages coalesced into this one
         mavlink_statustext_t    msg;
     };
+    // buffer for messages too long to send in one chunk
     char statustext_printf_buffer[256+1];
 
     virtual AP_GPS::GPS_Status min_status_for_gps_healthy() const {
@@ -989,16 +1064,29 @@ private:
     void update_sensor_status_flags();
 
     void service_statustext(void);
+    void queue_statustext(const statustext_t *chunks, uint8_t count);
+    void drain_statustext_incoming(void);
 #if HAL_MEM_CLASS <= HAL_MEM_CLASS_192 || CONFIG_HAL_BOARD == HAL_BOARD_SITL
     static const uint8_t _status_capacity = 5;
 #else
     static const uint8_t _status_capacity = 30;
 #endif
 
-    // a lock for the statustext queue, to make it safe to use send_text()
-    // from multiple threads
+    // most chunks a message in statustext_printf_buffer can need
+    static const uint8_t _statustext_max_chunks = (sizeof(statustext_printf_buffer) + MAVLINK_MSG_STATUSTEXT_FIELD_TEXT_LEN - 1) / MAVLINK_MSG_STATUSTEXT_FIELD_TEXT_LEN;
+
+    // chunks of a long message, all queued together
+    statustext_t statustext_chunks[_statustext_max_chunks];
+
+    // a lock for statustext_printf_buffer, statustext_chunks and
+    // _statustext_queue, and for popping from _statustext_incoming
     HAL_Semaphore _statustext_sem;
 
+    // statustext messages from any thread, waiting to be moved to
+    // _statustext_queue by the main thread, or by a pushing thread
+    // which finds it full
+    ObjectQueueMPSC<statustext_t> _statustext_incoming{_status_capacity};
+
     // queue of outgoing statustext messages
     ObjectArray<statustext_t> _statustext_queue{_status_capacity};
 
@@ -666,6 +666,14 @@ void GCS_MAVLINK::handle_radio_status(const mavlink_message_t &msg, bool log_rad
         stream_slowdown_ms -= 20;
     }
 
+    // the radio's buffer also tells us how much of the nominal link
+    // bandwidth we are really getting; scale the send budget to match
+    if (packet.txbuf < 50 && send_budget.radio_scale_pct > 20) {
+        send_budget.radio_scale_pct -= 10;
+    } else if (packet.txbuf > 90 && send_budget.radio_scale_pct < 100) {
+        send_budget.radio_scale_pct += 5;
+    }
+
 #if GCS_DEBUG_SEND_MESSAGE_TIMINGS
     if (stream_slowdown_ms > max_slowdown_ms) {
         max_slowdown_ms = stream_slowdown_ms;
@@ -906,6 +914,7 @@ void GCS_MAVLINK::find_next_bucket_to_send(uint16_t now16_ms)
     // all done sending this bucket... find another bucket...
     sending_bucket_id = no_bucket_to_send;
     uint16_t ms_before_send_next_bucket_to_send = UINT16_MAX;
+    uint32_t overdue_score_next_bucket_to_send = 0;
     for (uint8_t i=0; i<ARRAY_SIZE(deferred_message_bucket); i++) {
         if (deferred_message_bucket[i].ap_message_ids.count() == 0) {
             // no entries
@@ -914,15 +923,24 @@ void GCS_MAVLINK::find_next_bucket_to_send(uint16_t now16_ms)
         const uint16_t interval = get_reschedule_interval_ms(deferred_message_bucket[i]);
         const uint16_t ms_since_last_sent = now16_ms - deferred_message_bucket[i].last_sent_ms;
         uint16_t ms_before_send_this_bucket;
+        uint32_t overdue_score = 0;
         if (ms_since_last_sent > interval) {
             // should already have sent this bucket!
             ms_before_send_this_bucket = 0;
+            // several buckets are overdue when the link is saturated.
+            // Weighted fair queueing: the bucket furthest behind
+            // relative to its interval, scaled by its weight, goes
+            // first, so each stream is slowed by a similar fraction
+            // and high weight streams are slowed least
+            overdue_score = (uint32_t(ms_since_last_sent - interval) * deferred_message_bucket[i].weight * 256U) / MAX(interval, 1U);
         } else {
             ms_before_send_this_bucket = interval - ms_since_last_sent;
         }
-        if (ms_before_send_this_bucket < ms_before_send_next_bucket_to_send) {
+        if (ms_before_send_this_bucket < ms_before_send_next_bucket_to_send ||
+            (ms_before_send_this_bucket == 0 && overdue_score > overdue_score_next_bucket_to_send)) {
             sending_bucket_id = i;
             ms_before_send_next_bucket_to_send = ms_before_send_this_bucket;
+            overdue_score_next_bucket_to_send = overdue_score;
         }
     }
     if (sending_bucket_id != no_bucket_to_send) {
@@ -981,14 +999,30 @@ bool GCS_MAVLINK::do_try_send_message(const ap_message id)
     void *data = hal.scheduler->disable_interrupts_save();
     uint32_t start_send_message_us = AP_HAL::micros();
 #endif
+    const uint32_t start_tx_bytes = comm_get_tx_bytes(chan);
     if (!try_send_message(id)) {
         // didn't fit in buffer...
 #if GCS_DEBUG_SEND_MESSAGE_TIMINGS
         try_send_message_stats.no_space_for_message++;
         hal.scheduler->restore_interrupts(data);
+#endif
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+        note_message_deferred(id);
 #endif
         return false;
     }
+
+    // learn the encoded size of this message and charge it to the
+    // link budget
+    const uint32_t sent_bytes = comm_get_tx_bytes(chan) - start_tx_bytes;
+    if (sent_bytes != 0) {
+        ap_message_size[id] = MIN(sent_bytes, UINT16_MAX);
+    }
+    send_budget.tokens -= MIN(sent_bytes, send_budget.tokens);
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+    ap_message_stats[id].sent++;
+    ap_message_stats[id].deferring = false;
+#endif
 #if GCS_DEBUG_SEND_MESSAGE_TIMINGS
     const uint32_t delta_us = AP_HAL::micros() - start_send_message_us;
     hal.scheduler->restore_interrupts(data);
@@ -1000,6 +1034,85 @@ bool GCS_MAVLINK::do_try_send_message(const ap_message id)
     return true;
 }
 
+// refill the link budget based on the time since the last refill
+void GCS_MAVLINK::refill_send_budget(void)
+{
+    const uint32_t now_us = AP_HAL::micros();
+    const uint32_t dt_us = now_us - send_budget.last_refill_us;
+    send_budget.last_refill_us = now_us;
+
+    const uint32_t link_bytes_per_sec = _port->bw_in_kilobytes_per_second() * 1024U * send_budget.radio_scale_pct / 100U;
+
+    // with no bandwidth estimate for the port (unknown or very low
+    // baud rate) streams are not held back
+    send_budget.unlimited = (link_bytes_per_sec == 0);
+    if (send_budget.unlimited) {
+        return;
+    }
+
+    // never bank more than 100ms of link time, so a quiet period
+    // can't be followed by a burst which overruns the radio
+    send_budget.max_tokens = MAX(link_bytes_per_sec / 10U, 300U);
+    const uint64_t refill = (uint64_t(link_bytes_per_sec) * dt_us) / 1000000U;
+    send_budget.tokens = MIN(uint64_t(send_budget.tokens) + refill, uint64_t(send_budget.max_tokens));
+}
+
+// return true if the link budget can cover sending the given message
+bool GCS_MAVLINK::send_budget_available(const ap_message id) const
+{
+    // messages we have never sent are assumed to fit so we can learn
+    // their size.  A full budget always allows a send so messages
+    // which emit several packets can't be starved
+    if (send_budget.unlimited) {
+        return true;
+    }
+    return send_budget.tokens >= MIN(uint32_t(ap_message_size[id]), send_budget.max_tokens);
+}
+
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+// count a message held back by the budget or lack of payload space.
+// Sending is retried on every pass of update_send(), so a deferral is
+// only counted once for each interval of the message it misses
+void GCS_MAVLINK::note_message_deferred(ap_message id)
+{
+    ap_message_stats_t &st = ap_message_stats[id];
+    const uint16_t now16_ms = AP_HAL::millis16();
+    if (st.deferring) {
+        uint16_t interval_ms;
+        if (!get_ap_message_interval(id, interval_ms) || interval_ms == 0 ||
+            uint16_t(now16_ms - st.last_deferred_ms) < interval_ms) {
+            return;
+        }
+    }
+    st.deferred++;
+    st.last_deferred_ms = now16_ms;
+    st.deferring = true;
+}
+
+// display per-message send statistics as text buffer for @SYS/mavlink.txt
+size_t GCS_MAVLINK::message_stats_info(char *buf, size_t bufsize) const
+{
+    size_t total = 0;
+    for (uint8_t i=0; i<MSG_LAST; i++) {
+        const ap_message_stats_t &st = ap_message_stats[i];
+        if (st.sent == 0 && st.deferred == 0) {
+            continue;
+        }
+        const int n = hal.util->snprintf(buf, bufsize, "%u %3u SIZE=%3u SENT=%7u DEFER=%7u\n",
+                                         unsigned(chan), unsigned(i),
+                                         unsigned(ap_message_size[i]),
+                                         unsigned(st.sent), unsigned(st.deferred));
+        if (n <= 0 || size_t(n) >= bufsize) {
+            break;
+        }
+        buf += n;
+        bufsize -= n;
+        total += n;
+    }
+    return total;
+}
+#endif
+
 int8_t GCS_MAVLINK::get_deferred_message_index(const ap_message id) const
 {
     for (uint8_t i=0; i<ARRAY_SIZE(deferred_message); i++) {
@@ -1069,6 +1182,8 @@ void GCS_MAVLINK::update_send()
     uint32_t retry_deferred_body_start = AP_HAL::micros();
 #endif
 
+    refill_send_budget();
+
     const uint32_t start = AP_HAL::millis();
     const uint16_t start16 = start & 0xFFFF;
     while (AP_HAL::millis() - start < 5) { // spend a max of 5ms sending messages.  This should never trigger - out_of_time() should become true
@@ -1133,6 +1248,14 @@ void GCS_MAVLINK::update_send()
 
         ap_message next = next_deferred_bucket_message_to_send(start16);
         if (next != no_message_to_send) {
+            if (!send_budget_available(next)) {
+                // link budget exhausted; the bucket stays due and
+                // will be sent when the budget has been refilled
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+                note_message_deferred(next);
+#endif
+                break;
+            }
             if (!do_try_send_message(next)) {
                 break;
             }
@@ -1180,9 +1303,46 @@ void GCS_MAVLINK::update_send()
     }
 }
 
+/*
+  weight of a streamed message when the link is saturated.  Attitude
+  and position are what a GCS operator flies by, so are slowed least
+ */
+uint8_t GCS_MAVLINK::ap_message_weight(ap_message id)
+{
+    switch (id) {
+    case MSG_ATTITUDE:
+    case MSG_LOCATION:
+    case MSG_VFR_HUD:
+        return 4;
+    case MSG_SYS_STATUS:
+    case MSG_EXTENDED_SYS_STATE:
+    case MSG_GPS_RAW:
+    case MSG_BATTERY_STATUS:
+    case MSG_EKF_STATUS_REPORT:
+    case MSG_NAV_CONTROLLER_OUTPUT:
+    case MSG_CURRENT_WAYPOINT:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+// the weight of a bucket is that of the most important message in it
+void GCS_MAVLINK::update_bucket_weight(uint8_t bucket)
+{
+    uint8_t weight = 0;
+    for (uint8_t i=0; i<MSG_LAST; i++) {
+        if (deferred_message_bucket[bucket].ap_message_ids.get(i)) {
+            weight = MAX(weight, ap_message_weight(ap_message(i)));
+        }
+    }
+    deferred_message_bucket[bucket].weight = weight;
+}
+
 void GCS_MAVLINK::remove_message_from_bucket(int8_t bucket, ap_message id)
 {
     deferred_message_bucket[bucket].ap_message_ids.clear(id);
+    update_bucket_weight(bucket);
     if (deferred_message_bucket[bucket].ap_message_ids.count() == 0) {
         // bucket empty.  Free it:
         deferred_message_bucket[bucket].interval_ms = 0;
@@ -1305,6 +1465,7 @@ bool GCS_MAVLINK::set_ap_message_interval(enum ap_message id, uint16_t interval_
     }
 
     deferred_message_bucket[closest_bucket].ap_message_ids.set(id);
+    update_bucket_weight(closest_bucket);
 
     if (sending_bucket_id == no_bucket_to_send) {
         sending_bucket_id = closest_bucket;
@@ -1859,13 +2020,13 @@ void GCS::send_textv(MAV_SEVERITY severity, const char *fmt, va_list arg_list, u
 {
     char first_piece_of_text[MAVLINK_MSG_STATUSTEXT_FIELD_TEXT_LEN+1]{};
 
-    do {
-        WITH_SEMAPHORE(_statustext_sem);
-        // send_text can be called from multiple threads; we must
-        // protect the "text" member with _statustext_sem
-        hal.util->vsnprintf(statustext_printf_buffer, sizeof(statustext_printf_buffer), fmt, arg_list);
-        memcpy(first_piece_of_text, statustext_printf_buffer, ARRAY_SIZE(first_piece_of_text)-1);
+    // most messages fit in one chunk, so format them without taking
+    // any lock. Longer messages are formatted again below
+    va_list arg_list_copy;
+    va_copy(arg_list_copy, arg_list);
+    const int len = hal.util->vsnprintf(first_piece_of_text, sizeof(first_piece_of_text), fmt, arg_list);
 
+    do {
         // filter destination ports to only allow active ports.
         statustext_t statustext{};
         if (update_send_has_been_called) {
@@ -1884,48 +2045,60 @@ void GCS::send_textv(MAV_SEVERITY severity, const char *fmt, va_list arg_list, u
 
         statustext.msg.severity = severity;
 
-        static uint16_t msgid;
-        if (strlen(statustext_printf_buffer) > sizeof(statustext.msg.text)) {
+        if (len <= int(sizeof(statustext.msg.text))) {
+            memcpy(statustext.msg.text, first_piece_of_text, sizeof(statustext.msg.text));
+            queue_statustext(&statustext, 1);
+        } else {
+            // send_text can be called from multiple threads; we must
+            // protect statustext_printf_buffer and statustext_chunks
+            // with _statustext_sem
+            WITH_SEMAPHORE(_statustext_sem);
+            hal.util->vsnprintf(statustext_printf_buffer, sizeof(statustext_printf_buffer), fmt, arg_list_copy);
+
+            static uint16_t msgid;
             msgid++;
             if (msgid == 0) {
                 msgid = 1;
             }
             statustext.msg.id = msgid;
-        }
 
-        const char *remainder = statustext_printf_buffer;
-        for (uint8_t i=0; i<_status_capacity; i++) {
-            statustext.msg.chunk_seq = i;
-            const size_t remainder_len = strlen(remainder);
-            // note that remainder_len may be zero here!
-            uint16_t n = MIN(sizeof(statustext.msg.text), remainder_len);
-            if (i == _status_capacity -1 && n == sizeof(statustext.msg.text)) {
-                // fantastic.  This us a very long statustext and
-                // we've actually managed to push everything else out
-                // of the queue - this is the last chunk, so we MUST
-                // null-terminate.
-                n -= 1;
-            }
-            memset(statustext.msg.text, '\0', sizeof(statustext.msg.text));
-            memcpy(statustext.msg.text, remainder, n);
-            // The force push will ensure comm links do not block other comm links forever if they fail.
-            // If we push to a full buffer then we overwrite the oldest entry, effectively removing the
-            // block but not until the buffer fills up.
-            _statustext_queue.push_force(statustext);
-            remainder = &remainder[n];
-
-            // note that remainder_len here is the remainder length for
-            // the *old* remainder!
-            if (remainder_len < sizeof(statustext.msg.text) || statustext.msg.id == 0) {
-                break;
+            // build all the chunks first so they are queued together
+            // or not at all
+            const uint8_t max_chunks = MIN(_status_capacity, _statustext_max_chunks);
+            const char *remainder = statustext_printf_buffer;
+            uint8_t count = 0;
+            for (uint8_t i=0; i<max_chunks; i++) {
+                statustext.msg.chunk_seq = i;
+                const size_t remainder_len = strlen(remainder);
+                // note that remainder_len may be zero here!
+                uint16_t n = MIN(sizeof(statustext.msg.text), remainder_len);
+                if (i == max_chunks -1 && n == sizeof(statustext.msg.text)) {
+                    // fantastic.  This us a very long statustext and
+                    // it fills the whole queue - this is the last
+                    // chunk, so we MUST null-terminate.
+                    n -= 1;
+                }
+                memset(statustext.msg.text, '\0', sizeof(statustext.msg.text));
+                memcpy(statustext.msg.text, remainder, n);
+                statustext_chunks[count++] = statustext;
+                remainder = &remainder[n];
+
+                // note that remainder_len here is the remainder length for
+                // the *old* remainder!
+                if (remainder_len < sizeof(statustext.msg.text)) {
+                    break;
+                }
             }
+            queue_statustext(statustext_chunks, count);
         }
 
         // try and send immediately if possible
         if (hal.scheduler->in_main_thread()) {
+            WITH_SEMAPHORE(_statustext_sem);
             service_statustext();
         }
     } while (false);
+    va_end(arg_list_copy);
 
     // given we don't really know what these methods get up to, we
     // don't hold the statustext semaphore while doing them:
@@ -1951,7 +2124,63 @@ void GCS::send_textv(MAV_SEVERITY severity, const char *fmt, va_list arg_list, u
 }
 
 /*
-    send a statustext message to specific MAVLink connections in a bitmask
+    queue the chunks of a statustext message from any thread, all of
+    them or none. If the incoming queue is full it is drained into
+    _statustext_queue, which drops the oldest messages rather than
+    this one
+ */
+void GCS::queue_statustext(const statustext_t *chunks, uint8_t count)
+{
+    if (_statustext_incoming.push(chunks, count)) {
+        return;
+    }
+    WITH_SEMAPHORE(_statustext_sem);
+    // another thread may refill the queue between the drain and the
+    // push, so try a few times
+    for (uint8_t i=0; i<3; i++) {
+        drain_statustext_incoming();
+        if (_statustext_incoming.push(chunks, count)) {
+            return;
+        }
+    }
+}
+
+/*
+    move messages from other threads to _statustext_queue. Repeats of
+    a message which hasn't been sent anywhere yet are counted instead
+    of queued, so a storm of warnings doesn't push out other
+    messages. Must be called with _statustext_sem held
+ */
+void GCS::drain_statustext_incoming(void)
+{
+    // The force push will ensure comm links do not block other comm links forever if they fail.
+    // If we push to a full buffer then we overwrite the oldest entry, effectively removing the
+    // block but not until the buffer fills up.
+    statustext_t incoming;
+    while (_statustext_incoming.pop(incoming)) {
+        bool coalesced = false;
+        for (uint8_t idx=0; incoming.msg.id == 0 && idx<_statustext_queue.available(); idx++) {
+            statustext_t *statustext = _statustext_queue[idx];
+            if (statustext->bitmask == incoming.bitmask &&
+                statustext->msg.id == 0 &&
+                statustext->msg.severity == incoming.msg.severity &&
+                strncmp(statustext->msg.text, incoming.msg.text, sizeof(incoming.msg.text)) == 0) {
+                if (statustext->repeats < UINT8_MAX) {
+                    statustext->repeats++;
+                }
+                coalesced = true;
+                break;
+            }
+        }
+        if (!coalesced) {
+            _statustext_queue.push_force(incoming);
+        }
+    }
+}
+
+/*
+    send a statustext message to specific MAVLink connections in a
+    bitmask. Must be called with _statustext_sem held
  */
 void GCS::service_statustext(void)
 {
@@ -1963,6 +2192,8 @@ void GCS::service_statustext(void)
     // is if you have a super slow link mixed with a faster port, if there are _status_capacity
     // strings in the slow queue then the next item can not be queued for the faster link
 
+    drain_statustext_incoming();
+
     if (_statustext_queue.is_empty()) {
         // nothing to do
         return;
@@ -1974,6 +2205,21 @@ void GCS::service_statustext(void)
             break;
         }
 
+        // add the number of messages coalesced into this one if it fits
+        const char *text = statustext->msg.text;
+        char text_repeats[sizeof(statustext->msg.text)];
+        if (statustext->repeats != 0) {
+            const size_t len = strnlen(text, sizeof(text_repeats));
+            char suffix[8];
+            const int n = hal.util->snprintf(suffix, sizeof(suffix), " (x%u)", unsigned(statustext->repeats) + 1);
+            if (n > 0 && len + n <= sizeof(text_repeats)) {
+                memset(text_repeats, '\0', sizeof(text_repeats));
+                memcpy(text_repeats, text, len);
+                memcpy(&text_repeats[len], suffix, n);
+                text = text_repeats;
+            }
+        }
+
         // try and send to all active mavlink ports listed in the statustext.bitmask
         for (uint8_t i=0; i<MAVLINK_COMM_NUM_BUFFERS; i++) {
             uint8_t chan_bit = (1U<<i);
@@ -1983,7 +2229,7 @@ void GCS::service_statustext(void)
                 mavlink_channel_t chan_index = (mavlink_channel_t)(MAVLINK_COMM_0+i);
                 if (HAVE_PAYLOAD_SPACE(chan_index, STATUSTEXT)) {
                     // we have space so send then clear that channel bit on the mask
-                    mavlink_msg_statustext_send(chan_index, statustext->msg.severity, statustext->msg.text, statustext->msg.id, statustext->msg.chunk_seq);
+                    mavlink_msg_statustext_send(chan_index, statustext->msg.severity, text, statustext->msg.id, statustext->msg.chunk_seq);
                     statustext->bitmask &= ~chan_bit;
                 }
             }
@@ -2005,6 +2251,29 @@ void GCS::send_message(enum ap_message id)
     }
 }
 
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+// display per-link message statistics as text buffer for @SYS/mavlink.txt
+size_t GCS::message_stats_info(char *buf, size_t bufsize) const
+{
+    // a header to allow for machine parsers to determine format
+    int n = hal.util->snprintf(buf, bufsize, "MsgStatsV1\n");
+    if (n <= 0) {
+        return 0;
+    }
+    size_t total = n;
+    for (uint8_t i=0; i<num_gcs(); i++) {
+        if (total >= bufsize) {
+            break;
+        }
+        total += chan(i)->message_stats_info(&buf[total], bufsize - total);
+    }
+    if (total < bufsize) {
+        total += GCS_MAVLINK::ftp_stats_info(&buf[total], bufsize - total);
+    }
+    return total;
+}
+#endif
+
 void GCS::update_send()
 {
     update_send_has_been_called = true;
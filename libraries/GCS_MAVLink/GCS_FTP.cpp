@@ -29,6 +29,14 @@ struct GCS_MAVLINK::ftp_state GCS_MAVLINK::ftp;
 // timeout for session inactivity
 #define FTP_SESSION_TIMEOUT 3000
 
+// size of the prefetch ring used for file reads, 0 disables it
+#ifndef FTP_READ_RING_SIZE
+#define FTP_READ_RING_SIZE 2048
+#endif
+
+// size of each filesystem read into the prefetch ring
+#define FTP_READ_RING_BLOCK_SIZE 512
+
 bool GCS_MAVLINK::ftp_init(void) {
 
     // check if ftp is disabled for memory savings
@@ -51,6 +59,12 @@ bool GCS_MAVLINK::ftp_init(void) {
         goto failed;
     }
 
+#if FTP_READ_RING_SIZE > 0
+    // failing to get the prefetch ring is not fatal, reads will go
+    // straight to the filesystem instead
+    ftp.read_ring = new uint8_t[FTP_READ_RING_SIZE];
+#endif
+
     if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&GCS_MAVLINK::ftp_worker, void),
                                       "FTP", 3072, AP_HAL::Scheduler::PRIORITY_IO, 0)) {
         goto failed;
@@ -63,6 +77,8 @@ failed:
     ftp.requests = nullptr;
     delete ftp.replies;
     ftp.replies = nullptr;
+    delete[] ftp.read_ring;
+    ftp.read_ring = nullptr;
 
     return false;
 }
@@ -163,11 +179,129 @@ void GCS_MAVLINK::ftp_error(struct pending_ftp &response, FTP_ERROR error) {
     }
 }
 
+// read the next block of the file into the prefetch ring. The file
+// position is always at the end of the data held, so no seek is needed.
+// Returns false on a filesystem error
+bool GCS_MAVLINK::ftp_ring_fill(void)
+{
+    const uint16_t tail = (ftp.read_ring_head + ftp.read_ring_len) % FTP_READ_RING_SIZE;
+    const uint16_t n = MIN(MIN(FTP_READ_RING_SIZE - ftp.read_ring_len, FTP_READ_RING_BLOCK_SIZE),
+                           FTP_READ_RING_SIZE - tail);
+    if (ftp.read_ring_eof || n == 0) {
+        return true;
+    }
+    const int32_t read_bytes = AP::FS().read(ftp.fd, &ftp.read_ring[tail], n);
+    ftp.session_stats.fs_reads++;
+    if (read_bytes == -1) {
+        // the file position is unknown, so the next read starts again
+        // with a seek
+        ftp.read_ring_offset = UINT32_MAX;
+        ftp.read_ring_len = 0;
+        return false;
+    }
+    ftp.read_ring_len += read_bytes;
+    ftp.read_ring_eof = (read_bytes == 0);
+    return true;
+}
+
+// read ahead of transmission, called while the link has no space for
+// more replies. Returns true if a block was read
+bool GCS_MAVLINK::ftp_prefetch(void)
+{
+    if (ftp.read_ring == nullptr || ftp.fd == -1 || ftp.mode != FTP_FILE_MODE::Read ||
+        ftp.read_ring_eof || FTP_READ_RING_SIZE - ftp.read_ring_len < FTP_READ_RING_BLOCK_SIZE) {
+        return false;
+    }
+    return ftp_ring_fill() && !ftp.read_ring_eof;
+}
+
+// read file data at the given offset, serving it from the prefetch ring
+// where possible. Returns the number of bytes read or -1 on error
+int32_t GCS_MAVLINK::ftp_read(uint32_t offset, uint8_t *dest, uint8_t len)
+{
+    if (ftp.read_ring == nullptr) {
+        if (AP::FS().lseek(ftp.fd, offset, SEEK_SET) == -1) {
+            return -1;
+        }
+        ftp.session_stats.fs_reads++;
+        return AP::FS().read(ftp.fd, dest, len);
+    }
+
+    if (offset < ftp.read_ring_offset || offset - ftp.read_ring_offset > ftp.read_ring_len) {
+        // not held, start the ring again at the requested offset
+        if (AP::FS().lseek(ftp.fd, offset, SEEK_SET) == -1) {
+            return -1;
+        }
+        ftp.read_ring_head = 0;
+        ftp.read_ring_len = 0;
+        ftp.read_ring_eof = false;
+    } else {
+        // data before the offset has been sent, so make room for more
+        const uint16_t sent = offset - ftp.read_ring_offset;
+        ftp.read_ring_head = (ftp.read_ring_head + sent) % FTP_READ_RING_SIZE;
+        ftp.read_ring_len -= sent;
+    }
+    ftp.read_ring_offset = offset;
+
+    while (ftp.read_ring_len < len && !ftp.read_ring_eof) {
+        if (!ftp_ring_fill()) {
+            return -1;
+        }
+    }
+
+    const uint16_t n = MIN(ftp.read_ring_len, len);
+    const uint16_t first = MIN(n, uint16_t(FTP_READ_RING_SIZE - ftp.read_ring_head));
+    memcpy(dest, &ftp.read_ring[ftp.read_ring_head], first);
+    memcpy(&dest[first], ftp.read_ring, n - first);
+    return n;
+}
+
+// close the session file, keeping its read statistics
+void GCS_MAVLINK::ftp_close_file(void)
+{
+    if (ftp.fd == -1) {
+        return;
+    }
+    AP::FS().close(ftp.fd);
+    ftp.fd = -1;
+    ftp.read_ring_len = 0;
+    ftp.read_ring_eof = false;
+
+    if (ftp.mode == FTP_FILE_MODE::Read && ftp.session_stats.bytes > 0) {
+        ftp.session_stats.ms = AP_HAL::millis() - ftp.session_start_ms;
+        ftp.last_stats = ftp.session_stats;
+        ftp.total_stats.bytes += ftp.session_stats.bytes;
+        ftp.total_stats.ms += ftp.session_stats.ms;
+        ftp.total_stats.fs_reads += ftp.session_stats.fs_reads;
+    }
+    ftp.session_stats = {};
+}
+
+#if HAL_GCS_MESSAGE_STATS_ENABLED
+// display FTP read statistics as text buffer for @SYS/mavlink.txt
+size_t GCS_MAVLINK::ftp_stats_info(char *buf, size_t bufsize)
+{
+    const int n = hal.util->snprintf(buf, bufsize, "FTP LAST BYTES=%u MS=%u FSREADS=%u TOTAL BYTES=%u MS=%u FSREADS=%u\n",
+                                     unsigned(ftp.last_stats.bytes), unsigned(ftp.last_stats.ms),
+                                     unsigned(ftp.last_stats.fs_reads),
+                                     unsigned(ftp.total_stats.bytes), unsigned(ftp.total_stats.ms),
+                                     unsigned(ftp.total_stats.fs_reads));
+    if (n <= 0 || size_t(n) >= bufsize) {
+        return 0;
+    }
+    return n;
+}
+#endif
+
 // send our response back out to the system
 void GCS_MAVLINK::ftp_push_replies(pending_ftp &reply)
 {
     while (!ftp.replies->push(reply)) { // we must fit the response, keep shoving it in
-        hal.scheduler->delay(2);
+        // the link is busy sending earlier replies, so read ahead
+        // rather than wait if there is room in the prefetch ring
+        if (!ftp_prefetch()) {
+            hal.scheduler->delay(2);
+        }
     }
 }
 
@@ -226,8 +360,7 @@ void GCS_MAVLINK::ftp_worker(void) {
                 // if a new session appears and the old session has
                 // been idle for more than the timeout then force
                 // close the old session
-                AP::FS().close(ftp.fd);
-                ftp.fd = -1;
+                ftp_close_file();
                 ftp.current_session = -1;
             }
             // dispatch the command as needed
@@ -238,10 +371,7 @@ void GCS_MAVLINK::ftp_worker(void) {
                 case FTP_OP::TerminateSession:
                 case FTP_OP::ResetSessions:
                     // we already handled this, just listed for completeness
-                    if (ftp.fd != -1) {
-                        AP::FS().close(ftp.fd);
-                        ftp.fd = -1;
-                    }
+                    ftp_close_file();
                     ftp.current_session = -1;
                     reply.opcode = FTP_OP::Ack;
                     break;
@@ -255,8 +385,7 @@ void GCS_MAVLINK::ftp_worker(void) {
                             // no activity for 3s, assume client has
                             // timed out receiving open reply, close
                             // the file
-                            AP::FS().close(ftp.fd);
-                            ftp.fd = -1;
+                            ftp_close_file();
                             ftp.current_session = -1;
                         }
                         if (ftp.fd != -1) {
@@ -289,6 +418,12 @@ void GCS_MAVLINK::ftp_worker(void) {
                         }
                         ftp.mode = FTP_FILE_MODE::Read;
                         ftp.current_session = request.session;
+                        ftp.read_ring_offset = 0;
+                        ftp.read_ring_head = 0;
+                        ftp.read_ring_len = 0;
+                        ftp.read_ring_eof = false;
+                        ftp.session_start_ms = now;
+                        ftp.session_stats = {};
 
                         reply.opcode = FTP_OP::Ack;
                         reply.size = sizeof(uint32_t);
@@ -314,14 +449,8 @@ void GCS_MAVLINK::ftp_worker(void) {
                             break;
                         }
 
-                        // seek to requested offset
-                        if (AP::FS().lseek(ftp.fd, request.offset, SEEK_SET) == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
-
                         // fill the buffer
-                        const ssize_t read_bytes = AP::FS().read(ftp.fd, reply.data, request.size);
+                        const int32_t read_bytes = ftp_read(request.offset, reply.data, request.size);
                         if (read_bytes == -1) {
                             ftp_error(reply, FTP_ERROR::FailErrno);
                             break;
@@ -334,6 +463,7 @@ void GCS_MAVLINK::ftp_worker(void) {
                         reply.opcode = FTP_OP::Ack;
                         reply.offset = request.offset;
                         reply.size = (uint8_t)read_bytes;
+                        ftp.session_stats.bytes += read_bytes;
                         break;
                     }
                 case FTP_OP::Ack:
@@ -497,16 +627,14 @@ void GCS_MAVLINK::ftp_worker(void) {
                             break;
                         }
 
-                        // seek to requested offset
-                        if (AP::FS().lseek(ftp.fd, request.offset, SEEK_SET) == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
-
+                        // packets are sliced out of the prefetch ring,
+                        // which is filled a block at a time while the
+                        // reply queue waits for the link
                         const uint32_t transfer_size = 100;
+                        uint32_t read_offset = request.offset;
                         for (uint32_t i = 0; (i < transfer_size); i++) {
                             // fill the buffer
-                            const ssize_t read_bytes = AP::FS().read(ftp.fd, reply.data, max_read);
+                            const int32_t read_bytes = ftp_read(read_offset, reply.data, max_read);
                             if (read_bytes == -1) {
                                 ftp_error(reply, FTP_ERROR::FailErrno);
                                 break;
@@ -523,11 +651,13 @@ void GCS_MAVLINK::ftp_worker(void) {
                             }
 
                             reply.opcode = FTP_OP::Ack;
-                            reply.offset = request.offset + i * max_read;
+                            reply.offset = read_offset;
                             reply.burst_complete = (i == (transfer_size - 1));
                             reply.size = (uint8_t)read_bytes;
 
                             ftp_push_replies(reply);
+                            read_offset += read_bytes;
+                            ftp.session_stats.bytes += read_bytes;
 
                             if (read_bytes < max_read) {
                                 // ensure the NACK which we send next is at the right offset
@@ -66,6 +66,12 @@ void comm_send_buffer(mavlink_channel_t chan, const uint8_t *buf, uint8_t len);
 /// @returns		Number of bytes available
 uint16_t comm_get_txspace(mavlink_channel_t chan);
 
+/// Total number of bytes written to the nominated MAVLink channel
+///
+/// @param chan		Channel to check
+/// @returns		Number of bytes written since boot
+uint32_t comm_get_tx_bytes(mavlink_channel_t chan);
+
 #define MAVLINK_USE_CONVENIENCE_FUNCTIONS
 #include "include/mavlink/v2.0/ardupilotmega/mavlink.h"
 
@@ -29,6 +29,124 @@ extern const AP_HAL::HAL& hal;
 // constructor
 MAVLink_routing::MAVLink_routing(void) : num_routes(0) {}
 
+/*
+  return index of route for sysid/compid, or -1 if not known
+ */
+int16_t MAVLink_routing::find_route(uint8_t sysid, uint8_t compid) const
+{
+    uint16_t idx = route_slot(sysid, compid);
+    for (uint16_t n=0; n<MAVLINK_ROUTING_TABLE_SIZE; n++) {
+        const route &r = routes[idx];
+        if (r.sysid == 0) {
+            break;
+        }
+        if (r.sysid == sysid && r.compid == compid) {
+            return idx;
+        }
+        idx = (idx + 1) & (MAVLINK_ROUTING_TABLE_SIZE-1);
+    }
+    return -1;
+}
+
+/*
+  remove the route at index idx. Later entries in the probe run are
+  shifted back so lookups never need to skip over deleted slots
+ */
+void MAVLink_routing::remove_route(uint16_t idx)
+{
+    uint16_t hole = idx;
+    uint16_t j = idx;
+    while (true) {
+        j = (j + 1) & (MAVLINK_ROUTING_TABLE_SIZE-1);
+        if (routes[j].sysid == 0) {
+            break;
+        }
+        // the entry at j can fill the hole unless its home slot lies
+        // cyclically in (hole, j]
+        const uint16_t home = route_slot(routes[j].sysid, routes[j].compid);
+        const bool home_in_range = (hole <= j) ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!home_in_range) {
+            routes[hole] = routes[j];
+            hole = j;
+        }
+    }
+    memset(&routes[hole], 0, sizeof(routes[hole]));
+    num_routes--;
+
+    all_routes_channel_mask = 0;
+    for (uint16_t i=0; i<MAVLINK_ROUTING_TABLE_SIZE; i++) {
+        all_routes_channel_mask |= routes[i].channel_mask;
+    }
+}
+
+/*
+  remove the least recently seen route if it has not been heard from
+  for MAVLINK_ROUTE_TIMEOUT_MS. Only called when the table is full
+ */
+bool MAVLink_routing::remove_stale_route(uint32_t now_ms)
+{
+    int16_t oldest = -1;
+    uint32_t oldest_age_ms = 0;
+    for (uint16_t i=0; i<MAVLINK_ROUTING_TABLE_SIZE; i++) {
+        if (routes[i].sysid == 0) {
+            continue;
+        }
+        const uint32_t age_ms = now_ms - routes[i].last_seen_ms;
+        if (oldest == -1 || age_ms > oldest_age_ms) {
+            oldest = i;
+            oldest_age_ms = age_ms;
+        }
+    }
+    if (oldest == -1 || oldest_age_ms < MAVLINK_ROUTE_TIMEOUT_MS) {
+        return false;
+    }
+#if ROUTING_DEBUG
+    ::printf("expired route %u %u\n",
+             (unsigned)routes[oldest].sysid,
+             (unsigned)routes[oldest].compid);
+#endif
+    remove_route(oldest);
+    return true;
+}
+
+/*
+  return the mask of channels a message with the given targets should
+  be forwarded on, see the routing rules in check_and_forward()
+ */
+uint8_t MAVLink_routing::forward_channel_mask(int16_t target_system, int16_t target_component,
+                                              bool broadcast_system, bool broadcast_component,
+                                              bool match_system) const
+{
+    // private channels only get messages explicitly targetted at a
+    // sysid/compid seen on them, which can't be the case for broadcasts
+    const uint8_t private_mask = GCS_MAVLINK::private_channel_mask();
+    if (broadcast_system) {
+        return all_routes_channel_mask & ~private_mask;
+    }
+
+    if (match_system && !broadcast_component) {
+        // a single component, which is one lookup
+        const int16_t idx = find_route(uint8_t(target_system), uint8_t(target_component));
+        return (idx == -1) ? 0 : routes[idx].channel_mask;
+    }
+
+    // any component of the target system may match, so all routes are
+    // checked
+    uint8_t mask = 0;
+    for (uint16_t i=0; i<MAVLINK_ROUTING_TABLE_SIZE; i++) {
+        const route &r = routes[i];
+        if (r.sysid != target_system) {
+            continue;
+        }
+        if (target_component == r.compid) {
+            mask |= r.channel_mask;
+        } else {
+            mask |= r.channel_mask & ~private_mask;
+        }
+    }
+    return mask;
+}
+
 /*
   forward a MAVLink message to the right port. This also
   automatically learns the route for the sender if it is not
@@ -140,40 +258,28 @@ bool MAVLink_routing::check_and_forward(mavlink_channel_t in_channel, const mavl
     }
 
     // forward on any channels matching the targets
-    bool forwarded = false;
-    bool sent_to_chan[MAVLINK_COMM_NUM_BUFFERS];
-    memset(sent_to_chan, 0, sizeof(sent_to_chan));
-    for (uint8_t i=0; i<num_routes; i++) {
-
-        // Skip if channel is private and the target system or component IDs do not match
-        if ((GCS_MAVLINK::is_private(routes[i].channel)) &&
-            (target_system != routes[i].sysid ||
-             target_component != routes[i].compid)) {
+    uint8_t mask = forward_channel_mask(target_system, target_component,
+                                        broadcast_system, broadcast_component,
+                                        match_system);
+    mask &= ~(1U<<(in_channel-MAVLINK_COMM_0));
+    const bool forwarded = (mask != 0);
+    for (uint8_t i=0; i<MAVLINK_COMM_NUM_BUFFERS && mask != 0; i++) {
+        if (!(mask & (1U<<i))) {
             continue;
         }
-
-        if (broadcast_system || (target_system == routes[i].sysid &&
-                                 (broadcast_component || 
-                                  target_component == routes[i].compid ||
-                                  !match_system))) {
-
-            if (in_channel != routes[i].channel && !sent_to_chan[routes[i].channel]) {
-                
-                if (comm_get_txspace(routes[i].channel) >= ((uint16_t)msg.len) +
-                    GCS_MAVLINK::packet_overhead_chan(routes[i].channel)) {
+        mask &= ~(1U<<i);
+        const mavlink_channel_t channel = (mavlink_channel_t)(MAVLINK_COMM_0 + i);
+        if (comm_get_txspace(channel) >= ((uint16_t)msg.len) +
+            GCS_MAVLINK::packet_overhead_chan(channel)) {
 #if ROUTING_DEBUG
-                    ::printf("fwd msg %u from chan %u on chan %u sysid=%d compid=%d\n",
-                             msg.msgid,
-                             (unsigned)in_channel,
-                             (unsigned)routes[i].channel,
-                             (int)target_system,
-                             (int)target_component);
+            ::printf("fwd msg %u from chan %u on chan %u sysid=%d compid=%d\n",
+                     msg.msgid,
+                     (unsigned)in_channel,
+                     (unsigned)channel,
+                     (int)target_system,
+                     (int)target_component);
 #endif
-                    _mavlink_resend_uart(routes[i].channel, &msg);
-                }
-                sent_to_chan[routes[i].channel] = true;
-                forwarded = true;
-            }
+            _mavlink_resend_uart(channel, &msg);
         }
     }
 
@@ -201,29 +307,28 @@ void MAVLink_routing::send_to_components(uint32_t msgid, const char *pkt, uint8_
 
 void MAVLink_routing::send_to_components(const char *pkt, const mavlink_msg_entry_t *entry, const uint8_t pkt_len)
 {
-    bool sent_to_chan[MAVLINK_COMM_NUM_BUFFERS] {};
-
-    // check learned routes
-    for (uint8_t i=0; i<num_routes; i++) {
-        if (routes[i].sysid != mavlink_system.sysid) {
-            // our system ID hasn't been seen on this link
-            continue;
+    // find the channels our own system's components have been seen on
+    uint8_t mask = 0;
+    for (uint16_t i=0; i<MAVLINK_ROUTING_TABLE_SIZE; i++) {
+        if (routes[i].sysid == mavlink_system.sysid) {
+            mask |= routes[i].channel_mask;
         }
-        if (sent_to_chan[routes[i].channel]) {
-            // we've already send it on this link
+    }
+
+    for (uint8_t i=0; i<MAVLINK_COMM_NUM_BUFFERS; i++) {
+        if (!(mask & (1U<<i))) {
             continue;
         }
-        if (comm_get_txspace(routes[i].channel) <
-            ((uint16_t)entry->max_msg_len) + GCS_MAVLINK::packet_overhead_chan(routes[i].channel)) {
+        const mavlink_channel_t channel = (mavlink_channel_t)(MAVLINK_COMM_0 + i);
+        if (comm_get_txspace(channel) <
+            ((uint16_t)entry->max_msg_len) + GCS_MAVLINK::packet_overhead_chan(channel)) {
             // it doesn't fit on this channel
             continue;
         }
 #if ROUTING_DEBUG
-        ::printf("send msg %u on chan %u sysid=%u compid=%u\n",
+        ::printf("send msg %u on chan %u\n",
                  entry->msgid,
-                 (unsigned)routes[i].channel,
-                 (unsigned)routes[i].sysid,
-                 (unsigned)routes[i].compid);
+                 (unsigned)channel);
 #endif
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
         if (entry->max_msg_len > pkt_len) {
@@ -231,13 +336,12 @@ void MAVLink_routing::send_to_components(const char *pkt, const mavlink_msg_entr
                           entry->max_msg_len, pkt_len);
         }
 #endif
-        _mav_finalize_message_chan_send(routes[i].channel,
+        _mav_finalize_message_chan_send(channel,
                                         entry->msgid,
                                         pkt,
                                         entry->min_msg_len,
                                         MIN(entry->max_msg_len, pkt_len),
                                         entry->crc_extra);
-        sent_to_chan[routes[i].channel] = true;
     }
 }
 
@@ -248,11 +352,18 @@ void MAVLink_routing::send_to_components(const char *pkt, const mavlink_msg_entr
 bool MAVLink_routing::find_by_mavtype(uint8_t mavtype, uint8_t &sysid, uint8_t &compid, mavlink_channel_t &channel)
 {
     // check learned routes
-    for (uint8_t i=0; i<num_routes; i++) {
-        if (routes[i].mavtype == mavtype) {
-            sysid = routes[i].sysid;
-            compid = routes[i].compid;
-            channel = routes[i].channel;
+    for (uint16_t i=0; i<MAVLINK_ROUTING_TABLE_SIZE; i++) {
+        const route &r = routes[i];
+        if (r.sysid != 0 && r.mavtype == mavtype) {
+            sysid = r.sysid;
+            compid = r.compid;
+            // report the first channel the route was seen on
+            for (uint8_t c=0; c<MAVLINK_COMM_NUM_BUFFERS; c++) {
+                if (r.channel_mask & (1U<<c)) {
+                    channel = (mavlink_channel_t)(MAVLINK_COMM_0 + c);
+                    break;
+                }
+            }
             return true;
         }
     }
@@ -266,7 +377,6 @@ bool MAVLink_routing::find_by_mavtype(uint8_t mavtype, uint8_t &sysid, uint8_t &
 */
 void MAVLink_routing::learn_route(mavlink_channel_t in_channel, const mavlink_message_t &msg)
 {
-    uint8_t i;
     if (msg.sysid == 0) {
         // don't learn routes to the broadcast system
         return;
@@ -283,24 +393,30 @@ void MAVLink_routing::learn_route(mavlink_channel_t in_channel, const mavlink_me
         // should also process them locally.
         return;
     }
-    for (i=0; i<num_routes; i++) {
-        if (routes[i].sysid == msg.sysid &&
-            routes[i].compid == msg.compid &&
-            routes[i].channel == in_channel) {
-            if (routes[i].mavtype == 0 && msg.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
-                routes[i].mavtype = mavlink_msg_heartbeat_get_type(&msg);
-            }
-            break;
+    const uint32_t now_ms = AP_HAL::millis();
+    const uint8_t chan_bit = 1U<<(in_channel-MAVLINK_COMM_0);
+
+    int16_t idx = find_route(msg.sysid, msg.compid);
+    if (idx == -1) {
+        if (num_routes >= MAVLINK_MAX_ROUTES && !remove_stale_route(now_ms)) {
+            routes_dropped++;
+            return;
         }
-    }
-    if (i == num_routes && i<MAVLINK_MAX_ROUTES) {
-        routes[i].sysid = msg.sysid;
-        routes[i].compid = msg.compid;
-        routes[i].channel = in_channel;
-        if (msg.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
-            routes[i].mavtype = mavlink_msg_heartbeat_get_type(&msg);
+        // take the first free slot in the probe run
+        uint16_t slot = route_slot(msg.sysid, msg.compid);
+        while (routes[slot].sysid != 0) {
+            slot = (slot + 1) & (MAVLINK_ROUTING_TABLE_SIZE-1);
         }
+        idx = slot;
+        routes[idx].sysid = msg.sysid;
+        routes[idx].compid = msg.compid;
         num_routes++;
+    }
+
+    route &r = routes[idx];
+    if ((r.channel_mask & chan_bit) == 0) {
+        r.channel_mask |= chan_bit;
+        all_routes_channel_mask |= chan_bit;
 #if ROUTING_DEBUG
         ::printf("learned route %u %u via %u\n",
                  (unsigned)msg.sysid,
@@ -308,6 +424,12 @@ void MAVLink_routing::learn_route(mavlink_channel_t in_channel, const mavlink_me
                  (unsigned)in_channel);
 #endif
     }
+    if (r.mavtype == 0 && msg.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+        r.mavtype = mavlink_msg_heartbeat_get_type(&msg);
+    }
+    r.last_seen_ms = now_ms;
+    r.packets++;
+    r.bytes += msg.len + GCS_MAVLINK::packet_overhead_chan(in_channel);
 }
 
 
@@ -328,10 +450,9 @@ void MAVLink_routing::handle_heartbeat(mavlink_channel_t in_channel, const mavli
     mask &= ~no_route_mask;
     
     // mask out channels that are known sources for this sysid/compid
-    for (uint8_t i=0; i<num_routes; i++) {
-        if (routes[i].sysid == msg.sysid && routes[i].compid == msg.compid) {
-            mask &= ~(1U<<((unsigned)(routes[i].channel-MAVLINK_COMM_0)));
-        }
+    const int16_t idx = find_route(msg.sysid, msg.compid);
+    if (idx != -1) {
+        mask &= ~routes[idx].channel_mask;
     }
 
     if (mask == 0) {
@@ -8,7 +8,26 @@
 
 // 20 routes should be enough for now. This may need to increase as
 // we make more extensive use of MAVLink forwarding
+#ifndef MAVLINK_MAX_ROUTES
 #define MAVLINK_MAX_ROUTES 20
+#endif
+
+/*
+  size of the routing hash table, the smallest power of 2 which is no
+  more than 3/4 full with MAVLINK_MAX_ROUTES routes, so probe runs
+  stay short
+ */
+#define MAVLINK_ROUTING_TABLE_SIZE (MAVLINK_MAX_ROUTES <= 12 ? 16 :  \
+                                    MAVLINK_MAX_ROUTES <= 24 ? 32 :  \
+                                    MAVLINK_MAX_ROUTES <= 48 ? 64 :  \
+                                    MAVLINK_MAX_ROUTES <= 96 ? 128 : 256)
+static_assert(MAVLINK_MAX_ROUTES <= 192, "MAVLINK_MAX_ROUTES too large");
+
+// when the table is full, routes not heard from for this long may be
+// replaced by new ones
+#ifndef MAVLINK_ROUTE_TIMEOUT_MS
+#define MAVLINK_ROUTE_TIMEOUT_MS 30000U
+#endif
 
 /*
   object to handle MAVLink packet routing
@@ -45,16 +64,50 @@ public:
     bool find_by_mavtype(uint8_t mavtype, uint8_t &sysid, uint8_t &compid, mavlink_channel_t &channel);
 
 private:
-    // a simple linear routing table. We don't expect to have a lot of
-    // routes, so a scalable structure isn't worthwhile yet.
-    uint8_t num_routes;
+    friend class MAVLink_routing_Test;
+
+    /*
+      open-addressing hash table of routes keyed on sysid/compid,
+      with linear probing. A route covers every channel the
+      sysid/compid has been seen on.
+     */
+    uint16_t num_routes;
     struct route {
-        uint8_t sysid;
+        uint8_t sysid;          // zero marks an empty slot
         uint8_t compid;
-        mavlink_channel_t channel;
         uint8_t mavtype;
-    } routes[MAVLINK_MAX_ROUTES];
-    
+        uint8_t channel_mask;   // channels this sysid/compid has been seen on
+        uint32_t last_seen_ms;
+        uint32_t packets;       // packets received from this sysid/compid
+        uint32_t bytes;
+    } routes[MAVLINK_ROUTING_TABLE_SIZE];
+
+    // union of channel_mask over all routes
+    uint8_t all_routes_channel_mask;
+
+    // count of routes we could not learn because the table was full
+    uint32_t routes_dropped;
+
+    // home slot for a sysid/compid. The multipliers are odd and
+    // differ, so the components of a system spread over the table
+    static uint16_t route_slot(uint8_t sysid, uint8_t compid) {
+        return (sysid * 37U + compid * 151U) & (MAVLINK_ROUTING_TABLE_SIZE-1);
+    }
+
+    // return index of route for sysid/compid, or -1 if not known
+    int16_t find_route(uint8_t sysid, uint8_t compid) const;
+
+    // remove the route at index idx, closing the gap in its probe run
+    void remove_route(uint16_t idx);
+
+    // remove the least recently seen route if it has timed out
+    bool remove_stale_route(uint32_t now_ms);
+
+    // return the mask of channels a message for sysid/compid should be forwarded on
+    uint8_t forward_channel_mask(int16_t target_system, int16_t target_component,
+                                 bool broadcast_system, bool broadcast_component,
+                                 bool match_system) const;
+
     // a channel mask to block routing as required
     uint8_t no_route_mask;
     
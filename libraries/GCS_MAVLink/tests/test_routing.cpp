@@ -0,0 +1,239 @@
+#include <AP_gtest.h>
+
+#include <GCS_MAVLink/GCS.h>
+#include <GCS_MAVLink/GCS_Dummy.h>
+#include <AP_SerialManager/AP_SerialManager.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+AP_SerialManager _serialmanager;
+GCS_Dummy _gcs;
+
+const AP_Param::GroupInfo GCS_MAVLINK_Parameters::var_info[] = {
+    AP_GROUPEND
+};
+
+class MAVLink_routing_Test
+{
+public:
+    uint16_t num_routes() const { return routing.num_routes; }
+    uint32_t routes_dropped() const { return routing.routes_dropped; }
+
+    bool check_and_forward(mavlink_channel_t chan, const mavlink_message_t &msg) {
+        return routing.check_and_forward(chan, msg);
+    }
+
+    bool get_route(uint8_t sysid, uint8_t compid, uint8_t &channel_mask, uint32_t &packets) const {
+        const int16_t idx = routing.find_route(sysid, compid);
+        if (idx == -1) {
+            return false;
+        }
+        channel_mask = routing.routes[idx].channel_mask;
+        packets = routing.routes[idx].packets;
+        return true;
+    }
+
+    uint8_t forward_mask(uint8_t sysid, uint8_t compid) const {
+        return routing.forward_channel_mask(sysid, compid, false, false, true);
+    }
+
+    bool remove(uint8_t sysid, uint8_t compid) {
+        const int16_t idx = routing.find_route(sysid, compid);
+        if (idx == -1) {
+            return false;
+        }
+        routing.remove_route(idx);
+        return true;
+    }
+
+private:
+    MAVLink_routing routing;
+};
+
+// a message from sysid/compid targetted at us, so it is learnt but
+// never forwarded
+static void encode_for_us(uint8_t sysid, uint8_t compid, mavlink_message_t &msg)
+{
+    mavlink_param_set_t param_set {};
+    param_set.target_system = mavlink_system.sysid;
+    param_set.target_component = mavlink_system.compid;
+    mavlink_msg_param_set_encode(sysid, compid, &msg, &param_set);
+}
+
+static const uint8_t comps_per_system = 2;
+static const uint8_t num_systems = MAVLINK_MAX_ROUTES / comps_per_system;
+static const uint8_t num_channels = 4;
+
+static mavlink_channel_t channel_for(uint8_t sysid)
+{
+    return (mavlink_channel_t)(MAVLINK_COMM_0 + (sysid % num_channels));
+}
+
+TEST(MAVLink_routing, ManyRoutes)
+{
+    MAVLink_routing_Test routing;
+    mavlink_message_t msg;
+
+    const uint32_t rounds = 100;
+    const uint64_t start_us = AP_HAL::micros64();
+    for (uint32_t r=0; r<rounds; r++) {
+        for (uint8_t s=0; s<num_systems; s++) {
+            const uint8_t sysid = 10 + s;
+            for (uint8_t c=1; c<=comps_per_system; c++) {
+                encode_for_us(sysid, c, msg);
+                EXPECT_TRUE(routing.check_and_forward(channel_for(sysid), msg));
+            }
+        }
+    }
+    const uint64_t dt_us = AP_HAL::micros64() - start_us;
+    const uint32_t num_packets = rounds * num_systems * comps_per_system;
+    ::printf("routed %u packets over %u routes in %llu us\n",
+             unsigned(num_packets), unsigned(routing.num_routes()),
+             (unsigned long long)dt_us);
+
+    EXPECT_EQ(num_systems * comps_per_system, routing.num_routes());
+    EXPECT_EQ(0U, routing.routes_dropped());
+
+    for (uint8_t s=0; s<num_systems; s++) {
+        const uint8_t sysid = 10 + s;
+        for (uint8_t c=1; c<=comps_per_system; c++) {
+            uint8_t channel_mask;
+            uint32_t packets;
+            ASSERT_TRUE(routing.get_route(sysid, c, channel_mask, packets));
+            EXPECT_EQ(1U<<(sysid % num_channels), channel_mask);
+            EXPECT_EQ(rounds, packets);
+        }
+    }
+
+    // a system seen on a second channel adds to the existing route
+    encode_for_us(10, 1, msg);
+    routing.check_and_forward(MAVLINK_COMM_3, msg);
+    uint8_t channel_mask;
+    uint32_t packets;
+    ASSERT_TRUE(routing.get_route(10, 1, channel_mask, packets));
+    EXPECT_EQ((1U<<(10 % num_channels)) | (1U<<3), channel_mask);
+    EXPECT_EQ(num_systems * comps_per_system, routing.num_routes());
+}
+
+TEST(MAVLink_routing, RemoveKeepsProbeRuns)
+{
+    MAVLink_routing_Test routing;
+    mavlink_message_t msg;
+
+    // a full table, so some routes are away from their home slots
+    const uint8_t num_comps = MAVLINK_MAX_ROUTES;
+    for (uint8_t c=1; c<=num_comps; c++) {
+        encode_for_us(42, c, msg);
+        routing.check_and_forward(MAVLINK_COMM_0, msg);
+    }
+    EXPECT_EQ(num_comps, routing.num_routes());
+
+    // removing from the middle of a probe run must not hide later entries
+    uint8_t removed = 0;
+    for (uint8_t c=1; c<=num_comps; c+=3) {
+        EXPECT_TRUE(routing.remove(42, c));
+        removed++;
+    }
+    EXPECT_EQ(num_comps - removed, routing.num_routes());
+    for (uint8_t c=1; c<=num_comps; c++) {
+        uint8_t channel_mask;
+        uint32_t packets;
+        EXPECT_EQ((c % 3) != 1, routing.get_route(42, c, channel_mask, packets));
+    }
+}
+
+TEST(MAVLink_routing, TableFull)
+{
+    MAVLink_routing_Test routing;
+    mavlink_message_t msg;
+
+    // fill the table with fresh routes; further routes are dropped
+    // as none have timed out
+    for (uint16_t i=0; i<MAVLINK_MAX_ROUTES+10; i++) {
+        encode_for_us(100 + (i / 4), 1 + (i % 4), msg);
+        routing.check_and_forward(MAVLINK_COMM_1, msg);
+    }
+    EXPECT_EQ(unsigned(MAVLINK_MAX_ROUTES), unsigned(routing.num_routes()));
+    EXPECT_EQ(10U, routing.routes_dropped());
+}
+
+/*
+  the linear routing table used before the hash table, with one entry
+  per sysid/compid and channel, for comparing the cost of forwarding a
+  message to one component
+ */
+class LinearRoutes
+{
+public:
+    void add(uint8_t sysid, uint8_t compid, uint8_t channel) {
+        if (num_routes < ARRAY_SIZE(routes)) {
+            routes[num_routes++] = {sysid, compid, channel};
+        }
+    }
+
+    uint8_t forward_mask(uint8_t sysid, uint8_t compid) const {
+        uint8_t mask = 0;
+        for (uint8_t i=0; i<num_routes; i++) {
+            if (routes[i].sysid == sysid && routes[i].compid == compid) {
+                mask |= 1U<<routes[i].channel;
+            }
+        }
+        return mask;
+    }
+
+private:
+    struct {
+        uint8_t sysid;
+        uint8_t compid;
+        uint8_t channel;
+    } routes[MAVLINK_MAX_ROUTES];
+    uint8_t num_routes;
+};
+
+TEST(MAVLink_routing, RoutingCost)
+{
+    MAVLink_routing_Test routing;
+    LinearRoutes linear {};
+    mavlink_message_t msg;
+
+    for (uint8_t s=0; s<num_systems; s++) {
+        const uint8_t sysid = 10 + s;
+        for (uint8_t c=1; c<=comps_per_system; c++) {
+            encode_for_us(sysid, c, msg);
+            routing.check_and_forward(channel_for(sysid), msg);
+            linear.add(sysid, c, channel_for(sysid) - MAVLINK_COMM_0);
+        }
+    }
+
+    // look up every route, and a system we have not seen
+    const uint32_t rounds = 10000;
+    uint32_t hash_sum = 0;
+    uint32_t linear_sum = 0;
+    uint64_t start_us = AP_HAL::micros64();
+    for (uint32_t r=0; r<rounds; r++) {
+        for (uint8_t s=0; s<=num_systems; s++) {
+            for (uint8_t c=1; c<=comps_per_system; c++) {
+                hash_sum += routing.forward_mask(10 + s, c);
+            }
+        }
+    }
+    const uint64_t hash_us = AP_HAL::micros64() - start_us;
+    start_us = AP_HAL::micros64();
+    for (uint32_t r=0; r<rounds; r++) {
+        for (uint8_t s=0; s<=num_systems; s++) {
+            for (uint8_t c=1; c<=comps_per_system; c++) {
+                linear_sum += linear.forward_mask(10 + s, c);
+            }
+        }
+    }
+    const uint64_t linear_us = AP_HAL::micros64() - start_us;
+
+    EXPECT_EQ(linear_sum, hash_sum);
+    ::printf("%u lookups over %u routes: hash table %llu us, linear table %llu us\n",
+             unsigned(rounds * (num_systems + 1) * comps_per_system),
+             unsigned(routing.num_routes()),
+             (unsigned long long)hash_us,
+             (unsigned long long)linear_us);
+}
+
+AP_GTEST_MAIN()
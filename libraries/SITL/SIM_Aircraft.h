@@ -52,6 +52,11 @@ public:
     void set_speedup(float speedup);
     float get_speedup() { return target_speedup; }
 
+    /*
+      run as fast as possible rather than syncing to the wall clock
+     */
+    void set_max_speed(void) { use_time_sync = false; }
+
     /*
       set instance number
      */